@@ -203,6 +203,7 @@ if test "$PHP_SWOOLE" != "no"; then
     AC_CHECK_LIB(pcre, pcre_compile, AC_DEFINE(HAVE_PCRE, 1, [have pcre]))
     AC_CHECK_LIB(hiredis, redisConnect, AC_DEFINE(HAVE_HIREDIS, 1, [have hiredis]))
     AC_CHECK_LIB(nghttp2, nghttp2_hd_inflate_new, AC_DEFINE(HAVE_NGHTTP2, 1, [have nghttp2]))
+    AC_CHECK_HEADER(linux/io_uring.h, AC_DEFINE(HAVE_IO_URING, 1, [have io_uring]))
 
     AC_CHECK_LIB(z, gzgets, [
         AC_DEFINE(SW_HAVE_ZLIB, 1, [have zlib])
@@ -267,20 +268,24 @@ if test "$PHP_SWOOLE" != "no"; then
         swoole_http_client.c \
         swoole_mysql.c \
         swoole_redis.c \
+        swoole_connpool.c \
         src/core/base.c \
         src/core/log.c \
         src/core/hashmap.c \
         src/core/RingQueue.c \
         src/core/Channel.c \
+        src/core/ShmRing.c \
         src/core/string.c \
         src/core/array.c \
         src/core/socket.c \
         src/core/list.c \
         src/core/heap.c \
+        src/core/histogram.c \
         src/memory/ShareMemory.c \
         src/memory/MemoryGlobal.c \
         src/memory/RingBuffer.c \
         src/memory/FixedPool.c \
+        src/memory/Arena.c \
         src/memory/Malloc.c \
         src/memory/Table.c \
         src/memory/Buffer.c \
@@ -304,6 +309,7 @@ if test "$PHP_SWOOLE" != "no"; then
         src/network/TaskWorker.c \
         src/network/Client.c \
         src/network/Connection.c \
+        src/network/Heartbeat.c \
         src/network/ProcessPool.c \
         src/network/ThreadPool.c \
         src/network/ReactorThread.c \
@@ -312,8 +318,10 @@ if test "$PHP_SWOOLE" != "no"; then
         src/network/Worker.c \
         src/network/Timer.c \
         src/network/Port.c \
+        src/network/Stats.c \
         src/os/base.c \
         src/os/linux_aio.c \
+        src/os/uring_aio.c \
         src/os/gcc_aio.c \
         src/os/msg_queue.c \
         src/os/sendfile.c \
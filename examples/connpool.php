@@ -0,0 +1,57 @@
+<?php
+$serv = new swoole_http_server("127.0.0.1", 9501);
+$serv->set(array('worker_num' => 4));
+
+$serv->on('WorkerStart', function ($serv, $worker_id) {
+    //one pool per worker, min connections are kept by the health check
+    $serv->mysql = new swoole_connpool(SWOOLE_CONNPOOL_MYSQL, array(
+        'host' => '127.0.0.1',
+        'user' => 'root',
+        'password' => 'root',
+        'database' => 'test',
+        'min' => 2,
+        'max' => 16,
+        'wait_timeout' => 0.5,
+        'idle_timeout' => 60,
+        'check_interval' => 5,
+    ));
+    $serv->redis = new swoole_connpool(SWOOLE_CONNPOOL_REDIS, array(
+        'host' => '127.0.0.1',
+        'port' => 6379,
+        'max' => 8,
+    ));
+});
+
+$serv->on('Request', function ($request, $response) use ($serv) {
+    if ($request->server['request_uri'] == '/stats')
+    {
+        $response->end(json_encode(array('mysql' => $serv->mysql->getStats(), 'redis' => $serv->redis->getStats())));
+        return;
+    }
+    $serv->redis->get(function (swoole_connpool $pool, $redis) use ($serv, $response) {
+        //timeout or failed to connect
+        if ($redis === false)
+        {
+            $response->status(503);
+            $response->end("redis is busy\n");
+            return;
+        }
+        $redis->incr('hits', function ($redis, $hits) use ($pool, $serv, $response) {
+            $pool->release($redis);
+            $serv->mysql->get(function (swoole_connpool $pool, $db) use ($hits, $response) {
+                if ($db === false)
+                {
+                    $response->status(503);
+                    $response->end("mysql is busy\n");
+                    return;
+                }
+                $db->query("SELECT NOW() AS now", function ($db, $r) use ($pool, $hits, $response) {
+                    $pool->release($db);
+                    $response->end("hits: $hits, now: {$r[0]['now']}\n");
+                });
+            });
+        });
+    });
+});
+
+$serv->start();
@@ -0,0 +1,30 @@
+<?php
+$db = new swoole_mysql('127.0.0.1', 'root', 'root', 'test');
+
+//the queries are sent at once, the callbacks are called in order
+for ($i = 0; $i < 10; $i++)
+{
+    $db->query("SELECT $i AS n", function (swoole_mysql $db, $r) {
+        var_dump($r);
+    });
+}
+
+//prepared once and cached in the connection, the rows are decoded in binary protocol
+for ($i = 1; $i <= 10; $i++)
+{
+    $db->execute("SELECT * FROM userinfo WHERE id = ?", array($i), function (swoole_mysql $db, $r) {
+        if ($r === false)
+        {
+            var_dump($db->error, $db->errno);
+        }
+        else
+        {
+            var_dump($r);
+        }
+    });
+}
+
+$db->execute("INSERT INTO userinfo (name, passwd) VALUES (?, ?)", array('jack', 'xuyou'), function (swoole_mysql $db, $r) {
+    var_dump($r, $db->affected_rows, $db->insert_id);
+    $db->close();
+});
@@ -0,0 +1,26 @@
+<?php
+$serv = new swoole_server("0.0.0.0", 9501);
+$serv->set(array(
+    'worker_num' => 4,
+    'dispatch_mode' => 6,   //least load dispatch
+));
+
+$serv->on('workerStart', function ($serv, $worker_id) {
+    echo "{$worker_id} start" . PHP_EOL;
+});
+
+$serv->on('receive', function (swoole_server $serv, $fd, $from_id, $data) {
+    //mixed fast and slow requests
+    if (trim($data) == 'slow')
+    {
+        usleep(200000);
+    }
+    elseif (trim($data) == 'stats')
+    {
+        $serv->send($fd, var_export($serv->stats(), true) . PHP_EOL);
+        return;
+    }
+    $serv->send($fd, "worker#{$serv->worker_id}: " . $data);
+});
+
+$serv->start();
@@ -0,0 +1,30 @@
+<?php
+$serv = new swoole_server("127.0.0.1", 9501);
+$serv->set(array(
+    'worker_num' => 4,
+    'task_worker_num' => 2,
+    //curl http://127.0.0.1:9100/metrics
+    'stats_port' => 9100,
+    'stats_host' => '127.0.0.1',
+));
+
+$serv->on('Receive', function (swoole_server $serv, $fd, $from_id, $data) {
+    if (trim($data) == 'stats')
+    {
+        //the latency of every worker in usec: count, avg, p50, p90, p99, p999, max
+        $serv->send($fd, var_export($serv->stats(), true) . "\n");
+        return;
+    }
+    $result = $serv->taskwait($data, 0.5);
+    $serv->send($fd, "Server: $result\n");
+});
+
+$serv->on('Task', function (swoole_server $serv, $task_id, $from_id, $data) {
+    usleep(1000);
+    return strtoupper($data);
+});
+
+$serv->on('Finish', function (swoole_server $serv, $task_id, $data) {
+});
+
+$serv->start();
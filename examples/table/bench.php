@@ -0,0 +1,66 @@
+<?php
+/**
+ * Read-heavy throughput of swoole_table across worker counts.
+ * usage: php bench.php [seconds] [write_percent]
+ */
+$seconds = isset($argv[1]) ? intval($argv[1]) : 2;
+$write_percent = isset($argv[2]) ? intval($argv[2]) : 1;
+
+$table = new swoole_table(1024);
+$table->column('id', swoole_table::TYPE_INT, 8);
+$table->column('name', swoole_table::TYPE_STRING, 32);
+$table->create();
+
+for ($i = 0; $i < 1000; $i++)
+{
+    $table->set("key_$i", array('id' => $i, 'name' => "name_$i"));
+}
+//the hot counter row which every worker hits
+$table->set('hot', array('id' => 0, 'name' => 'hot'));
+
+//result of each worker
+$result = new swoole_table(64);
+$result->column('ops', swoole_table::TYPE_INT, 8);
+$result->create();
+
+foreach (array(1, 2, 4, 8, 16, 32) as $worker_num)
+{
+    for ($i = 0; $i < $worker_num; $i++)
+    {
+        $process = new swoole_process(function ($worker) use ($table, $result, $seconds, $write_percent, $i)
+        {
+            $ops = 0;
+            $end = microtime(true) + $seconds;
+            while (microtime(true) < $end)
+            {
+                for ($j = 0; $j < 1000; $j++)
+                {
+                    if ($j % 100 < $write_percent)
+                    {
+                        $table->set('hot', array('id' => $j));
+                    }
+                    else
+                    {
+                        $table->get($j % 2 ? 'hot' : 'key_' . $j);
+                    }
+                }
+                $ops += 1000;
+            }
+            $result->set("worker_$i", array('ops' => $ops));
+        }, false, false);
+        $process->start();
+    }
+    for ($i = 0; $i < $worker_num; $i++)
+    {
+        swoole_process::wait();
+    }
+
+    $total = 0;
+    for ($i = 0; $i < $worker_num; $i++)
+    {
+        $row = $result->get("worker_$i");
+        $total += $row['ops'];
+        $result->del("worker_$i");
+    }
+    printf("workers=%-3d ops=%-12d ops/s=%d\n", $worker_num, $total, $total / $seconds);
+}
@@ -58,6 +58,8 @@ enum swEventType
     //proxy
     SW_EVENT_PROXY_START     = 16,
     SW_EVENT_PROXY_END       = 17,
+    //worker -> reactor, one message for many sessions
+    SW_EVENT_BROADCAST       = 18,
 };
 
 enum swIPCMode
@@ -65,6 +67,7 @@ enum swIPCMode
 	SW_IPC_UNSOCK   = 1,
 	SW_IPC_MSGQUEUE = 2,
 	SW_IPC_CHANNEL  = 3,
+	SW_IPC_RING     = 4,
 };
 
 enum swTaskIPCMode
@@ -102,6 +105,7 @@ enum swTaskType
     SW_TASK_SERIALIZE  = 2,  //php serialize
     SW_TASK_NONBLOCK   = 4,  //task
     SW_TASK_CALLBACK   = 8,  //callback
+    SW_TASK_SHM        = 16, //task arena
 };
 
 typedef struct _swUdpFd
@@ -110,6 +114,26 @@ typedef struct _swUdpFd
     int sock;
 } swUdpFd;
 
+/**
+ * idle connections of a reactor, a timing wheel with one slot per second.
+ * The connection is linked by fd in the slot of the second it may expire in,
+ * receiving data only updates conn->last_time, the connection is moved when its slot is checked.
+ */
+typedef struct _swHeartbeat
+{
+    uint32_t size;
+    uint32_t mask;
+    uint32_t num;
+    uint16_t idle_time;
+    /**
+     * the new connections are added by the master thread
+     */
+    sw_atomic_t lock;
+    time_t current;
+    swConnection *connection_list;
+    int *slots;
+} swHeartbeat;
+
 typedef struct _swReactorThread
 {
     pthread_t thread_id;
@@ -119,6 +143,19 @@ typedef struct _swReactorThread
 #ifdef SW_USE_RINGBUFFER
     int *pipe_read_list;
 #endif
+    /**
+     * ipc_mode = SW_IPC_RING, requests parked while the worker ring is full
+     */
+    swBuffer **ring_buffer;
+    swHeartbeat heartbeat;
+    /**
+     * out_buffer trunks released by this thread, hit/miss are read by stats()
+     */
+    swBuffer_pool buffer_pool;
+    /**
+     * out_buffer overflow events, read by stats()
+     */
+    sw_atomic_t overflow_count;
     swLock lock;
     int c_udp_fd;
 } swReactorThread;
@@ -150,6 +187,10 @@ typedef struct _swListenPort
     uint8_t ssl;
     int port;
     int sock;
+    /**
+     * reactor_accept: the SO_REUSEPORT socket of every reactor thread, reuse_sock[0] is sock
+     */
+    int *reuse_sock;
     pthread_t thread_id;
     char host[SW_HOST_MAXSIZE];
 
@@ -308,6 +349,11 @@ struct _swServer
      */
     uint8_t dispatch_mode; //分配模式，1平均分配，2按FD取摸固定分配，3,使用抢占式队列(IPC消息队列)分配
 
+    /**
+     * reactor <-> worker transport, SW_IPC_UNSOCK or SW_IPC_RING
+     */
+    uint8_t ipc_mode;
+
     int worker_uid;
     int worker_groupid;
 
@@ -370,6 +416,10 @@ struct _swServer
      * parse x-www-form-urlencoded data
      */
     uint32_t http_parse_post :1;
+    /**
+     * http server: ship the header index built by the reactor with the request
+     */
+    uint32_t http_header_index :1;
     /**
      * enable onConnect/onClose event when use dispatch_mode=1/3
      */
@@ -382,6 +432,14 @@ struct _swServer
      * run as a daemon process
      */
     uint32_t reload_async :1;
+    /**
+     * every reactor thread accepts on its own SO_REUSEPORT socket
+     */
+    uint32_t reactor_accept :1;
+    /**
+     * reactor_accept: select the socket by the cpu which received the SYN
+     */
+    uint32_t reactor_accept_cbpf :1;
 
     /* heartbeat check time*/
     uint16_t heartbeat_idle_time; //心跳存活时间
@@ -399,6 +457,26 @@ struct _swServer
 
     uint32_t pipe_buffer_size;
 
+    /**
+     * ipc_mode = SW_IPC_RING: reactor_num * worker_num request rings, then worker_num * reactor_num response rings.
+     * doorbells: [0, worker_num) for workers, [worker_num, worker_num + reactor_num) for reactor threads.
+     */
+    uint32_t ipc_ring_size;
+    void *ipc_rings;
+    sw_atomic_t *ipc_ring_signaled;
+    swPipe *ipc_ring_notify;
+
+    /**
+     * stats in Prometheus text on a dedicated port, served by the master thread. 0: disabled
+     */
+    char *stats_host;
+    uint16_t stats_port;
+    int stats_fd;
+    /**
+     * event workers and task workers, see swServer_get_worker_stats
+     */
+    struct _swWorkerStats *worker_stats;
+
     void *ptr2;
 
     swReactor reactor;
@@ -420,6 +498,7 @@ struct _swServer
 
     swConnection *connection_list;
     swSession *session_list;
+    struct _swSessionQueue *session_queue;
 
     /**
      * message queue key
@@ -470,6 +549,10 @@ typedef struct _swPackage
 typedef struct
 {
     int length;
+    /**
+     * SW_TASK_SHM, offset in SwooleG.task_arena
+     */
+    uint32_t offset;
     char tmpfile[SW_TASK_TMPDIR_SIZE + sizeof(SW_TASK_TMP_FILE)];
 } swPackage_task;
 
@@ -477,12 +560,94 @@ typedef struct
 {
 	int length;
 	int worker_id;
+	uint32_t num;
+	/**
+	 * index of the chunks in worker->send_shm
+	 */
+	uint32_t chunk_id[0];
 } swPackage_response;
 
+enum swResponse_chunk_state
+{
+    SW_RESPONSE_CHUNK_FREE = 0,
+    /**
+     * being written by the worker, reclaimed if the worker dies
+     */
+    SW_RESPONSE_CHUNK_FILLING,
+    /**
+     * referenced by a message to the reactor thread
+     */
+    SW_RESPONSE_CHUNK_SENT,
+};
+
+/**
+ * written by the worker, released by the reactor thread after it is sent
+ */
+typedef struct
+{
+    sw_atomic_t used;
+    /**
+     * broadcast, held by the worker, the messages and the out_buffer trunks, released at 0
+     */
+    sw_atomic_t refcount;
+    uint32_t worker_id;
+    uint32_t length;
+    char data[SW_WORKER_SEND_CHUNK_SIZE];
+} swResponse_chunk;
+
+/**
+ * written by the worker itself without lock, read by stats() in any process
+ */
+typedef struct _swWorkerStats
+{
+    /**
+     * usec of onReceive/onPacket, onTask in the task worker
+     */
+    swHistogram request_latency;
+    /**
+     * usec blocked in taskwait()
+     */
+    swHistogram task_wait;
+    /**
+     * bytes parked in the pipe buffer of the reactor thread, the worker is busy
+     */
+    sw_atomic_t pipe_buffer_length;
+} swWorkerStats;
+
+#define swServer_get_worker_stats(serv, worker_id)   (&(serv)->worker_stats[worker_id])
+
+/**
+ * [Worker] the request started at start_usec is finished
+ */
+static sw_inline void swWorker_record_latency(swServer *serv, uint64_t start_usec)
+{
+    if (serv->worker_stats)
+    {
+        swHistogram_record(&swServer_get_worker_stats(serv, SwooleWG.id)->request_latency, swoole_monotonic_usec() - start_usec);
+    }
+}
+
+/**
+ * SW_EVENT_BROADCAST, followed by the data, or by a swPackage_response when it is shared
+ */
+typedef struct
+{
+    uint32_t num;
+    /**
+     * 1: the data is in the chunks of the worker, every reactor thread only gets the reference
+     */
+    uint32_t shared;
+    uint32_t session_id[0];
+} swPackage_broadcast;
+
 int swServer_master_onAccept(swReactor *reactor, swEvent *event);
 int swServer_onFinish(swFactory *factory, swSendData *resp);
 int swServer_onFinish2(swFactory *factory, swSendData *resp);
 
+int swServer_stats_listen(swServer *serv);
+int swServer_stats_add(swServer *serv, swReactor *reactor);
+int swServer_stats_format(swServer *serv, swString *buffer);
+
 void swServer_init(swServer *serv);
 void swServer_signal_init(void);
 int swServer_start(swServer *serv);
@@ -527,8 +692,30 @@ static sw_inline swListenPort* swServer_get_port(swServer *serv, int fd)
 
 int swServer_udp_send(swServer *serv, swSendData *resp);
 int swServer_tcp_send(swServer *serv, int fd, void *data, uint32_t length);
+int swServer_tcp_sendv(swServer *serv, int fd, struct iovec *iov, int iovcnt);
 int swServer_tcp_sendwait(swServer *serv, int fd, void *data, uint32_t length);
 int swServer_tcp_sendfile(swServer *serv, int fd, char *filename, uint32_t len);
+int swServer_broadcast(swServer *serv, uint32_t *session_list, uint32_t num, void *data, uint32_t length);
+
+/**
+ * lock-free MPMC queue of the free session slots, in FIFO order so that a slot is reused as late as possible
+ */
+typedef struct _swSessionQueue
+{
+    volatile uint32_t head;
+    char _pad0[SW_CACHELINE_SIZE - sizeof(uint32_t)];
+    volatile uint32_t tail;
+    char _pad1[SW_CACHELINE_SIZE - sizeof(uint32_t)];
+    struct
+    {
+        uint32_t sequence;
+        uint32_t slot;
+    } cells[SW_SESSION_LIST_SIZE];
+} swSessionQueue;
+
+int swServer_session_init(swServer *serv);
+uint32_t swServer_session_alloc(swServer *serv, int fd, int reactor_id);
+void swServer_session_free(swServer *serv, uint32_t session_id);
 
 //UDP, UDP必然超过0x1000000
 //原因：IPv4的第4字节最小为1,而这里的conn_fd是网络字节序
@@ -586,9 +773,11 @@ int swTaskWorker_onFinish(swReactor *reactor, swEvent *event);
 void swTaskWorker_onStart(swProcessPool *pool, int worker_id);
 void swTaskWorker_onStop(swProcessPool *pool, int worker_id);
 int swTaskWorker_large_pack(swEventData *task, void *data, int data_len);
+void swTaskWorker_large_free(swEventData *task);
 int swTaskWorker_finish(swServer *serv, char *data, int data_len, int flags);
 
 #define swTask_type(task)                  ((task)->info.from_fd)
+#define swTask_is_large(task)              (swTask_type(task) & (SW_TASK_TMPFILE | SW_TASK_SHM))
 
 #define swTaskWorker_large_unpack(task, __malloc, _buf, _length)   swPackage_task _pkg;\
 	memcpy(&_pkg, task->data, sizeof(_pkg));\
@@ -598,8 +787,11 @@ int swTaskWorker_finish(swServer *serv, char *data, int data_len, int flags);
     }\
     _buf = __malloc(_length + 1);\
     _buf[_length] = 0;\
-    int tmp_file_fd = open(_pkg.tmpfile, O_RDONLY);\
-    if (tmp_file_fd < 0){\
+    int tmp_file_fd = -1;\
+    if (swTask_type(task) & SW_TASK_SHM) {\
+        memcpy(_buf, swArena_get(SwooleG.task_arena, _pkg.offset), _length);\
+        swArena_free(SwooleG.task_arena, _pkg.offset);\
+    } else if ((tmp_file_fd = open(_pkg.tmpfile, O_RDONLY)) < 0){\
         swSysError("open(%s) failed.", task->data);\
         _length = -1;\
     } else if (swoole_sync_readfile(tmp_file_fd, _buf, _length) > 0) {\
@@ -624,6 +816,8 @@ int swTaskWorker_finish(swServer *serv, char *data, int data_len, int flags);
 #define swServer_get_minfd(serv) (serv->connection_list[SW_SERVER_MIN_FD_INDEX].fd)
 
 #define swServer_get_thread(serv, reactor_id)    (&(serv->reactor_threads[reactor_id]))
+//SWOOLE_BASE: every worker process has only one reactor
+#define swServer_get_heartbeat(serv, reactor_id) (&(serv->reactor_threads[serv->factory_mode == SW_MODE_SINGLE ? 0 : reactor_id].heartbeat))
 
 static sw_inline swConnection* swServer_connection_get(swServer *serv, int fd)
 {
@@ -674,6 +868,26 @@ static sw_inline swWorker* swServer_get_worker(swServer *serv, uint16_t worker_i
     return NULL;
 }
 
+static sw_inline swShmRing* swServer_get_ring(swServer *serv, int index)
+{
+    return (swShmRing *) ((char *) serv->ipc_rings + index * swShmRing_memory_size(serv->ipc_ring_size));
+}
+
+#define swServer_request_ring(serv, reactor_id, worker_id)   swServer_get_ring(serv, (reactor_id) * (serv)->worker_num + (worker_id))
+#define swServer_response_ring(serv, worker_id, reactor_id)  swServer_get_ring(serv, (serv)->reactor_num * ((serv)->worker_num + (worker_id)) + (reactor_id))
+
+/**
+ * ring the doorbell once, the consumer clears the flag before it drains the rings.
+ */
+static sw_inline void swServer_ring_notify(swServer *serv, int index)
+{
+    if (sw_atomic_cmp_set(&serv->ipc_ring_signaled[index], 0, 1))
+    {
+        uint64_t flag = 1;
+        serv->ipc_ring_notify[index].write(&serv->ipc_ring_notify[index], &flag, sizeof(flag));
+    }
+}
+
 static sw_inline uint32_t swServer_worker_schedule(swServer *serv, uint32_t schedule_key)
 {
     uint32_t target_worker_id = 0;
@@ -729,6 +943,27 @@ static sw_inline uint32_t swServer_worker_schedule(swServer *serv, uint32_t sche
             target_worker_id = schedule_key % serv->worker_num;
         }
     }
+    //Least in-flight requests
+    else if (serv->dispatch_mode == SW_DISPATCH_LEAST_LOAD)
+    {
+        int i;
+        uint32_t start = sw_atomic_fetch_add(&serv->worker_round_id, 1);
+        int32_t load, min_load = INT32_MAX;
+        for (i = 0; i < serv->worker_num; i++)
+        {
+            uint32_t worker_id = (start + i) % serv->worker_num;
+            load = (int32_t) serv->workers[worker_id].dispatch_count;
+            if (load < min_load)
+            {
+                min_load = load;
+                target_worker_id = worker_id;
+                if (load <= 0)
+                {
+                    break;
+                }
+            }
+        }
+    }
     //Preemptive distribution
     else
     {
@@ -764,6 +999,8 @@ static sw_inline swConnection *swWorker_get_connection(swServer *serv, int sessi
     return conn;
 }
 
+#define swWorker_get_chunk(worker, chunk_id)   (((swResponse_chunk *) (worker)->send_shm) + (chunk_id))
+
 static sw_inline swString *swWorker_get_buffer(swServer *serv, int worker_id)
 {
     //input buffer
@@ -817,16 +1054,29 @@ void swPort_init(swListenPort *port);
 void swPort_free(swListenPort *port);
 void swPort_set_protocol(swListenPort *ls);
 int swPort_set_option(swListenPort *ls);
+int swPort_create_reuseport(swListenPort *ls, int num, int cbpf);
 
 void swWorker_free(swWorker *worker);
 void swWorker_onStart(swServer *serv);
 void swWorker_onStop(swServer *serv);
 int swWorker_loop(swFactory *factory, int worker_pti);
 int swWorker_send2reactor(swEventData *ev_data, size_t sendn, int fd);
+int swWorker_send2reactor_ring(swDataHead *info, char *data, uint32_t length);
 int swWorker_send2worker(swWorker *dst_worker, void *buf, int n, int flag);
+swResponse_chunk* swWorker_alloc_chunk(swWorker *worker);
+int swWorker_fill_chunks(swWorker *worker, swPackage_response *response, char *data, uint32_t length);
+void swWorker_release_chunk(swResponse_chunk *chunk);
+void swWorker_unref_chunk(swResponse_chunk *chunk);
+int swWorker_reclaim_chunks(swWorker *worker);
 void swWorker_signal_handler(int signo);
 void swWorker_clean(void);
 
+int swHeartbeat_create(swHeartbeat *hb, swConnection *connection_list, uint16_t idle_time, time_t now);
+void swHeartbeat_free(swHeartbeat *hb);
+void swHeartbeat_add(swHeartbeat *hb, swConnection *conn);
+void swHeartbeat_del(swHeartbeat *hb, swConnection *conn);
+int swHeartbeat_check(swHeartbeat *hb, time_t now, void (*onExpire)(swHeartbeat *hb, swConnection *conn, void *arg), void *arg);
+
 int swReactorThread_create(swServer *serv);
 int swReactorThread_start(swServer *serv, swReactor *main_reactor_ptr);
 void swReactorThread_set_protocol(swServer *serv, swReactor *reactor);
@@ -26,6 +26,7 @@ enum swAioMode
     SW_AIO_BASE = 0,
     SW_AIO_GCC,
     SW_AIO_LINUX,
+    SW_AIO_URING,
 };
 
 enum
@@ -80,4 +81,10 @@ int swAioGcc_init(int max_aio_events);
 int swAioLinux_init(int max_aio_events);
 #endif
 
+#ifdef HAVE_IO_URING
+int swAioUring_init(int max_aio_events);
+void* swAioUring_malloc(size_t size);
+void swAioUring_free(void *ptr);
+#endif
+
 #endif /* _SW_ASYNC_H_ */
@@ -27,6 +27,10 @@ enum swBufferChunk
     SW_CHUNK_DATA,
     SW_CHUNK_SENDFILE,
     SW_CHUNK_CLOSE,
+    /**
+     * data owned by a swBuffer_shared, sent like SW_CHUNK_DATA
+     */
+    SW_CHUNK_SHARED,
 };
 
 typedef struct _swBuffer_trunk
@@ -44,10 +48,43 @@ typedef struct _swBuffer_trunk
         } data;
     } store;
     uint32_t size;
+    /**
+     * size class of swBuffer_pool, SW_BUFFER_POOL_CLASS_NUM: exact size, never cached
+     */
+    uint32_t pool_class;
     void (*destroy)(struct _swBuffer_trunk *chunk);
     struct _swBuffer_trunk *next;
+    /**
+     * SW_CHUNK_DATA payload, allocated together with the trunk
+     */
+    char data[0];
 } swBuffer_trunk;
 
+#define SW_BUFFER_POOL_CLASS_NUM     6
+
+/**
+ * free trunks of every size class, one pool per thread, no lock.
+ * A trunk can be released by another thread, it is cached by the pool of that thread.
+ */
+typedef struct _swBuffer_pool
+{
+    swBuffer_trunk *free_list[SW_BUFFER_POOL_CLASS_NUM];
+    uint32_t free_num[SW_BUFFER_POOL_CLASS_NUM];
+    uint64_t hit;
+    uint64_t miss;
+} swBuffer_pool;
+
+/**
+ * one copy of the data referenced by the out_buffer of many connections,
+ * only used by the thread which created it, so the refcount is not atomic.
+ */
+typedef struct _swBuffer_shared
+{
+    uint32_t refcount;
+    uint32_t length;
+    char data[0];
+} swBuffer_shared;
+
 typedef struct _swBuffer
 {
     int fd;
@@ -66,6 +103,12 @@ swBuffer_trunk *swBuffer_new_trunk(swBuffer *buffer, uint32_t type, uint32_t siz
 void swBuffer_pop_trunk(swBuffer *buffer, swBuffer_trunk *trunk);
 int swBuffer_append(swBuffer *buffer, void *data, uint32_t size);
 
+swBuffer_shared* swBuffer_shared_new(void *data, uint32_t length);
+void swBuffer_shared_release(swBuffer_shared *shared);
+int swBuffer_append_shared(swBuffer *buffer, swBuffer_shared *shared, uint32_t offset);
+
+void swBuffer_pool_free(swBuffer_pool *pool);
+
 void swBuffer_debug(swBuffer *buffer, int print_data);
 int swBuffer_free(swBuffer *buffer);
 
@@ -0,0 +1,45 @@
+/*
+ +----------------------------------------------------------------------+
+ | Swoole                                                               |
+ +----------------------------------------------------------------------+
+ | This source file is subject to version 2.0 of the Apache license,    |
+ | that is bundled with this package in the file LICENSE, and is        |
+ | available through the world-wide-web at the following url:           |
+ | http://www.apache.org/licenses/LICENSE-2.0.html                      |
+ | If you did not receive a copy of the Apache2.0 license and are unable|
+ | to obtain it through the world-wide-web, please send a note to       |
+ | license@swoole.com so we can mail you a copy immediately.            |
+ +----------------------------------------------------------------------+
+ | Author: Tianfeng Han  <mikan.tenny@gmail.com>                        |
+ +----------------------------------------------------------------------+
+ */
+
+#ifndef SW_HISTOGRAM_H_
+#define SW_HISTOGRAM_H_
+
+/**
+ * log-linear buckets like HdrHistogram, 2^SW_HISTOGRAM_SUB_BITS buckets for every power of 2,
+ * values >= 2^SW_HISTOGRAM_MAX_BITS are counted by the last bucket.
+ */
+#define SW_HISTOGRAM_SUB_BITS      3
+#define SW_HISTOGRAM_SUB_NUM       (1 << SW_HISTOGRAM_SUB_BITS)
+#define SW_HISTOGRAM_MAX_BITS      32
+#define SW_HISTOGRAM_BUCKET_NUM    ((SW_HISTOGRAM_MAX_BITS - SW_HISTOGRAM_SUB_BITS + 1) * SW_HISTOGRAM_SUB_NUM)
+
+/**
+ * one writer without lock, the readers in other processes may see a sample being recorded.
+ */
+typedef struct _swHistogram
+{
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t buckets[SW_HISTOGRAM_BUCKET_NUM];
+} swHistogram;
+
+void swHistogram_record(swHistogram *hist, uint64_t value);
+uint64_t swHistogram_percentile(swHistogram *hist, double percentile);
+uint32_t swHistogram_bucket_index(uint64_t value);
+uint64_t swHistogram_bucket_max(uint32_t index);
+
+#endif /* SW_HISTOGRAM_H_ */
@@ -46,6 +46,53 @@ enum swHttpVersion
     HTTP_VERSION_11,
 };
 
+typedef struct _swHttpIndex_header
+{
+    uint16_t name_offset;
+    uint16_t name_length;
+    uint16_t value_offset;
+    uint16_t value_length;
+} swHttpIndex_header;
+
+/**
+ * header index built by the reactor, shipped to the worker after the request:
+ * [request][swHttpIndex][swHttpIndex_header * header_num][uint32_t request length]
+ * The offsets are relative to the beginning of the request.
+ */
+typedef struct _swHttpIndex
+{
+    /**
+     * swHttpMethod, 0 if the request is not indexed, the worker must parse it
+     */
+    uint8_t method;
+    uint8_t version;
+    uint8_t keepalive;
+    uint8_t reserved;
+
+    uint16_t method_length;
+    uint16_t path_offset;
+    uint16_t path_length;
+    uint16_t query_offset;
+    uint16_t query_length;
+    uint16_t header_num;
+
+    uint32_t header_length;
+    uint32_t content_length;
+
+    swHttpIndex_header headers[0];
+} swHttpIndex;
+
+#define swHttpIndex_size(index)   (sizeof(swHttpIndex) + (index)->header_num * sizeof(swHttpIndex_header))
+
+/**
+ * the index follows the request without alignment, the worker reads it into this buffer
+ */
+typedef union
+{
+    swHttpIndex index;
+    char data[sizeof(swHttpIndex) + SW_HTTP_INDEX_MAX_HEADER * sizeof(swHttpIndex_header)];
+} swHttpIndex_buffer;
+
 typedef struct _swHttpRequest
 {
     uint8_t method;
@@ -57,12 +104,15 @@ typedef struct _swHttpRequest
     uint32_t content_length;
 
     swString *buffer;
+    swHttpIndex *index;
 
     uint8_t opcode;
 
 } swHttpRequest;
 
 int swHttpRequest_get_protocol(swHttpRequest *request);
+int swHttpRequest_parse_header(swHttpRequest *request);
+swHttpIndex* swHttpIndex_get(char *data, uint32_t length, swHttpIndex_buffer *buffer, uint32_t *request_length);
 int swHttpRequest_get_content_length(swHttpRequest *request);
 int swHttpRequest_get_header_length(swHttpRequest *request);
 int swHttpRequest_have_content_length(swHttpRequest *request);
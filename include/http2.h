@@ -87,6 +87,10 @@ enum swHttp2SettingId
 #define SW_HTTP2_STREAM_ID_SIZE               4
 #define SW_HTTP2_SETTINGS_PARAM_SIZE          6
 
+#define SW_HTTP2_DEFAULT_WINDOW_SIZE          65535
+#define SW_HTTP2_DEFAULT_MAX_FRAME_SIZE       16384
+#define SW_HTTP2_DEFAULT_HEADER_TABLE_SIZE    4096
+
 /**
  +-----------------------------------------------+
  |                 Length (24)                   |
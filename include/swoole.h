@@ -32,6 +32,7 @@ extern "C" {
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <errno.h>
 #include <string.h>
@@ -47,6 +48,7 @@ extern "C" {
 #include <netinet/tcp.h>
 #include <netdb.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/time.h>
 #include <sys/select.h>
 #include <sys/mman.h>
@@ -125,6 +127,7 @@ typedef unsigned long ulong_t;
 #include "hashmap.h"
 #include "list.h"
 #include "heap.h"
+#include "histogram.h"
 #include "RingQueue.h"
 #include "array.h"
 #include "error.h"
@@ -142,6 +145,9 @@ typedef unsigned long ulong_t;
 #define MIN(a, b)              (a)<(b)?a:b;
 #endif
 
+#define SW_MIN(A, B)           ((A) < (B) ? (A) : (B))
+#define SW_MAX(A, B)           ((A) > (B) ? (A) : (B))
+
 #define SW_STRL(s)             s, sizeof(s)
 #define SW_START_SLEEP         usleep(100000)  //sleep 1s,wait fork and pthread_create
 
@@ -190,9 +196,11 @@ enum swFd_type
     SW_FD_SIGNAL          = 11, //signalfd
     SW_FD_DNS_RESOLVER    = 12, //dns resolver
     SW_FD_INOTIFY         = 13, //server socket
+    SW_FD_RING            = 14, //shm ring doorbell
     SW_FD_USER            = 15, //SW_FD_USER or SW_FD_USER+n: for custom event
     SW_FD_STREAM_CLIENT   = 16, //swClient stream
     SW_FD_DGRAM_CLIENT    = 17, //swClient dgram
+    SW_FD_STATS           = 18, //stats_port
 };
 
 enum swBool_type
@@ -249,6 +257,7 @@ enum swFactory_dispatch_mode
     SW_DISPATCH_QUEUE = 3,
     SW_DISPATCH_IPMOD = 4,
     SW_DISPATCH_UIDMOD = 5,
+    SW_DISPATCH_LEAST_LOAD = 6,
 };
 
 enum swWorker_status
@@ -259,33 +268,42 @@ enum swWorker_status
 };
 //-------------------------------------------------------------------------------
 
-#define swWarn(str,...)        SwooleGS->lock.lock(&SwooleGS->lock);\
+#ifdef SW_LOG_ASYNC
+//sw_error is thread local, the lines are serialized by the log ring of the process
+#define swLog_lock()
+#define swLog_unlock()
+#else
+#define swLog_lock()           SwooleGS->lock.lock(&SwooleGS->lock)
+#define swLog_unlock()         SwooleGS->lock.unlock(&SwooleGS->lock)
+#endif
+
+#define swWarn(str,...)        swLog_lock();\
 snprintf(sw_error,SW_ERROR_MSG_SIZE,"%s: "str,__func__,##__VA_ARGS__);\
 swLog_put(SW_LOG_WARNING, sw_error);\
-SwooleGS->lock.unlock(&SwooleGS->lock)
+swLog_unlock()
 
-#define swNotice(str,...)        SwooleGS->lock.lock(&SwooleGS->lock);\
+#define swNotice(str,...)        swLog_lock();\
 snprintf(sw_error,SW_ERROR_MSG_SIZE,str,##__VA_ARGS__);\
 swLog_put(SW_LOG_NOTICE, sw_error);\
-SwooleGS->lock.unlock(&SwooleGS->lock)
+swLog_unlock()
 
-#define swError(str,...)       SwooleGS->lock.lock(&SwooleGS->lock);\
+#define swError(str,...)       swLog_lock();\
 snprintf(sw_error, SW_ERROR_MSG_SIZE, str, ##__VA_ARGS__);\
 swLog_put(SW_LOG_ERROR, sw_error);\
-SwooleGS->lock.unlock(&SwooleGS->lock);\
+swLog_unlock();\
 exit(1)
 
-#define swSysError(str,...) SwooleGS->lock.lock(&SwooleGS->lock);\
+#define swSysError(str,...) swLog_lock();\
 snprintf(sw_error,SW_ERROR_MSG_SIZE,"%s(:%d): "str" Error: %s[%d].",__func__,__LINE__,##__VA_ARGS__,strerror(errno),errno);\
 swLog_put(SW_LOG_ERROR, sw_error);\
-SwooleGS->lock.unlock(&SwooleGS->lock)
+swLog_unlock()
 
 #define swoole_error_log(level, errno, str, ...)      do{SwooleG.error=errno;\
-    if (level >= SwooleG.log_level){\
+    if (level >= SwooleG.log_level && swLog_limit(errno) == SW_OK){\
     snprintf(sw_error, SW_ERROR_MSG_SIZE, "%s (ERROR %d): "str,__func__,errno,##__VA_ARGS__);\
-    SwooleGS->lock.lock(&SwooleGS->lock);\
+    swLog_lock();\
     swLog_put( SW_LOG_ERROR, sw_error);\
-    SwooleGS->lock.unlock(&SwooleGS->lock);}}while(0)
+    swLog_unlock();}}while(0)
 
 #ifdef SW_DEBUG_REMOTE_OPEN
 #define swDebug(str,...) int __debug_log_n = snprintf(sw_error,SW_ERROR_MSG_SIZE,str,##__VA_ARGS__);\
@@ -317,17 +335,17 @@ enum swTraceType
 };
 
 #if SW_LOG_TRACE_OPEN == 1
-#define swTraceLog(id,str,...)      SwooleGS->lock.lock(&SwooleGS->lock);\
+#define swTraceLog(id,str,...)      swLog_lock();\
 snprintf(sw_error,SW_ERROR_MSG_SIZE,"%s: "str,__func__,##__VA_ARGS__);\
 swLog_put(SW_LOG_TRACE, sw_error);\
-SwooleGS->lock.unlock(&SwooleGS->lock)
+swLog_unlock()
 #elif SW_LOG_TRACE_OPEN == 0
 #define swTraceLog(id,str,...)
 #else
-#define swTraceLog(id,str,...)      if (id==SW_LOG_TRACE_OPEN) {SwooleGS->lock.lock(&SwooleGS->lock);\
+#define swTraceLog(id,str,...)      if (id==SW_LOG_TRACE_OPEN) {swLog_lock();\
 snprintf(sw_error,SW_ERROR_MSG_SIZE,"%s: "str,__func__,##__VA_ARGS__);\
 swLog_put(SW_LOG_TRACE, sw_error);\
-SwooleGS->lock.unlock(&SwooleGS->lock);}
+swLog_unlock();}
 #endif
 
 #define swYield()              sched_yield() //or usleep(1)
@@ -504,6 +522,17 @@ typedef struct _swConnection
      */
     time_t last_time;
 
+    /**
+     * heartbeat: the second the connection is checked in, 0 if it is not tracked
+     */
+    time_t idle_expire;
+
+    /**
+     * heartbeat: the fd of the previous and next connection in the same slot
+     */
+    int idle_prev;
+    int idle_next;
+
     /**
      * bind uid
      */
@@ -867,6 +896,49 @@ swMemoryPool* swMemoryGlobal_new(int pagesize, char shared);
 
 void swFixedPool_debug(swMemoryPool *pool);
 
+/**
+ * Arena, slab allocator in shared memory, blocks are addressed by offset.
+ * The memory is split into pages, a page is bound to one size class while it has used slices,
+ * and goes back to the common pool when all of them are freed.
+ */
+typedef struct _swArenaPage
+{
+    /**
+     * offset + 1 of the first free slice in this page, 0 is full
+     */
+    uint32_t free_slice;
+    /**
+     * page index + 1 in the list of the class or of the pool, 0 is the end
+     */
+    uint32_t prev;
+    uint32_t next;
+    uint16_t used;
+    uint8_t class_id;
+} swArenaPage;
+
+typedef struct _swArena
+{
+    swLock lock;
+    char *memory;
+    uint32_t page_size;
+    uint32_t page_num;
+    /**
+     * page index + 1 of the first unused page
+     */
+    uint32_t free_page;
+    /**
+     * page index + 1 of the first page with free slices of each size class
+     */
+    uint32_t class_page[SW_ARENA_CLASS_NUM];
+    swArenaPage pages[0];
+} swArena;
+
+swArena* swArena_new(size_t size);
+void* swArena_alloc(swArena *arena, uint32_t size, uint32_t *offset);
+void swArena_free(swArena *arena, uint32_t offset);
+void swArena_destroy(swArena *arena);
+#define swArena_get(arena, offset)   ((arena)->memory + (offset))
+
 /**
  * alloc shared memory
  */
@@ -894,7 +966,7 @@ typedef struct _swThreadParam
 } swThreadParam;
 
 extern int16_t sw_errno;
-extern char sw_error[SW_ERROR_MSG_SIZE];
+extern __thread char sw_error[SW_ERROR_MSG_SIZE];
 
 enum swProcessType
 {
@@ -912,7 +984,9 @@ enum swProcessType
 
 //----------------------tool function---------------------
 int swLog_init(char *logfile);
+int swLog_start(void);
 void swLog_put(int level, char *cnt);
+int swLog_limit(int error_code);
 void swLog_free(void);
 #define sw_log(str,...)       {snprintf(sw_error,SW_ERROR_MSG_SIZE,str,##__VA_ARGS__);swLog_put(SW_LOG_INFO, sw_error);}
 
@@ -983,39 +1057,18 @@ static sw_inline int32_t swoole_unpack(char type, void *data)
     }
 }
 
+int swoole_strnpos(char *haystack, uint32_t haystack_length, char *needle, uint32_t needle_length);
+
 static inline char* swoole_strnstr(char *haystack, char *needle, uint32_t length)
 {
-    int i;
     uint32_t needle_length = strlen(needle);
     assert(needle_length > 0);
-
-    for (i = 0; i < (int) (length - needle_length + 1); i++)
-    {
-        if ((haystack[0] == needle[0]) && (0 == memcmp(haystack, needle, needle_length)))
-        {
-            return (char *) haystack;
-        }
-        haystack++;
-    }
-
-    return NULL;
-}
-
-static inline int swoole_strnpos(char *haystack, uint32_t haystack_length, char *needle, uint32_t needle_length)
-{
-    assert(needle_length > 0);
-    uint32_t i;
-
-    for (i = 0; i < (int) (haystack_length - needle_length + 1); i++)
+    if (length < needle_length)
     {
-        if ((haystack[0] == needle[0]) && (0 == memcmp(haystack, needle, needle_length)))
-        {
-            return i;
-        }
-        haystack++;
+        return NULL;
     }
-
-    return -1;
+    int pos = swoole_strnpos(haystack, length, needle, needle_length);
+    return pos < 0 ? NULL : haystack + pos;
 }
 
 static inline int swoole_strrnpos(char *haystack, char *needle, uint32_t length)
@@ -1100,6 +1153,7 @@ void swoole_init(void);
 void swoole_clean(void);
 void swoole_update_time(void);
 double swoole_microtime(void);
+uint64_t swoole_monotonic_usec(void);
 void swoole_rtrim(char *str, int len);
 
 static sw_inline uint64_t swoole_hton64(uint64_t host)
@@ -1334,6 +1388,12 @@ struct _swWorker
      */
     sw_atomic_t tasking_num;
 
+    /**
+     * messages dispatched by the reactor threads and not yet finished
+     */
+    sw_atomic_t dispatch_count;
+    sw_atomic_t request_count;
+
 	/**
 	 * worker id
 	 */
@@ -1341,7 +1401,16 @@ struct _swWorker
 
 	swLock lock;
 
+	/**
+	 * chunks of the big responses, see swResponse_chunk
+	 */
 	void *send_shm;
+	uint32_t send_shm_num;
+	uint32_t send_shm_cursor;
+	/**
+	 * chunks referenced by the out_buffer of the connections
+	 */
+	sw_atomic_t send_shm_used;
 
 	swPipe *pipe_object;
 
@@ -1544,6 +1613,39 @@ int swChannel_wait(swChannel *object);
 int swChannel_notify(swChannel *object);
 void swChannel_free(swChannel *object);
 
+//-----------------------------ShmRing---------------------------
+/**
+ * single producer, single consumer ring in shared memory.
+ * head/tail are free running byte offsets, messages are stored inline.
+ */
+typedef struct _swShmRing
+{
+    volatile uint32_t head;
+    /**
+     * the consumer is running the message at head
+     */
+    volatile uint32_t busy;
+    /**
+     * the producer is waiting for free space
+     */
+    volatile uint32_t waiting;
+    char _pad0[SW_CACHELINE_SIZE - 3 * sizeof(uint32_t)];
+    volatile uint32_t tail;
+    char _pad1[SW_CACHELINE_SIZE - sizeof(uint32_t)];
+    uint32_t size;
+    uint32_t mask;
+    char data[0];
+} swShmRing;
+
+#define swShmRing_empty(ring)      ((ring)->head == (ring)->tail)
+#define swShmRing_memory_size(size) ((sizeof(swShmRing) + (size) + SW_CACHELINE_SIZE - 1) & ~(SW_CACHELINE_SIZE - 1))
+
+int swShmRing_init(swShmRing *ring, uint32_t size);
+int swShmRing_push(swShmRing *ring, void *header, uint32_t header_len, void *data, uint32_t data_len);
+void* swShmRing_front(swShmRing *ring, uint32_t *length);
+void swShmRing_pop(swShmRing *ring);
+uint32_t swShmRing_max_message(swShmRing *ring);
+
 swLinkedList* swLinkedList_new(uint8_t type, swDestructor dtor);
 int swLinkedList_append(swLinkedList *ll, void *data);
 void swLinkedList_remove_node(swLinkedList *ll, swLinkedList_node *remove_node);
@@ -1607,9 +1709,20 @@ int swProtocol_recv_check_length(swProtocol *protocol, swConnection *conn, swStr
 int swProtocol_recv_check_eof(swProtocol *protocol, swConnection *conn, swString *buffer);
 
 //--------------------------------timer------------------------------
+enum swTimer_backend
+{
+    SW_TIMER_BACKEND_HEAP  = 0,
+    SW_TIMER_BACKEND_WHEEL = 1,
+};
+
 typedef struct _swTimer_node
 {
     swHeap_node *heap_node;
+    /**
+     * timing wheel slot list, also used by the node pool
+     */
+    struct _swTimer_node *next;
+    struct _swTimer_node **pprev;
     void *data;
     int64_t exec_msec;
     uint32_t interval;
@@ -1617,10 +1730,27 @@ typedef struct _swTimer_node
     uint8_t remove :1;
 } swTimer_node;
 
+/**
+ * hierarchical timing wheel, SW_TIMER_WHEEL_LEVEL levels of SW_TIMER_WHEEL_SIZE slots, 1ms per tick.
+ */
+typedef struct _swTimerWheel
+{
+    /**
+     * the next tick to run
+     */
+    int64_t current;
+    /**
+     * the slot list being run
+     */
+    swTimer_node *pending;
+    swTimer_node *slots[SW_TIMER_WHEEL_LEVEL][SW_TIMER_WHEEL_SIZE];
+} swTimerWheel;
+
 typedef struct _swTimer
 {
     /*--------------timerfd & signal timer--------------*/
     swHeap *heap;
+    swTimerWheel *wheel;
     int num;
     int use_pipe;
     int lasttime;
@@ -1630,7 +1760,13 @@ typedef struct _swTimer
     long _next_msec;
     swPipe pipe;
     /*-----------------for EventTimer-------------------*/
-    struct timeval basetime;
+    /**
+     * CLOCK_MONOTONIC msec when the timer is created
+     */
+    int64_t basetime;
+    /*------------------node pool-----------------------*/
+    swTimer_node *node_pool;
+    void *node_batch;
     /*--------------------------------------------------*/
     int (*set)(struct _swTimer *timer, long exec_msec);
     /*-----------------event callback-------------------*/
@@ -1639,6 +1775,7 @@ typedef struct _swTimer
 } swTimer;
 
 int swTimer_init(long msec);
+int swTimer_create(swTimer *timer, int backend);
 swTimer_node* swTimer_add(swTimer *timer, int _msec, int interval, void *data);
 swTimer_node* swTimer_get(swTimer *timer, long id);
 void swTimer_del(swTimer *timer, swTimer_node *node);
@@ -1665,7 +1802,6 @@ typedef struct
     pid_t master_pid;
     pid_t manager_pid;
 
-    uint32_t session_round :24;
     uint8_t start;  //after swServer_start will set start=1
 
     time_t now;
@@ -1721,6 +1857,15 @@ typedef struct
     uint8_t update_time;
     uint8_t factory_lock_target;
     int16_t factory_target_worker;
+    /**
+     * ipc_mode = SW_IPC_RING, whole package appended to the dispatched header
+     */
+    char *factory_payload;
+    uint32_t factory_payload_length;
+    /**
+     * trunks of swBuffer are cached here, NULL: not cached
+     */
+    struct _swBuffer_pool *buffer_pool;
 } swThreadG;
 
 typedef struct _swServer swServer;
@@ -1735,6 +1880,10 @@ typedef struct
     uint8_t use_signalfd :1;
     uint8_t reuse_port :1;
     uint8_t socket_dontwait :1;
+    /**
+     * SW_TIMER_BACKEND_HEAP or SW_TIMER_BACKEND_WHEEL
+     */
+    uint8_t timer_backend;
 
     /**
      * Timer used pipe
@@ -1771,6 +1920,11 @@ typedef struct
     uint8_t task_recycle_num;
     char *task_tmpdir;
     uint16_t task_tmpdir_len;
+    /**
+     * large task payloads, the tmp file is only used when the arena is full
+     */
+    swArena *task_arena;
+    size_t task_arena_size;
     uint8_t task_ipc_mode;
     uint16_t task_max_request;
 
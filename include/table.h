@@ -26,20 +26,27 @@
 typedef struct _swTableRow
 {
     sw_atomic_t lock;
+    /**
+     * seqlock, odd while the row is being written
+     */
+    sw_atomic_t seq;
     /**
      * 1:used, 0:empty
      */
     uint8_t active;
-
+    uint8_t key_len;
     /**
-     * iterator
+     * 1: in the secondary indexes, a new row is indexed by swTableRow_commit()
      */
-    uint32_t list_index;
-
+    uint8_t indexed;
+    /**
+     * lock free swTableRow_atomic() in progress, a deleted row is not reused until it drops to 0
+     */
+    sw_atomic_t pin;
     /**
-     * next slot
+     * free list, row index + 1
      */
-    struct _swTableRow *next;
+    uint32_t next_free;
     /**
      * Hash Key
      */
@@ -47,13 +54,58 @@ typedef struct _swTableRow
     char data[0];
 } swTableRow;
 
+/**
+ * open addressing slot, rows never move, only slots do
+ */
 typedef struct
 {
-    uint32_t absolute_index;
-    uint32_t collision_index;
-    uint32_t skip_count;
+    uint32_t hash;
+    /**
+     * row index + 1, 0:empty
+     */
+    uint32_t row;
+} swTableSlot;
 
-    swTableRow *tmp_row;
+typedef struct
+{
+    uint32_t size;
+    uint32_t mask;
+    swTableSlot *slots;
+} swTableIndex;
+
+/**
+ * the key index is split into stripes by the high bits of the hash,
+ * every stripe has its own lock, seqlock and online rehash.
+ */
+typedef struct
+{
+    sw_atomic_t lock;
+    /**
+     * seqlock of the index, odd while the index is being modified
+     */
+    sw_atomic_t seq;
+    uint32_t row_num;
+
+    /**
+     * online rehash, old_index is migrated into index step by step
+     */
+    swTableIndex index;
+    swTableIndex old_index;
+    uint32_t rehash_pos;
+    uint8_t rehashing;
+
+    /**
+     * next index level
+     */
+    void *index_memory;
+    void *index_memory_end;
+} swTableStripe;
+
+#define SW_TABLE_STRIPE_NUM   (1 << SW_TABLE_STRIPE_BITS)
+
+typedef struct
+{
+    uint32_t absolute_index;
 } swTable_iterator;
 
 typedef struct
@@ -62,27 +114,42 @@ typedef struct
     uint16_t column_num;
     swLock lock;
     uint32_t size;
-    uint32_t mask;
+    uint32_t max_size;
     uint32_t item_size;
+    uint32_t row_memory_size;
 
     /**
      * total rows that in active state(shm)
      */
     sw_atomic_t row_num;
 
-    swTableRow **rows;
-    swMemoryPool *pool;
+    /**
+     * protect the row allocator
+     */
+    sw_atomic_t alloc_lock;
+
+    /**
+     * rows, allocated from the head, never move
+     */
+    void *rows;
+    uint32_t rows_used;
+    uint32_t free_list;
+
+    swTableStripe stripes[SW_TABLE_STRIPE_NUM];
 
     /**
-     * for iterator
+     * secondary indexes of the columns
      */
-    swTableRow **rows_list;
-    sw_atomic_t list_n;
-    uint32_t compress_threshold;
+    struct _swTableColumnIndex *index_list;
 
     swTable_iterator *iterator;
+    /**
+     * process local copy for the optimistic reader
+     */
+    swTableRow *tmp_row;
 
     void *memory;
+    size_t memory_size;
 } swTable;
 
 typedef struct
@@ -91,8 +158,52 @@ typedef struct
    uint32_t size;
    swString* name;
    uint16_t index;
+   /**
+    * secondary index, SW_TABLE_INDEX_HASH or SW_TABLE_INDEX_ORDERED
+    */
+   uint8_t index_type;
+   struct _swTableColumnIndex *sindex;
 } swTableColumn;
 
+typedef struct
+{
+    uint8_t level;
+    /**
+     * row index + 1, 0:NULL
+     */
+    uint32_t next[SW_TABLE_SKIPLIST_LEVEL];
+} swTableSkipNode;
+
+typedef struct
+{
+    /**
+     * row index + 1 of the rows with the same value, 0:NULL
+     */
+    uint32_t prev;
+    uint32_t next;
+} swTableChainNode;
+
+typedef struct _swTableColumnIndex
+{
+    uint8_t type;
+    uint8_t column_type;
+    uint16_t column_index;
+    sw_atomic_t lock;
+    swTable *table;
+    /**
+     * hash index, one slot per distinct value, the slot holds the first row,
+     * the other rows with the same value are chained, the node of row N is chain[N]
+     */
+    swTableIndex hash;
+    swTableChainNode *chain;
+    /**
+     * ordered index, the node of row N is nodes[N], the head is nodes[max_size]
+     */
+    swTableSkipNode *nodes;
+    uint8_t level;
+    struct _swTableColumnIndex *next;
+} swTableColumnIndex;
+
 enum swoole_table_type
 {
     SW_TABLE_INT = 1,
@@ -106,6 +217,26 @@ enum swoole_table_type
     SW_TABLE_STRING,
 };
 
+enum swoole_table_atomic
+{
+    SW_TABLE_ATOMIC_ADD = 1,
+    SW_TABLE_ATOMIC_CAS,
+    SW_TABLE_ATOMIC_MIN,
+    SW_TABLE_ATOMIC_MAX,
+};
+
+typedef union
+{
+    int64_t lval;
+    double dval;
+} swTable_number;
+
+enum swoole_table_index
+{
+    SW_TABLE_INDEX_HASH = 1,
+    SW_TABLE_INDEX_ORDERED,
+};
+
 enum swoole_table_find
 {
     SW_TABLE_FIND_EQ = 1,
@@ -117,17 +248,48 @@ enum swoole_table_find
     SW_TABLE_FIND_LIKE,
 };
 
-swTable* swTable_new(uint32_t rows_size);
+swTable* swTable_new(uint32_t rows_size, uint32_t max_size);
 int swTable_create(swTable *table);
 void swTable_free(swTable *table);
 int swTableColumn_add(swTable *table, char *name, int len, int type, int size);
-swTableRow* swTableRow_set(swTable *table, char *key, int keylen, sw_atomic_t **rowlock);
-swTableRow* swTableRow_get(swTable *table, char *key, int keylen, sw_atomic_t **rowlock);
+int swTableColumn_add_index(swTable *table, char *name, int len, int type);
+swTableRow* swTableRow_set(swTable *table, char *key, int keylen);
+void swTableRow_commit(swTable *table, swTableRow *row);
+swTableRow* swTableRow_get(swTable *table, char *key, int keylen);
+swTableRow* swTableRow_copy(swTable *table, char *key, int keylen);
+int swTableRow_exist(swTable *table, char *key, int keylen);
+int swTableRow_atomic(swTable *table, char *key, int keylen, swTableColumn *col, int op, swTable_number *value,
+        swTable_number *compare, swTable_number *result);
 
 void swTable_iterator_rewind(swTable *table);
 swTableRow* swTable_iterator_current(swTable *table);
 void swTable_iterator_forward(swTable *table);
 int swTableRow_del(swTable *table, char *key, int keylen);
+swTableRow* swTableRow_copy_row(swTable *table, swTableRow *row);
+int swTable_find(swTable *table, swTableColumn *col, int op, char *buf, swTableRow **rows, int max);
+int swTableColumn_match(swTableColumn *col, char *data, int op, char *value);
+
+void swTableColumnIndex_insert(swTableColumnIndex *sindex, swTableRow *row);
+void swTableColumnIndex_remove(swTableColumnIndex *sindex, swTableRow *row);
+
+static sw_inline swTableRow* swTable_get_row(swTable *table, uint32_t index)
+{
+    return (swTableRow *) ((char *) table->rows + (size_t) index * table->row_memory_size);
+}
+
+static sw_inline void swTableRow_lock(swTableRow *row)
+{
+    sw_spinlock(&row->lock);
+    row->seq++;
+    sw_atomic_memory_barrier();
+}
+
+static sw_inline void swTableRow_unlock(swTableRow *row)
+{
+    sw_atomic_memory_barrier();
+    row->seq++;
+    sw_spinlock_release(&row->lock);
+}
 
 static sw_inline swTableColumn* swTableColumn_get(swTable *table, char *column_key, int keylen)
 {
@@ -136,26 +298,26 @@ static sw_inline swTableColumn* swTableColumn_get(swTable *table, char *column_k
 
 typedef uint32_t swTable_string_length_t;
 
-static sw_inline void swTableRow_set_value(swTableRow *row, swTableColumn * col, void *value, int vlen)
+static sw_inline void swTableColumn_write(swTableColumn *col, char *dst, void *value, int vlen)
 {
     switch(col->type)
     {
     case SW_TABLE_INT8:
-        memcpy(row->data + col->index, value, 1);
+        memcpy(dst, value, 1);
         break;
     case SW_TABLE_INT16:
-        memcpy(row->data + col->index, value, 2);
+        memcpy(dst, value, 2);
         break;
     case SW_TABLE_INT32:
-        memcpy(row->data + col->index, value, 4);
+        memcpy(dst, value, 4);
         break;
 #ifdef __x86_64__
     case SW_TABLE_INT64:
-        memcpy(row->data + col->index, value, 8);
+        memcpy(dst, value, 8);
         break;
 #endif
     case SW_TABLE_FLOAT:
-        memcpy(row->data + col->index, value, sizeof(double));
+        memcpy(dst, value, sizeof(double));
         break;
     default:
         if (vlen > (col->size - sizeof(swTable_string_length_t)))
@@ -163,10 +325,26 @@ static sw_inline void swTableRow_set_value(swTableRow *row, swTableColumn * col,
             swWarn("string is too long.");
             vlen = col->size - sizeof(swTable_string_length_t);
         }
-        memcpy(row->data + col->index, &vlen, sizeof(swTable_string_length_t));
-        memcpy(row->data + col->index + sizeof(swTable_string_length_t), value, vlen);
+        memcpy(dst, &vlen, sizeof(swTable_string_length_t));
+        memcpy(dst + sizeof(swTable_string_length_t), value, vlen);
         break;
     }
 }
 
+/**
+ * the row must be locked
+ */
+static sw_inline void swTableRow_set_value(swTableRow *row, swTableColumn * col, void *value, int vlen)
+{
+    if (col->sindex && row->indexed)
+    {
+        swTableColumnIndex_remove(col->sindex, row);
+    }
+    swTableColumn_write(col, row->data + col->index, value, vlen);
+    if (col->sindex && row->indexed)
+    {
+        swTableColumnIndex_insert(col->sindex, row);
+    }
+}
+
 #endif /* SW_TABLE_H_ */
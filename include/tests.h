@@ -34,9 +34,17 @@ swUnitTest(mem_test1);
 swUnitTest(mem_test2);
 swUnitTest(mem_test3);
 swUnitTest(mem_test4);
+swUnitTest(mem_test5);
+swUnitTest(mem_test6);
+swUnitTest(mem_test7);
 
 swUnitTest(client_test);
 swUnitTest(server_test);
+swUnitTest(heartbeat_test1);
+swUnitTest(buffer_send_test1);
+swUnitTest(buffer_send_test2);
+swUnitTest(session_test1);
+swUnitTest(chunk_test1);
 
 swUnitTest(hashmap_test1);
 swUnitTest(ds_test2);
@@ -54,19 +62,41 @@ swUnitTest(type_test1);
 
 swUnitTest(aio_test);
 swUnitTest(aio_test2);
+#ifdef HAVE_IO_URING
+swUnitTest(aio_test3);
+#endif
 
 swUnitTest(ws_test1);
+swUnitTest(ws_test2);
+swUnitTest(ws_test3);
 
 swUnitTest(http_test1);
 swUnitTest(http_test2);
+swUnitTest(http_test3);
+
+swUnitTest(eof_test1);
+swUnitTest(eof_test2);
 
 swUnitTest(heap_test1);
+swUnitTest(timer_test1);
+swUnitTest(timer_test2);
+swUnitTest(log_test1);
+swUnitTest(log_test2);
+swUnitTest(log_test3);
 swUnitTest(linkedlist_test);
+swUnitTest(histogram_test1);
 swUnitTest(rbtree_test);
 void p_str(void *str);
 
 swUnitTest(pool_thread);
 
 swUnitTest(ringbuffer_test1);
+swUnitTest(shmring_test1);
+
+swUnitTest(table_test1);
+swUnitTest(table_test2);
+swUnitTest(table_test3);
+swUnitTest(table_test4);
+swUnitTest(table_test5);
 
 #endif /* SW_TESTS_H_ */
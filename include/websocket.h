@@ -27,6 +27,7 @@ extern "C"
 #define SW_WEBSOCKET_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
 #define SW_WEBSOCKET_HEADER_LEN  2
 #define SW_WEBSOCKET_MASK_LEN    4
+#define SW_WEBSOCKET_HEADER_MAX_LEN  14
 #define SW_WEBSOCKET_EXT16_LENGTH 0x7E
 #define SW_WEBSOCKET_EXT16_MAX_LEN 0xFFFF
 #define SW_WEBSOCKET_EXT64_LENGTH 0x7F
@@ -96,7 +97,11 @@ enum swWebsocketCode
 };
 
 int swWebSocket_get_package_length(swProtocol *protocol, swConnection *conn, char *data, uint32_t length);
-void swWebSocket_encode(swString *buffer, char *data, size_t length, char opcode, int finish, int mask);
+int swWebSocket_encode(swString *buffer, char *data, size_t length, char opcode, int finish, int mask);
+int swWebSocket_encode_header(char *header, size_t length, char opcode, int finish, int mask);
+int swWebSocket_encode_iov(struct iovec *iov, char *header, char *data, size_t length, char opcode, int finish, int mask);
+void swWebSocket_mask(char *dst, char *src, size_t length, char *mask_key);
+void swWebSocket_mask_key(char *mask_key);
 void swWebSocket_decode(swWebSocket_frame *frame, swString *data);
 void swWebSocket_print_frame(swWebSocket_frame *frm);
 
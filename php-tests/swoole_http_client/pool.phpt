@@ -0,0 +1,73 @@
+--TEST--
+Test of swoole_http_client connection pool
+--SKIPIF--
+<?php include "skipif.inc"; ?>
+--FILE--
+<?php
+include "include.inc";
+
+function start_swoole_http_server() {
+	$code = <<<'DOC'
+		$http = new swoole_http_server("127.0.0.1", 9501, SWOOLE_BASE);
+		$http->set(array(
+				'worker_num' => 1,
+		));
+		$http->on('request', function ($request, swoole_http_response $response) {
+				if ($request->server['request_uri'] == '/close') {
+					$response->header('Connection', 'close');
+				}
+				$response->end($request->server['remote_port']);
+		});
+
+		$http->start();
+DOC;
+
+	swoole_php_fork($code);
+}
+
+function pool_get($uri, $callback) {
+	$cli = new swoole_http_client('127.0.0.1', 9501);
+	$cli->set(array(
+			'pool' => true,
+	));
+	$cli->on('error', function($cli) {
+			echo "error\n";
+			swoole_event_exit();
+	});
+	$cli->get($uri, function($cli) use ($callback) {
+			$sock = $cli->sock;
+			$port = $cli->body;
+			//the connection goes back to the pool after the callback
+			swoole_timer_after(10, function() use ($callback, $sock, $port) {
+					$callback($sock, $port);
+			});
+	});
+}
+
+sleep(1);	//wait the release of port 9501
+start_swoole_http_server();
+sleep(1);
+
+pool_get('/', function($sock1, $port1) {
+	pool_get('/', function($sock2, $port2) use ($sock1, $port1) {
+		echo ($sock1 == $sock2 && $port1 == $port2) ? "reused\n" : "not reused\n";
+		pool_get('/close', function($sock3, $port3) use ($port1) {
+			echo $port3 == $port1 ? "reused\n" : "not reused\n";
+			$stats = swoole_http_client::getPoolStats();
+			echo "idle_num=" . $stats['idle_num'] . "\n";
+			pool_get('/', function($sock4, $port4) use ($port1) {
+				echo $port4 != $port1 ? "evicted\n" : "not evicted\n";
+				swoole_event_exit();
+			});
+		});
+	});
+});
+swoole_event_wait();
+?>
+Done
+--EXPECT--
+reused
+reused
+idle_num=0
+evicted
+Done
@@ -0,0 +1,49 @@
+--TEST--
+Test of swoole_connpool connection returned on error
+--SKIPIF--
+<?php include "skipif.inc"; ?>
+--FILE--
+<?php
+include "include.inc";
+
+$pool = mysql_test_pool(array('max' => 1));
+
+$pool->get(function (swoole_connpool $pool, $db1) {
+	$db1->query("SELECT * FROM swoole_no_such_table", function (swoole_mysql $db1, $r) use ($pool) {
+		var_dump($r, $db1->errno);
+		//the connection is still usable after an error of the query
+		$pool->release($db1);
+		$stats = $pool->getStats();
+		echo "idle_num=" . $stats['idle_num'] . " closed=" . $stats['closed'] . "\n";
+		$pool->get(function (swoole_connpool $pool, $db2) use ($db1) {
+			echo $db2 === $db1 ? "reused\n" : "not reused\n";
+			$pool->release($db2);
+			$pool->close();
+			connect_failed();
+		});
+	});
+});
+
+//the callback gets false if the connect failed
+function connect_failed() {
+	$pool = mysql_test_pool(array('port' => 1, 'max' => 1));
+	$pool->get(function (swoole_connpool $pool, $db) {
+		var_dump($db);
+		$stats = $pool->getStats();
+		echo "connection_num=" . $stats['connection_num'] . " connect_failed=" . $stats['connect_failed'] . "\n";
+		$pool->close();
+	});
+}
+swoole_event_wait();
+?>
+Done
+--EXPECTF--
+bool(false)
+int(1146)
+idle_num=1 closed=0
+reused
+
+Warning: %s in %s on line %d
+bool(false)
+connection_num=0 connect_failed=1
+Done
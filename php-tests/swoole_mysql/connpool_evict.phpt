@@ -0,0 +1,43 @@
+--TEST--
+Test of swoole_connpool broken connection evicted
+--SKIPIF--
+<?php include "skipif.inc"; ?>
+--FILE--
+<?php
+include "include.inc";
+
+$pool = mysql_test_pool(array('max' => 2));
+
+$pool->get(function (swoole_connpool $pool, $db1) {
+	$db1->query("SELECT CONNECTION_ID() AS id", function (swoole_mysql $db1, $r) use ($pool) {
+		$id1 = $r[0]['id'];
+		$pool->release($db1);
+		//the idle connection is killed by the server
+		$killer = mysql_test_connect();
+		$killer->query("KILL $id1", function (swoole_mysql $killer, $r) use ($pool, $db1, $id1) {
+			$killer->close();
+			swoole_timer_after(100, function () use ($pool, $db1, $id1) {
+				$pool->get(function (swoole_connpool $pool, $db2) use ($db1, $id1) {
+					echo $db2 !== $db1 ? "evicted\n" : "not evicted\n";
+					$db2->query("SELECT CONNECTION_ID() AS id", function (swoole_mysql $db2, $r) use ($pool, $id1) {
+						echo $r[0]['id'] != $id1 ? "new connection\n" : "same connection\n";
+						//a connection closed in use is not put back
+						$db2->close();
+						$pool->release($db2);
+						$stats = $pool->getStats();
+						echo "connection_num=" . $stats['connection_num'] . " idle_num=" . $stats['idle_num'] . " closed=" . $stats['closed'] . "\n";
+						$pool->close();
+					});
+				});
+			});
+		});
+	});
+});
+swoole_event_wait();
+?>
+Done
+--EXPECT--
+evicted
+new connection
+connection_num=0 idle_num=0 closed=2
+Done
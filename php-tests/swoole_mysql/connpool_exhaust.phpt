@@ -0,0 +1,38 @@
+--TEST--
+Test of swoole_connpool exhausted
+--SKIPIF--
+<?php include "skipif.inc"; ?>
+--FILE--
+<?php
+include "include.inc";
+
+$pool = mysql_test_pool(array('max' => 1, 'wait_timeout' => 0.2));
+
+$pool->get(function (swoole_connpool $pool, $db1) {
+	echo $db1 instanceof swoole_mysql ? "got\n" : "failed\n";
+	//no more connection, the waiter times out
+	$pool->get(function (swoole_connpool $pool, $db2) use ($db1) {
+		var_dump($db2);
+		$stats = $pool->getStats();
+		echo "connection_num=" . $stats['connection_num'] . " busy_num=" . $stats['busy_num'] . " timeout=" . $stats['timeout'] . "\n";
+		//the released connection goes to the waiter
+		$pool->get(function (swoole_connpool $pool, $db3) use ($db1) {
+			echo $db3 === $db1 ? "handed over\n" : "not handed over\n";
+			$pool->release($db3);
+			$stats = $pool->getStats();
+			echo "connection_num=" . $stats['connection_num'] . " idle_num=" . $stats['idle_num'] . " connect=" . $stats['connect'] . "\n";
+			$pool->close();
+		});
+		$pool->release($db1);
+	});
+});
+swoole_event_wait();
+?>
+Done
+--EXPECT--
+got
+bool(false)
+connection_num=1 busy_num=1 timeout=1
+handed over
+connection_num=1 idle_num=1 connect=1
+Done
@@ -0,0 +1,32 @@
+--TEST--
+Test of swoole_mysql pipelined queries
+--SKIPIF--
+<?php include "skipif.inc"; ?>
+--FILE--
+<?php
+include "include.inc";
+
+$db = mysql_test_connect();
+$result = array();
+
+//the queries are sent at once, the callbacks must be called in order
+for ($i = 0; $i < 10; $i++) {
+	$db->query("SELECT $i AS n", function (swoole_mysql $db, $r) use (&$result) {
+		$result[] = $r === false ? 'false' : $r[0]['n'];
+	});
+}
+//a prepared statement in the middle of the pipeline keeps its place
+$db->execute("SELECT ? AS n", array(10), function (swoole_mysql $db, $r) use (&$result) {
+	$result[] = $r === false ? 'false' : $r[0]['n'];
+});
+$db->query("SELECT 11 AS n", function (swoole_mysql $db, $r) use (&$result) {
+	$result[] = $r === false ? 'false' : $r[0]['n'];
+	echo implode(",", $result) . "\n";
+	$db->close();
+});
+swoole_event_wait();
+?>
+Done
+--EXPECT--
+0,1,2,3,4,5,6,7,8,9,10,11
+Done
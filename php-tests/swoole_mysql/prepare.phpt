@@ -0,0 +1,85 @@
+--TEST--
+Test of swoole_mysql prepared statement in binary protocol
+--SKIPIF--
+<?php include "skipif.inc"; ?>
+--FILE--
+<?php
+include "include.inc";
+
+$db = mysql_test_connect();
+
+$db->query("CREATE TEMPORARY TABLE swoole_stmt_test (
+	id INT NOT NULL,
+	tiny TINYINT,
+	big BIGINT UNSIGNED,
+	d DATE,
+	dt DATETIME,
+	t TIME,
+	name VARCHAR(32)
+)", function (swoole_mysql $db, $r) {
+	if ($r === false) {
+		var_dump($db->error);
+	}
+});
+
+$db->execute("INSERT INTO swoole_stmt_test VALUES (?, ?, ?, ?, ?, ?, ?)",
+	array(1, -5, '18446744073709551615', '2016-08-01', '2016-08-01 12:30:45', '-26:10:05', 'swoole'),
+	function (swoole_mysql $db, $r) {
+		var_dump($r, $db->affected_rows);
+	});
+
+$db->execute("INSERT INTO swoole_stmt_test VALUES (?, ?, ?, ?, ?, ?, ?)",
+	array(2, null, null, null, null, null, null),
+	function (swoole_mysql $db, $r) {
+		var_dump($r, $db->affected_rows);
+	});
+
+$db->execute("SELECT * FROM swoole_stmt_test WHERE id >= ? ORDER BY id", array(1), function (swoole_mysql $db, $r) {
+	var_dump($r);
+	$db->close();
+});
+swoole_event_wait();
+?>
+Done
+--EXPECT--
+bool(true)
+int(1)
+bool(true)
+int(1)
+array(2) {
+  [0]=>
+  array(7) {
+    ["id"]=>
+    int(1)
+    ["tiny"]=>
+    int(-5)
+    ["big"]=>
+    string(20) "18446744073709551615"
+    ["d"]=>
+    string(10) "2016-08-01"
+    ["dt"]=>
+    string(19) "2016-08-01 12:30:45"
+    ["t"]=>
+    string(9) "-26:10:05"
+    ["name"]=>
+    string(6) "swoole"
+  }
+  [1]=>
+  array(7) {
+    ["id"]=>
+    int(2)
+    ["tiny"]=>
+    NULL
+    ["big"]=>
+    NULL
+    ["d"]=>
+    NULL
+    ["dt"]=>
+    NULL
+    ["t"]=>
+    NULL
+    ["name"]=>
+    NULL
+  }
+}
+Done
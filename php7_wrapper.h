@@ -63,6 +63,7 @@ static inline int sw_zend_hash_find(HashTable *ht, char *k, int len, void **v)
 #define sw_add_assoc_stringl                  add_assoc_stringl
 #define sw_add_assoc_double_ex                add_assoc_double_ex
 #define sw_add_assoc_long_ex                  add_assoc_long_ex
+#define sw_add_assoc_zval_ex                  add_assoc_zval_ex
 #define sw_add_next_index_stringl             add_next_index_stringl
 
 #define sw_zval_ptr_dtor                      zval_ptr_dtor
@@ -170,6 +171,11 @@ static sw_inline int sw_add_assoc_double_ex(zval *arg, const char *key, size_t k
     return add_assoc_double_ex(arg, key, key_len - 1, value);
 }
 
+static sw_inline int sw_add_assoc_zval_ex(zval *arg, const char *key, size_t key_len, zval *value)
+{
+    return add_assoc_zval_ex(arg, key, key_len - 1, value);
+}
+
 #define SW_Z_ARRVAL_P(z)                          Z_ARRVAL_P(z)->ht
 
 #define SW_HASHTABLE_FOREACH_START(ht, _val) ZEND_HASH_FOREACH_VAL(ht, _val);  {
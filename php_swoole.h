@@ -352,6 +352,7 @@ void swoole_http_server_init(int module_number TSRMLS_DC);
 void swoole_websocket_init(int module_number TSRMLS_DC);
 void swoole_buffer_init(int module_number TSRMLS_DC);
 void swoole_mysql_init(int module_number TSRMLS_DC);
+void swoole_connpool_init(int module_number TSRMLS_DC);
 
 int php_swoole_process_start(swWorker *process, zval *object TSRMLS_DC);
 
@@ -359,10 +360,20 @@ void php_swoole_check_reactor();
 void php_swoole_event_init();
 void php_swoole_event_wait();
 void php_swoole_check_timer(int interval);
+typedef void (*php_swoole_timer_handler)(long timer_id, void *data);
+long php_swoole_add_timer_ex(int ms, int is_tick, php_swoole_timer_handler handler, void *data TSRMLS_DC);
+int php_swoole_clear_timer(long id TSRMLS_DC);
 void php_swoole_register_callback(swServer *serv);
 void php_swoole_client_free(zval *object, swClient *cli TSRMLS_DC);
 swClient* php_swoole_client_new(zval *object, char *host, int host_len, int port);
 zval* php_swoole_websocket_unpack(swString *data TSRMLS_DC);
+int php_swoole_mysql_connect(zval *zobject, char *host, int port, char *user, char *password, char *database TSRMLS_DC);
+int php_swoole_mysql_is_ready(zval *zobject);
+#ifdef SW_USE_REDIS
+typedef void (*php_swoole_redis_connect_callback)(zval *zobject, int success, void *data);
+int php_swoole_redis_connect(zval *zobject, char *host, int port, php_swoole_redis_connect_callback callback, void *data TSRMLS_DC);
+int php_swoole_redis_is_ready(zval *zobject);
+#endif
 void php_swoole_sha1(const char *str, int _len, unsigned char *digest);
 
 static sw_inline void* swoole_get_object(zval *object)
@@ -0,0 +1,136 @@
+/*
+  +----------------------------------------------------------------------+
+  | Swoole                                                               |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 2.0 of the Apache license,    |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.apache.org/licenses/LICENSE-2.0.html                      |
+  | If you did not receive a copy of the Apache2.0 license and are unable|
+  | to obtain it through the world-wide-web, please send a note to       |
+  | license@swoole.com so we can mail you a copy immediately.            |
+  +----------------------------------------------------------------------+
+  | Author: Tianfeng Han  <mikan.tenny@gmail.com>                        |
+  +----------------------------------------------------------------------+
+*/
+
+#include "swoole.h"
+
+#define SW_SHM_RING_WRAP      0xffffffff
+#define SW_SHM_RING_ALIGN(n)  (((n) + 7) & ~7)
+
+typedef struct _swShmRing_item
+{
+    uint32_t length;
+    uint32_t reserved;
+    char data[0];
+} swShmRing_item;
+
+/**
+ * size must be power of 2, the memory is allocated by the caller (swShmRing_memory_size)
+ */
+int swShmRing_init(swShmRing *ring, uint32_t size)
+{
+    if (size < 64 || (size & (size - 1)) != 0)
+    {
+        swWarn("ring size[%u] must be power of 2.", size);
+        return SW_ERR;
+    }
+    bzero(ring, sizeof(swShmRing));
+    ring->size = size;
+    ring->mask = size - 1;
+    return SW_OK;
+}
+
+/**
+ * the biggest message can be pushed, half of the ring so that a wrapped message always fits.
+ */
+uint32_t swShmRing_max_message(swShmRing *ring)
+{
+    return ring->size / 2 - sizeof(swShmRing_item);
+}
+
+/**
+ * [producer] copy header + data into the ring as one message
+ */
+int swShmRing_push(swShmRing *ring, void *header, uint32_t header_len, void *data, uint32_t data_len)
+{
+    uint32_t length = header_len + data_len;
+    if (length > swShmRing_max_message(ring))
+    {
+        return SW_ERR;
+    }
+
+    uint32_t msize = SW_SHM_RING_ALIGN(sizeof(swShmRing_item) + length);
+    uint32_t tail = ring->tail;
+    uint32_t offset = tail & ring->mask;
+    uint32_t skip = 0;
+
+    //not enough contiguous space, jump to the beginning
+    if (ring->size - offset < msize)
+    {
+        skip = ring->size - offset;
+    }
+    //full
+    if (ring->size - (tail - ring->head) < skip + msize)
+    {
+        return SW_ERR;
+    }
+    //the consumer has released these bytes
+    sw_atomic_memory_barrier();
+
+    swShmRing_item *item;
+    if (skip > 0)
+    {
+        item = (swShmRing_item *) (ring->data + offset);
+        item->length = SW_SHM_RING_WRAP;
+        offset = 0;
+    }
+    item = (swShmRing_item *) (ring->data + offset);
+    item->length = length;
+    memcpy(item->data, header, header_len);
+    if (data_len > 0)
+    {
+        memcpy(item->data + header_len, data, data_len);
+    }
+    //publish
+    sw_atomic_memory_barrier();
+    ring->tail = tail + skip + msize;
+    return SW_OK;
+}
+
+/**
+ * [consumer] peek the first message, NULL if the ring is empty.
+ * The message stays valid until swShmRing_pop.
+ */
+void* swShmRing_front(swShmRing *ring, uint32_t *length)
+{
+    uint32_t head = ring->head;
+    if (head == ring->tail)
+    {
+        return NULL;
+    }
+    sw_atomic_memory_barrier();
+
+    swShmRing_item *item = (swShmRing_item *) (ring->data + (head & ring->mask));
+    if (item->length == SW_SHM_RING_WRAP)
+    {
+        //the wrap marker and the next message are published together
+        ring->head = head + (ring->size - (head & ring->mask));
+        item = (swShmRing_item *) ring->data;
+    }
+    *length = item->length;
+    return item->data;
+}
+
+/**
+ * [consumer] release the first message
+ */
+void swShmRing_pop(swShmRing *ring)
+{
+    swShmRing_item *item = (swShmRing_item *) (ring->data + (ring->head & ring->mask));
+    uint32_t msize = SW_SHM_RING_ALIGN(sizeof(swShmRing_item) + item->length);
+    //finish reading before the producer may overwrite it
+    sw_atomic_memory_barrier();
+    ring->head += msize;
+}
@@ -25,6 +25,12 @@
 #include <execinfo.h>
 #endif
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 void swoole_init(void)
 {
     struct rlimit rlmt;
@@ -429,6 +435,16 @@ double swoole_microtime(void)
     return (double) t.tv_sec + ((double) t.tv_usec / 1000000);
 }
 
+/**
+ * for the latency, not affected by the wall clock adjustment
+ */
+uint64_t swoole_monotonic_usec(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t) t.tv_sec * 1000000 + t.tv_nsec / 1000;
+}
+
 void swoole_rtrim(char *str, int len)
 {
     int i;
@@ -758,6 +774,90 @@ static char *swoole_kmp_search(char *haystack, size_t haylen, char *needle, uint
     return NULL;
 }
 
+/**
+ * find the first needle in haystack, return the position or -1.
+ * Candidates are filtered by comparing the first and the last byte of the needle at 32/16 positions at a time,
+ * only the positions where both of them match are verified with memcmp.
+ */
+int swoole_strnpos(char *haystack, uint32_t haystack_length, char *needle, uint32_t needle_length)
+{
+    assert(needle_length > 0);
+    uint32_t i = 0;
+    uint32_t last = needle_length - 1;
+    char *p;
+
+    if (haystack_length < needle_length)
+    {
+        return -1;
+    }
+    if (needle_length == 1)
+    {
+        p = memchr(haystack, needle[0], haystack_length);
+        return p ? (int) (p - haystack) : -1;
+    }
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    uint32_t mask;
+#endif
+#ifdef __AVX2__
+    __m256i first256 = _mm256_set1_epi8(needle[0]);
+    __m256i last256 = _mm256_set1_epi8(needle[last]);
+    for (; i + last + 32 <= haystack_length; i += 32)
+    {
+        __m256i block_first = _mm256_loadu_si256((__m256i *) (haystack + i));
+        __m256i block_last = _mm256_loadu_si256((__m256i *) (haystack + i + last));
+        mask = (uint32_t) _mm256_movemask_epi8(
+                _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first256), _mm256_cmpeq_epi8(block_last, last256)));
+        while (mask)
+        {
+            uint32_t bit = __builtin_ctz(mask);
+            if (memcmp(haystack + i + bit + 1, needle + 1, needle_length - 2) == 0)
+            {
+                return i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+#endif
+#if defined(__AVX2__) || defined(__SSE2__)
+    __m128i first128 = _mm_set1_epi8(needle[0]);
+    __m128i last128 = _mm_set1_epi8(needle[last]);
+    for (; i + last + 16 <= haystack_length; i += 16)
+    {
+        __m128i block_first = _mm_loadu_si128((__m128i *) (haystack + i));
+        __m128i block_last = _mm_loadu_si128((__m128i *) (haystack + i + last));
+        mask = (uint32_t) _mm_movemask_epi8(
+                _mm_and_si128(_mm_cmpeq_epi8(block_first, first128), _mm_cmpeq_epi8(block_last, last128)));
+        while (mask)
+        {
+            uint32_t bit = __builtin_ctz(mask);
+            if (memcmp(haystack + i + bit + 1, needle + 1, needle_length - 2) == 0)
+            {
+                return i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    //tail or no SIMD, memchr is vectorized by the libc
+    while (i + last < haystack_length)
+    {
+        p = memchr(haystack + i, needle[0], haystack_length - last - i);
+        if (p == NULL)
+        {
+            return -1;
+        }
+        i = p - haystack;
+        if (haystack[i + last] == needle[last] && memcmp(p + 1, needle + 1, needle_length - 2) == 0)
+        {
+            return i;
+        }
+        i++;
+    }
+    return -1;
+}
+
 int swoole_itoa(char *buf, long value)
 {
     long i = 0, j;
@@ -69,12 +69,11 @@ uint32_t swHeap_size(swHeap *q)
 static uint32_t swHeap_maxchild(swHeap *heap, uint32_t i)
 {
     uint32_t child_i = left(i);
-    swHeap_node * child_node = heap->nodes[child_i];
-
     if (child_i >= heap->num)
     {
         return 0;
     }
+    swHeap_node * child_node = heap->nodes[child_i];
 
     if ((child_i + 1) < heap->num && swHeap_compare(heap->type, child_node->priority, heap->nodes[child_i + 1]->priority))
     {
@@ -168,6 +167,11 @@ int swHeap_remove(swHeap *heap, swHeap_node *node)
 {
     uint32_t pos = node->position;
     heap->nodes[pos] = heap->nodes[--heap->num];
+    //the last one
+    if (pos == heap->num)
+    {
+        return SW_OK;
+    }
 
     if (swHeap_compare(heap->type, node->priority, heap->nodes[pos]->priority))
     {
@@ -0,0 +1,86 @@
+/*
+ +----------------------------------------------------------------------+
+ | Swoole                                                               |
+ +----------------------------------------------------------------------+
+ | This source file is subject to version 2.0 of the Apache license,    |
+ | that is bundled with this package in the file LICENSE, and is        |
+ | available through the world-wide-web at the following url:           |
+ | http://www.apache.org/licenses/LICENSE-2.0.html                      |
+ | If you did not receive a copy of the Apache2.0 license and are unable|
+ | to obtain it through the world-wide-web, please send a note to       |
+ | license@swoole.com so we can mail you a copy immediately.            |
+ +----------------------------------------------------------------------+
+ | Author: Tianfeng Han  <mikan.tenny@gmail.com>                        |
+ +----------------------------------------------------------------------+
+ */
+
+#include "swoole.h"
+
+uint32_t swHistogram_bucket_index(uint64_t value)
+{
+    if (value < SW_HISTOGRAM_SUB_NUM)
+    {
+        return value;
+    }
+    if (value >> SW_HISTOGRAM_MAX_BITS)
+    {
+        return SW_HISTOGRAM_BUCKET_NUM - 1;
+    }
+    //the highest bit selects the power of 2, the next SW_HISTOGRAM_SUB_BITS bits select the sub bucket
+    uint32_t shift = 63 - __builtin_clzll(value) - SW_HISTOGRAM_SUB_BITS;
+    return (shift + 1) * SW_HISTOGRAM_SUB_NUM + (value >> shift) - SW_HISTOGRAM_SUB_NUM;
+}
+
+/**
+ * the largest value counted by the bucket
+ */
+uint64_t swHistogram_bucket_max(uint32_t index)
+{
+    if (index < SW_HISTOGRAM_SUB_NUM)
+    {
+        return index;
+    }
+    uint32_t shift = index / SW_HISTOGRAM_SUB_NUM - 1;
+    uint64_t sub = index % SW_HISTOGRAM_SUB_NUM + SW_HISTOGRAM_SUB_NUM;
+    return ((sub + 1) << shift) - 1;
+}
+
+void swHistogram_record(swHistogram *hist, uint64_t value)
+{
+    hist->buckets[swHistogram_bucket_index(value)]++;
+    hist->sum += value;
+    if (value > hist->max)
+    {
+        hist->max = value;
+    }
+    hist->count++;
+}
+
+/**
+ * percentile: 0-100, the error is less than 1/SW_HISTOGRAM_SUB_NUM of the value
+ */
+uint64_t swHistogram_percentile(swHistogram *hist, double percentile)
+{
+    uint64_t count = hist->count;
+    uint64_t target = (uint64_t) (count * percentile / 100 + 0.5);
+    uint64_t n = 0;
+    uint32_t i;
+
+    if (count == 0)
+    {
+        return 0;
+    }
+    if (target == 0)
+    {
+        target = 1;
+    }
+    for (i = 0; i < SW_HISTOGRAM_BUCKET_NUM; i++)
+    {
+        n += hist->buckets[i];
+        if (n >= target)
+        {
+            return swHistogram_bucket_max(i) < hist->max ? swHistogram_bucket_max(i) : hist->max;
+        }
+    }
+    return hist->max;
+}
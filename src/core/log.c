@@ -16,9 +16,60 @@
 
 #include "swoole.h"
 
+#include <poll.h>
+
 #define SW_LOG_BUFFER_SIZE 1024
 #define SW_LOG_DATE_STRLEN  64
 
+#ifdef SW_LOG_ASYNC
+typedef struct
+{
+    uint64_t sequence;
+    uint32_t length;
+    char data[SW_LOG_BUFFER_SIZE];
+} swLog_slot;
+
+/**
+ * bounded MPSC ring, the lines are written by the writer thread of this process
+ */
+static struct
+{
+    swLog_slot slots[SW_LOG_RING_SIZE];
+    uint64_t head;
+    uint64_t tail;
+    uint32_t dropped;
+    sw_atomic_t started;
+    volatile uint8_t running;
+    /**
+     * the writer is blocked on the notify fd
+     */
+    sw_atomic_t sleeping;
+    swPipe notify;
+    uint8_t notify_created;
+    pthread_t thread;
+} swLog_ring;
+
+static void swLog_ring_reset(void);
+static void swLog_wakeup(void);
+static void* swLog_writer(void *arg);
+static int swLog_flush(void);
+static void swLog_stop(void);
+#endif
+
+/**
+ * error code rate limit
+ */
+static struct
+{
+    int code;
+    time_t second;
+    uint32_t count;
+    uint32_t suppressed;
+} swLog_limit_slots[SW_LOG_LIMIT_SLOTS];
+
+static __thread time_t swLog_date_time;
+static __thread char swLog_date_str[SW_LOG_DATE_STRLEN];
+
 int swLog_init(char *logfile)
 {
     SwooleG.log_fd = open(logfile, O_APPEND| O_RDWR | O_CREAT, 0666);
@@ -32,18 +83,32 @@ int swLog_init(char *logfile)
 
 void swLog_free(void)
 {
+#ifdef SW_LOG_ASYNC
+    swLog_stop();
+#endif
     if (SwooleG.log_fd > STDOUT_FILENO)
     {
         close(SwooleG.log_fd);
     }
 }
 
-void swLog_put(int level, char *cnt)
+static sw_inline char* swLog_date(void)
+{
+    time_t now = time(NULL);
+    //formatted once per second by each thread
+    if (now != swLog_date_time)
+    {
+        struct tm p;
+        localtime_r(&now, &p);
+        snprintf(swLog_date_str, SW_LOG_DATE_STRLEN, "%d-%02d-%02d %02d:%02d:%02d", p.tm_year + 1900, p.tm_mon + 1, p.tm_mday, p.tm_hour, p.tm_min, p.tm_sec);
+        swLog_date_time = now;
+    }
+    return swLog_date_str;
+}
+
+static int swLog_format(char *buf, int level, char *cnt)
 {
     const char *level_str;
-    char date_str[SW_LOG_DATE_STRLEN];
-    char log_str[SW_LOG_BUFFER_SIZE];
-    int n;
 
     switch (level)
     {
@@ -67,12 +132,6 @@ void swLog_put(int level, char *cnt)
         break;
     }
 
-    time_t t;
-    struct tm *p;
-    t = time(NULL);
-    p = localtime(&t);
-    snprintf(date_str, SW_LOG_DATE_STRLEN, "%d-%02d-%02d %02d:%02d:%02d", p->tm_year + 1900, p->tm_mon + 1, p->tm_mday, p->tm_hour, p->tm_min, p->tm_sec);
-
     char process_flag = '@';
     int process_id = 0;
 
@@ -97,6 +156,275 @@ void swLog_put(int level, char *cnt)
         break;
     }
 
-    n = snprintf(log_str, SW_LOG_BUFFER_SIZE, "[%s %c%d.%d]\t%s\t%s\n", date_str, process_flag, SwooleG.pid, process_id, level_str, cnt);
+    int n = snprintf(buf, SW_LOG_BUFFER_SIZE, "[%s %c%d.%d]\t%s\t%s\n", swLog_date(), process_flag, SwooleG.pid, process_id, level_str, cnt);
+    if (n >= SW_LOG_BUFFER_SIZE)
+    {
+        n = SW_LOG_BUFFER_SIZE - 1;
+        buf[n - 1] = '\n';
+    }
+    return n;
+}
+
+void swLog_put(int level, char *cnt)
+{
+#ifdef SW_LOG_ASYNC
+    if (!swLog_ring.started)
+    {
+        swLog_start();
+    }
+    if (swLog_ring.running)
+    {
+        uint64_t pos = __atomic_load_n(&swLog_ring.tail, __ATOMIC_RELAXED);
+        swLog_slot *slot;
+        int64_t diff;
+
+        for (;;)
+        {
+            slot = &swLog_ring.slots[pos & (SW_LOG_RING_SIZE - 1)];
+            diff = (int64_t) __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - (int64_t) pos;
+            if (diff == 0)
+            {
+                if (__atomic_compare_exchange_n(&swLog_ring.tail, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                {
+                    break;
+                }
+            }
+            //full, the writer can not keep up with
+            else if (diff < 0)
+            {
+                __sync_add_and_fetch(&swLog_ring.dropped, 1);
+                return;
+            }
+            else
+            {
+                pos = __atomic_load_n(&swLog_ring.tail, __ATOMIC_RELAXED);
+            }
+        }
+        slot->length = swLog_format(slot->data, level, cnt);
+        __atomic_store_n(&slot->sequence, pos + 1, __ATOMIC_RELEASE);
+        swLog_wakeup();
+        return;
+    }
+#endif
+    char log_str[SW_LOG_BUFFER_SIZE];
+    int n = swLog_format(log_str, level, cnt);
     write(SwooleG.log_fd, log_str, n);
 }
+
+/**
+ * at most SW_LOG_RATE_LIMIT lines per error code in one second
+ */
+int swLog_limit(int error_code)
+{
+    time_t now = time(NULL);
+    int suppressed = 0;
+    int i = error_code % SW_LOG_LIMIT_SLOTS;
+
+    if (swLog_limit_slots[i].code != error_code || swLog_limit_slots[i].second != now)
+    {
+        if (swLog_limit_slots[i].code == error_code)
+        {
+            suppressed = swLog_limit_slots[i].suppressed;
+        }
+        swLog_limit_slots[i].code = error_code;
+        swLog_limit_slots[i].second = now;
+        swLog_limit_slots[i].count = 0;
+        swLog_limit_slots[i].suppressed = 0;
+    }
+    if (__sync_add_and_fetch(&swLog_limit_slots[i].count, 1) > SW_LOG_RATE_LIMIT)
+    {
+        __sync_add_and_fetch(&swLog_limit_slots[i].suppressed, 1);
+        return SW_ERR;
+    }
+    if (suppressed > 0)
+    {
+        char buf[SW_LOG_BUFFER_SIZE];
+        snprintf(buf, sizeof(buf), "swLog_limit: %d messages of ERROR %d were suppressed.", suppressed, error_code);
+        swLog_put(SW_LOG_WARNING, buf);
+    }
+    return SW_OK;
+}
+
+#ifdef SW_LOG_ASYNC
+static void swLog_ring_reset(void)
+{
+    int i;
+    for (i = 0; i < SW_LOG_RING_SIZE; i++)
+    {
+        swLog_ring.slots[i].sequence = i;
+    }
+    swLog_ring.head = 0;
+    swLog_ring.tail = 0;
+    swLog_ring.dropped = 0;
+    swLog_ring.sleeping = 0;
+}
+
+/**
+ * the writer thread does not exist in the child process, the notify fd is shared with the parent
+ */
+static void swLog_atfork_child(void)
+{
+    if (swLog_ring.notify_created)
+    {
+        swLog_ring.notify.close(&swLog_ring.notify);
+        swLog_ring.notify_created = 0;
+    }
+    swLog_ring.running = 0;
+    swLog_ring.started = 0;
+}
+
+/**
+ * called by the first line of each process, only one thread starts the writer,
+ * the lines of the other threads are written directly until it is running
+ */
+int swLog_start(void)
+{
+    static int registered = 0;
+
+    if (!sw_atomic_cmp_set(&swLog_ring.started, 0, 1))
+    {
+        return SW_OK;
+    }
+    swLog_ring_reset();
+    if (!registered)
+    {
+        pthread_atfork(NULL, NULL, swLog_atfork_child);
+        atexit(swLog_stop);
+        registered = 1;
+    }
+    if (swPipeNotify_auto(&swLog_ring.notify, 0, 0) < 0)
+    {
+        return SW_ERR;
+    }
+    swLog_ring.notify_created = 1;
+    sw_atomic_memory_barrier();
+    swLog_ring.running = 1;
+    if (pthread_create(&swLog_ring.thread, NULL, swLog_writer, NULL) != 0)
+    {
+        //write directly, the lines pushed in the meantime are flushed here
+        swLog_ring.running = 0;
+        sw_atomic_memory_barrier();
+        while (swLog_flush() > 0);
+        return SW_ERR;
+    }
+    return SW_OK;
+}
+
+/**
+ * the writer is only woken up when it is sleeping, no syscall while it is busy
+ */
+static void swLog_wakeup(void)
+{
+    uint64_t flag = 1;
+
+    sw_atomic_memory_barrier();
+    if (swLog_ring.sleeping && sw_atomic_cmp_set(&swLog_ring.sleeping, 1, 0))
+    {
+        swLog_ring.notify.write(&swLog_ring.notify, &flag, sizeof(flag));
+    }
+}
+
+static void swLog_writev(struct iovec *iov, int iovcnt)
+{
+    while (writev(SwooleG.log_fd, iov, iovcnt) < 0 && errno == EINTR);
+}
+
+/**
+ * write the ready lines with one writev, return the number of lines
+ */
+static int swLog_flush(void)
+{
+    struct iovec iov[SW_LOG_WRITEV_MAX];
+    uint64_t head = swLog_ring.head;
+    swLog_slot *slot;
+    int i, n = 0;
+
+    while (n < SW_LOG_WRITEV_MAX)
+    {
+        slot = &swLog_ring.slots[(head + n) & (SW_LOG_RING_SIZE - 1)];
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != head + n + 1)
+        {
+            break;
+        }
+        iov[n].iov_base = slot->data;
+        iov[n].iov_len = slot->length;
+        n++;
+    }
+
+    uint32_t dropped = 0;
+    if (n < SW_LOG_WRITEV_MAX)
+    {
+        dropped = __atomic_exchange_n(&swLog_ring.dropped, 0, __ATOMIC_RELAXED);
+    }
+    if (dropped > 0)
+    {
+        char buf[SW_LOG_BUFFER_SIZE];
+        char msg[SW_LOG_BUFFER_SIZE];
+        snprintf(msg, sizeof(msg), "swLog_flush: %d lines were dropped, the log ring is full.", dropped);
+        iov[n].iov_base = buf;
+        iov[n].iov_len = swLog_format(buf, SW_LOG_WARNING, msg);
+        swLog_writev(iov, n + 1);
+    }
+    else if (n > 0)
+    {
+        swLog_writev(iov, n);
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        slot = &swLog_ring.slots[(head + i) & (SW_LOG_RING_SIZE - 1)];
+        __atomic_store_n(&slot->sequence, head + i + SW_LOG_RING_SIZE, __ATOMIC_RELEASE);
+    }
+    swLog_ring.head = head + n;
+    return n;
+}
+
+static void* swLog_writer(void *arg)
+{
+    struct pollfd event;
+    uint64_t flag;
+
+    swSignal_none();
+    event.fd = swLog_ring.notify.getFd(&swLog_ring.notify, 0);
+    event.events = POLLIN;
+
+    while (swLog_ring.running)
+    {
+        if (swLog_flush() > 0)
+        {
+            continue;
+        }
+        swLog_ring.sleeping = 1;
+        sw_atomic_memory_barrier();
+        //a line may be pushed before the producer sees sleeping
+        if (swLog_flush() == 0 && swLog_ring.running)
+        {
+            poll(&event, 1, -1);
+            swLog_ring.notify.read(&swLog_ring.notify, &flag, sizeof(flag));
+        }
+        swLog_ring.sleeping = 0;
+    }
+    return NULL;
+}
+
+/**
+ * stop the writer and write the rest
+ */
+static void swLog_stop(void)
+{
+    uint64_t flag = 1;
+
+    if (!swLog_ring.running)
+    {
+        return;
+    }
+    swLog_ring.running = 0;
+    sw_atomic_memory_barrier();
+    swLog_ring.notify.write(&swLog_ring.notify, &flag, sizeof(flag));
+    pthread_join(swLog_ring.thread, NULL);
+    swLog_ring.notify.close(&swLog_ring.notify);
+    swLog_ring.notify_created = 0;
+    //the lines after this are written directly
+    while (swLog_flush() > 0);
+}
+#endif
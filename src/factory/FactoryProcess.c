@@ -24,8 +24,11 @@ static int swFactoryProcess_start(swFactory *factory);
 static int swFactoryProcess_notify(swFactory *factory, swDataHead *event);
 static int swFactoryProcess_dispatch(swFactory *factory, swDispatchData *buf);
 static int swFactoryProcess_finish(swFactory *factory, swSendData *data);
+static int swFactoryProcess_finish_copy(swSendData *resp, int from_id);
 static int swFactoryProcess_shutdown(swFactory *factory);
 static int swFactoryProcess_end(swFactory *factory, int fd);
+static int swFactoryProcess_create_ring(swServer *serv);
+static void swFactoryProcess_free_ring(swServer *serv);
 
 int swFactoryProcess_create(swFactory *factory, int worker_num)
 {
@@ -50,6 +53,7 @@ int swFactoryProcess_create(swFactory *factory, int worker_num)
 
 static int swFactoryProcess_shutdown(swFactory *factory)
 {
+    swServer *serv = factory->ptr;
     int status;
 
     if (swKill(SwooleGS->manager_pid, SIGTERM) < 0)
@@ -62,9 +66,81 @@ static int swFactoryProcess_shutdown(swFactory *factory)
         swSysError("waitpid(%d) failed.", SwooleGS->manager_pid);
     }
 
+    if (serv->ipc_mode == SW_IPC_RING)
+    {
+        swFactoryProcess_free_ring(serv);
+    }
+
     return SW_OK;
 }
 
+/**
+ * shared memory rings and eventfd doorbells, must be created before fork.
+ */
+static int swFactoryProcess_create_ring(swServer *serv)
+{
+    int i;
+    int ring_num = serv->reactor_num * serv->worker_num * 2;
+    int notify_num = serv->worker_num + serv->reactor_num;
+    uint32_t size = SW_IPC_RING_MIN_SIZE;
+
+    while (size < serv->ipc_ring_size && size < 0x40000000)
+    {
+        size <<= 1;
+    }
+    serv->ipc_ring_size = size;
+
+    serv->ipc_rings = sw_shm_malloc(swShmRing_memory_size(size) * ring_num);
+    if (serv->ipc_rings == NULL)
+    {
+        swWarn("malloc[ipc_rings] failed.");
+        return SW_ERR;
+    }
+    for (i = 0; i < ring_num; i++)
+    {
+        swShmRing_init(swServer_get_ring(serv, i), size);
+    }
+
+    serv->ipc_ring_signaled = sw_shm_calloc(notify_num, sizeof(sw_atomic_t));
+    serv->ipc_ring_notify = sw_calloc(notify_num, sizeof(swPipe));
+    if (serv->ipc_ring_signaled == NULL || serv->ipc_ring_notify == NULL)
+    {
+        swWarn("malloc[ipc_ring_notify] failed.");
+        return SW_ERR;
+    }
+    for (i = 0; i < notify_num; i++)
+    {
+        if (swPipeEventfd_create(&serv->ipc_ring_notify[i], 0, 0, 0) < 0)
+        {
+            return SW_ERR;
+        }
+    }
+    return SW_OK;
+}
+
+static void swFactoryProcess_free_ring(swServer *serv)
+{
+    int i;
+    if (serv->ipc_ring_notify)
+    {
+        for (i = 0; i < serv->worker_num + serv->reactor_num; i++)
+        {
+            serv->ipc_ring_notify[i].close(&serv->ipc_ring_notify[i]);
+        }
+        sw_free(serv->ipc_ring_notify);
+    }
+    if (serv->ipc_ring_signaled)
+    {
+        sw_shm_free((void *) serv->ipc_ring_signaled);
+        serv->ipc_ring_signaled = NULL;
+    }
+    if (serv->ipc_rings)
+    {
+        sw_shm_free(serv->ipc_rings);
+        serv->ipc_rings = NULL;
+    }
+}
+
 static int swFactoryProcess_start(swFactory *factory)
 {
     int i;
@@ -82,6 +158,11 @@ static int swFactoryProcess_start(swFactory *factory)
 
     serv->reactor_pipe_num = serv->worker_num / serv->reactor_num;
 
+    if (serv->ipc_mode == SW_IPC_RING && swFactoryProcess_create_ring(serv) < 0)
+    {
+        return SW_ERR;
+    }
+
     //必须先启动manager进程组，否则会带线程fork
     if (swManager_start(factory) < 0)
     {
@@ -170,7 +251,40 @@ static int swFactoryProcess_dispatch(swFactory *factory, swDispatchData *task)
         task->data.info.from_fd = conn->from_fd;
     }
 
-    return swReactorThread_send2worker((void *) &(task->data), send_len, target_worker_id);
+    sw_atomic_fetch_add(&serv->workers[target_worker_id].dispatch_count, 1);
+    if (swReactorThread_send2worker((void *) &(task->data), send_len, target_worker_id) < 0)
+    {
+        sw_atomic_fetch_sub(&serv->workers[target_worker_id].dispatch_count, 1);
+        return SW_ERR;
+    }
+    return SW_OK;
+}
+
+/**
+ * worker: no free chunk, the big response is copied through the pipe by small messages
+ */
+static int swFactoryProcess_finish_copy(swSendData *resp, int from_id)
+{
+    swEventData ev_data;
+    uint32_t offset, n;
+
+    ev_data.info.fd = resp->info.fd;
+    ev_data.info.type = resp->info.type;
+    ev_data.info.from_id = from_id;
+    ev_data.info.from_fd = SW_RESPONSE_SMALL;
+
+    for (offset = 0; offset < resp->length; offset += n)
+    {
+        n = SW_MIN(resp->length - offset, sizeof(ev_data.data));
+        memcpy(ev_data.data, resp->data + offset, n);
+        ev_data.info.len = n;
+        if (swWorker_send2reactor(&ev_data, n + sizeof(ev_data.info), resp->info.fd) < 0)
+        {
+            swWarn("sendto to reactor failed. Error: %s [%d]", strerror(errno), errno);
+            return SW_ERR;
+        }
+    }
+    return SW_OK;
 }
 
 /**
@@ -181,23 +295,48 @@ static int swFactoryProcess_finish(swFactory *factory, swSendData *resp)
     int ret, sendn;
     swServer *serv = factory->ptr;
     int fd = resp->info.fd;
+    int from_id;
 
-    swConnection *conn = swServer_connection_verify(serv, fd);
-    if (!conn)
+    /**
+     * broadcast, the sessions are checked by the reactor thread, see swServer_broadcast
+     */
+    if (resp->info.type == SW_EVENT_BROADCAST)
     {
-        swoole_error_log(SW_LOG_NOTICE, SW_ERROR_SESSION_NOT_EXIST, "session#%d does not exist.", fd);
-        return SW_ERR;
+        from_id = resp->info.from_id;
     }
-    else if ((conn->closed || conn->removed) && resp->info.type != SW_EVENT_CLOSE)
+    else
     {
-        int _len = resp->length > 0 ? resp->length : resp->info.len;
-        swoole_error_log(SW_LOG_NOTICE, SW_ERROR_SESSION_CLOSED, "send %d byte failed, because session#%d is closed.", _len, fd);
-        return SW_ERR;
+        swConnection *conn = swServer_connection_verify(serv, fd);
+        if (!conn)
+        {
+            swoole_error_log(SW_LOG_NOTICE, SW_ERROR_SESSION_NOT_EXIST, "session#%d does not exist.", fd);
+            return SW_ERR;
+        }
+        else if ((conn->closed || conn->removed) && resp->info.type != SW_EVENT_CLOSE)
+        {
+            int _len = resp->length > 0 ? resp->length : resp->info.len;
+            swoole_error_log(SW_LOG_NOTICE, SW_ERROR_SESSION_CLOSED, "send %d byte failed, because session#%d is closed.", _len, fd);
+            return SW_ERR;
+        }
+        else if (conn->overflow)
+        {
+            swoole_error_log(SW_LOG_WARNING, SW_ERROR_OUTPUT_BUFFER_OVERFLOW, "send failed, session#%d output buffer has been overflowed.", fd);
+            return SW_ERR;
+        }
+        from_id = conn->from_id;
     }
-    else if (conn->overflow)
+
+    /**
+     * event worker, write into the response ring, no size limit.
+     */
+    if (serv->ipc_mode == SW_IPC_RING && swIsWorker())
     {
-        swoole_error_log(SW_LOG_WARNING, SW_ERROR_OUTPUT_BUFFER_OVERFLOW, "send failed, session#%d output buffer has been overflowed.", fd);
-        return SW_ERR;
+        swDataHead info;
+        info.fd = fd;
+        info.type = resp->info.type;
+        info.from_id = from_id;
+        info.from_fd = SW_RESPONSE_SMALL;
+        return swWorker_send2reactor_ring(&info, resp->data, resp->length > 0 ? resp->length : resp->info.len);
     }
 
     swEventData ev_data;
@@ -205,31 +344,22 @@ static int swFactoryProcess_finish(swFactory *factory, swSendData *resp)
     ev_data.info.type = resp->info.type;
     swWorker *worker = swServer_get_worker(serv, SwooleWG.id);
 
+    swPackage_response *response = (swPackage_response *) ev_data.data;
+    uint32_t i;
+
     /**
-     * Big response, use shared memory
+     * Big response, written into the chunks of shared memory, the reactor thread sends them without copy.
      */
     if (resp->length > 0)
     {
-        if (worker->send_shm == NULL)
+        if (sizeof(swPackage_response)
+                + (resp->length + SW_WORKER_SEND_CHUNK_SIZE - 1) / SW_WORKER_SEND_CHUNK_SIZE * sizeof(uint32_t)
+                > sizeof(ev_data.data) || swWorker_fill_chunks(worker, response, resp->data, resp->length) < 0)
         {
-            swWarn("send failed, data is too big.");
-            return SW_ERR;
+            return swFactoryProcess_finish_copy(resp, from_id);
         }
-
-        swPackage_response response;
-
-        worker->lock.lock(&worker->lock);
-
-        response.length = resp->length;
-        response.worker_id = SwooleWG.id;
-
-        //swWarn("BigPackage, length=%d|worker_id=%d", response.length, response.worker_id);
-
         ev_data.info.from_fd = SW_RESPONSE_BIG;
-        ev_data.info.len = sizeof(response);
-
-        memcpy(ev_data.data, &response, sizeof(response));
-        memcpy(worker->send_shm, resp->data, resp->length);
+        ev_data.info.len = sizeof(swPackage_response) + response->num * sizeof(uint32_t);
     }
     else
     {
@@ -240,7 +370,7 @@ static int swFactoryProcess_finish(swFactory *factory, swSendData *resp)
         ev_data.info.from_fd = SW_RESPONSE_SMALL;
     }
 
-    ev_data.info.from_id = conn->from_id;
+    ev_data.info.from_id = from_id;
 
     sendn = ev_data.info.len + sizeof(resp->info);
     swTrace("[Worker] send: sendn=%d|type=%d|content=%s", sendn, resp->info.type, resp->data);
@@ -248,6 +378,13 @@ static int swFactoryProcess_finish(swFactory *factory, swSendData *resp)
     if (ret < 0)
     {
         swWarn("sendto to reactor failed. Error: %s [%d]", strerror(errno), errno);
+        if (ev_data.info.from_fd == SW_RESPONSE_BIG)
+        {
+            for (i = 0; i < response->num; i++)
+            {
+                swWorker_release_chunk(swWorker_get_chunk(worker, response->chunk_id[i]));
+            }
+        }
     }
     return ret;
 }
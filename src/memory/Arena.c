@@ -0,0 +1,181 @@
+/*
+  +----------------------------------------------------------------------+
+  | Swoole                                                               |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 2.0 of the Apache license,    |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.apache.org/licenses/LICENSE-2.0.html                      |
+  | If you did not receive a copy of the Apache2.0 license and are unable|
+  | to obtain it through the world-wide-web, please send a note to       |
+  | license@swoole.com so we can mail you a copy immediately.            |
+  +----------------------------------------------------------------------+
+  | Author: Tianfeng Han  <mikan.tenny@gmail.com>                        |
+  +----------------------------------------------------------------------+
+*/
+
+#include "swoole.h"
+
+#define swArena_slice_size(n)       (SW_ARENA_MIN_SLICE << (n))
+#define swArena_next(arena, offset) (*(uint32_t *) ((arena)->memory + (offset)))
+
+#if (SW_ARENA_MIN_SLICE << (SW_ARENA_CLASS_NUM - 1)) > SW_ARENA_PAGE_SIZE
+#error "the largest arena slice must fit in a page"
+#endif
+
+static sw_inline void swArena_unlink(swArena *arena, uint32_t *head, uint32_t page)
+{
+    swArenaPage *p = &arena->pages[page];
+    if (p->prev)
+    {
+        arena->pages[p->prev - 1].next = p->next;
+    }
+    else
+    {
+        *head = p->next;
+    }
+    if (p->next)
+    {
+        arena->pages[p->next - 1].prev = p->prev;
+    }
+    p->prev = p->next = 0;
+}
+
+static sw_inline void swArena_push(swArena *arena, uint32_t *head, uint32_t page)
+{
+    swArenaPage *p = &arena->pages[page];
+    p->prev = 0;
+    p->next = *head;
+    if (*head)
+    {
+        arena->pages[*head - 1].prev = page + 1;
+    }
+    *head = page + 1;
+}
+
+/**
+ * create the arena in shared memory, must be called before fork.
+ */
+swArena* swArena_new(size_t size)
+{
+    uint32_t page_size = SW_ARENA_PAGE_SIZE;
+    uint32_t page_num = size / page_size;
+    uint32_t i;
+
+    if (page_num == 0 || size > 0xffffffff)
+    {
+        swWarn("invalid arena size[%ld].", size);
+        return NULL;
+    }
+
+    size_t header_size = (sizeof(swArena) + page_num * sizeof(swArenaPage) + SW_CACHELINE_SIZE - 1) & ~(SW_CACHELINE_SIZE - 1);
+    swArena *arena = sw_shm_malloc(header_size + (size_t) page_num * page_size);
+    if (arena == NULL)
+    {
+        swWarn("malloc[arena] failed.");
+        return NULL;
+    }
+    bzero(arena, header_size);
+
+    if (swMutex_create(&arena->lock, 1) < 0)
+    {
+        swWarn("mutex create failed.");
+        sw_shm_free(arena);
+        return NULL;
+    }
+    arena->memory = (char *) arena + header_size;
+    arena->page_size = page_size;
+    arena->page_num = page_num;
+    for (i = page_num; i > 0; i--)
+    {
+        swArena_push(arena, &arena->free_page, i - 1);
+    }
+    return arena;
+}
+
+/**
+ * alloc a slice of the smallest class which can hold size bytes, NULL when the arena is full.
+ */
+void* swArena_alloc(swArena *arena, uint32_t size, uint32_t *offset)
+{
+    int class_id = 0;
+    uint32_t i, n, slice, page, page_offset;
+    swArenaPage *p;
+
+    while (class_id < SW_ARENA_CLASS_NUM && swArena_slice_size(class_id) < size)
+    {
+        class_id++;
+    }
+    if (class_id == SW_ARENA_CLASS_NUM)
+    {
+        return NULL;
+    }
+
+    arena->lock.lock(&arena->lock);
+    if (arena->class_page[class_id] == 0)
+    {
+        if (arena->free_page == 0)
+        {
+            arena->lock.unlock(&arena->lock);
+            return NULL;
+        }
+        //bind a page of the pool to this class, link all slices
+        page = arena->free_page - 1;
+        swArena_unlink(arena, &arena->free_page, page);
+        page_offset = page * arena->page_size;
+
+        slice = swArena_slice_size(class_id);
+        n = arena->page_size / slice;
+        for (i = 0; i < n; i++)
+        {
+            swArena_next(arena, page_offset + i * slice) = (i == n - 1) ? 0 : page_offset + (i + 1) * slice + 1;
+        }
+        p = &arena->pages[page];
+        p->class_id = class_id;
+        p->free_slice = page_offset + 1;
+        p->used = 0;
+        swArena_push(arena, &arena->class_page[class_id], page);
+    }
+
+    page = arena->class_page[class_id] - 1;
+    p = &arena->pages[page];
+    *offset = p->free_slice - 1;
+    p->free_slice = swArena_next(arena, *offset);
+    p->used++;
+    //full, no longer a candidate of this class
+    if (p->free_slice == 0)
+    {
+        swArena_unlink(arena, &arena->class_page[class_id], page);
+    }
+    arena->lock.unlock(&arena->lock);
+
+    return arena->memory + *offset;
+}
+
+void swArena_free(swArena *arena, uint32_t offset)
+{
+    uint32_t page = offset / arena->page_size;
+    swArenaPage *p = &arena->pages[page];
+
+    arena->lock.lock(&arena->lock);
+    if (p->free_slice == 0)
+    {
+        swArena_push(arena, &arena->class_page[p->class_id], page);
+    }
+    swArena_next(arena, offset) = p->free_slice;
+    p->free_slice = offset + 1;
+    p->used--;
+    //all slices are freed, the page can serve any class again
+    if (p->used == 0)
+    {
+        swArena_unlink(arena, &arena->class_page[p->class_id], page);
+        swArena_push(arena, &arena->free_page, page);
+    }
+    arena->lock.unlock(&arena->lock);
+}
+
+void swArena_destroy(swArena *arena)
+{
+    arena->lock.free(&arena->lock);
+    sw_shm_free(arena);
+}
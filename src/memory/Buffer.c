@@ -35,32 +35,114 @@ swBuffer* swBuffer_new(int trunk_size)
     return buffer;
 }
 
+static const uint32_t swBuffer_pool_class_size[SW_BUFFER_POOL_CLASS_NUM] = { 0, 256, 1024, 4096, 16384, SW_BUFFER_SIZE_BIG };
+
+static sw_inline uint32_t swBuffer_pool_get_class(uint32_t size)
+{
+    uint32_t i;
+    for (i = 0; i < SW_BUFFER_POOL_CLASS_NUM; i++)
+    {
+        if (size <= swBuffer_pool_class_size[i])
+        {
+            return i;
+        }
+    }
+    return SW_BUFFER_POOL_CLASS_NUM;
+}
+
 /**
- * create new trunk
+ * the trunk and the payload are one allocation, taken from the pool of the current thread if possible
  */
-swBuffer_trunk *swBuffer_new_trunk(swBuffer *buffer, uint32_t type, uint32_t size)
+static swBuffer_trunk* swBuffer_trunk_alloc(uint32_t size)
 {
-    swBuffer_trunk *chunk = sw_malloc(sizeof(swBuffer_trunk));
-    if (chunk == NULL)
+    swBuffer_pool *pool = SwooleTG.buffer_pool;
+    uint32_t pool_class = swBuffer_pool_get_class(size);
+    swBuffer_trunk *chunk;
+
+    if (pool && pool_class < SW_BUFFER_POOL_CLASS_NUM && pool->free_list[pool_class])
     {
-        swWarn("malloc for trunk failed. Error: %s[%d]", strerror(errno), errno);
-        return NULL;
+        chunk = pool->free_list[pool_class];
+        pool->free_list[pool_class] = chunk->next;
+        pool->free_num[pool_class]--;
+        pool->hit++;
+    }
+    else
+    {
+        uint32_t capacity = pool_class < SW_BUFFER_POOL_CLASS_NUM ? swBuffer_pool_class_size[pool_class] : size;
+        chunk = sw_malloc(sizeof(swBuffer_trunk) + capacity);
+        if (chunk == NULL)
+        {
+            swWarn("malloc(%d) for trunk failed. Error: %s[%d]", capacity, strerror(errno), errno);
+            return NULL;
+        }
+        if (pool)
+        {
+            pool->miss++;
+        }
     }
 
     bzero(chunk, sizeof(swBuffer_trunk));
+    chunk->pool_class = pool_class;
+    return chunk;
+}
 
-    //require alloc memory
-    if (type == SW_CHUNK_DATA && size > 0)
+static void swBuffer_trunk_release(swBuffer_trunk *chunk)
+{
+    swBuffer_pool *pool = SwooleTG.buffer_pool;
+    uint32_t pool_class = chunk->pool_class;
+
+    if (chunk->destroy)
+    {
+        chunk->destroy(chunk);
+    }
+    if (pool && pool_class < SW_BUFFER_POOL_CLASS_NUM
+            && pool->free_num[pool_class] < SW_BUFFER_POOL_MAX_SIZE / (sizeof(swBuffer_trunk) + swBuffer_pool_class_size[pool_class]))
+    {
+        chunk->next = pool->free_list[pool_class];
+        pool->free_list[pool_class] = chunk;
+        pool->free_num[pool_class]++;
+    }
+    else
+    {
+        sw_free(chunk);
+    }
+}
+
+/**
+ * free the cached trunks, the counters are kept
+ */
+void swBuffer_pool_free(swBuffer_pool *pool)
+{
+    swBuffer_trunk *chunk;
+    int i;
+
+    for (i = 0; i < SW_BUFFER_POOL_CLASS_NUM; i++)
     {
-        void *buf = sw_malloc(size);
-        if (buf == NULL)
+        while (pool->free_list[i])
         {
-            swWarn("malloc(%d) for data failed. Error: %s[%d]", size, strerror(errno), errno);
+            chunk = pool->free_list[i];
+            pool->free_list[i] = chunk->next;
             sw_free(chunk);
-            return NULL;
         }
+        pool->free_num[i] = 0;
+    }
+}
+
+/**
+ * create new trunk
+ */
+swBuffer_trunk *swBuffer_new_trunk(swBuffer *buffer, uint32_t type, uint32_t size)
+{
+    swBuffer_trunk *chunk = swBuffer_trunk_alloc(type == SW_CHUNK_DATA ? size : 0);
+    if (chunk == NULL)
+    {
+        return NULL;
+    }
+
+    if (type == SW_CHUNK_DATA && size > 0)
+    {
         chunk->size = size;
-        chunk->store.ptr = buf;
+        chunk->store.ptr = chunk->data;
     }
 
     chunk->type = type;
@@ -97,15 +179,7 @@ void swBuffer_pop_trunk(swBuffer *buffer, swBuffer_trunk *chunk)
         buffer->length -= chunk->length;
         buffer->trunk_num--;
     }
-    if (chunk->type == SW_CHUNK_DATA)
-    {
-        sw_free(chunk->store.ptr);
-    }
-    if (chunk->destroy)
-    {
-        chunk->destroy(chunk);
-    }
-    sw_free(chunk);
+    swBuffer_trunk_release(chunk);
 }
 
 /**
@@ -113,17 +187,13 @@ void swBuffer_pop_trunk(swBuffer *buffer, swBuffer_trunk *chunk)
  */
 int swBuffer_free(swBuffer *buffer)
 {
-    volatile swBuffer_trunk *chunk = buffer->head;
-    void * *will_free_trunk;  //free the point
+    swBuffer_trunk *chunk = buffer->head;
+    swBuffer_trunk *will_free_trunk;
     while (chunk != NULL)
     {
-        if (chunk->type == SW_CHUNK_DATA)
-        {
-            sw_free(chunk->store.ptr);
-        }
-        will_free_trunk = (void *) chunk;
+        will_free_trunk = chunk;
         chunk = chunk->next;
-        sw_free(will_free_trunk);
+        swBuffer_trunk_release(will_free_trunk);
     }
     sw_free(buffer);
     return SW_OK;
@@ -151,6 +221,53 @@ int swBuffer_append(swBuffer *buffer, void *data, uint32_t size)
     return SW_OK;
 }
 
+swBuffer_shared* swBuffer_shared_new(void *data, uint32_t length)
+{
+    swBuffer_shared *shared = sw_malloc(sizeof(swBuffer_shared) + length);
+    if (shared == NULL)
+    {
+        swWarn("malloc(%d) for shared data failed.", length);
+        return NULL;
+    }
+    shared->refcount = 1;
+    shared->length = length;
+    memcpy(shared->data, data, length);
+    return shared;
+}
+
+void swBuffer_shared_release(swBuffer_shared *shared)
+{
+    if (--shared->refcount == 0)
+    {
+        sw_free(shared);
+    }
+}
+
+static void swBuffer_shared_destructor(swBuffer_trunk *chunk)
+{
+    swBuffer_shared_release((swBuffer_shared *) ((char *) chunk->store.ptr - offsetof(swBuffer_shared, data)));
+}
+
+/**
+ * append a reference of the shared data, the first offset bytes are already sent.
+ */
+int swBuffer_append_shared(swBuffer *buffer, swBuffer_shared *shared, uint32_t offset)
+{
+    swBuffer_trunk *chunk = swBuffer_new_trunk(buffer, SW_CHUNK_SHARED, 0);
+    if (chunk == NULL)
+    {
+        return SW_ERR;
+    }
+
+    shared->refcount++;
+    chunk->store.ptr = shared->data;
+    chunk->length = shared->length;
+    chunk->offset = offset;
+    chunk->destroy = swBuffer_shared_destructor;
+    buffer->length += shared->length;
+    return SW_OK;
+}
+
 /**
  * print buffer
  */
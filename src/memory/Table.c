@@ -17,13 +17,17 @@
 #include "swoole.h"
 #include "table.h"
 
+#include <sys/mman.h>
+
+#define SW_TABLE_SLOT_DELETED     0xffffffff
+
 #ifdef SW_TABLE_DEBUG
-static int conflict_count = 0;
+static int rehash_count = 0;
 static int insert_count = 0;
 #endif
 
-static void swTable_compress_list(swTable *table);
 static void swTableColumn_free(swTableColumn *col);
+static swTableRow* swTable_set_row(swTable *table, char *key, int keylen, uint8_t *created);
 
 static void swTableColumn_free(swTableColumn *col)
 {
@@ -31,36 +35,434 @@ static void swTableColumn_free(swTableColumn *col)
     sw_free(col);
 }
 
-static void swTable_compress_list(swTable *table)
+static sw_inline uint32_t swTable_hash(char *key, int keylen)
+{
+#ifdef SW_TABLE_USE_PHP_HASH
+    return (uint32_t) swoole_hash_php(key, keylen);
+#else
+    return swoole_hash_austin(key, keylen);
+#endif
+}
+
+static sw_inline uint32_t swTable_align_size(uint32_t size)
+{
+    uint32_t i = 1;
+    if (size >= 0x80000000)
+    {
+        return 0x80000000;
+    }
+    while (i < size)
+    {
+        i <<= 1;
+    }
+    return i;
+}
+
+static sw_inline uint32_t swTableIndex_distance(swTableIndex *index, uint32_t pos, uint32_t hash)
+{
+    return (pos - (hash & index->mask)) & index->mask;
+}
+
+static sw_inline int swTableRow_compare(swTableRow *row, char *key, int keylen)
+{
+    return row->key_len == keylen && memcmp(row->key, key, keylen) == 0;
+}
+
+/**
+ * Robin Hood insertion, the slot which is closer to its home gives way.
+ */
+static void swTableIndex_insert(swTableIndex *index, uint32_t hash, uint32_t row)
+{
+    uint32_t pos = hash & index->mask;
+    uint32_t dist = 0;
+    uint32_t slot_dist;
+    swTableSlot *slot;
+    swTableSlot tmp;
+
+    for (;;)
+    {
+        slot = &index->slots[pos];
+        if (slot->row == 0)
+        {
+            slot->hash = hash;
+            slot->row = row;
+            return;
+        }
+        slot_dist = swTableIndex_distance(index, pos, slot->hash);
+        if (slot_dist < dist)
+        {
+            tmp = *slot;
+            slot->hash = hash;
+            slot->row = row;
+            hash = tmp.hash;
+            row = tmp.row;
+            dist = slot_dist;
+        }
+        pos = (pos + 1) & index->mask;
+        dist++;
+    }
+}
+
+/**
+ * backward shift deletion, no tombstone is left in the active index.
+ */
+static void swTableIndex_remove(swTableIndex *index, swTableSlot *slot)
+{
+    uint32_t pos = slot - index->slots;
+    uint32_t next;
+
+    for (;;)
+    {
+        next = (pos + 1) & index->mask;
+        slot = &index->slots[next];
+        if (slot->row == 0 || swTableIndex_distance(index, next, slot->hash) == 0)
+        {
+            index->slots[pos].hash = 0;
+            index->slots[pos].row = 0;
+            return;
+        }
+        index->slots[pos] = *slot;
+        pos = next;
+    }
+}
+
+static swTableSlot* swTableIndex_find(swTable *table, swTableIndex *index, uint32_t hash, char *key, int keylen)
+{
+    uint32_t pos = hash & index->mask;
+    uint32_t dist;
+    swTableSlot *slot;
+
+    for (dist = 0; dist < index->size; dist++)
+    {
+        slot = &index->slots[pos];
+        if (slot->row == 0 || swTableIndex_distance(index, pos, slot->hash) < dist)
+        {
+            return NULL;
+        }
+        if (slot->hash == hash && swTableRow_compare(swTable_get_row(table, slot->row - 1), key, keylen))
+        {
+            return slot;
+        }
+        pos = (pos + 1) & index->mask;
+    }
+    return NULL;
+}
+
+/**
+ * the slots before rehash_pos have been copied to the new index already.
+ */
+static swTableSlot* swTableIndex_find_old(swTable *table, swTableIndex *index, uint32_t rehash_pos, uint32_t hash,
+        char *key, int keylen)
+{
+    uint32_t pos = hash & index->mask;
+    uint32_t i;
+    swTableSlot *slot;
+
+    for (i = 0; i < index->size; i++)
+    {
+        slot = &index->slots[pos];
+        if (slot->row == 0)
+        {
+            return NULL;
+        }
+        if (pos >= rehash_pos && slot->row != SW_TABLE_SLOT_DELETED && slot->hash == hash
+                && swTableRow_compare(swTable_get_row(table, slot->row - 1), key, keylen))
+        {
+            return slot;
+        }
+        pos = (pos + 1) & index->mask;
+    }
+    return NULL;
+}
+
+static sw_inline swTableStripe* swTable_get_stripe(swTable *table, uint32_t hash)
+{
+    return &table->stripes[hash >> (32 - SW_TABLE_STRIPE_BITS)];
+}
+
+static sw_inline swTableSlot* swTable_find_slot(swTable *table, swTableStripe *stripe, uint32_t hash, char *key,
+        int keylen)
+{
+    swTableSlot *slot = swTableIndex_find(table, &stripe->index, hash, key, keylen);
+    if (slot == NULL && stripe->rehashing)
+    {
+        slot = swTableIndex_find_old(table, &stripe->old_index, stripe->rehash_pos, hash, key, keylen);
+    }
+    return slot;
+}
+
+/**
+ * Lock free lookup, the index may be modified by another process at the same time.
+ * return the row index + 1, or 0 when the key does not exist.
+ */
+static uint32_t swTable_find_optimistic(swTable *table, uint32_t hash, char *key, int keylen)
+{
+    swTableStripe *stripe = swTable_get_stripe(table, hash);
+    swTableIndex index, old_index;
+    uint32_t rehash_pos;
+    uint8_t rehashing;
+    uint32_t seq;
+    uint32_t row;
+    swTableSlot *slot;
+
+    for (;;)
+    {
+        seq = stripe->seq;
+        if (seq & 1)
+        {
+            sw_atomic_cpu_pause();
+            continue;
+        }
+        sw_atomic_memory_barrier();
+
+        index = stripe->index;
+        old_index = stripe->old_index;
+        rehash_pos = stripe->rehash_pos;
+        rehashing = stripe->rehashing;
+
+        sw_atomic_memory_barrier();
+        //the index descriptor must be consistent before probing
+        if (stripe->seq != seq)
+        {
+            continue;
+        }
+
+        slot = swTableIndex_find(table, &index, hash, key, keylen);
+        if (slot == NULL && rehashing)
+        {
+            slot = swTableIndex_find_old(table, &old_index, rehash_pos, hash, key, keylen);
+        }
+        row = slot ? slot->row : 0;
+
+        sw_atomic_memory_barrier();
+        if (stripe->seq == seq)
+        {
+            return row;
+        }
+    }
+}
+
+static sw_inline void swTable_index_write_begin(swTableStripe *stripe)
+{
+    sw_spinlock(&stripe->lock);
+    stripe->seq++;
+    sw_atomic_memory_barrier();
+}
+
+static sw_inline void swTable_index_write_end(swTableStripe *stripe)
+{
+    sw_atomic_memory_barrier();
+    stripe->seq++;
+    sw_spinlock_release(&stripe->lock);
+}
+
+static void swTable_rehash_step(swTableStripe *stripe, uint32_t n)
+{
+    swTableSlot *slot;
+
+    while (n-- > 0 && stripe->rehash_pos < stripe->old_index.size)
+    {
+        slot = &stripe->old_index.slots[stripe->rehash_pos];
+        if (slot->row != 0 && slot->row != SW_TABLE_SLOT_DELETED)
+        {
+            swTableIndex_insert(&stripe->index, slot->hash, slot->row);
+        }
+        stripe->rehash_pos++;
+    }
+    if (stripe->rehash_pos == stripe->old_index.size)
+    {
+        stripe->rehashing = 0;
+        bzero(&stripe->old_index, sizeof(swTableIndex));
+    }
+}
+
+/**
+ * switch to the next (double sized) index level, the old one is migrated by the following writes.
+ */
+static int swTable_rehash_start(swTableStripe *stripe)
 {
-    table->lock.lock(&table->lock);
+    uint32_t new_size = stripe->index.size << 1;
+    size_t need = sizeof(swTableSlot) * (size_t) new_size;
 
-    swTableRow **tmp = sw_malloc(sizeof(swTableRow *) * table->size);
-    if (!tmp)
+    if ((char *) stripe->index_memory + need > (char *) stripe->index_memory_end)
     {
-        swWarn("malloc() failed, cannot compress the jump table.");
-        goto unlock;
+        return SW_ERR;
     }
 
-    int i, tmp_i = 0;
-    for (i = 0; i < table->list_n; i++)
+    stripe->old_index = stripe->index;
+    stripe->index.size = new_size;
+    stripe->index.mask = new_size - 1;
+    stripe->index.slots = stripe->index_memory;
+    stripe->index_memory = (char *) stripe->index_memory + need;
+    stripe->rehash_pos = 0;
+    stripe->rehashing = 1;
+
+#ifdef SW_TABLE_DEBUG
+    rehash_count++;
+#endif
+    return SW_OK;
+}
+
+#define SW_TABLE_ATOMIC_FUNC(name, type) \
+static void name(type *ptr, int op, type value, type compare, type *result) \
+{ \
+    type old, new_value; \
+    if (op == SW_TABLE_ATOMIC_ADD) \
+    { \
+        *result = __sync_add_and_fetch(ptr, value); \
+        return; \
+    } \
+    if (op == SW_TABLE_ATOMIC_CAS) \
+    { \
+        *result = __sync_val_compare_and_swap(ptr, compare, value); \
+        return; \
+    } \
+    for (;;) \
+    { \
+        old = *ptr; \
+        if (op == SW_TABLE_ATOMIC_MIN) \
+        { \
+            new_value = value < old ? value : old; \
+        } \
+        else \
+        { \
+            new_value = value > old ? value : old; \
+        } \
+        if (new_value == old || __sync_bool_compare_and_swap(ptr, old, new_value)) \
+        { \
+            *result = new_value; \
+            return; \
+        } \
+    } \
+}
+
+SW_TABLE_ATOMIC_FUNC(swTable_atomic_int8, int8_t)
+SW_TABLE_ATOMIC_FUNC(swTable_atomic_int16, int16_t)
+SW_TABLE_ATOMIC_FUNC(swTable_atomic_int32, int32_t)
+SW_TABLE_ATOMIC_FUNC(swTable_atomic_int64, int64_t)
+
+/**
+ * there is no atomic instruction for double, CAS on the bit pattern instead.
+ */
+static void swTable_atomic_double(double *ptr, int op, double value, double compare, double *result)
+{
+    union
+    {
+        double dval;
+        int64_t lval;
+    } old, new_value;
+
+    for (;;)
     {
-        if (table->rows_list[i] != NULL)
+        old.dval = *ptr;
+        switch (op)
+        {
+        case SW_TABLE_ATOMIC_ADD:
+            new_value.dval = old.dval + value;
+            break;
+        case SW_TABLE_ATOMIC_CAS:
+            if (old.dval != compare)
+            {
+                *result = old.dval;
+                return;
+            }
+            new_value.dval = value;
+            break;
+        case SW_TABLE_ATOMIC_MIN:
+            new_value.dval = value < old.dval ? value : old.dval;
+            break;
+        default:
+            new_value.dval = value > old.dval ? value : old.dval;
+            break;
+        }
+        if (__sync_bool_compare_and_swap((int64_t *) ptr, old.lval, new_value.lval))
         {
-            tmp[tmp_i] = table->rows_list[i];
-            tmp[tmp_i]->list_index = tmp_i;
-            tmp_i++;
+            *result = op == SW_TABLE_ATOMIC_CAS ? old.dval : new_value.dval;
+            return;
         }
     }
+}
+
+static void swTableColumn_atomic(swTableRow *row, swTableColumn *col, int op, swTable_number *value,
+        swTable_number *compare, swTable_number *result)
+{
+    void *ptr = row->data + col->index;
+    int64_t cmp = compare ? compare->lval : 0;
+
+    switch (col->type)
+    {
+    case SW_TABLE_INT8:
+    {
+        int8_t r;
+        swTable_atomic_int8(ptr, op, value->lval, cmp, &r);
+        result->lval = r;
+        break;
+    }
+    case SW_TABLE_INT16:
+    {
+        int16_t r;
+        swTable_atomic_int16(ptr, op, value->lval, cmp, &r);
+        result->lval = r;
+        break;
+    }
+    case SW_TABLE_INT32:
+    {
+        int32_t r;
+        swTable_atomic_int32(ptr, op, value->lval, cmp, &r);
+        result->lval = r;
+        break;
+    }
+    case SW_TABLE_FLOAT:
+        swTable_atomic_double(ptr, op, value->dval, compare ? compare->dval : 0, &result->dval);
+        break;
+    default:
+        swTable_atomic_int64(ptr, op, value->lval, cmp, &result->lval);
+        break;
+    }
+}
 
-    memcpy(table->rows_list, tmp, sizeof(swTableRow *) * tmp_i);
-    sw_free(tmp);
-    table->list_n = tmp_i;
+static swTableRow* swTable_alloc_row(swTable *table, uint32_t *index)
+{
+    swTableRow *row;
+    uint32_t i;
+
+    sw_spinlock(&table->alloc_lock);
+    if (table->free_list)
+    {
+        i = table->free_list - 1;
+        row = swTable_get_row(table, i);
+        table->free_list = row->next_free;
+        //an atomic operation may still be working on the deleted row
+        while (row->pin)
+        {
+            sw_atomic_cpu_pause();
+        }
+    }
+    else if (table->rows_used < table->max_size)
+    {
+        i = table->rows_used++;
+        row = swTable_get_row(table, i);
+    }
+    else
+    {
+        sw_spinlock_release(&table->alloc_lock);
+        return NULL;
+    }
+    row->next_free = 0;
+    sw_spinlock_release(&table->alloc_lock);
+    *index = i;
+    return row;
+}
 
-    unlock: table->lock.unlock(&table->lock);
+static void swTable_free_row(swTable *table, swTableRow *row, uint32_t index)
+{
+    sw_spinlock(&table->alloc_lock);
+    row->next_free = table->free_list;
+    table->free_list = index + 1;
+    sw_spinlock_release(&table->alloc_lock);
 }
 
-swTable* swTable_new(uint32_t rows_size)
+swTable* swTable_new(uint32_t rows_size, uint32_t max_size)
 {
     if (rows_size >= 0x80000000)
     {
@@ -76,11 +478,25 @@ swTable* swTable_new(uint32_t rows_size)
         rows_size = 1 << i;
     }
 
+    if (max_size == 0)
+    {
+        max_size = rows_size >= 0x80000000 / SW_TABLE_GROWTH_LIMIT ? 0x80000000 : rows_size * SW_TABLE_GROWTH_LIMIT;
+    }
+    else if (max_size < rows_size)
+    {
+        max_size = rows_size;
+    }
+    else if (max_size > 0x80000000)
+    {
+        max_size = 0x80000000;
+    }
+
     swTable *table = SwooleG.memory_pool->alloc(SwooleG.memory_pool, sizeof(swTable));
     if (table == NULL)
     {
         return NULL;
     }
+    bzero(table, sizeof(swTable));
     if (swMutex_create(&table->lock, 1) < 0)
     {
         swWarn("mutex create failed.");
@@ -99,7 +515,7 @@ swTable* swTable_new(uint32_t rows_size)
     }
 
     table->size = rows_size;
-    table->mask = rows_size - 1;
+    table->max_size = max_size;
 
     bzero(table->iterator, sizeof(swTable_iterator));
     table->memory = NULL;
@@ -114,6 +530,8 @@ int swTableColumn_add(swTable *table, char *name, int len, int type, int size)
     {
         return SW_ERR;
     }
+    col->index_type = 0;
+    col->sindex = NULL;
     switch(type)
     {
     case SW_TABLE_INT:
@@ -151,94 +569,199 @@ int swTableColumn_add(swTable *table, char *name, int len, int type, int size)
         swWarn("unkown column type.");
         return SW_ERR;
     }
+    //numeric columns are naturally aligned for the atomic operations
+    if (col->type != SW_TABLE_STRING)
+    {
+        table->item_size = (table->item_size + col->size - 1) & ~(col->size - 1);
+    }
     col->index = table->item_size;
     table->item_size += col->size;
     table->column_num ++;
     return swHashMap_add(table->columns, name, len, col);
 }
 
-int swTable_create(swTable *table)
+int swTableColumn_add_index(swTable *table, char *name, int len, int type)
+{
+    swTableColumn *col = swTableColumn_get(table, name, len);
+    if (col == NULL)
+    {
+        swWarn("column[%.*s] not exist.", len, name);
+        return SW_ERR;
+    }
+    if (table->memory)
+    {
+        swWarn("the index must be added before the table is created.");
+        return SW_ERR;
+    }
+    if (type != SW_TABLE_INDEX_HASH && type != SW_TABLE_INDEX_ORDERED)
+    {
+        swWarn("unknown index type.");
+        return SW_ERR;
+    }
+    col->index_type = type;
+    return SW_OK;
+}
+
+static size_t swTableColumnIndex_memory_size(swTable *table, int type)
+{
+    size_t size = sizeof(swTableColumnIndex);
+    if (type == SW_TABLE_INDEX_HASH)
+    {
+        size += sizeof(swTableSlot) * (size_t) swTable_align_size(table->max_size / SW_TABLE_LOAD_FACTOR + 1);
+        size += sizeof(swTableChainNode) * (size_t) table->max_size;
+    }
+    else
+    {
+        size += sizeof(swTableSkipNode) * ((size_t) table->max_size + 1);
+    }
+    return (size + 7) & ~7;
+}
+
+static void swTableColumnIndex_create(swTable *table, swTableColumn *col, void *memory)
 {
-    uint32_t row_num = table->size * (1 + SW_TABLE_CONFLICT_PROPORTION);
+    swTableColumnIndex *sindex = memory;
+
+    sindex->type = col->index_type;
+    sindex->column_type = col->type;
+    sindex->column_index = col->index;
+    sindex->table = table;
+    sindex->level = 1;
+
+    if (sindex->type == SW_TABLE_INDEX_HASH)
+    {
+        sindex->hash.size = swTable_align_size(table->max_size / SW_TABLE_LOAD_FACTOR + 1);
+        sindex->hash.mask = sindex->hash.size - 1;
+        sindex->hash.slots = (swTableSlot *) (sindex + 1);
+        sindex->chain = (swTableChainNode *) (sindex->hash.slots + sindex->hash.size);
+    }
+    else
+    {
+        sindex->nodes = (swTableSkipNode *) (sindex + 1);
+    }
+
+    sindex->next = table->index_list;
+    table->index_list = sindex;
+    col->sindex = sindex;
+}
 
+/**
+ * Reserve the address space for max_size rows and every index level up front,
+ * the pages are only committed when they are touched, so the table grows online
+ * without remapping (the workers have been forked already).
+ */
+int swTable_create(swTable *table)
+{
     //header + data
-    uint32_t row_memory_size = sizeof(swTableRow) + table->item_size;
+    table->row_memory_size = (sizeof(swTableRow) + table->item_size + 7) & ~7;
+
+    uint32_t index_size = swTable_align_size(table->size / SW_TABLE_LOAD_FACTOR + 1) >> SW_TABLE_STRIPE_BITS;
+    //one more level for the stripes which get more keys than the average
+    uint32_t max_index_size = swTable_align_size(table->max_size / SW_TABLE_LOAD_FACTOR + 1) >> (SW_TABLE_STRIPE_BITS - 1);
+    size_t stripe_memory_size = 0;
+    uint32_t n;
+    int i;
 
     /**
      * row data & header
      */
-    size_t memory_size = row_num * row_memory_size;
+    size_t memory_size = (size_t) table->max_size * table->row_memory_size;
 
     /**
-     * row point
+     * index levels of every stripe: index_size, index_size * 2, ... max_index_size
      */
-    memory_size += table->size * sizeof(swTableRow *);
+    for (n = index_size; n <= max_index_size && n != 0; n <<= 1)
+    {
+        stripe_memory_size += sizeof(swTableSlot) * (size_t) n;
+    }
+    memory_size += stripe_memory_size * SW_TABLE_STRIPE_NUM;
 
     /**
-     * memory pool for conflict rows
+     * secondary indexes, sized for max_size rows
      */
-    memory_size += sizeof(swMemoryPool) + sizeof(swFixedPool) + ((row_num - table->size) * sizeof(swFixedPool_slice));
+    swTableColumn *col;
+    char *k;
+    size_t index_memory_size = 0;
+    while ((col = swHashMap_each(table->columns, &k)))
+    {
+        if (col->index_type)
+        {
+            index_memory_size += swTableColumnIndex_memory_size(table, col->index_type);
+        }
+    }
+    memory_size += index_memory_size;
 
-    /**
-     * for iterator, Iterate through all the elements
-     */
-    memory_size += table->size * sizeof(swTableRow *);
+    int flags = MAP_SHARED | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+    flags |= MAP_NORESERVE;
+#endif
 
-    void *memory = sw_shm_malloc(memory_size);
-    if (memory == NULL)
+    void *memory = mmap(NULL, memory_size, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (memory == MAP_FAILED)
     {
+        swWarn("mmap(%ld) failed. Error: %s[%d]", (long) memory_size, strerror(errno), errno);
         return SW_ERR;
     }
 
-    memset(memory, 0, memory_size);
     table->memory = memory;
-    table->compress_threshold = table->size * SW_TABLE_COMPRESS_PROPORTION;
-    table->rows_list = memory;
-
-    memory += table->size * sizeof(swTableRow *);
-    memory_size -= table->size * sizeof(swTableRow *);
+    table->memory_size = memory_size;
 
     table->rows = memory;
-    memory += table->size * sizeof(swTableRow *);
-    memory_size -= table->size * sizeof(swTableRow *);
+    table->rows_used = 0;
+    table->free_list = 0;
 
-    int i;
-    for (i = 0; i < table->size; i++)
+    char *stripe_memory = (char *) memory + (size_t) table->max_size * table->row_memory_size;
+    swTableStripe *stripe;
+    for (i = 0; i < SW_TABLE_STRIPE_NUM; i++)
+    {
+        stripe = &table->stripes[i];
+        stripe->index.size = index_size;
+        stripe->index.mask = index_size - 1;
+        stripe->index.slots = (swTableSlot *) stripe_memory;
+        stripe->index_memory = stripe->index.slots + index_size;
+        stripe->index_memory_end = stripe_memory + stripe_memory_size;
+        stripe_memory += stripe_memory_size;
+    }
+
+    void *sindex_memory = (char *) memory + memory_size - index_memory_size;
+    while ((col = swHashMap_each(table->columns, &k)))
+    {
+        if (col->index_type)
+        {
+            swTableColumnIndex_create(table, col, sindex_memory);
+            sindex_memory = (char *) sindex_memory + swTableColumnIndex_memory_size(table, col->index_type);
+        }
+    }
+
+    table->tmp_row = sw_malloc(table->row_memory_size);
+    if (!table->tmp_row)
     {
-        table->rows[i] = memory + (row_memory_size * i);
+        swWarn("malloc(%d) failed.", table->row_memory_size);
+        return SW_ERR;
     }
-    memory += row_memory_size * table->size;
-    memory_size -= row_memory_size * table->size;
-    table->pool = swFixedPool_new2(row_memory_size, memory, memory_size);
     return SW_OK;
 }
 
 void swTable_free(swTable *table)
 {
 #ifdef SW_TABLE_DEBUG
-    printf("swoole_table: size=%d, conflict_count=%d, insert_count=%d\n", table->size, conflict_count, insert_count);
+    printf("swoole_table: size=%d, max_size=%d, rehash_count=%d, insert_count=%d\n", table->size, table->max_size,
+            rehash_count, insert_count);
 #endif
 
     swHashMap_free(table->columns);
     sw_free(table->iterator);
+    if (table->tmp_row)
+    {
+        sw_free(table->tmp_row);
+        table->tmp_row = NULL;
+    }
     if (table->memory)
     {
-        sw_shm_free(table->memory);
+        munmap(table->memory, table->memory_size);
+        table->memory = NULL;
     }
 }
 
-static sw_inline swTableRow* swTable_hash(swTable *table, char *key, int keylen)
-{
-#ifdef SW_TABLE_USE_PHP_HASH
-    uint64_t hashv = swoole_hash_php(key, keylen);
-#else
-    uint64_t hashv = swoole_hash_austin(key, keylen);
-#endif
-    uint32_t index = hashv & table->mask;
-    assert(index < table->size);
-    return table->rows[index];
-}
-
 void swTable_iterator_rewind(swTable *table)
 {
     bzero(table->iterator, sizeof(swTable_iterator));
@@ -246,180 +769,236 @@ void swTable_iterator_rewind(swTable *table)
 
 swTableRow* swTable_iterator_current(swTable *table)
 {
-    swTableRow *row = NULL;
+    swTableRow *row;
 
-    for (; table->iterator->absolute_index < table->list_n; table->iterator->absolute_index++)
+    for (; table->iterator->absolute_index < table->rows_used; table->iterator->absolute_index++)
     {
-        row = table->rows_list[table->iterator->absolute_index];
-        if (row == NULL)
+        row = swTable_get_row(table, table->iterator->absolute_index);
+        if (row->active)
         {
-            table->iterator->skip_count++;
-            continue;
-        }
-        else
-        {
-            break;
+            return row;
         }
     }
+    return NULL;
+}
 
-    if (table->iterator->collision_index == 0)
-    {
-        return row;
-    }
-    int i;
-    for (i = 0; i < table->iterator->collision_index; i++)
+void swTable_iterator_forward(swTable *table)
+{
+    if (table->iterator->absolute_index < table->rows_used)
     {
-        row = row->next;
+        table->iterator->absolute_index++;
     }
-    return row;
 }
 
-void swTable_iterator_forward(swTable *table)
+/**
+ * return the row with its lock held, or NULL (nothing is locked).
+ */
+swTableRow* swTableRow_get(swTable *table, char *key, int keylen)
 {
-    for ( ; table->iterator->absolute_index < table->list_n; table->iterator->absolute_index++)
+    if (keylen > SW_TABLE_KEY_SIZE)
     {
-        swTableRow *row = table->rows_list[table->iterator->absolute_index];
-
-        if (row == NULL)
+        keylen = SW_TABLE_KEY_SIZE;
+    }
+
+    uint32_t hash = swTable_hash(key, keylen);
+    uint32_t index;
+    swTableRow *row;
+
+    for (;;)
+    {
+        index = swTable_find_optimistic(table, hash, key, keylen);
+        if (index == 0)
         {
-            continue;
+            return NULL;
         }
-        else if (row->next == NULL)
+        row = swTable_get_row(table, index - 1);
+        swTableRow_lock(row);
+        //the row may have been deleted or reused before we got the lock
+        if (row->active && swTableRow_compare(row, key, keylen))
         {
-            table->iterator->absolute_index++;
-            return;
-        }
-        else
-        {
-            int i = 0;
-            for (;; i++)
-            {
-                row = row->next;
-                if (i == table->iterator->collision_index)
-                {
-                    if (row == NULL)
-                    {
-                        table->iterator->absolute_index++;
-                        table->iterator->collision_index = 0;
-                    }
-                    else
-                    {
-                        table->iterator->collision_index++;
-                    }
-                    return;
-                }
-            }
+            return row;
         }
+        swTableRow_unlock(row);
     }
 }
 
-swTableRow* swTableRow_get(swTable *table, char *key, int keylen, sw_atomic_t **rowlock)
+/**
+ * Seqlock reader, copy the row to the process local table->tmp_row without writing any shared memory.
+ */
+swTableRow* swTableRow_copy(swTable *table, char *key, int keylen)
 {
     if (keylen > SW_TABLE_KEY_SIZE)
     {
         keylen = SW_TABLE_KEY_SIZE;
     }
 
-    swTableRow *row = swTable_hash(table, key, keylen);
-    sw_atomic_t *lock = &row->lock;
-    sw_spinlock(lock);
-    *rowlock = lock;
+    uint32_t hash = swTable_hash(key, keylen);
+    uint32_t index;
+    swTableRow *row;
+    swTableRow *copy;
 
     for (;;)
     {
-        if (strncmp(row->key, key, keylen) == 0)
+        index = swTable_find_optimistic(table, hash, key, keylen);
+        if (index == 0)
         {
-            if (!row->active)
-            {
-                row = NULL;
-            }
-            break;
+            return NULL;
         }
-        else if (row->next == NULL)
+        row = swTable_get_row(table, index - 1);
+        copy = swTableRow_copy_row(table, row);
+        //the row has been reused by another key
+        if (!copy || !swTableRow_compare(copy, key, keylen))
         {
-            row = NULL;
-            break;
+            continue;
         }
-        else
+        return copy;
+    }
+}
+
+/**
+ * copy a consistent snapshot of the row, NULL if it is not active.
+ */
+swTableRow* swTableRow_copy_row(swTable *table, swTableRow *row)
+{
+    swTableRow *copy = table->tmp_row;
+    uint32_t seq;
+
+    for (;;)
+    {
+        seq = row->seq;
+        if (seq & 1)
         {
-            row = row->next;
+            sw_atomic_cpu_pause();
+            continue;
+        }
+        sw_atomic_memory_barrier();
+        memcpy(copy, row, table->row_memory_size);
+        sw_atomic_memory_barrier();
+        if (row->seq == seq)
+        {
+            return copy->active ? copy : NULL;
         }
     }
-
-    return row;
 }
 
-swTableRow* swTableRow_set(swTable *table, char *key, int keylen, sw_atomic_t **rowlock)
+int swTableRow_exist(swTable *table, char *key, int keylen)
 {
     if (keylen > SW_TABLE_KEY_SIZE)
     {
         keylen = SW_TABLE_KEY_SIZE;
     }
+    return swTable_find_optimistic(table, swTable_hash(key, keylen), key, keylen) != 0;
+}
 
-    swTableRow *row = swTable_hash(table, key, keylen);
-    sw_atomic_t *lock = &row->lock;
-    sw_spinlock(lock);
-    *rowlock = lock;
+/**
+ * find or insert the row, return it with its lock held, or NULL when the table is full.
+ */
+swTableRow* swTableRow_set(swTable *table, char *key, int keylen)
+{
+    uint8_t created;
+    return swTable_set_row(table, key, keylen, &created);
+}
 
-    if (row->active)
+/**
+ * created is set when the row is inserted (zero filled)
+ */
+static swTableRow* swTable_set_row(swTable *table, char *key, int keylen, uint8_t *created)
+{
+    if (keylen > SW_TABLE_KEY_SIZE)
     {
-        for (;;)
-        {
-            if (strncmp(row->key, key, keylen) == 0)
-            {
-                break;
-            }
-            else if (row->next == NULL)
-            {
-                table->lock.lock(&table->lock);
-                swTableRow *new_row = table->pool->alloc(table->pool, 0);
+        keylen = SW_TABLE_KEY_SIZE;
+    }
 
-#ifdef SW_TABLE_DEBUG
-                conflict_count ++;
-#endif
-                table->lock.unlock(&table->lock);
+    *created = 0;
+    uint32_t hash = swTable_hash(key, keylen);
+    swTableStripe *stripe = swTable_get_stripe(table, hash);
+    uint32_t index;
+    swTableRow *row;
 
-                if (!new_row)
-                {
-                    return NULL;
-                }
-                //add row_num
-                bzero(new_row, sizeof(swTableRow));
-                sw_atomic_fetch_add(&(table->row_num), 1);
-                row->next = new_row;
-                row = new_row;
-                break;
-            }
-            else
-            {
-                row = row->next;
-            }
+    //update an existing row without touching the index lock
+    index = swTable_find_optimistic(table, hash, key, keylen);
+    if (index)
+    {
+        row = swTable_get_row(table, index - 1);
+        swTableRow_lock(row);
+        if (row->active && swTableRow_compare(row, key, keylen))
+        {
+            return row;
         }
+        swTableRow_unlock(row);
     }
-    else
+
+    swTable_index_write_begin(stripe);
+    if (stripe->rehashing)
     {
-#ifdef SW_TABLE_DEBUG
-        insert_count ++;
-#endif
+        swTable_rehash_step(stripe, SW_TABLE_REHASH_STEP);
+    }
 
-        sw_atomic_fetch_add(&(table->row_num), 1);
+    swTableSlot *slot = swTable_find_slot(table, stripe, hash, key, keylen);
+    if (slot)
+    {
+        row = swTable_get_row(table, slot->row - 1);
+        swTableRow_lock(row);
+        swTable_index_write_end(stripe);
+        return row;
+    }
 
-        // when the root node become active, we may need compress the jump table
-        if (table->list_n >= table->size - 1)
+    if (stripe->row_num + 1 > stripe->index.size * SW_TABLE_LOAD_FACTOR)
+    {
+        //the previous rehash must be finished before the next one
+        if (stripe->rehashing)
         {
-            swTable_compress_list(table);
+            swTable_rehash_step(stripe, stripe->old_index.size);
         }
+        swTable_rehash_start(stripe);
+    }
 
-        table->rows_list[table->list_n] = row;
-        row->list_index = table->list_n;
-        sw_atomic_fetch_add(&table->list_n, 1);
+    //the last level of a skewed stripe is full
+    row = stripe->row_num + 1 < stripe->index.size ? swTable_alloc_row(table, &index) : NULL;
+    if (!row)
+    {
+        swTable_index_write_end(stripe);
+        swWarn("the table is full, max_size=%d.", table->max_size);
+        return NULL;
     }
 
+#ifdef SW_TABLE_DEBUG
+    insert_count++;
+#endif
+
+    swTableRow_lock(row);
+    bzero(row->data, table->item_size);
     memcpy(row->key, key, keylen);
+    row->key_len = keylen;
     row->active = 1;
+    //the values are not written yet
+    row->indexed = 0;
+    *created = 1;
+    swTableIndex_insert(&stripe->index, hash, index + 1);
+    stripe->row_num++;
+    sw_atomic_fetch_add(&table->row_num, 1);
+
+    swTable_index_write_end(stripe);
     return row;
 }
 
+/**
+ * end of swTableRow_set(), a new row is added to the secondary indexes with the values written, then unlocked.
+ */
+void swTableRow_commit(swTable *table, swTableRow *row)
+{
+    swTableColumnIndex *sindex;
+    if (!row->indexed)
+    {
+        for (sindex = table->index_list; sindex; sindex = sindex->next)
+        {
+            swTableColumnIndex_insert(sindex, row);
+        }
+        row->indexed = 1;
+    }
+    swTableRow_unlock(row);
+}
+
 int swTableRow_del(swTable *table, char *key, int keylen)
 {
     if (keylen > SW_TABLE_KEY_SIZE)
@@ -427,82 +1006,547 @@ int swTableRow_del(swTable *table, char *key, int keylen)
         keylen = SW_TABLE_KEY_SIZE;
     }
 
-    swTableRow *row = swTable_hash(table, key, keylen);
-    sw_atomic_t *lock = &row->lock;
-    //no exists
-    if (!row->active)
+    uint32_t hash = swTable_hash(key, keylen);
+    swTableStripe *stripe = swTable_get_stripe(table, hash);
+
+    //fast path for the missing key
+    if (swTable_find_optimistic(table, hash, key, keylen) == 0)
     {
         return SW_ERR;
     }
 
-    sw_spinlock(lock);
-    if (row->next == NULL)
+    swTable_index_write_begin(stripe);
+    if (stripe->rehashing)
     {
-        if (strncmp(row->key, key, keylen) == 0)
+        swTable_rehash_step(stripe, SW_TABLE_REHASH_STEP);
+    }
+
+    swTableSlot *slot = swTable_find_slot(table, stripe, hash, key, keylen);
+    if (slot == NULL)
+    {
+        swTable_index_write_end(stripe);
+        return SW_ERR;
+    }
+
+    uint32_t index = slot->row - 1;
+    swTableRow *row = swTable_get_row(table, index);
+
+    if (slot >= stripe->index.slots && slot < stripe->index.slots + stripe->index.size)
+    {
+        swTableIndex_remove(&stripe->index, slot);
+    }
+    //keep the probe sequence of the old index
+    else
+    {
+        slot->row = SW_TABLE_SLOT_DELETED;
+    }
+
+    //wait for the writer holding this row
+    swTableRow_lock(row);
+
+    swTableColumnIndex *sindex;
+    for (sindex = table->index_list; sindex && row->indexed; sindex = sindex->next)
+    {
+        swTableColumnIndex_remove(sindex, row);
+    }
+
+    row->active = 0;
+    row->indexed = 0;
+    row->key_len = 0;
+    swTableRow_unlock(row);
+    swTable_free_row(table, row, index);
+
+    stripe->row_num--;
+    sw_atomic_fetch_sub(&table->row_num, 1);
+    swTable_index_write_end(stripe);
+
+    return SW_OK;
+}
+
+/**
+ * Update a numeric column of an existing row without the row lock, the row is pinned so it
+ * cannot be reused by another key, and the key is validated by the row seq.
+ * The row lock is only taken to create the row or to update the secondary index of the column.
+ * ADD/MIN/MAX return the new value, CAS returns the previous value (succeeded when it equals compare).
+ * The row is created when the key does not exist, MIN/MAX seed it with the operand.
+ */
+int swTableRow_atomic(swTable *table, char *key, int keylen, swTableColumn *col, int op, swTable_number *value,
+        swTable_number *compare, swTable_number *result)
+{
+    if (col->type == SW_TABLE_STRING)
+    {
+        swWarn("cannot use atomic operation on string column.");
+        return SW_ERR;
+    }
+    if (keylen > SW_TABLE_KEY_SIZE)
+    {
+        keylen = SW_TABLE_KEY_SIZE;
+    }
+
+    uint8_t created;
+    uint32_t index, seq;
+    swTableRow *row;
+
+    if (!col->sindex)
+    {
+        uint32_t hash = swTable_hash(key, keylen);
+        while ((index = swTable_find_optimistic(table, hash, key, keylen)))
         {
-            table->rows_list[row->list_index] = NULL;
-            if (table->iterator->skip_count > table->compress_threshold)
+            row = swTable_get_row(table, index - 1);
+            sw_atomic_fetch_add(&row->pin, 1);
+            seq = row->seq;
+            if (!(seq & 1))
             {
-                swTable_compress_list(table);
+                sw_atomic_memory_barrier();
+                //a deleted row may be updated, but never a row of another key
+                if (row->active && swTableRow_compare(row, key, keylen))
+                {
+                    sw_atomic_memory_barrier();
+                    if (row->seq == seq)
+                    {
+                        swTableColumn_atomic(row, col, op, value, compare, result);
+                        sw_atomic_fetch_sub(&row->pin, 1);
+                        return SW_OK;
+                    }
+                }
             }
-            bzero(row, sizeof(swTableRow));
-            goto delete_element;
+            sw_atomic_fetch_sub(&row->pin, 1);
+            sw_atomic_cpu_pause();
         }
-        else
+    }
+
+    row = swTable_set_row(table, key, keylen, &created);
+    if (!row)
+    {
+        return SW_ERR;
+    }
+    //the new row is zero filled
+    if (created && (op == SW_TABLE_ATOMIC_MIN || op == SW_TABLE_ATOMIC_MAX))
+    {
+        op = SW_TABLE_ATOMIC_ADD;
+    }
+    //the secondary index must be updated with the value
+    if (col->sindex && row->indexed)
+    {
+        swTableColumnIndex_remove(col->sindex, row);
+    }
+    swTableColumn_atomic(row, col, op, value, compare, result);
+    if (col->sindex && row->indexed)
+    {
+        swTableColumnIndex_insert(col->sindex, row);
+    }
+    swTableRow_commit(table, row);
+    return SW_OK;
+}
+
+static sw_inline uint32_t swTable_row_index(swTable *table, swTableRow *row)
+{
+    return ((char *) row - (char *) table->rows) / table->row_memory_size;
+}
+
+#define SW_TABLE_CMP(a, b)      (((a) > (b)) - ((a) < (b)))
+
+/**
+ * compare two values in the column format
+ */
+static int swTableColumnIndex_compare(int type, char *a, char *b)
+{
+    switch (type)
+    {
+    case SW_TABLE_INT8:
+        return SW_TABLE_CMP(*(int8_t *) a, *(int8_t *) b);
+    case SW_TABLE_INT16:
+        return SW_TABLE_CMP(*(int16_t *) a, *(int16_t *) b);
+    case SW_TABLE_INT32:
+        return SW_TABLE_CMP(*(int32_t *) a, *(int32_t *) b);
+    case SW_TABLE_FLOAT:
+        return SW_TABLE_CMP(*(double *) a, *(double *) b);
+    case SW_TABLE_STRING:
+    {
+        swTable_string_length_t la = *(swTable_string_length_t *) a;
+        swTable_string_length_t lb = *(swTable_string_length_t *) b;
+        int ret = memcmp(a + sizeof(swTable_string_length_t), b + sizeof(swTable_string_length_t), la < lb ? la : lb);
+        return ret != 0 ? ret : SW_TABLE_CMP(la, lb);
+    }
+    default:
+        return SW_TABLE_CMP(*(int64_t *) a, *(int64_t *) b);
+    }
+}
+
+static sw_inline uint32_t swTableColumnIndex_hash(int type, char *value)
+{
+    switch (type)
+    {
+    case SW_TABLE_INT8:
+        return swoole_hash_austin(value, 1);
+    case SW_TABLE_INT16:
+        return swoole_hash_austin(value, 2);
+    case SW_TABLE_INT32:
+        return swoole_hash_austin(value, 4);
+    case SW_TABLE_STRING:
+        return swoole_hash_austin(value + sizeof(swTable_string_length_t), *(swTable_string_length_t *) value);
+    default:
+        return swoole_hash_austin(value, 8);
+    }
+}
+
+static sw_inline char* swTableColumnIndex_value(swTableColumnIndex *sindex, uint32_t row_index)
+{
+    return swTable_get_row(sindex->table, row_index)->data + sindex->column_index;
+}
+
+/**
+ * order by (value, row index), so every node has an unique position
+ */
+static sw_inline int swTableSkipList_less(swTableColumnIndex *sindex, uint32_t a, uint32_t b)
+{
+    int ret = swTableColumnIndex_compare(sindex->column_type, swTableColumnIndex_value(sindex, a),
+            swTableColumnIndex_value(sindex, b));
+    return ret < 0 || (ret == 0 && a < b);
+}
+
+static int swTableSkipList_random_level(void)
+{
+    static uint32_t seed = 0;
+    int level = 1;
+
+    if (seed == 0)
+    {
+        seed = getpid() ^ time(NULL);
+    }
+    //xorshift, p = 1/4
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+
+    uint32_t r = seed;
+    while ((r & 3) == 0 && level < SW_TABLE_SKIPLIST_LEVEL)
+    {
+        level++;
+        r >>= 2;
+    }
+    return level;
+}
+
+static void swTableSkipList_insert(swTableColumnIndex *sindex, uint32_t r)
+{
+    swTableSkipNode *nodes = sindex->nodes;
+    uint32_t head = sindex->table->max_size;
+    uint32_t update[SW_TABLE_SKIPLIST_LEVEL];
+    uint32_t x = head;
+    uint32_t n;
+    int l, level;
+
+    if (nodes[r].level)
+    {
+        return;
+    }
+
+    for (l = sindex->level - 1; l >= 0; l--)
+    {
+        while ((n = nodes[x].next[l]) && swTableSkipList_less(sindex, n - 1, r))
         {
-            goto not_exists;
+            x = n - 1;
         }
+        update[l] = x;
     }
-    else
+
+    level = swTableSkipList_random_level();
+    if (level > sindex->level)
+    {
+        for (l = sindex->level; l < level; l++)
+        {
+            update[l] = head;
+        }
+        sindex->level = level;
+    }
+
+    nodes[r].level = level;
+    for (l = 0; l < level; l++)
+    {
+        nodes[r].next[l] = nodes[update[l]].next[l];
+        nodes[update[l]].next[l] = r + 1;
+    }
+}
+
+static void swTableSkipList_remove(swTableColumnIndex *sindex, uint32_t r)
+{
+    swTableSkipNode *nodes = sindex->nodes;
+    uint32_t head = sindex->table->max_size;
+    uint32_t x = head;
+    uint32_t n;
+    int l;
+
+    if (nodes[r].level == 0)
     {
-        swTableRow *tmp = row;
-        swTableRow *prev = NULL;
+        return;
+    }
 
-        while (tmp)
+    for (l = sindex->level - 1; l >= 0; l--)
+    {
+        while ((n = nodes[x].next[l]) && swTableSkipList_less(sindex, n - 1, r))
         {
-            if ((strncmp(tmp->key, key, keylen) == 0))
+            x = n - 1;
+        }
+        if (l < nodes[r].level && nodes[x].next[l] == r + 1)
+        {
+            nodes[x].next[l] = nodes[r].next[l];
+        }
+    }
+
+    bzero(&nodes[r], sizeof(swTableSkipNode));
+    while (sindex->level > 1 && nodes[head].next[sindex->level - 1] == 0)
+    {
+        sindex->level--;
+    }
+}
+
+/**
+ * the first node whose value is not less than (or greater than, if strict) value
+ */
+static uint32_t swTableSkipList_lower_bound(swTableColumnIndex *sindex, char *value, int strict)
+{
+    swTableSkipNode *nodes = sindex->nodes;
+    uint32_t x = sindex->table->max_size;
+    uint32_t n;
+    int l, ret;
+
+    for (l = sindex->level - 1; l >= 0; l--)
+    {
+        while ((n = nodes[x].next[l]))
+        {
+            ret = swTableColumnIndex_compare(sindex->column_type, swTableColumnIndex_value(sindex, n - 1), value);
+            if (ret < 0 || (strict && ret == 0))
+            {
+                x = n - 1;
+            }
+            else
             {
                 break;
             }
-            prev = tmp;
-            tmp = tmp->next;
         }
+    }
+    return nodes[x].next[0];
+}
+
+/**
+ * the slot of the value in the hash index, NULL if no row has it
+ */
+static swTableSlot* swTableColumnIndex_lookup(swTableColumnIndex *sindex, uint32_t hash, char *value)
+{
+    swTableIndex *index = &sindex->hash;
+    uint32_t pos = hash & index->mask;
+    uint32_t dist;
+    swTableSlot *slot;
 
-        if (tmp == NULL)
+    for (dist = 0; dist < index->size; dist++)
+    {
+        slot = &index->slots[pos];
+        if (slot->row == 0 || swTableIndex_distance(index, pos, slot->hash) < dist)
         {
-            not_exists:
-            sw_spinlock_release(lock);
-            return SW_ERR;
+            return NULL;
         }
-
-        //when the deleting element is root, we should move the first element's data to root,
-        //and remove the element from the collision list.
-        if (tmp == row)
+        if (slot->hash == hash
+                && swTableColumnIndex_compare(sindex->column_type, swTableColumnIndex_value(sindex, slot->row - 1), value) == 0)
         {
-            tmp = tmp->next;
-            row->next = tmp->next;
-            memcpy(row->key, tmp->key, strlen(tmp->key));
+            return slot;
+        }
+        pos = (pos + 1) & index->mask;
+    }
+    return NULL;
+}
+
+/**
+ * the row must be locked
+ */
+void swTableColumnIndex_insert(swTableColumnIndex *sindex, swTableRow *row)
+{
+    uint32_t r = swTable_row_index(sindex->table, row);
 
-            if (table->iterator->skip_count > table->compress_threshold)
+    sw_spinlock(&sindex->lock);
+    if (sindex->type == SW_TABLE_INDEX_HASH)
+    {
+        char *value = row->data + sindex->column_index;
+        uint32_t hash = swTableColumnIndex_hash(sindex->column_type, value);
+        swTableSlot *slot = swTableColumnIndex_lookup(sindex, hash, value);
+        swTableChainNode *node = &sindex->chain[r];
+
+        //the value exists, chain the row after the first one
+        if (slot)
+        {
+            node->prev = slot->row;
+            node->next = sindex->chain[slot->row - 1].next;
+            if (node->next)
             {
-                swTable_compress_list(table);
+                sindex->chain[node->next - 1].prev = r + 1;
             }
+            sindex->chain[slot->row - 1].next = r + 1;
+        }
+        else
+        {
+            node->prev = node->next = 0;
+            swTableIndex_insert(&sindex->hash, hash, r + 1);
+        }
+    }
+    else
+    {
+        swTableSkipList_insert(sindex, r);
+    }
+    sw_spinlock_release(&sindex->lock);
+}
+
+/**
+ * the row must be locked, and still hold the indexed value
+ */
+void swTableColumnIndex_remove(swTableColumnIndex *sindex, swTableRow *row)
+{
+    uint32_t r = swTable_row_index(sindex->table, row);
+
+    sw_spinlock(&sindex->lock);
+    if (sindex->type == SW_TABLE_INDEX_HASH)
+    {
+        swTableChainNode *node = &sindex->chain[r];
 
-            memcpy(row->data, tmp->data, table->item_size);
+        if (node->prev)
+        {
+            sindex->chain[node->prev - 1].next = node->next;
+            if (node->next)
+            {
+                sindex->chain[node->next - 1].prev = node->prev;
+            }
         }
-        if (prev)
+        else
         {
-            prev->next = tmp->next;
+            char *value = row->data + sindex->column_index;
+            swTableSlot *slot = swTableColumnIndex_lookup(sindex, swTableColumnIndex_hash(sindex->column_type, value), value);
+            //the next row with the same value takes the slot
+            if (slot && node->next)
+            {
+                slot->row = node->next;
+                sindex->chain[node->next - 1].prev = 0;
+            }
+            else if (slot)
+            {
+                swTableIndex_remove(&sindex->hash, slot);
+            }
         }
-        table->lock.lock(&table->lock);
-        bzero(tmp, sizeof(swTableRow));
-        table->pool->free(table->pool, tmp);
-        table->lock.unlock(&table->lock);
+        node->prev = node->next = 0;
     }
+    else
+    {
+        swTableSkipList_remove(sindex, r);
+    }
+    sw_spinlock_release(&sindex->lock);
+}
 
-    delete_element:
-    sw_atomic_fetch_sub(&(table->row_num), 1);
-    sw_spinlock_release(lock);
+/**
+ * match the column data of a row, value is in the column format written by swTableColumn_write().
+ */
+int swTableColumn_match(swTableColumn *col, char *data, int op, char *value)
+{
+    if (op == SW_TABLE_FIND_EQ)
+    {
+        return swTableColumnIndex_compare(col->type, data, value) == 0;
+    }
+    else if (op == SW_TABLE_FIND_NEQ)
+    {
+        return swTableColumnIndex_compare(col->type, data, value) != 0;
+    }
+    else if (op == SW_TABLE_FIND_GT)
+    {
+        return swTableColumnIndex_compare(col->type, data, value) > 0;
+    }
+    else if (op == SW_TABLE_FIND_LT)
+    {
+        return swTableColumnIndex_compare(col->type, data, value) < 0;
+    }
+    else if (col->type != SW_TABLE_STRING)
+    {
+        return 0;
+    }
 
-    return SW_OK;
+    swTable_string_length_t dlen = *(swTable_string_length_t *) data;
+    swTable_string_length_t vlen = *(swTable_string_length_t *) value;
+    data += sizeof(swTable_string_length_t);
+    value += sizeof(swTable_string_length_t);
+
+    if (vlen > dlen)
+    {
+        return 0;
+    }
+    switch (op)
+    {
+    case SW_TABLE_FIND_LEFTLIKE:
+        return memcmp(data, value, vlen) == 0;
+    case SW_TABLE_FIND_RIGHTLIKE:
+        return memcmp(data + dlen - vlen, value, vlen) == 0;
+    case SW_TABLE_FIND_LIKE:
+        return vlen == 0 || memmem(data, dlen, value, vlen) != NULL;
+    default:
+        return 0;
+    }
+}
+
+/**
+ * Find the rows by a column value, use the secondary index if the column has one which supports the operator,
+ * otherwise scan all rows. The rows are not locked, copy them with swTableRow_copy_row() and match the copies
+ * again with swTableColumn_match(), they may be changed after the scan.
+ * buf is the value in the column format written by swTableColumn_write(), return the number of rows.
+ */
+int swTable_find(swTable *table, swTableColumn *col, int op, char *buf, swTableRow **rows, int max)
+{
+    swTableColumnIndex *sindex = col->sindex;
+    uint32_t i, n;
+    int count = 0;
+    char *data;
+
+    if (sindex && sindex->type == SW_TABLE_INDEX_HASH && op == SW_TABLE_FIND_EQ)
+    {
+        sw_spinlock(&sindex->lock);
+        swTableSlot *slot = swTableColumnIndex_lookup(sindex, swTableColumnIndex_hash(col->type, buf), buf);
+        for (n = slot ? slot->row : 0; n && count < max; n = sindex->chain[n - 1].next)
+        {
+            rows[count++] = swTable_get_row(table, n - 1);
+        }
+        sw_spinlock_release(&sindex->lock);
+    }
+    else if (sindex && sindex->type == SW_TABLE_INDEX_ORDERED
+            && (op == SW_TABLE_FIND_EQ || op == SW_TABLE_FIND_GT || op == SW_TABLE_FIND_LT
+                    || (op == SW_TABLE_FIND_LEFTLIKE && col->type == SW_TABLE_STRING)))
+    {
+        sw_spinlock(&sindex->lock);
+        if (op == SW_TABLE_FIND_LT)
+        {
+            n = sindex->nodes[table->max_size].next[0];
+        }
+        else
+        {
+            //a prefix is never greater than the strings starting with it
+            n = swTableSkipList_lower_bound(sindex, buf, op == SW_TABLE_FIND_GT);
+        }
+        for (; n && count < max; n = sindex->nodes[n - 1].next[0])
+        {
+            data = swTableColumnIndex_value(sindex, n - 1);
+            if (!swTableColumn_match(col, data, op, buf))
+            {
+                break;
+            }
+            rows[count++] = swTable_get_row(table, n - 1);
+        }
+        sw_spinlock_release(&sindex->lock);
+    }
+    else
+    {
+        swTableRow *row;
+        for (i = 0; i < table->rows_used && count < max; i++)
+        {
+            row = swTable_get_row(table, i);
+            if (row->active && swTableColumn_match(col, row->data + col->index, op, buf))
+            {
+                rows[count++] = row;
+            }
+        }
+    }
+
+    return count;
 }
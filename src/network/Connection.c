@@ -21,6 +21,11 @@
 #include "Connection.h"
 
 #include <sys/stat.h>
+#include <limits.h>
+
+#ifndef IOV_MAX
+#define IOV_MAX     1024
+#endif
 
 #ifndef MSG_NOSIGNAL
 #define MSG_NOSIGNAL        0
@@ -111,7 +116,8 @@ int swConnection_onSendfile(swConnection *conn, swBuffer_trunk *chunk)
 }
 
 /**
- * send buffer to client
+ * send buffer to client, the data trunks at the head of the chain of a stream socket are sent with one sendmsg.
+ * SW_CHUNK_SENDFILE and SW_CHUNK_CLOSE trunks stop the gather, they are handled by the caller.
  */
 int swConnection_buffer_send(swConnection *conn)
 {
@@ -127,7 +133,45 @@ int swConnection_buffer_send(swConnection *conn)
         return SW_OK;
     }
 
-    ret = swConnection_send(conn, trunk->store.ptr + trunk->offset, sendn, 0);
+    //the pipes are dgram sockets, a gather send would join the messages
+    int gather = trunk->next != NULL && (swSocket_is_stream(conn->socket_type) || conn->fdtype == SW_FD_STREAM_CLIENT);
+#ifdef SW_USE_OPENSSL
+    if (conn->ssl)
+    {
+        gather = 0;
+    }
+#endif
+
+    if (!gather)
+    {
+        ret = swConnection_send(conn, trunk->store.ptr + trunk->offset, sendn, 0);
+    }
+    else
+    {
+        struct iovec iov[IOV_MAX];
+        int iovcnt = 0;
+        for (; trunk && iovcnt < IOV_MAX; trunk = trunk->next)
+        {
+            if (trunk->type != SW_CHUNK_DATA && trunk->type != SW_CHUNK_SHARED)
+            {
+                break;
+            }
+            if (trunk->length == trunk->offset)
+            {
+                continue;
+            }
+            iov[iovcnt].iov_base = trunk->store.ptr + trunk->offset;
+            iov[iovcnt].iov_len = trunk->length - trunk->offset;
+            iovcnt++;
+        }
+        //MSG_NOSIGNAL: the async clients of php-cli do not ignore SIGPIPE
+        struct msghdr msg;
+        bzero(&msg, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iovcnt;
+        ret = sendmsg(conn->fd, &msg, MSG_NOSIGNAL);
+    }
+
     if (ret < 0)
     {
         switch (swConnection_error(errno))
@@ -146,14 +190,23 @@ int swConnection_buffer_send(swConnection *conn)
         }
         return SW_OK;
     }
-    //trunk full send
-    else if (ret == sendn || sendn == 0)
+
+    //pop the trunks which are sent completely
+    while (1)
     {
+        trunk = swBuffer_get_trunk(buffer);
+        sendn = trunk->length - trunk->offset;
+        if (ret < sendn)
+        {
+            trunk->offset += ret;
+            break;
+        }
+        ret -= sendn;
         swBuffer_pop_trunk(buffer, trunk);
-    }
-    else
-    {
-        trunk->offset += ret;
+        if (ret == 0)
+        {
+            break;
+        }
     }
     return SW_OK;
 }
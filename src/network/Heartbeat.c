@@ -0,0 +1,166 @@
+/*
+  +----------------------------------------------------------------------+
+  | Swoole                                                               |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 2.0 of the Apache license,    |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.apache.org/licenses/LICENSE-2.0.html                      |
+  | If you did not receive a copy of the Apache2.0 license and are unable|
+  | to obtain it through the world-wide-web, please send a note to       |
+  | license@swoole.com so we can mail you a copy immediately.            |
+  +----------------------------------------------------------------------+
+  | Author: Tianfeng Han  <mikan.tenny@gmail.com>                        |
+  +----------------------------------------------------------------------+
+*/
+
+#include "swoole.h"
+#include "Server.h"
+
+static void swHeartbeat_link(swHeartbeat *hb, swConnection *conn, time_t expire);
+
+/**
+ * the wheel must cover idle_time seconds, slots >= idle_time + 2
+ */
+int swHeartbeat_create(swHeartbeat *hb, swConnection *connection_list, uint16_t idle_time, time_t now)
+{
+    uint32_t size = 64;
+    while (size < (uint32_t) idle_time + 2)
+    {
+        size <<= 1;
+    }
+
+    bzero(hb, sizeof(swHeartbeat));
+    hb->slots = sw_calloc(size, sizeof(int));
+    if (hb->slots == NULL)
+    {
+        swSysError("calloc(%d) failed.", (int ) (size * sizeof(int)));
+        return SW_ERR;
+    }
+    hb->size = size;
+    hb->mask = size - 1;
+    hb->idle_time = idle_time;
+    hb->current = now;
+    hb->connection_list = connection_list;
+    return SW_OK;
+}
+
+void swHeartbeat_free(swHeartbeat *hb)
+{
+    if (hb->slots)
+    {
+        sw_free(hb->slots);
+        hb->slots = NULL;
+    }
+}
+
+static void swHeartbeat_link(swHeartbeat *hb, swConnection *conn, time_t expire)
+{
+    //the slot must be in (current, current + size)
+    if (expire <= hb->current)
+    {
+        expire = hb->current + 1;
+    }
+    else if (expire - hb->current >= hb->size)
+    {
+        expire = hb->current + hb->size - 1;
+    }
+
+    int *head = &hb->slots[expire & hb->mask];
+
+    conn->idle_expire = expire;
+    conn->idle_prev = 0;
+    conn->idle_next = *head;
+    if (*head)
+    {
+        hb->connection_list[*head].idle_prev = conn->fd;
+    }
+    *head = conn->fd;
+    hb->num++;
+}
+
+void swHeartbeat_add(swHeartbeat *hb, swConnection *conn)
+{
+    sw_spinlock(&hb->lock);
+    swHeartbeat_link(hb, conn, conn->last_time + hb->idle_time);
+    sw_spinlock_release(&hb->lock);
+}
+
+void swHeartbeat_del(swHeartbeat *hb, swConnection *conn)
+{
+    sw_spinlock(&hb->lock);
+    if (conn->idle_expire == 0)
+    {
+        sw_spinlock_release(&hb->lock);
+        return;
+    }
+    if (conn->idle_prev)
+    {
+        hb->connection_list[conn->idle_prev].idle_next = conn->idle_next;
+    }
+    else
+    {
+        hb->slots[conn->idle_expire & hb->mask] = conn->idle_next;
+    }
+    if (conn->idle_next)
+    {
+        hb->connection_list[conn->idle_next].idle_prev = conn->idle_prev;
+    }
+    conn->idle_expire = 0;
+    conn->idle_prev = 0;
+    conn->idle_next = 0;
+    hb->num--;
+    sw_spinlock_release(&hb->lock);
+}
+
+/**
+ * check the slots from the last time to now, only the connections in these slots are visited.
+ * The active connections are moved to the slot of last_time + idle_time, the others are passed to onExpire.
+ * Return the number of expired connections.
+ */
+int swHeartbeat_check(swHeartbeat *hb, time_t now, void (*onExpire)(swHeartbeat *hb, swConnection *conn, void *arg), void *arg)
+{
+    swConnection *conn;
+    time_t expire;
+    int fd, next, n = 0;
+
+    sw_spinlock(&hb->lock);
+    //every slot has been visited once
+    if (now - hb->current > hb->size)
+    {
+        hb->current = now - hb->size;
+    }
+    while (hb->current < now)
+    {
+        hb->current++;
+        fd = hb->slots[hb->current & hb->mask];
+        hb->slots[hb->current & hb->mask] = 0;
+
+        for (; fd != 0; fd = next)
+        {
+            conn = &hb->connection_list[fd];
+            next = conn->idle_next;
+            conn->idle_expire = 0;
+            conn->idle_prev = 0;
+            conn->idle_next = 0;
+            hb->num--;
+
+            expire = conn->protect ? hb->current + hb->idle_time : conn->last_time + hb->idle_time;
+            if (expire > hb->current)
+            {
+                swHeartbeat_link(hb, conn, expire);
+                continue;
+            }
+            n++;
+            /**
+             * the detached connections are only closed by this thread,
+             * onExpire may close the connection without the lock.
+             */
+            sw_spinlock_release(&hb->lock);
+            onExpire(hb, conn, arg);
+            sw_spinlock(&hb->lock);
+        }
+    }
+    sw_spinlock_release(&hb->lock);
+    return n;
+}
@@ -535,6 +535,12 @@ static int swManager_loop_sync(swFactory *factory)
                 {
                     swManager_check_exit_status(serv, i, pid, status);
                     pid = 0;
+                    if (swWorker_reclaim_chunks(&serv->workers[i]) > 0)
+                    {
+                        swWarn("the unsent response chunks of worker#%d are reclaimed.", i);
+                    }
+                    //the messages in flight of the dead worker are never finished
+                    serv->workers[i].dispatch_count = 0;
                     while (1)
                     {
                         new_pid = swManager_spawn_worker(factory, i);
@@ -20,6 +20,11 @@
 #include "websocket.h"
 #include "mqtt.h"
 
+#if defined(HAVE_REUSEPORT) && defined(__linux__)
+#include <linux/filter.h>
+#endif
+
+static int swPort_listen(swListenPort *ls, int sock);
 static int swPort_onRead_raw(swReactor *reactor, swListenPort *lp, swEvent *event);
 static int swPort_onRead_check_length(swReactor *reactor, swListenPort *lp, swEvent *event);
 static int swPort_onRead_check_eof(swReactor *reactor, swListenPort *lp, swEvent *event);
@@ -52,12 +57,11 @@ int swPort_set_option(swListenPort *ls)
 {
     int sock = ls->sock;
 
-    //reuse address
-    int option = 1;
     //reuse port
 #ifdef HAVE_REUSEPORT
     if (SwooleG.reuse_port)
     {
+        int option = 1;
         if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &option, sizeof(int)) < 0)
         {
             swSysError("setsockopt(SO_REUSEPORT) failed.");
@@ -125,6 +129,25 @@ int swPort_set_option(swListenPort *ls)
 #endif
 
     //listen stream socket
+    if (swPort_listen(ls, sock) < 0)
+    {
+        return SW_ERR;
+    }
+    int i;
+    for (i = 1; ls->reuse_sock && i < SwooleG.serv->reactor_num; i++)
+    {
+        if (swPort_listen(ls, ls->reuse_sock[i]) < 0)
+        {
+            return SW_ERR;
+        }
+    }
+    return SW_OK;
+}
+
+static int swPort_listen(swListenPort *ls, int sock)
+{
+    int option;
+
     if (listen(sock, ls->backlog) < 0)
     {
         swWarn("listen(%s:%d, %d) failed. Error: %s[%d]", ls->host, ls->port, ls->backlog, strerror(errno), errno);
@@ -169,6 +192,90 @@ int swPort_set_option(swListenPort *ls)
     return SW_OK;
 }
 
+/**
+ * replace the listen socket with a SO_REUSEPORT group, one socket for every reactor thread.
+ * The fd of ls->sock is kept.
+ */
+int swPort_create_reuseport(swListenPort *ls, int num, int cbpf)
+{
+#ifdef HAVE_REUSEPORT
+    int option = 1;
+    int i, sock;
+
+    if (ls->type != SW_SOCK_TCP && ls->type != SW_SOCK_TCP6)
+    {
+        return SW_ERR;
+    }
+
+    ls->reuse_sock = sw_calloc(num, sizeof(int));
+    if (ls->reuse_sock == NULL)
+    {
+        swSysError("calloc(%d) failed.", num);
+        return SW_ERR;
+    }
+
+    //ls->sock is bound without SO_REUSEPORT
+    close(ls->sock);
+
+    for (i = 0; i < num; i++)
+    {
+        sock = swSocket_create(ls->type);
+        if (sock < 0)
+        {
+            swSysError("create socket failed.");
+            return SW_ERR;
+        }
+        if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &option, sizeof(int)) < 0)
+        {
+            swSysError("setsockopt(SO_REUSEPORT) failed.");
+            close(sock);
+            return SW_ERR;
+        }
+        if (swSocket_bind(sock, ls->type, ls->host, ls->port) < 0)
+        {
+            close(sock);
+            return SW_ERR;
+        }
+        swSetNonBlock(sock);
+        //the sockets join the group in order, the socket index is the reactor id
+        if (i == 0 && sock != ls->sock)
+        {
+            if (dup2(sock, ls->sock) < 0)
+            {
+                swSysError("dup2(%d, %d) failed.", sock, ls->sock);
+                close(sock);
+                return SW_ERR;
+            }
+            close(sock);
+            sock = ls->sock;
+        }
+        ls->reuse_sock[i] = sock;
+    }
+
+#if defined(SO_ATTACH_REUSEPORT_CBPF) && defined(SKF_AD_CPU)
+    if (cbpf)
+    {
+        //socket index = cpu % num
+        struct sock_filter code[] = {
+            { BPF_LD | BPF_W | BPF_ABS, 0, 0, SKF_AD_OFF + SKF_AD_CPU },
+            { BPF_ALU | BPF_MOD | BPF_K, 0, 0, num },
+            { BPF_RET | BPF_A, 0, 0, 0 },
+        };
+        struct sock_fprog prog;
+        prog.len = sizeof(code) / sizeof(code[0]);
+        prog.filter = code;
+        if (setsockopt(ls->sock, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) < 0)
+        {
+            swSysError("setsockopt(SO_ATTACH_REUSEPORT_CBPF) failed.");
+        }
+    }
+#endif
+    return SW_OK;
+#else
+    return SW_ERR;
+#endif
+}
+
 static int swPort_websocket_onPackage(swConnection *conn, char *data, uint32_t length)
 {
     swString frame;
@@ -347,6 +454,25 @@ static int swPort_onRead_check_length(swReactor *reactor, swListenPort *port, sw
 /**
  * For Http Protocol
  */
+/**
+ * the http server gets the header index after the request, see swHttpIndex
+ */
+static int swPort_http_dispatch(swConnection *conn, swHttpRequest *request)
+{
+    swString *buffer = request->buffer;
+    uint32_t length = buffer->length;
+
+    if (SwooleG.serv->http_header_index)
+    {
+        if (swString_append_ptr(buffer, (char *) request->index, swHttpIndex_size(request->index)) < 0
+                || swString_append_ptr(buffer, (char *) &length, sizeof(length)) < 0)
+        {
+            return SW_ERR;
+        }
+    }
+    return swReactorThread_dispatch(conn, buffer->str, buffer->length);
+}
+
 static int swPort_onRead_http(swReactor *reactor, swListenPort *port, swEvent *event)
 {
     swConnection *conn = event->socket;
@@ -447,156 +573,99 @@ static int swPort_onRead_http(swReactor *reactor, swListenPort *port, swEvent *e
             goto close_fd;
         }
 
-        //DELETE
-        if (request->method == HTTP_DELETE)
-        {
-            if (request->content_length == 0 && swHttpRequest_have_content_length(request) == SW_FALSE)
-            {
-                goto http_no_entity;
-            }
-            else
-            {
-                goto http_entity;
-            }
-        }
-        //GET HEAD OPTIONS
-        else if (request->method == HTTP_GET || request->method == HTTP_HEAD || request->method == HTTP_OPTIONS)
+#ifdef SW_USE_HTTP2
+        if (request->method == HTTP_PRI)
         {
-            http_no_entity:
-            if (memcmp(buffer->str + buffer->length - 4, "\r\n\r\n", 4) == 0)
+            conn->http2_stream = 1;
+            swHttp2_send_setting_frame(protocol, conn);
+            if (n == sizeof(SW_HTTP2_PRI_STRING) - 1)
             {
-                swReactorThread_dispatch(conn, buffer->str, buffer->length);
                 swHttpRequest_free(conn);
+                return SW_OK;
             }
-            else if (buffer->size == buffer->length)
-            {
-                swWarn("[0]http header is too long.");
-                goto close_fd;
-            }
-            //wait more data
-            else
-            {
-                goto recv_data;
-            }
+            swHttp2_parse_frame(protocol, conn, buf + (sizeof(SW_HTTP2_PRI_STRING) - 1), n - (sizeof(SW_HTTP2_PRI_STRING) - 1));
+            swHttpRequest_free(conn);
+            return SW_OK;
         }
-        //POST PUT HTTP_PATCH
-        else if (request->method == HTTP_POST || request->method == HTTP_PUT || request->method == HTTP_PATCH)
-        {
-            http_entity:
-            if (request->content_length == 0)
-            {
-                if (swHttpRequest_get_content_length(request) < 0)
-                {
-                    if (buffer->size == buffer->length)
-                    {
-                        swWarn("[1]http header is too long.");
-                        goto close_fd;
-                    }
-                    else
-                    {
-                        goto recv_data;
-                    }
-                }
-                else if (request->content_length > protocol->package_max_length)
-                {
-                    swWarn("content-length more than the package_max_length[%d].", protocol->package_max_length);
-                    goto close_fd;
-                }
-            }
-
-            uint32_t request_size = 0;
+#endif
 
-            //http header is not the end
-            if (request->header_length == 0)
+        //the header is parsed only once, when it is complete
+        if (request->header_length == 0)
+        {
+            if (swHttpRequest_get_header_length(request) < 0)
             {
                 if (buffer->size == buffer->length)
                 {
-                    swWarn("[2]http header is too long.");
+                    swWarn("[0]http header is too long.");
                     goto close_fd;
                 }
-                if (swHttpRequest_get_header_length(request) < 0)
-                {
-                    goto recv_data;
-                }
-                request_size = request->content_length + request->header_length;
+                goto recv_data;
             }
-            else
+            if (swHttpRequest_parse_header(request) < 0)
             {
-                request_size = request->content_length + request->header_length;
+                swWarn("bad http header.");
+                goto close_fd;
             }
-
-            if (request_size > buffer->size && swString_extend(buffer, request_size) < 0)
+            if (request->content_length > protocol->package_max_length)
             {
+                swWarn("content-length more than the package_max_length[%d].", protocol->package_max_length);
                 goto close_fd;
             }
+        }
 
-            //discard the redundant data
-            if (buffer->length > request_size)
-            {
-                buffer->length = request_size;
-            }
+        uint32_t request_size = request->content_length + request->header_length;
 
-            if (buffer->length == request_size)
-            {
-                swReactorThread_dispatch(conn, buffer->str, buffer->length);
-                swHttpRequest_free(conn);
-            }
-            else
-            {
+        if (request_size > buffer->size && swString_extend(buffer, request_size) < 0)
+        {
+            goto close_fd;
+        }
+
+        //discard the redundant data
+        if (buffer->length > request_size)
+        {
+            buffer->length = request_size;
+        }
+
+        if (buffer->length == request_size)
+        {
+            swPort_http_dispatch(conn, request);
+            swHttpRequest_free(conn);
+        }
+        else
+        {
 #ifdef SW_HTTP_100_CONTINUE
-                //Expect: 100-continue
-                if (swHttpRequest_has_expect_header(request))
+            //Expect: 100-continue
+            if (swHttpRequest_has_expect_header(request))
+            {
+                swSendData _send;
+                _send.data = "HTTP/1.1 100 Continue\r\n\r\n";
+                _send.length = strlen(_send.data);
+
+                int send_times = 0;
+                direct_send:
+                n = swConnection_send(conn, _send.data, _send.length, 0);
+                if (n < _send.length)
                 {
-                    swSendData _send;
-                    _send.data = "HTTP/1.1 100 Continue\r\n\r\n";
-                    _send.length = strlen(_send.data);
-
-                    int send_times = 0;
-                    direct_send:
-                    n = swConnection_send(conn, _send.data, _send.length, 0);
-                    if (n < _send.length)
+                    _send.data += n;
+                    _send.length -= n;
+                    send_times++;
+                    if (send_times < 10)
                     {
-                        _send.data += n;
-                        _send.length -= n;
-                        send_times++;
-                        if (send_times < 10)
-                        {
-                            goto direct_send;
-                        }
-                        else
-                        {
-                            swWarn("send http header failed");
-                        }
+                        goto direct_send;
+                    }
+                    else
+                    {
+                        swWarn("send http header failed");
                     }
                 }
-                else
-                {
-                    swTrace("PostWait: request->content_length=%d, buffer->length=%zd, request->header_length=%d\n",
-                            request->content_length, buffer->length, request->header_length);
-                }
-#endif
-                goto recv_data;
             }
-        }
-#ifdef SW_USE_HTTP2
-        else if (request->method == HTTP_PRI)
-        {
-            conn->http2_stream = 1;
-            swHttp2_send_setting_frame(protocol, conn);
-            if (n == sizeof(SW_HTTP2_PRI_STRING) - 1)
+            else
             {
-                swHttpRequest_free(conn);
-                return SW_OK;
+                swTrace("PostWait: request->content_length=%d, buffer->length=%zd, request->header_length=%d\n",
+                        request->content_length, buffer->length, request->header_length);
             }
-            swHttp2_parse_frame(protocol, conn, buf + (sizeof(SW_HTTP2_PRI_STRING) - 1), n - (sizeof(SW_HTTP2_PRI_STRING) - 1));
-            swHttpRequest_free(conn);
-            return SW_OK;
-        }
 #endif
-        else
-        {
-            swWarn("method no support");
-            goto close_fd;
+            goto recv_data;
         }
     }
     return SW_OK;
@@ -634,6 +703,16 @@ void swPort_free(swListenPort *port)
 #endif
 
     close(port->sock);
+    if (port->reuse_sock)
+    {
+        int i;
+        for (i = 1; i < SwooleG.serv->reactor_num; i++)
+        {
+            close(port->reuse_sock[i]);
+        }
+        sw_free(port->reuse_sock);
+        port->reuse_sock = NULL;
+    }
 
     //remove unix socket file
     if (port->type == SW_SOCK_UNIX_STREAM || port->type == SW_SOCK_UNIX_DGRAM)
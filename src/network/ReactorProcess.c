@@ -20,9 +20,11 @@ static int swReactorProcess_loop(swProcessPool *pool, swWorker *worker);
 static int swReactorProcess_onPipeRead(swReactor *reactor, swEvent *event);
 static int swReactorProcess_send2client(swFactory *, swSendData *);
 static void swReactorProcess_onTimeout(swReactor *reactor);
+static void swReactorProcess_onFinish(swReactor *reactor);
+static void swReactorProcess_heartbeat(swReactor *reactor);
 
-static uint32_t heartbeat_check_lasttime = 0;
 static void (*swReactor_onTimeout_old)(swReactor *reactor);
+static void (*swReactor_onFinish_old)(swReactor *reactor);
 
 int swReactorProcess_create(swServer *serv)
 {
@@ -84,6 +86,12 @@ int swReactorProcess_start(swServer *serv)
         }
     }
 
+    //served by the first worker
+    if (serv->stats_port > 0 && swServer_stats_listen(serv) < 0)
+    {
+        return SW_ERR;
+    }
+
     if (swProcessPool_create(&SwooleGS->event_workers, serv->worker_num, serv->max_request, 0, 1) < 0)
     {
         return SW_ERR;
@@ -226,6 +234,7 @@ static int swReactorProcess_loop(swProcessPool *pool, swWorker *worker)
     SwooleWG.request_count = 0;
     
     SwooleTG.id = 0;
+    SwooleTG.buffer_pool = &serv->reactor_threads[0].buffer_pool;
     if (worker->id == 0)
     {
         SwooleTG.update_time = 1;
@@ -331,6 +340,11 @@ static int swReactorProcess_loop(swProcessPool *pool, swWorker *worker)
         reactor->add(reactor, worker->pipe_master, SW_FD_PIPE);
     }
 
+    if (serv->stats_port > 0 && worker->id == 0 && swServer_stats_add(serv, reactor) < 0)
+    {
+        return SW_ERR;
+    }
+
     //task workers
     if (SwooleG.task_worker_num > 0)
     {
@@ -364,8 +378,14 @@ static int swReactorProcess_loop(swProcessPool *pool, swWorker *worker)
      */
     if (serv->heartbeat_check_interval > 0)
     {
+        if (swHeartbeat_create(&serv->reactor_threads[0].heartbeat, serv->connection_list, serv->heartbeat_idle_time, SwooleGS->now) < 0)
+        {
+            return SW_ERR;
+        }
         swReactor_onTimeout_old = reactor->onTimeout;
         reactor->onTimeout = swReactorProcess_onTimeout;
+        swReactor_onFinish_old = reactor->onFinish;
+        reactor->onFinish = swReactorProcess_onFinish;
     }
 
     struct timeval timeo;
@@ -471,45 +491,44 @@ static int swReactorProcess_send2client(swFactory *factory, swSendData *_send)
     }
 }
 
-static void swReactorProcess_onTimeout(swReactor *reactor)
+static void swReactorProcess_onIdle(swHeartbeat *hb, swConnection *conn, void *arg)
 {
-    swServer *serv = reactor->ptr;
     swEvent notify_ev;
-    swConnection *conn;
-
-    swReactor_onTimeout_old(reactor);
 
-    if (SwooleGS->now < heartbeat_check_lasttime + 10)
+    if (conn->active == 0 || conn->fdtype != SW_FD_TCP)
     {
         return;
     }
-
-    int fd;
-    int serv_max_fd;
-    int serv_min_fd;
-    int checktime;
-
     bzero(&notify_ev, sizeof(notify_ev));
     notify_ev.type = SW_EVENT_CLOSE;
+    notify_ev.fd = conn->fd;
+    notify_ev.from_id = conn->from_id;
+    swReactorProcess_onClose((swReactor *) arg, &notify_ev);
+}
 
-    serv_max_fd = swServer_get_maxfd(serv);
-    serv_min_fd = swServer_get_minfd(serv);
-
-    checktime = SwooleGS->now - serv->heartbeat_idle_time;
+/**
+ * only the expired slots of the heartbeat wheel are checked
+ */
+static void swReactorProcess_heartbeat(swReactor *reactor)
+{
+    swServer *serv = reactor->ptr;
+    swHeartbeat *hb = &serv->reactor_threads[0].heartbeat;
 
-    for (fd = serv_min_fd; fd <= serv_max_fd; fd++)
+    if (SwooleGS->now - hb->current < serv->heartbeat_check_interval)
     {
-        conn = swServer_connection_get(serv, fd);
-
-        if (conn != NULL && conn->active == 1 && conn->fdtype == SW_FD_TCP)
-        {
-            if (conn->protect || conn->last_time > checktime)
-            {
-                continue;
-            }
-            notify_ev.fd = fd;
-            notify_ev.from_id = conn->from_id;
-            swReactorProcess_onClose(reactor, &notify_ev);
-        }
+        return;
     }
+    swHeartbeat_check(hb, SwooleGS->now, swReactorProcess_onIdle, reactor);
+}
+
+static void swReactorProcess_onTimeout(swReactor *reactor)
+{
+    swReactor_onTimeout_old(reactor);
+    swReactorProcess_heartbeat(reactor);
+}
+
+static void swReactorProcess_onFinish(swReactor *reactor)
+{
+    swReactor_onFinish_old(reactor);
+    swReactorProcess_heartbeat(reactor);
 }
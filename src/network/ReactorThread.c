@@ -23,6 +23,10 @@ static int swReactorThread_loop_dgram(swThreadParam *param);
 static int swReactorThread_loop_stream(swThreadParam *param);
 static int swReactorThread_onPipeWrite(swReactor *reactor, swEvent *ev);
 static int swReactorThread_onPipeReceive(swReactor *reactor, swEvent *ev);
+static int swReactorThread_onRingReceive(swReactor *reactor, swEvent *ev);
+static int swReactorThread_send2worker_ring(swServer *serv, void *data, int len, uint16_t target_worker_id);
+static int swReactorThread_broadcast(swSendData *_send);
+static int swReactorThread_send_chunks(swSendData *_send);
 
 static int swReactorThread_onRead(swReactor *reactor, swEvent *ev);
 static int swReactorThread_onWrite(swReactor *reactor, swEvent *ev);
@@ -277,8 +281,8 @@ int swReactorThread_close(swReactor *reactor, int fd)
 
     if (serv->factory_mode == SW_MODE_PROCESS)
     {
-        assert(fd % serv->reactor_num == reactor->id);
-        assert(fd % serv->reactor_num == SwooleTG.id);
+        assert(conn->from_id == reactor->id);
+        assert(conn->from_id == SwooleTG.id);
     }
 
     sw_atomic_fetch_add(&SwooleStats->close_count, 1);
@@ -286,6 +290,11 @@ int swReactorThread_close(swReactor *reactor, int fd)
 
     swTrace("Close Event.fd=%d|from=%d", fd, reactor->id);
 
+    if (conn->idle_expire)
+    {
+        swHeartbeat_del(swServer_get_heartbeat(serv, conn->from_id), conn);
+    }
+
 #ifdef SW_USE_OPENSSL
     if (conn->ssl)
     {
@@ -317,8 +326,7 @@ int swReactorThread_close(swReactor *reactor, int fd)
 #endif
 
 #ifdef SW_REACTOR_USE_SESSION
-    swSession *session = swServer_get_session(serv, conn->session_id);
-    session->fd = 0;
+    swServer_session_free(serv, conn->session_id);
 #endif
 
     /**
@@ -334,13 +342,54 @@ int swReactorThread_close(swReactor *reactor, int fd)
          */
         for (; serv->connection_list[find_max_fd].active == 0 && find_max_fd > swServer_get_minfd(serv); find_max_fd--)
             ;
-        swServer_set_maxfd(serv, find_max_fd);
+        //the reactor threads may raise maxfd at the same time in reactor_accept mode
+        sw_atomic_cmp_set(&serv->connection_list[SW_SERVER_MAX_FD_INDEX].fd, fd, find_max_fd);
         SwooleGS->lock.unlock(&SwooleGS->lock);
     }
 
+    //the reactor threads have no timeout callback, enable accept once a file descriptor is released
+    if (reactor->disable_accept && SwooleTG.type == SW_THREAD_REACTOR)
+    {
+        int ret = swReactor_close(reactor, fd);
+        reactor->enable_accept(reactor);
+        reactor->disable_accept = 0;
+        return ret;
+    }
     return swReactor_close(reactor, fd);
 }
 
+/**
+ * heartbeat: notify the reactor thread to close the idle connection
+ */
+static void swReactorThread_onIdle(swHeartbeat *hb, swConnection *conn, void *arg)
+{
+    swReactor *reactor = arg;
+
+    if (conn->active == 0 || conn->fdtype != SW_FD_TCP)
+    {
+        return;
+    }
+    conn->close_force = 1;
+    conn->close_notify = 1;
+    conn->close_wait = 1;
+    reactor->set(reactor, conn->fd, SW_FD_TCP | SW_EVENT_WRITE);
+}
+
+/**
+ * heartbeat: called after every event loop, only the expired slots of the wheel are checked
+ */
+static void swReactorThread_onHeartbeat(swReactor *reactor)
+{
+    swServer *serv = reactor->ptr;
+    swHeartbeat *hb = swServer_get_heartbeat(serv, reactor->id);
+
+    if (SwooleGS->now - hb->current < serv->heartbeat_check_interval)
+    {
+        return;
+    }
+    swHeartbeat_check(hb, SwooleGS->now, swReactorThread_onIdle, reactor);
+}
+
 /**
  * close the connection
  */
@@ -356,8 +405,8 @@ int swReactorThread_onClose(swReactor *reactor, swEvent *event)
     swDataHead notify_ev;
     bzero(&notify_ev, sizeof(notify_ev));
 
-    assert(fd % serv->reactor_num == reactor->id);
-    assert(fd % serv->reactor_num == SwooleTG.id);
+    assert(serv->connection_list[fd].from_id == reactor->id);
+    assert(serv->connection_list[fd].from_id == SwooleTG.id);
 
     notify_ev.from_id = reactor->id;
     notify_ev.fd = fd;
@@ -392,9 +441,6 @@ static int swReactorThread_onPipeReceive(swReactor *reactor, swEvent *ev)
     swEventData resp;
     swSendData _send;
 
-    swPackage_response pkg_resp;
-    swWorker *worker;
-
 #ifdef SW_REACTOR_RECV_AGAIN
     while (1)
 #endif
@@ -411,25 +457,9 @@ static int swReactorThread_onPipeReceive(swReactor *reactor, swEvent *ev)
             }
             else
             {
-                memcpy(&pkg_resp, resp.data, sizeof(pkg_resp));
-                worker = swServer_get_worker(SwooleG.serv, pkg_resp.worker_id);
-
-                _send.data = worker->send_shm;
-                _send.length = pkg_resp.length;
-
-#if 0
-                struct
-                {
-                    uint32_t worker;
-                    uint32_t index;
-                    uint32_t serid;
-                } pkg_header;
-
-                memcpy(&pkg_header, _send.data + 4, sizeof(pkg_header));
-                swWarn("fd=%d, worker=%d, index=%d, serid=%d", _send.info.fd, pkg_header.worker, pkg_header.index, pkg_header.serid);
-#endif
-                swReactorThread_send(&_send);
-                worker->lock.unlock(&worker->lock);
+                _send.data = resp.data;
+                _send.length = resp.info.len;
+                swReactorThread_send_chunks(&_send);
             }
         }
         else if (errno == EAGAIN)
@@ -446,6 +476,116 @@ static int swReactorThread_onPipeReceive(swReactor *reactor, swEvent *ev)
     return SW_OK;
 }
 
+/**
+ * receive responses from the worker rings, then retry the parked requests.
+ */
+static int swReactorThread_onRingReceive(swReactor *reactor, swEvent *ev)
+{
+    swServer *serv = reactor->ptr;
+    swReactorThread *thread = swServer_get_thread(serv, reactor->id);
+    swShmRing *ring;
+    swSendData _send;
+    swBuffer *buffer;
+    swBuffer_trunk *trunk;
+    uint64_t flag;
+    uint32_t length;
+    char *data;
+    int i;
+
+    if (read(ev->fd, &flag, sizeof(flag)) < 0 && errno != EAGAIN)
+    {
+        swSysError("read(ring_notify) failed.");
+    }
+    serv->ipc_ring_signaled[serv->worker_num + reactor->id] = 0;
+    sw_atomic_memory_barrier();
+
+    for (i = 0; i < serv->worker_num; i++)
+    {
+        ring = swServer_response_ring(serv, i, reactor->id);
+        while ((data = swShmRing_front(ring, &length)) != NULL)
+        {
+            memcpy(&_send.info, data, sizeof(_send.info));
+            _send.data = data + sizeof(_send.info);
+            _send.length = length - sizeof(_send.info);
+            swReactorThread_send(&_send);
+            swShmRing_pop(ring);
+        }
+        if (ring->waiting)
+        {
+            ring->waiting = 0;
+            swServer_ring_notify(serv, i);
+        }
+
+        buffer = thread->ring_buffer[i];
+        if (swBuffer_empty(buffer))
+        {
+            continue;
+        }
+        ring = swServer_request_ring(serv, reactor->id, i);
+        while ((trunk = swBuffer_get_trunk(buffer)) != NULL)
+        {
+            if (swShmRing_push(ring, trunk->store.ptr, trunk->length, NULL, 0) < 0)
+            {
+                //the worker wakes us up after it drained the ring
+                ring->waiting = 1;
+                sw_atomic_memory_barrier();
+                if (swShmRing_push(ring, trunk->store.ptr, trunk->length, NULL, 0) < 0)
+                {
+                    break;
+                }
+            }
+            swBuffer_pop_trunk(buffer, trunk);
+        }
+        swServer_ring_notify(serv, i);
+    }
+    return SW_OK;
+}
+
+/**
+ * [ReactorThread] push to the request ring, park the message in the local buffer when the ring is full.
+ */
+static int swReactorThread_send2worker_ring(swServer *serv, void *data, int len, uint16_t target_worker_id)
+{
+    swReactorThread *thread = swServer_get_thread(serv, SwooleTG.id);
+    swShmRing *ring = swServer_request_ring(serv, SwooleTG.id, target_worker_id);
+    swBuffer *buffer = thread->ring_buffer[target_worker_id];
+    char *payload = SwooleTG.factory_payload;
+    uint32_t payload_length = payload ? SwooleTG.factory_payload_length : 0;
+
+    if (swBuffer_empty(buffer))
+    {
+        if (swShmRing_push(ring, data, len, payload, payload_length) == SW_OK)
+        {
+            goto notify;
+        }
+        //the worker wakes us up after it drained the ring
+        ring->waiting = 1;
+        sw_atomic_memory_barrier();
+        if (swShmRing_push(ring, data, len, payload, payload_length) == SW_OK)
+        {
+            goto notify;
+        }
+    }
+
+    swBuffer_trunk *trunk = swBuffer_new_trunk(buffer, SW_CHUNK_DATA, len + payload_length);
+    if (trunk == NULL)
+    {
+        swWarn("append to ring_buffer failed.");
+        return SW_ERR;
+    }
+    memcpy(trunk->store.ptr, data, len);
+    if (payload_length > 0)
+    {
+        memcpy(trunk->store.ptr + len, payload, payload_length);
+    }
+    trunk->length = len + payload_length;
+    buffer->length += trunk->length;
+
+    notify:
+    swServer_ring_notify(serv, target_worker_id);
+    return SW_OK;
+}
+
 int swReactorThread_send2worker(void *data, int len, uint16_t target_worker_id)
 {
     swServer *serv = SwooleG.serv;
@@ -455,8 +595,12 @@ int swReactorThread_send2worker(void *data, int len, uint16_t target_worker_id)
     int ret = -1;
     swWorker *worker = &(serv->workers[target_worker_id]);
 
+    if (serv->ipc_mode == SW_IPC_RING && SwooleTG.type == SW_THREAD_REACTOR)
+    {
+        return swReactorThread_send2worker_ring(serv, data, len, target_worker_id);
+    }
     //reactor thread
-    if (SwooleTG.type == SW_THREAD_REACTOR)
+    else if (SwooleTG.type == SW_THREAD_REACTOR)
     {
         int pipe_fd = worker->pipe_master;
         int thread_id = serv->connection_list[pipe_fd].from_id;
@@ -498,6 +642,7 @@ int swReactorThread_send2worker(void *data, int len, uint16_t target_worker_id)
             }
             else
             {
+                swServer_get_worker_stats(serv, target_worker_id)->pipe_buffer_length = buffer->length;
                 ret = SW_OK;
             }
         }
@@ -513,6 +658,314 @@ int swReactorThread_send2worker(void *data, int len, uint16_t target_worker_id)
     return ret;
 }
 
+static sw_inline void swReactorThread_overflow(swServer *serv, swConnection *conn)
+{
+    swReactorThread *thread = swServer_get_thread(serv, serv->factory_mode == SW_MODE_SINGLE ? 0 : conn->from_id);
+    sw_atomic_fetch_add(&thread->overflow_count, 1);
+    conn->overflow = 1;
+}
+
+static void swReactorThread_broadcast_chunk_destructor(swBuffer_trunk *trunk)
+{
+    swWorker_unref_chunk((swResponse_chunk *) ((char *) trunk->store.ptr - offsetof(swResponse_chunk, data)));
+}
+
+/**
+ * [ReactorThread] the frame of a big broadcast stays in the chunks of the worker,
+ * every out_buffer holds a reference of them.
+ */
+static int swReactorThread_broadcast_chunks(swServer *serv, swPackage_broadcast *pkg)
+{
+    swPackage_response *response = (swPackage_response *) (pkg->session_id + pkg->num);
+    swWorker *worker = swServer_get_worker(serv, response->worker_id);
+    swResponse_chunk *chunk;
+    swBuffer_trunk *trunk;
+    swConnection *conn;
+    swReactor *reactor;
+    uint32_t i, j, offset;
+
+    for (i = 0; i < pkg->num; i++)
+    {
+        conn = swServer_connection_verify(serv, pkg->session_id[i]);
+        if (!conn || conn->closed || conn->removed)
+        {
+            continue;
+        }
+        reactor = &(serv->reactor_threads[conn->from_id].reactor);
+        j = 0;
+        offset = 0;
+
+        if (swBuffer_empty(conn->out_buffer))
+        {
+#ifdef SW_REACTOR_SYNC_SEND
+            int n;
+            while (conn->direct_send && j < response->num)
+            {
+                chunk = swWorker_get_chunk(worker, response->chunk_id[j]);
+                n = swConnection_send(conn, chunk->data, chunk->length, 0);
+                if (n < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                else if (n != chunk->length)
+                {
+                    offset = n > 0 ? n : 0;
+                    break;
+                }
+                j++;
+            }
+            if (j == response->num)
+            {
+                continue;
+            }
+#endif
+            if (!conn->out_buffer)
+            {
+                conn->out_buffer = swBuffer_new(SW_BUFFER_SIZE);
+                if (conn->out_buffer == NULL)
+                {
+                    continue;
+                }
+            }
+        }
+        else if (conn->out_buffer->length >= serv->buffer_output_size)
+        {
+            swoole_error_log(SW_LOG_WARNING, SW_ERROR_OUTPUT_BUFFER_OVERFLOW, "connection#%d output buffer overflow.", conn->fd);
+            swReactorThread_overflow(serv, conn);
+        }
+
+        for (; j < response->num; j++, offset = 0)
+        {
+            chunk = swWorker_get_chunk(worker, response->chunk_id[j]);
+            trunk = swBuffer_new_trunk(conn->out_buffer, SW_CHUNK_SHARED, 0);
+            if (trunk == NULL)
+            {
+                break;
+            }
+            sw_atomic_fetch_add(&chunk->refcount, 1);
+            trunk->store.ptr = chunk->data;
+            trunk->length = chunk->length;
+            trunk->offset = offset;
+            trunk->destroy = swReactorThread_broadcast_chunk_destructor;
+            conn->out_buffer->length += chunk->length;
+        }
+        //listen EPOLLOUT event
+        if (reactor->set(reactor, conn->fd, SW_EVENT_TCP | SW_EVENT_WRITE | SW_EVENT_READ) < 0
+                && (errno == EBADF || errno == ENOENT))
+        {
+            reactor->close(reactor, conn->fd);
+        }
+    }
+
+    //the reference of this message
+    for (j = 0; j < response->num; j++)
+    {
+        swWorker_unref_chunk(swWorker_get_chunk(worker, response->chunk_id[j]));
+    }
+    return SW_OK;
+}
+
+/**
+ * [ReactorThread] the data is copied once and shared by the out_buffer of all the sessions, see swServer_broadcast
+ */
+static int swReactorThread_broadcast(swSendData *_send)
+{
+    swServer *serv = SwooleG.serv;
+    swPackage_broadcast *pkg = (swPackage_broadcast *) _send->data;
+    if (pkg->shared)
+    {
+        return swReactorThread_broadcast_chunks(serv, pkg);
+    }
+    char *data = (char *) (pkg->session_id + pkg->num);
+    uint32_t length = _send->length - sizeof(swPackage_broadcast) - pkg->num * sizeof(uint32_t);
+    swBuffer_shared *shared = NULL;
+    swConnection *conn;
+    swReactor *reactor;
+    uint32_t i;
+    int n;
+
+    for (i = 0; i < pkg->num; i++)
+    {
+        conn = swServer_connection_verify(serv, pkg->session_id[i]);
+        if (!conn || conn->closed || conn->removed)
+        {
+            continue;
+        }
+        reactor = &(serv->reactor_threads[conn->from_id].reactor);
+        n = 0;
+
+        if (swBuffer_empty(conn->out_buffer))
+        {
+#ifdef SW_REACTOR_SYNC_SEND
+            if (conn->direct_send)
+            {
+                n = swConnection_send(conn, data, length, 0);
+                if (n == length)
+                {
+                    continue;
+                }
+                else if (n < 0)
+                {
+                    n = 0;
+                }
+            }
+#endif
+            if (!conn->out_buffer)
+            {
+                conn->out_buffer = swBuffer_new(SW_BUFFER_SIZE);
+                if (conn->out_buffer == NULL)
+                {
+                    continue;
+                }
+            }
+        }
+        else if (conn->out_buffer->length >= serv->buffer_output_size)
+        {
+            swoole_error_log(SW_LOG_WARNING, SW_ERROR_OUTPUT_BUFFER_OVERFLOW, "connection#%d output buffer overflow.", conn->fd);
+            swReactorThread_overflow(serv, conn);
+        }
+
+        if (shared == NULL)
+        {
+            shared = swBuffer_shared_new(data, length);
+            if (shared == NULL)
+            {
+                return SW_ERR;
+            }
+        }
+        if (swBuffer_append_shared(conn->out_buffer, shared, n) < 0)
+        {
+            continue;
+        }
+        //listen EPOLLOUT event
+        if (reactor->set(reactor, conn->fd, SW_EVENT_TCP | SW_EVENT_WRITE | SW_EVENT_READ) < 0
+                && (errno == EBADF || errno == ENOENT))
+        {
+            reactor->close(reactor, conn->fd);
+        }
+    }
+
+    if (shared)
+    {
+        swBuffer_shared_release(shared);
+    }
+    return SW_OK;
+}
+
+static void swReactorThread_chunk_destructor(swBuffer_trunk *trunk)
+{
+    swResponse_chunk *chunk = (swResponse_chunk *) ((char *) trunk->store.ptr - offsetof(swResponse_chunk, data));
+    swWorker *worker = swServer_get_worker(SwooleG.serv, chunk->worker_id);
+    sw_atomic_fetch_sub(&worker->send_shm_used, 1);
+    swWorker_release_chunk(chunk);
+}
+
+/**
+ * [ReactorThread] the big response is referenced from the chunks of worker->send_shm by the out_buffer,
+ * the chunks are released after sent. When the worker is short of chunks (slow clients), they are copied.
+ */
+static int swReactorThread_send_chunks(swSendData *_send)
+{
+    swServer *serv = SwooleG.serv;
+    swPackage_response *pkg = (swPackage_response *) _send->data;
+    swWorker *worker = swServer_get_worker(serv, pkg->worker_id);
+    swResponse_chunk *chunk;
+    swBuffer_trunk *trunk;
+    swReactor *reactor;
+    uint32_t offset = 0;
+    uint32_t i = 0;
+
+    swConnection *conn = swServer_connection_verify(serv, _send->info.fd);
+    if (!conn)
+    {
+        swoole_error_log(SW_LOG_NOTICE, SW_ERROR_SESSION_NOT_EXIST, "send %d byte failed, session#%d does not exist.", pkg->length, _send->info.fd);
+        goto release;
+    }
+    if (conn->removed)
+    {
+        swWarn("connection#%d is closed by client.", conn->fd);
+        goto release;
+    }
+    reactor = &(serv->reactor_threads[conn->from_id].reactor);
+
+    if (swBuffer_empty(conn->out_buffer))
+    {
+#ifdef SW_REACTOR_SYNC_SEND
+        int n = 0;
+        while (conn->direct_send && i < pkg->num)
+        {
+            chunk = swWorker_get_chunk(worker, pkg->chunk_id[i]);
+            n = swConnection_send(conn, chunk->data, chunk->length, 0);
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            else if (n != chunk->length)
+            {
+                offset = n > 0 ? n : 0;
+                break;
+            }
+            swWorker_release_chunk(chunk);
+            i++;
+        }
+        if (i == pkg->num)
+        {
+            return SW_OK;
+        }
+#endif
+        if (!conn->out_buffer)
+        {
+            conn->out_buffer = swBuffer_new(SW_BUFFER_SIZE);
+            if (conn->out_buffer == NULL)
+            {
+                goto release;
+            }
+        }
+    }
+    else if (conn->out_buffer->length >= serv->buffer_output_size)
+    {
+        swoole_error_log(SW_LOG_WARNING, SW_ERROR_OUTPUT_BUFFER_OVERFLOW, "connection#%d output buffer overflow.", conn->fd);
+        swReactorThread_overflow(serv, conn);
+    }
+
+    for (; i < pkg->num; i++, offset = 0)
+    {
+        chunk = swWorker_get_chunk(worker, pkg->chunk_id[i]);
+        if (worker->send_shm_used >= worker->send_shm_num / 2)
+        {
+            swBuffer_append(conn->out_buffer, chunk->data + offset, chunk->length - offset);
+            swWorker_release_chunk(chunk);
+            continue;
+        }
+        trunk = swBuffer_new_trunk(conn->out_buffer, SW_CHUNK_SHARED, 0);
+        if (trunk == NULL)
+        {
+            goto release;
+        }
+        sw_atomic_fetch_add(&worker->send_shm_used, 1);
+        trunk->store.ptr = chunk->data;
+        trunk->length = chunk->length;
+        trunk->offset = offset;
+        trunk->destroy = swReactorThread_chunk_destructor;
+        conn->out_buffer->length += chunk->length;
+    }
+
+    //listen EPOLLOUT event
+    if (reactor->set(reactor, conn->fd, SW_EVENT_TCP | SW_EVENT_WRITE | SW_EVENT_READ) < 0
+            && (errno == EBADF || errno == ENOENT))
+    {
+        reactor->close(reactor, conn->fd);
+    }
+    return SW_OK;
+
+    release:
+    for (; i < pkg->num; i++)
+    {
+        swWorker_release_chunk(swWorker_get_chunk(worker, pkg->chunk_id[i]));
+    }
+    return SW_ERR;
+}
+
 /**
  * send to client or append to out_buffer
  */
@@ -523,6 +976,11 @@ int swReactorThread_send(swSendData *_send)
     void *_send_data = _send->data;
     uint32_t _send_length = _send->length;
 
+    if (_send->info.type == SW_EVENT_BROADCAST)
+    {
+        return swReactorThread_broadcast(_send);
+    }
+
     swConnection *conn = swServer_connection_verify(serv, session_id);
     if (!conn)
     {
@@ -643,7 +1101,7 @@ int swReactorThread_send(swSendData *_send)
         if (conn->out_buffer->length >= serv->buffer_output_size)
         {
             swoole_error_log(SW_LOG_WARNING, SW_ERROR_OUTPUT_BUFFER_OVERFLOW, "connection#%d output buffer overflow.", fd);
-            conn->overflow = 1;
+            swReactorThread_overflow(serv, conn);
         }
 
         int _length = _send_length;
@@ -717,6 +1175,7 @@ static int swReactorThread_onPipeWrite(swReactor *reactor, swEvent *ev)
         ret = write(ev->fd, trunk->store.ptr, trunk->length);
         if (ret < 0)
         {
+            swServer_get_worker_stats(serv, serv->connection_list[ev->fd].from_fd)->pipe_buffer_length = buffer->length;
             //release lock
             lock->unlock(lock);
 #ifdef HAVE_KQUEUE
@@ -734,6 +1193,7 @@ static int swReactorThread_onPipeWrite(swReactor *reactor, swEvent *ev)
     //remove EPOLLOUT event
     if (swBuffer_empty(buffer))
     {
+        swServer_get_worker_stats(serv, serv->connection_list[ev->fd].from_fd)->pipe_buffer_length = 0;
         if (SwooleG.serv->connection_list[ev->fd].from_id == SwooleTG.id)
         {
             ret = reactor->set(reactor, ev->fd, SW_FD_PIPE | SW_EVENT_READ);
@@ -796,10 +1256,10 @@ static int swReactorThread_onWrite(swReactor *reactor, swEvent *ev)
     swServer *serv = SwooleG.serv;
     int fd = ev->fd;
 
-    assert(fd % serv->reactor_num == reactor->id);
-    assert(fd % serv->reactor_num == SwooleTG.id);
-
     swConnection *conn = swServer_connection_get(serv, fd);
+    assert(conn->from_id == reactor->id);
+    assert(conn->from_id == SwooleTG.id);
+
     if (conn->active == 0)
     {
         return SW_OK;
@@ -970,6 +1430,11 @@ int swReactorThread_start(swServer *serv, swReactor *main_reactor_ptr)
             {
                 continue;
             }
+            //accepted by the reactor threads
+            if (ls->reuse_sock)
+            {
+                continue;
+            }
             main_reactor_ptr->add(main_reactor_ptr, ls->sock, SW_FD_LISTEN);
         }
 
@@ -992,6 +1457,12 @@ int swReactorThread_start(swServer *serv, swReactor *main_reactor_ptr)
             param->object = serv;
             param->pti = i;
 
+            if (serv->heartbeat_check_interval > 0
+                    && swHeartbeat_create(&thread->heartbeat, serv->connection_list, serv->heartbeat_idle_time, SwooleGS->now) < 0)
+            {
+                return SW_ERR;
+            }
+
             if (pthread_create(&pidt, NULL, (void * (*)(void *)) swReactorThread_loop_stream, (void *) param) < 0)
             {
                 swError("pthread_create[tcp_reactor] failed. Error: %s[%d]", strerror(errno), errno);
@@ -1025,6 +1496,7 @@ static int swReactorThread_loop_stream(swThreadParam *param)
 
     swReactorThread *thread = swServer_get_thread(serv, reactor_id);
     swReactor *reactor = &thread->reactor;
+    SwooleTG.buffer_pool = &thread->buffer_pool;
 
 #ifdef HAVE_CPU_AFFINITY
     //cpu affinity setting
@@ -1066,14 +1538,28 @@ static int swReactorThread_loop_stream(swThreadParam *param)
     reactor->onFinish = NULL;
     reactor->onTimeout = NULL;
     reactor->close = swReactorThread_close;
+    reactor->disable_accept = 0;
+    reactor->enable_accept = swServer_enable_accept;
 
     reactor->setHandle(reactor, SW_FD_CLOSE, swReactorThread_onClose);
     reactor->setHandle(reactor, SW_FD_PIPE | SW_EVENT_READ, swReactorThread_onPipeReceive);
     reactor->setHandle(reactor, SW_FD_PIPE | SW_EVENT_WRITE, swReactorThread_onPipeWrite);
+    reactor->setHandle(reactor, SW_FD_RING, swReactorThread_onRingReceive);
 
     //set protocol function point
     swReactorThread_set_protocol(serv, reactor);
 
+    //reactor_accept, every reactor thread accepts on its own SO_REUSEPORT socket
+    swListenPort *ls;
+    LL_FOREACH(serv->listen_list, ls)
+    {
+        if (ls->reuse_sock)
+        {
+            reactor->setHandle(reactor, SW_FD_LISTEN, swServer_master_onAccept);
+            reactor->add(reactor, ls->reuse_sock[reactor_id], SW_FD_LISTEN);
+        }
+    }
+
     int i = 0, pipe_fd;
 #ifdef SW_USE_RINGBUFFER
     int j = 0;
@@ -1114,6 +1600,8 @@ static int swReactorThread_loop_stream(swThreadParam *param)
                  */
                 serv->connection_list[pipe_fd].from_id = reactor_id;
                 serv->connection_list[pipe_fd].fd = pipe_fd;
+                //worker_id of the pipe, for the stats of the pipe buffer
+                serv->connection_list[pipe_fd].from_fd = i;
                 serv->connection_list[pipe_fd].object = sw_malloc(sizeof(swLock));
 
                 /**
@@ -1132,6 +1620,26 @@ static int swReactorThread_loop_stream(swThreadParam *param)
 #endif
             }
         }
+
+        if (serv->ipc_mode == SW_IPC_RING)
+        {
+            thread->ring_buffer = sw_calloc(serv->worker_num, sizeof(swBuffer *));
+            if (thread->ring_buffer == NULL)
+            {
+                swSysError("thread->ring_buffer create failed");
+                return SW_ERR;
+            }
+            for (i = 0; i < serv->worker_num; i++)
+            {
+                thread->ring_buffer[i] = swBuffer_new(sizeof(swEventData));
+                if (thread->ring_buffer[i] == NULL)
+                {
+                    return SW_ERR;
+                }
+            }
+            pipe_fd = serv->ipc_ring_notify[serv->worker_num + reactor_id].getFd(&serv->ipc_ring_notify[serv->worker_num + reactor_id], 0);
+            reactor->add(reactor, pipe_fd, SW_FD_RING | SW_EVENT_READ);
+        }
     }
 
     //wait other thread
@@ -1141,9 +1649,23 @@ static int swReactorThread_loop_stream(swThreadParam *param)
     SW_START_SLEEP;
 #endif
     //main loop
-    reactor->wait(reactor, NULL);
+    if (serv->heartbeat_check_interval > 0)
+    {
+        struct timeval timeo;
+        timeo.tv_sec = 1;
+        timeo.tv_usec = 0;
+        reactor->onFinish = swReactorThread_onHeartbeat;
+        reactor->onTimeout = swReactorThread_onHeartbeat;
+        reactor->wait(reactor, &timeo);
+    }
+    else
+    {
+        reactor->wait(reactor, NULL);
+    }
     //shutdown
     reactor->free(reactor);
+    swBuffer_pool_free(&thread->buffer_pool);
+    SwooleTG.buffer_pool = NULL;
     pthread_exit(0);
     return SW_OK;
 }
@@ -1255,6 +1777,25 @@ int swReactorThread_dispatch(swConnection *conn, char *data, uint32_t length)
     }
 #else
 
+    swServer *serv = SwooleG.serv;
+    /**
+     * ring transport, send the whole package as one message
+     */
+    if (serv->ipc_mode == SW_IPC_RING && length > SW_BUFFER_SIZE
+            && length + sizeof(swDataHead) <= swShmRing_max_message(swServer_get_ring(serv, 0)))
+    {
+        task.data.info.type = SW_EVENT_PACKAGE_END;
+        task.data.info.len = 0;
+        task.target_worker_id = -1;
+
+        SwooleTG.factory_payload = data;
+        SwooleTG.factory_payload_length = length;
+        factory->dispatch(factory, &task);
+        SwooleTG.factory_payload = NULL;
+        SwooleTG.factory_payload_length = 0;
+        return SW_OK;
+    }
+
     task.data.info.type = SW_EVENT_PACKAGE_START;
     task.target_worker_id = -1;
 
@@ -1416,6 +1957,7 @@ void swReactorThread_free(swServer *serv)
 #ifdef SW_USE_RINGBUFFER
             thread->buffer_input->destroy(thread->buffer_input);
 #endif
+            swHeartbeat_free(&thread->heartbeat);
         }
     }
 
@@ -40,8 +40,6 @@ static void swServer_signal_hanlder(int sig);
 static int swServer_start_proxy(swServer *serv);
 static void swServer_disable_accept(swReactor *reactor);
 
-static void swHeartbeatThread_start(swServer *serv);
-static void swHeartbeatThread_loop(swThreadParam *param);
 
 static int swServer_send1(swServer *serv, swSendData *resp);
 static int swServer_send2(swServer *serv, swSendData *resp);
@@ -55,7 +53,19 @@ swServerStats *SwooleStats;
 __thread swThreadG SwooleTG;
 
 int16_t sw_errno;
-char sw_error[SW_ERROR_MSG_SIZE];
+__thread char sw_error[SW_ERROR_MSG_SIZE];
+
+/**
+ * the listen socket of the reactor, see swPort_create_reuseport
+ */
+static sw_inline int swServer_get_listen_socket(swReactor *reactor, swListenPort *ls)
+{
+    if (ls->reuse_sock && SwooleTG.type == SW_THREAD_REACTOR)
+    {
+        return ls->reuse_sock[reactor->id];
+    }
+    return ls->sock;
+}
 
 static void swServer_disable_accept(swReactor *reactor)
 {
@@ -68,7 +78,11 @@ static void swServer_disable_accept(swReactor *reactor)
         {
             continue;
         }
-        reactor->del(reactor, ls->sock);
+        if (SwooleTG.type == SW_THREAD_REACTOR && !ls->reuse_sock)
+        {
+            continue;
+        }
+        reactor->del(reactor, swServer_get_listen_socket(reactor, ls));
     }
 }
 
@@ -83,7 +97,11 @@ void swServer_enable_accept(swReactor *reactor)
         {
             continue;
         }
-        reactor->add(reactor, ls->sock, SW_FD_LISTEN);
+        if (SwooleTG.type == SW_THREAD_REACTOR && !ls->reuse_sock)
+        {
+            continue;
+        }
+        reactor->add(reactor, swServer_get_listen_socket(reactor, ls), SW_FD_LISTEN);
     }
 }
 
@@ -144,6 +162,11 @@ int swServer_master_onAccept(swReactor *reactor, swEvent *event)
         {
             reactor_id = 0;
         }
+        //reactor_accept, keep the connection in the reactor thread which accepted it
+        else if (SwooleTG.type == SW_THREAD_REACTOR)
+        {
+            reactor_id = reactor->id;
+        }
         else
         {
             reactor_id = new_fd % serv->reactor_num;
@@ -155,11 +178,21 @@ int swServer_master_onAccept(swReactor *reactor, swEvent *event)
         sub_reactor = &serv->reactor_threads[reactor_id].reactor;
         conn->socket_type = listen_host->type;
 
+        //must be tracked before the reactor thread can close it
+        if (serv->heartbeat_check_interval > 0)
+        {
+            swHeartbeat_add(swServer_get_heartbeat(serv, reactor_id), conn);
+        }
+
 #ifdef SW_USE_OPENSSL
         if (listen_host->ssl)
         {
             if (swSSL_create(conn, listen_host->ssl_context, 0) < 0)
             {
+                if (conn->idle_expire)
+                {
+                    swHeartbeat_del(swServer_get_heartbeat(serv, reactor_id), conn);
+                }
                 bzero(conn, sizeof(swConnection));
                 close(new_fd);
                 return SW_OK;
@@ -198,6 +231,10 @@ int swServer_master_onAccept(swReactor *reactor, swEvent *event)
 
         if (ret < 0)
         {
+            if (conn->idle_expire)
+            {
+                swHeartbeat_del(swServer_get_heartbeat(serv, reactor_id), conn);
+            }
             bzero(conn, sizeof(swConnection));
             close(new_fd);
             return SW_OK;
@@ -229,10 +266,11 @@ static int swServer_start_check(swServer *serv)
     {
         serv->onPacket = serv->onReceive;
     }
-    //disable notice when use SW_DISPATCH_ROUND and SW_DISPATCH_QUEUE
+    //disable notice when use SW_DISPATCH_ROUND, SW_DISPATCH_QUEUE and SW_DISPATCH_LEAST_LOAD
     if (serv->factory_mode == SW_MODE_PROCESS)
     {
-        if (serv->dispatch_mode == SW_DISPATCH_ROUND || serv->dispatch_mode == SW_DISPATCH_QUEUE)
+        if (serv->dispatch_mode == SW_DISPATCH_ROUND || serv->dispatch_mode == SW_DISPATCH_QUEUE
+                || serv->dispatch_mode == SW_DISPATCH_LEAST_LOAD)
         {
             if (!serv->enable_unsafe_event)
             {
@@ -242,6 +280,19 @@ static int swServer_start_check(swServer *serv)
             }
         }
     }
+    //the ring transport and the reactor accept are only for reactor threads and worker processes
+    else
+    {
+        serv->ipc_mode = SW_IPC_UNSOCK;
+        serv->reactor_accept = 0;
+    }
+#ifndef HAVE_REUSEPORT
+    if (serv->reactor_accept)
+    {
+        swWarn("reactor_accept requires SO_REUSEPORT.");
+        serv->reactor_accept = 0;
+    }
+#endif
     //AsyncTask
     if (SwooleG.task_worker_num > 0)
     {
@@ -280,7 +331,11 @@ static int swServer_start_check(swServer *serv)
         swWarn("serv->max_connection is too small.");
         serv->max_connection = SwooleG.max_sockets;
     }
-    SwooleGS->session_round = 1;
+    //heartbeat
+    if (serv->heartbeat_check_interval > 0 && serv->heartbeat_idle_time == 0)
+    {
+        serv->heartbeat_idle_time = serv->heartbeat_check_interval * 2;
+    }
     return SW_OK;
 }
 
@@ -322,15 +377,6 @@ static int swServer_start_proxy(swServer *serv)
         return SW_ERR;
     }
 
-    /**
-     * heartbeat thread
-     */
-    if (serv->heartbeat_check_interval >= 1 && serv->heartbeat_check_interval <= serv->heartbeat_idle_time)
-    {
-        swTrace("hb timer start, time: %d live time:%d", serv->heartbeat_check_interval, serv->heartbeat_idle_time);
-        swHeartbeatThread_start(serv);
-    }
-
     /**
      * master thread loop
      */
@@ -351,6 +397,11 @@ static int swServer_start_proxy(swServer *serv)
     main_reactor->ptr = serv;
     main_reactor->setHandle(main_reactor, SW_FD_LISTEN, swServer_master_onAccept);
 
+    if (serv->stats_port > 0 && (swServer_stats_listen(serv) < 0 || swServer_stats_add(serv, main_reactor) < 0))
+    {
+        return SW_ERR;
+    }
+
     if (serv->onStart != NULL)
     {
         serv->onStart(serv);
@@ -406,6 +457,21 @@ void swServer_store_listen_socket(swServer *serv)
             swServer_set_minfd(serv, sockfd);
             swServer_set_maxfd(serv, sockfd);
         }
+        //SO_REUSEPORT sockets of the reactor threads
+        if (ls->reuse_sock)
+        {
+            int i;
+            for (i = 1; i < serv->reactor_num; i++)
+            {
+                sockfd = ls->reuse_sock[i];
+                memcpy(&serv->connection_list[sockfd], &serv->connection_list[ls->sock], sizeof(swConnection));
+                serv->connection_list[sockfd].fd = sockfd;
+                if (sockfd > swServer_get_maxfd(serv))
+                {
+                    swServer_set_maxfd(serv, sockfd);
+                }
+            }
+        }
     }
 }
 
@@ -569,6 +635,12 @@ int swServer_start(swServer *serv)
         swoole_error_log(SW_LOG_ERROR, SW_ERROR_SYSTEM_CALL_FAIL, "gmalloc[object->workers] failed");
         return SW_ERR;
     }
+    serv->worker_stats = sw_shm_calloc(serv->worker_num + SwooleG.task_worker_num, sizeof(swWorkerStats));
+    if (serv->worker_stats == NULL)
+    {
+        swoole_error_log(SW_LOG_ERROR, SW_ERROR_SYSTEM_CALL_FAIL, "sw_shm_calloc[object->worker_stats] failed");
+        return SW_ERR;
+    }
 
     /**
      * store to swProcessPool object
@@ -610,6 +682,18 @@ int swServer_start(swServer *serv)
         }
     }
 
+    /**
+     * For large task and pipe message payloads.
+     */
+    if (SwooleG.task_arena_size > 0 && (SwooleG.task_worker_num > 0 || serv->onPipeMessage))
+    {
+        SwooleG.task_arena = swArena_new(SwooleG.task_arena_size);
+        if (SwooleG.task_arena == NULL)
+        {
+            return SW_ERR;
+        }
+    }
+
     /**
      * user worker process
      */
@@ -628,6 +712,13 @@ int swServer_start(swServer *serv)
     swListenPort *ls;
     LL_FOREACH(serv->listen_list, ls)
     {
+        if (serv->reactor_accept && (ls->type == SW_SOCK_TCP || ls->type == SW_SOCK_TCP6))
+        {
+            if (swPort_create_reuseport(ls, serv->reactor_num, serv->reactor_accept_cbpf) < 0)
+            {
+                return SW_ERR;
+            }
+        }
         swPort_set_option(ls);
     }
     //factory start
@@ -686,6 +777,9 @@ void swServer_init(swServer *serv)
     serv->buffer_output_size = SW_BUFFER_OUTPUT_SIZE;
 
     serv->pipe_buffer_size = SW_PIPE_BUFFER_SIZE;
+    serv->ipc_mode = SW_IPC_UNSOCK;
+    serv->ipc_ring_size = SW_IPC_RING_SIZE;
+    SwooleG.task_arena_size = SW_TASK_ARENA_SIZE;
 
     SwooleG.serv = serv;
 }
@@ -703,10 +797,8 @@ int swServer_create(swServer *serv)
     serv->factory.ptr = serv;
 
 #ifdef SW_REACTOR_USE_SESSION
-    serv->session_list = sw_shm_calloc(SW_SESSION_LIST_SIZE, sizeof(swSession));
-    if (serv->session_list == NULL)
+    if (swServer_session_init(serv) < 0)
     {
-        swError("sw_shm_calloc(%ld) for session_list failed", SW_SESSION_LIST_SIZE * sizeof(swSession));
         return SW_ERR;
     }
 #endif
@@ -737,15 +829,6 @@ int swServer_free(swServer *serv)
     {
         serv->factory.shutdown(&(serv->factory));
     }
-    /**
-     * Shutdown heartbeat thread
-     */
-    if (SwooleG.heartbeat_pidt)
-    {
-        pthread_cancel(SwooleG.heartbeat_pidt);
-        pthread_join(SwooleG.heartbeat_pidt, NULL);
-    }
-
     if (serv->factory_mode == SW_MODE_SINGLE)
     {
         if (SwooleG.task_worker_num > 0)
@@ -876,6 +959,87 @@ int swServer_tcp_send(swServer *serv, int fd, void *data, uint32_t length)
     return SW_OK;
 }
 
+/**
+ * send the parts as one piece of data without joining a big payload with its header.
+ * The base mode writes them with one sendmsg when the out_buffer is empty, otherwise every part becomes
+ * a trunk of the out_buffer and swConnection_buffer_send() gathers them. The iov is modified.
+ */
+int swServer_tcp_sendv(swServer *serv, int fd, struct iovec *iov, int iovcnt)
+{
+    uint32_t length = 0;
+    int i;
+
+    for (i = 0; i < iovcnt; i++)
+    {
+        length += iov[i].iov_len;
+    }
+    if (length >= serv->buffer_output_size)
+    {
+        swoole_error_log(SW_LOG_WARNING, SW_ERROR_OUTPUT_BUFFER_OVERFLOW, "More than the output buffer size[%d], please use the sendfile.", serv->buffer_output_size);
+        return SW_ERR;
+    }
+
+#ifdef SW_REACTOR_SYNC_SEND
+    swConnection *conn;
+    if (serv->factory_mode == SW_MODE_SINGLE && (conn = swServer_connection_verify(serv, fd))
+            && conn->direct_send && !conn->closed && swBuffer_empty(conn->out_buffer))
+    {
+        struct msghdr msg;
+        ssize_t n;
+
+        bzero(&msg, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iovcnt;
+        do
+        {
+            n = sendmsg(conn->fd, &msg, MSG_NOSIGNAL);
+        } while (n < 0 && errno == EINTR);
+        if (n == length)
+        {
+            return SW_OK;
+        }
+        //skip the bytes which have been sent
+        for (; n > 0 && iovcnt > 0; iov++, iovcnt--)
+        {
+            if (n < iov->iov_len)
+            {
+                iov->iov_base = (char *) iov->iov_base + n;
+                iov->iov_len -= n;
+                break;
+            }
+            n -= iov->iov_len;
+        }
+        length = 0;
+        for (i = 0; i < iovcnt; i++)
+        {
+            length += iov[i].iov_len;
+        }
+    }
+#endif
+
+    //the small parts are joined into one message
+    if (length < SW_IPC_MAX_SIZE - sizeof(swDataHead))
+    {
+        char buffer[SW_IPC_MAX_SIZE];
+        uint32_t offset = 0;
+        for (i = 0; i < iovcnt; i++)
+        {
+            memcpy(buffer + offset, iov[i].iov_base, iov[i].iov_len);
+            offset += iov[i].iov_len;
+        }
+        return swServer_tcp_send(serv, fd, buffer, length);
+    }
+    //the parts of the same session are kept in order by the reactor thread
+    for (i = 0; i < iovcnt; i++)
+    {
+        if (iov[i].iov_len > 0 && swServer_tcp_send(serv, fd, iov[i].iov_base, iov[i].iov_len) < 0)
+        {
+            return SW_ERR;
+        }
+    }
+    return SW_OK;
+}
+
 int swServer_tcp_sendfile(swServer *serv, int fd, char *filename, uint32_t len)
 {
 #ifdef SW_USE_OPENSSL
@@ -928,6 +1092,207 @@ int swServer_tcp_sendwait(swServer *serv, int fd, void *data, uint32_t length)
     return swSocket_write_blocking(conn->fd, data, length);
 }
 
+static int swServer_broadcast_copy(swServer *serv, uint32_t *session_list, uint32_t num, void *data, uint32_t length)
+{
+    uint32_t i;
+    int ret = SW_OK;
+
+    for (i = 0; i < num; i++)
+    {
+        if (swServer_tcp_send(serv, session_list[i], data, length) < 0)
+        {
+            ret = SW_ERR;
+        }
+    }
+    return ret;
+}
+
+/**
+ * send the same data to many sessions, one message for every reactor pipe instead of one for every session.
+ * The reactor thread keeps a single copy referenced by all the out_buffers.
+ */
+int swServer_broadcast(swServer *serv, uint32_t *session_list, uint32_t num, void *data, uint32_t length)
+{
+    swFactory *factory = &(serv->factory);
+    swConnection *conn;
+    swSendData _send;
+    swWorker *worker = NULL;
+    uint32_t i, n;
+    int ret = SW_OK;
+
+    if (num == 0)
+    {
+        return SW_OK;
+    }
+
+    /**
+     * every message must fit in the IPC channel without being split,
+     * the pipe only carries the small messages, the big ones are sent by the chunks of one session
+     */
+    uint32_t max_length = serv->buffer_output_size - 1;
+    if (serv->factory_mode == SW_MODE_PROCESS && serv->ipc_mode == SW_IPC_RING && swIsWorker())
+    {
+        n = swShmRing_max_message(swServer_get_ring(serv, 0)) - sizeof(swDataHead);
+    }
+    else
+    {
+        n = SW_IPC_MAX_SIZE - sizeof(swDataHead) - 1;
+    }
+    max_length = SW_MIN(max_length, n);
+
+    if (serv->factory_mode != SW_MODE_PROCESS)
+    {
+        return swServer_broadcast_copy(serv, session_list, num, data, length);
+    }
+
+    /**
+     * the data which does not fit in one message is copied into the chunks of the worker once,
+     * the messages only carry the reference, see swReactorThread_broadcast_chunks
+     */
+    char *payload = data;
+    uint32_t payload_length = length;
+    swPackage_response *response = NULL;
+
+    if (sizeof(swPackage_broadcast) + sizeof(uint32_t) + length > max_length)
+    {
+        n = (length + SW_WORKER_SEND_CHUNK_SIZE - 1) / SW_WORKER_SEND_CHUNK_SIZE;
+        payload_length = sizeof(swPackage_response) + n * sizeof(uint32_t);
+        if (!swIsWorker() || sizeof(swPackage_broadcast) + sizeof(uint32_t) + payload_length > max_length)
+        {
+            return swServer_broadcast_copy(serv, session_list, num, data, length);
+        }
+        response = sw_malloc(payload_length);
+        if (!response)
+        {
+            swWarn("malloc for broadcast failed.");
+            return SW_ERR;
+        }
+        worker = swServer_get_worker(serv, SwooleWG.id);
+        if (swWorker_fill_chunks(worker, response, data, length) < 0)
+        {
+            sw_free(response);
+            return swServer_broadcast_copy(serv, session_list, num, data, length);
+        }
+        payload = (char *) response;
+    }
+
+    /**
+     * group by the pipe (reactor thread + session_id % reactor_pipe_num), keep the order with the other responses.
+     */
+    uint32_t group_num = serv->reactor_num * serv->reactor_pipe_num;
+    uint32_t *group_count = sw_calloc(group_num + 1, sizeof(uint32_t));
+    uint32_t *group_list = sw_malloc(sizeof(uint32_t) * (num + 1));
+    uint16_t *group_id = sw_malloc(sizeof(uint16_t) * (num + 1));
+    if (!group_count || !group_list || !group_id)
+    {
+        swWarn("malloc for broadcast failed.");
+        ret = SW_ERR;
+        goto _free;
+    }
+
+    for (i = 0; i < num; i++)
+    {
+        conn = swServer_connection_verify(serv, session_list[i]);
+        if (!conn || conn->closed || conn->removed)
+        {
+            group_id[i] = 0xffff;
+            continue;
+        }
+        group_id[i] = conn->from_id + (session_list[i] % serv->reactor_pipe_num) * serv->reactor_num;
+        group_count[group_id[i] + 1]++;
+    }
+    for (i = 1; i <= group_num; i++)
+    {
+        group_count[i] += group_count[i - 1];
+    }
+    for (i = 0; i < num; i++)
+    {
+        if (group_id[i] != 0xffff)
+        {
+            group_list[group_count[group_id[i]]++] = session_list[i];
+        }
+    }
+
+    //the rest of the message is filled with the sessions
+    uint32_t max_session = (max_length - sizeof(swPackage_broadcast) - payload_length) / sizeof(uint32_t);
+    max_session = SW_MIN(max_session, num);
+
+    swPackage_broadcast *pkg = sw_malloc(sizeof(swPackage_broadcast) + max_session * sizeof(uint32_t) + payload_length);
+    if (!pkg)
+    {
+        swWarn("malloc for broadcast failed.");
+        ret = SW_ERR;
+        goto _free;
+    }
+    pkg->shared = response != NULL;
+
+    uint32_t start = 0, end, msg_length;
+    //group_count[g] is the end of group g now
+    for (i = 0; i < group_num; i++)
+    {
+        end = group_count[i];
+        for (; start < end; start += pkg->num)
+        {
+            pkg->num = SW_MIN(end - start, max_session);
+            memcpy(pkg->session_id, group_list + start, pkg->num * sizeof(uint32_t));
+
+            _send.info.fd = pkg->session_id[0];
+            _send.info.type = SW_EVENT_BROADCAST;
+            _send.info.from_id = i % serv->reactor_num;
+            _send.data = (char *) pkg;
+
+            memcpy(pkg->session_id + pkg->num, payload, payload_length);
+            msg_length = sizeof(swPackage_broadcast) + pkg->num * sizeof(uint32_t) + payload_length;
+            if (msg_length >= SW_IPC_MAX_SIZE - sizeof(swDataHead))
+            {
+                _send.length = msg_length;
+            }
+            else
+            {
+                _send.info.len = msg_length;
+                _send.length = 0;
+            }
+            //every message holds a reference of the chunks
+            for (n = 0; response && n < response->num; n++)
+            {
+                sw_atomic_fetch_add(&swWorker_get_chunk(worker, response->chunk_id[n])->refcount, 1);
+            }
+            if (factory->finish(factory, &_send) < 0)
+            {
+                for (n = 0; response && n < response->num; n++)
+                {
+                    swWorker_unref_chunk(swWorker_get_chunk(worker, response->chunk_id[n]));
+                }
+                ret = SW_ERR;
+            }
+        }
+    }
+    sw_free(pkg);
+
+    _free:
+    if (response)
+    {
+        for (n = 0; n < response->num; n++)
+        {
+            swWorker_unref_chunk(swWorker_get_chunk(worker, response->chunk_id[n]));
+        }
+        sw_free(response);
+    }
+    if (group_count)
+    {
+        sw_free(group_count);
+    }
+    if (group_list)
+    {
+        sw_free(group_list);
+    }
+    if (group_id)
+    {
+        sw_free(group_id);
+    }
+    return ret;
+}
+
 /**
  * for udp + tcp
  */
@@ -1145,96 +1510,6 @@ static void swServer_signal_hanlder(int sig)
     }
 }
 
-static void swHeartbeatThread_start(swServer *serv)
-{
-    swThreadParam *param;
-    pthread_t thread_id;
-    param = SwooleG.memory_pool->alloc(SwooleG.memory_pool, sizeof(swThreadParam));
-    if (param == NULL)
-    {
-        swError("heartbeat_param malloc fail\n");
-        return;
-    }
-
-    param->object = serv;
-    param->pti = 0;
-
-    if (pthread_create(&thread_id, NULL, (void * (*)(void *)) swHeartbeatThread_loop, (void *) param) < 0)
-    {
-        swWarn("pthread_create[hbcheck] fail");
-    }
-    SwooleG.heartbeat_pidt = thread_id;
-}
-
-static void swHeartbeatThread_loop(swThreadParam *param)
-{
-    swSignal_none();
-
-    swServer *serv = param->object;
-    swDataHead notify_ev;
-    swConnection *conn;
-    swReactor *reactor;
-
-    int fd;
-    int serv_max_fd;
-    int serv_min_fd;
-    int checktime;
-
-    SwooleTG.type = SW_THREAD_HEARTBEAT;
-
-    bzero(&notify_ev, sizeof(notify_ev));
-    notify_ev.type = SW_EVENT_CLOSE;
-
-    while (SwooleG.running)
-    {
-        serv_max_fd = swServer_get_maxfd(serv);
-        serv_min_fd = swServer_get_minfd(serv);
-
-        checktime = (int) time(NULL) - serv->heartbeat_idle_time;
-
-        for (fd = serv_min_fd; fd <= serv_max_fd; fd++)
-        {
-            swTrace("check fd=%d", fd);
-            conn = swServer_connection_get(serv, fd);
-
-            if (conn != NULL && conn->active == 1 && conn->fdtype == SW_FD_TCP)
-            {
-                if (conn->protect || conn->last_time > checktime)
-                {
-                    continue;
-                }
-
-                notify_ev.fd = fd;
-                notify_ev.from_id = conn->from_id;
-
-                conn->close_force = 1;
-                conn->close_notify = 1;
-                conn->close_wait = 1;
-
-                if (serv->factory_mode != SW_MODE_PROCESS)
-                {
-                    if (serv->factory_mode == SW_MODE_SINGLE)
-                    {
-                        reactor = SwooleG.main_reactor;
-                    }
-                    else
-                    {
-                        reactor = &serv->reactor_threads[conn->from_id].reactor;
-                    }
-                }
-                else
-                {
-                    reactor = &serv->reactor_threads[conn->from_id].reactor;
-                }
-                //notify to reactor thread
-                reactor->set(reactor, fd, SW_FD_TCP | SW_EVENT_WRITE);
-            }
-        }
-        sleep(serv->heartbeat_check_interval);
-    }
-    pthread_exit(0);
-}
-
 /**
  * new connection
  */
@@ -1242,12 +1517,18 @@ static swConnection* swServer_connection_new(swServer *serv, swListenPort *ls, i
 {
     swConnection* connection = NULL;
 
-    SwooleStats->accept_count++;
+    int maxfd;
+
+    sw_atomic_fetch_add(&SwooleStats->accept_count, 1);
     sw_atomic_fetch_add(&SwooleStats->connection_num, 1);
 
-    if (fd > swServer_get_maxfd(serv))
+    //the reactor threads accept at the same time in reactor_accept mode
+    while (fd > (maxfd = swServer_get_maxfd(serv)))
     {
-        swServer_set_maxfd(serv, fd);
+        if (sw_atomic_cmp_set(&serv->connection_list[SW_SERVER_MAX_FD_INDEX].fd, maxfd, fd))
+        {
+            break;
+        }
     }
 
     connection = &(serv->connection_list[fd]);
@@ -1287,31 +1568,7 @@ static swConnection* swServer_connection_new(swServer *serv, swListenPort *ls, i
 #endif
 
 #ifdef SW_REACTOR_USE_SESSION
-    uint32_t session_id = 1;
-    swSession *session;
-    sw_spinlock(&SwooleGS->spinlock);
-    int i;
-    //get session id
-    for (i = 0; i < serv->max_connection; i++)
-    {
-        session_id = SwooleGS->session_round++;
-        if (session_id == 0)
-        {
-            session_id = 1;
-            SwooleGS->session_round = 1;
-        }
-        session = swServer_get_session(serv, session_id);
-        //vacancy
-        if (session->fd == 0)
-        {
-            session->fd = fd;
-            session->id = session_id;
-            session->reactor_id = connection->from_id;
-            break;
-        }
-    }
-    sw_spinlock_release(&SwooleGS->spinlock);
-    connection->session_id = session_id;
+    connection->session_id = swServer_session_alloc(serv, fd, connection->from_id);
 #endif
 
     return connection;
@@ -1372,3 +1629,122 @@ void swServer_set_callback_onClose(swServer *serv, void (*callback)(swServer *,
     onClose_callback = callback;
     serv->onClose = swServer_scalar_onClose_callback;
 }
+
+#ifdef SW_REACTOR_USE_SESSION
+int swServer_session_init(swServer *serv)
+{
+    serv->session_list = sw_shm_calloc(SW_SESSION_LIST_SIZE, sizeof(swSession));
+    if (serv->session_list == NULL)
+    {
+        swError("sw_shm_calloc(%ld) for session_list failed", SW_SESSION_LIST_SIZE * sizeof(swSession));
+        return SW_ERR;
+    }
+    serv->session_queue = sw_shm_malloc(sizeof(swSessionQueue));
+    if (serv->session_queue == NULL)
+    {
+        swError("sw_shm_malloc(%ld) for session_queue failed", sizeof(swSessionQueue));
+        return SW_ERR;
+    }
+
+    swSessionQueue *queue = serv->session_queue;
+    uint32_t i;
+
+    //slot 0 is never used, the session_id can not be 0
+    for (i = 0; i < SW_SESSION_LIST_SIZE - 1; i++)
+    {
+        queue->cells[i].sequence = i + 1;
+        queue->cells[i].slot = i + 1;
+    }
+    queue->cells[i].sequence = i;
+    queue->head = 0;
+    queue->tail = SW_SESSION_LIST_SIZE - 1;
+    return SW_OK;
+}
+
+/**
+ * O(1) without lock, the reactor threads (or the workers in SW_MODE_SINGLE) allocate at the same time
+ */
+uint32_t swServer_session_alloc(swServer *serv, int fd, int reactor_id)
+{
+    swSessionQueue *queue = serv->session_queue;
+    uint32_t pos = queue->head;
+    int32_t diff;
+
+    for (;;)
+    {
+        diff = (int32_t) (__atomic_load_n(&queue->cells[pos & (SW_SESSION_LIST_SIZE - 1)].sequence, __ATOMIC_ACQUIRE) - (pos + 1));
+        if (diff == 0)
+        {
+            if (__atomic_compare_exchange_n(&queue->head, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            if (__atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE) == pos)
+            {
+                swWarn("no free session, the max is %d.", SW_SESSION_LIST_SIZE - 1);
+                return 0;
+            }
+            //the slot is being freed by another thread
+            swYield();
+            pos = queue->head;
+        }
+        else
+        {
+            pos = queue->head;
+        }
+    }
+
+    uint32_t slot = queue->cells[pos & (SW_SESSION_LIST_SIZE - 1)].slot;
+    __atomic_store_n(&queue->cells[pos & (SW_SESSION_LIST_SIZE - 1)].sequence, pos + SW_SESSION_LIST_SIZE, __ATOMIC_RELEASE);
+
+    swSession *session = &serv->session_list[slot];
+    //the generation in bits 20-23 is increased when the slot is reused, the session_id is less than SW_MAX_SOCKET_ID
+    uint32_t session_id = session->id == 0 ? slot : (session->id + SW_SESSION_LIST_SIZE) & (SW_MAX_SOCKET_ID - 1);
+    session->fd = fd;
+    session->reactor_id = reactor_id;
+    session->id = session_id;
+    return session_id;
+}
+
+void swServer_session_free(swServer *serv, uint32_t session_id)
+{
+    if (session_id == 0)
+    {
+        return;
+    }
+
+    swSessionQueue *queue = serv->session_queue;
+    swSession *session = swServer_get_session(serv, session_id);
+    uint32_t pos = queue->tail;
+    int32_t diff;
+
+    //closed twice
+    if (session->id != session_id || session->fd == 0)
+    {
+        return;
+    }
+    session->fd = 0;
+
+    //every slot is in the queue at most once, it is never full
+    for (;;)
+    {
+        diff = (int32_t) (__atomic_load_n(&queue->cells[pos & (SW_SESSION_LIST_SIZE - 1)].sequence, __ATOMIC_ACQUIRE) - pos);
+        if (diff == 0)
+        {
+            if (__atomic_compare_exchange_n(&queue->tail, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                break;
+            }
+        }
+        else
+        {
+            pos = queue->tail;
+        }
+    }
+    queue->cells[pos & (SW_SESSION_LIST_SIZE - 1)].slot = session_id % SW_SESSION_LIST_SIZE;
+    __atomic_store_n(&queue->cells[pos & (SW_SESSION_LIST_SIZE - 1)].sequence, pos + 1, __ATOMIC_RELEASE);
+}
+#endif
@@ -0,0 +1,231 @@
+/*
+ +----------------------------------------------------------------------+
+ | Swoole                                                               |
+ +----------------------------------------------------------------------+
+ | This source file is subject to version 2.0 of the Apache license,    |
+ | that is bundled with this package in the file LICENSE, and is        |
+ | available through the world-wide-web at the following url:           |
+ | http://www.apache.org/licenses/LICENSE-2.0.html                      |
+ | If you did not receive a copy of the Apache2.0 license and are unable|
+ | to obtain it through the world-wide-web, please send a note to       |
+ | license@swoole.com so we can mail you a copy immediately.            |
+ +----------------------------------------------------------------------+
+ | Author: Tianfeng Han  <mikan.tenny@gmail.com>                        |
+ +----------------------------------------------------------------------+
+ */
+
+#include "Server.h"
+#include <stdarg.h>
+#include <inttypes.h>
+
+static int swServer_stats_onRead(swReactor *reactor, swEvent *event);
+
+static swString *stats_buffer;
+
+static int swServer_stats_printf(swString *buffer, const char *format, ...)
+{
+    va_list args;
+    int n;
+
+    while (1)
+    {
+        va_start(args, format);
+        n = vsnprintf(buffer->str + buffer->length, buffer->size - buffer->length, format, args);
+        va_end(args);
+        if (n < 0)
+        {
+            return SW_ERR;
+        }
+        if (buffer->length + n < buffer->size)
+        {
+            buffer->length += n;
+            return SW_OK;
+        }
+        if (swString_extend(buffer, buffer->size * 2) < 0)
+        {
+            return SW_ERR;
+        }
+    }
+}
+
+static void swServer_stats_summary(swString *buffer, char *name, int worker_id, swHistogram *hist)
+{
+    static const double quantiles[] = { 50, 90, 99, 99.9 };
+    int i;
+
+    for (i = 0; i < sizeof(quantiles) / sizeof(quantiles[0]); i++)
+    {
+        swServer_stats_printf(buffer, "%s{worker=\"%d\",quantile=\"%g\"} %" PRIu64 "\n", name, worker_id, quantiles[i] / 100,
+                swHistogram_percentile(hist, quantiles[i]));
+    }
+    swServer_stats_printf(buffer, "%s_sum{worker=\"%d\"} %" PRIu64 "\n", name, worker_id, hist->sum);
+    swServer_stats_printf(buffer, "%s_count{worker=\"%d\"} %" PRIu64 "\n", name, worker_id, hist->count);
+}
+
+/**
+ * Prometheus text format, the counters are read without lock
+ */
+int swServer_stats_format(swServer *serv, swString *buffer)
+{
+    swWorkerStats *stats;
+    swWorker *worker;
+    int i;
+
+    swServer_stats_printf(buffer, "# TYPE swoole_start_time gauge\nswoole_start_time %ld\n", SwooleStats->start_time);
+    swServer_stats_printf(buffer, "# TYPE swoole_connection_num gauge\nswoole_connection_num %u\n", SwooleStats->connection_num);
+    swServer_stats_printf(buffer, "# TYPE swoole_accept_total counter\nswoole_accept_total %u\n", SwooleStats->accept_count);
+    swServer_stats_printf(buffer, "# TYPE swoole_close_total counter\nswoole_close_total %u\n", SwooleStats->close_count);
+    swServer_stats_printf(buffer, "# TYPE swoole_request_total counter\nswoole_request_total %u\n", SwooleStats->request_count);
+    swServer_stats_printf(buffer, "# TYPE swoole_tasking_num gauge\nswoole_tasking_num %u\n", SwooleStats->tasking_num);
+
+    if (serv->factory_mode == SW_MODE_PROCESS)
+    {
+        swServer_stats_printf(buffer, "# TYPE swoole_worker_request_total counter\n");
+        for (i = 0; i < serv->worker_num; i++)
+        {
+            worker = swServer_get_worker(serv, i);
+            swServer_stats_printf(buffer, "swoole_worker_request_total{worker=\"%d\"} %u\n", i, worker->request_count);
+        }
+        swServer_stats_printf(buffer, "# TYPE swoole_worker_dispatch_num gauge\n");
+        for (i = 0; i < serv->worker_num; i++)
+        {
+            worker = swServer_get_worker(serv, i);
+            swServer_stats_printf(buffer, "swoole_worker_dispatch_num{worker=\"%d\"} %d\n", i, (int32_t) worker->dispatch_count);
+        }
+        swServer_stats_printf(buffer, "# TYPE swoole_worker_pipe_buffer_bytes gauge\n");
+        for (i = 0; i < serv->worker_num; i++)
+        {
+            stats = swServer_get_worker_stats(serv, i);
+            swServer_stats_printf(buffer, "swoole_worker_pipe_buffer_bytes{worker=\"%d\"} %u\n", i, stats->pipe_buffer_length);
+        }
+    }
+
+    //the task workers follow the event workers
+    swServer_stats_printf(buffer, "# TYPE swoole_worker_request_latency_usec summary\n");
+    for (i = 0; i < serv->worker_num + SwooleG.task_worker_num; i++)
+    {
+        stats = swServer_get_worker_stats(serv, i);
+        swServer_stats_summary(buffer, "swoole_worker_request_latency_usec", i, &stats->request_latency);
+    }
+    swServer_stats_printf(buffer, "# TYPE swoole_worker_task_wait_usec summary\n");
+    for (i = 0; i < serv->worker_num; i++)
+    {
+        stats = swServer_get_worker_stats(serv, i);
+        swServer_stats_summary(buffer, "swoole_worker_task_wait_usec", i, &stats->task_wait);
+    }
+
+    int reactor_num = serv->factory_mode == SW_MODE_PROCESS ? serv->reactor_num : 1;
+    swServer_stats_printf(buffer, "# TYPE swoole_reactor_output_overflow_total counter\n");
+    for (i = 0; i < reactor_num; i++)
+    {
+        swServer_stats_printf(buffer, "swoole_reactor_output_overflow_total{reactor=\"%d\"} %u\n", i,
+                serv->reactor_threads[i].overflow_count);
+    }
+    swServer_stats_printf(buffer, "# TYPE swoole_reactor_buffer_pool_hit_total counter\n");
+    for (i = 0; i < reactor_num; i++)
+    {
+        swServer_stats_printf(buffer, "swoole_reactor_buffer_pool_hit_total{reactor=\"%d\"} %" PRIu64 "\n", i,
+                serv->reactor_threads[i].buffer_pool.hit);
+    }
+    swServer_stats_printf(buffer, "# TYPE swoole_reactor_buffer_pool_miss_total counter\n");
+    for (i = 0; i < reactor_num; i++)
+    {
+        swServer_stats_printf(buffer, "swoole_reactor_buffer_pool_miss_total{reactor=\"%d\"} %" PRIu64 "\n", i,
+                serv->reactor_threads[i].buffer_pool.miss);
+    }
+    return SW_OK;
+}
+
+/**
+ * create the listen socket before the workers are forked
+ */
+int swServer_stats_listen(swServer *serv)
+{
+    char *host = serv->stats_host ? serv->stats_host : "127.0.0.1";
+    int type = strchr(host, ':') ? SW_SOCK_TCP6 : SW_SOCK_TCP;
+
+    int fd = swSocket_create(type);
+    if (fd < 0)
+    {
+        swSysError("socket() failed.");
+        return SW_ERR;
+    }
+    if (swSocket_bind(fd, type, host, serv->stats_port) < 0)
+    {
+        close(fd);
+        return SW_ERR;
+    }
+    if (listen(fd, SW_BACKLOG) < 0)
+    {
+        swSysError("listen(%s:%d) failed.", host, serv->stats_port);
+        close(fd);
+        return SW_ERR;
+    }
+    swSetNonBlock(fd);
+
+    stats_buffer = swString_new(SW_BUFFER_SIZE_BIG);
+    if (stats_buffer == NULL)
+    {
+        close(fd);
+        return SW_ERR;
+    }
+    serv->stats_fd = fd;
+    return SW_OK;
+}
+
+/**
+ * the scraper is answered by the master thread in process mode, by the first worker in base mode
+ */
+int swServer_stats_add(swServer *serv, swReactor *reactor)
+{
+    reactor->setHandle(reactor, SW_FD_STATS, swServer_stats_onRead);
+    return reactor->add(reactor, serv->stats_fd, SW_FD_STATS);
+}
+
+static int swServer_stats_onRead(swReactor *reactor, swEvent *event)
+{
+    swServer *serv = reactor->ptr;
+    char buf[SW_BUFFER_SIZE];
+    char header[128];
+    int fd, n;
+
+    if (event->fd == serv->stats_fd)
+    {
+        fd = accept(event->fd, NULL, NULL);
+        if (fd < 0)
+        {
+            return SW_OK;
+        }
+        swSetNonBlock(fd);
+        return reactor->add(reactor, fd, SW_FD_STATS);
+    }
+
+    //the request is not parsed, any path is answered
+    n = recv(event->fd, buf, sizeof(buf), 0);
+    if (n < 0 && errno == EAGAIN)
+    {
+        return SW_OK;
+    }
+    if (n > 0)
+    {
+        swString_clear(stats_buffer);
+        swServer_stats_format(serv, stats_buffer);
+
+        struct iovec iov[2];
+        iov[0].iov_base = header;
+        iov[0].iov_len = snprintf(header, sizeof(header), "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                "Content-Length: %ld\r\nConnection: close\r\n\r\n", stats_buffer->length);
+        iov[1].iov_base = stats_buffer->str;
+        iov[1].iov_len = stats_buffer->length;
+
+        //one write without blocking the master thread, the socket buffer is large enough
+        swSocket_set_buffer_size(event->fd, iov[0].iov_len + iov[1].iov_len);
+        if (writev(event->fd, iov, 2) < iov[0].iov_len + iov[1].iov_len)
+        {
+            swWarn("the stats of %ld bytes is truncated.", stats_buffer->length);
+        }
+    }
+    reactor->del(reactor, event->fd);
+    close(event->fd);
+    return SW_OK;
+}
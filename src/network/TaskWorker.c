@@ -72,7 +72,9 @@ int swTaskWorker_onTask(swProcessPool *pool, swEventData *task)
     }
     else
     {
+        uint64_t start_usec = swoole_monotonic_usec();
         ret = serv->onTask(serv, task);
+        swWorker_record_latency(serv, start_usec);
     }
 
     return ret;
@@ -83,6 +85,21 @@ int swTaskWorker_large_pack(swEventData *task, void *data, int data_len)
     swPackage_task pkg;
     bzero(&pkg, sizeof(pkg));
 
+    //shared memory arena, the receiver frees it after unpack
+    if (SwooleG.task_arena)
+    {
+        void *mem = swArena_alloc(SwooleG.task_arena, data_len, &pkg.offset);
+        if (mem)
+        {
+            memcpy(mem, data, data_len);
+            task->info.len = sizeof(swPackage_task);
+            swTask_type(task) |= SW_TASK_SHM;
+            pkg.length = data_len;
+            memcpy(task->data, &pkg, sizeof(swPackage_task));
+            return SW_OK;
+        }
+    }
+
     memcpy(pkg.tmpfile, SwooleG.task_tmpdir, SwooleG.task_tmpdir_len);
 
     //create temp file
@@ -109,6 +126,25 @@ int swTaskWorker_large_pack(swEventData *task, void *data, int data_len)
     return SW_OK;
 }
 
+/**
+ * release the payload of a result which is never unpacked, e.g. it arrives after the taskwait timeout
+ */
+void swTaskWorker_large_free(swEventData *task)
+{
+    swPackage_task pkg;
+    memcpy(&pkg, task->data, sizeof(pkg));
+
+    if (swTask_type(task) & SW_TASK_SHM)
+    {
+        swArena_free(SwooleG.task_arena, pkg.offset);
+    }
+    else if (swTask_type(task) & SW_TASK_TMPFILE)
+    {
+        unlink(pkg.tmpfile);
+    }
+    swTask_type(task) &= ~(SW_TASK_SHM | SW_TASK_TMPFILE);
+}
+
 static void swTaskWorker_signal_init(void)
 {
     swSignal_set(SIGHUP, NULL, 1, 0);
@@ -199,6 +235,12 @@ int swTaskWorker_finish(swServer *serv, char *data, int data_len, int flags)
         //lock worker
         worker->lock.lock(&worker->lock);
 
+        //the previous result was not taken by the worker
+        if (swTask_is_large(result))
+        {
+            swTaskWorker_large_free(result);
+        }
+
         result->info.type = SW_EVENT_FINISH;
         result->info.fd = current_task->info.fd;
         swTask_type(result) = flags;
@@ -16,45 +16,121 @@
 
 #include "swoole.h"
 
+#ifndef CLOCK_MONOTONIC
+#define CLOCK_MONOTONIC CLOCK_REALTIME
+#endif
+
+#define SW_TIMER_WHEEL_MASK    (SW_TIMER_WHEEL_SIZE - 1)
+#define SW_TIMER_WHEEL_MAX     (1LL << (SW_TIMER_WHEEL_BITS * SW_TIMER_WHEEL_LEVEL))
+
 static int swReactorTimer_init(long msec);
 static int swReactorTimer_set(swTimer *timer, long exec_msec);
+static void swTimerWheel_add(swTimerWheel *wheel, swTimer_node *tnode);
+static int swTimerWheel_select(swTimer *timer, int64_t now_msec);
 
-static sw_inline int64_t swTimer_get_relative_msec()
+static sw_inline int64_t swTimer_get_monotonic_msec()
 {
-    struct timeval now;
-    if (gettimeofday(&now, NULL) < 0)
+    struct timespec now;
+    if (clock_gettime(CLOCK_MONOTONIC, &now) < 0)
     {
-        swSysError("gettimeofday() failed.");
+        swSysError("clock_gettime(CLOCK_MONOTONIC) failed.");
         return SW_ERR;
     }
-    int64_t msec1 = (now.tv_sec - SwooleG.timer.basetime.tv_sec) * 1000;
-    int64_t msec2 = (now.tv_usec - SwooleG.timer.basetime.tv_usec) / 1000;
-    return msec1 + msec2;
+    return (int64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
 }
 
-int swTimer_init(long msec)
+/**
+ * not affected by the wall clock adjustment
+ */
+static sw_inline int64_t swTimer_get_relative_msec(swTimer *timer)
 {
-    if (SwooleGS->start && (swIsMaster() || swIsManager()))
+    int64_t now = swTimer_get_monotonic_msec();
+    if (now < 0)
     {
-        swWarn("cannot use timer in master and manager process.");
         return SW_ERR;
     }
+    return now - timer->basetime;
+}
+
+static swTimer_node* swTimer_node_alloc(swTimer *timer)
+{
+    swTimer_node *tnode = timer->node_pool;
+    if (tnode)
+    {
+        timer->node_pool = tnode->next;
+        return tnode;
+    }
+
+    //the first pointer links the batches
+    void **batch = sw_malloc(sizeof(void *) + sizeof(swTimer_node) * SW_TIMER_NODE_BATCH);
+    if (!batch)
+    {
+        swSysError("malloc(%ld) failed.", sizeof(swTimer_node) * SW_TIMER_NODE_BATCH);
+        return NULL;
+    }
+    *batch = timer->node_batch;
+    timer->node_batch = batch;
+
+    swTimer_node *nodes = (swTimer_node *) (batch + 1);
+    int i;
+    for (i = SW_TIMER_NODE_BATCH - 1; i > 0; i--)
+    {
+        nodes[i].next = timer->node_pool;
+        timer->node_pool = &nodes[i];
+    }
+    return &nodes[0];
+}
+
+static sw_inline void swTimer_node_free(swTimer *timer, swTimer_node *tnode)
+{
+    tnode->next = timer->node_pool;
+    timer->node_pool = tnode;
+}
 
-    if (gettimeofday(&SwooleG.timer.basetime, NULL) < 0)
+int swTimer_create(swTimer *timer, int backend)
+{
+    timer->basetime = swTimer_get_monotonic_msec();
+    if (timer->basetime < 0)
     {
-        swSysError("gettimeofday() failed.");
         return SW_ERR;
     }
 
-    SwooleG.timer._current_id = -1;
-    SwooleG.timer._next_msec = msec;
-    SwooleG.timer._next_id = 1;
+    timer->_current_id = -1;
+    timer->_next_id = 1;
+
+    if (backend == SW_TIMER_BACKEND_WHEEL)
+    {
+        timer->wheel = sw_calloc(1, sizeof(swTimerWheel));
+        if (!timer->wheel)
+        {
+            swSysError("calloc(%ld) failed.", sizeof(swTimerWheel));
+            return SW_ERR;
+        }
+    }
+    else
+    {
+        timer->heap = swHeap_new(1024, SW_MIN_HEAP);
+        if (!timer->heap)
+        {
+            return SW_ERR;
+        }
+    }
+    return SW_OK;
+}
+
+int swTimer_init(long msec)
+{
+    if (SwooleGS->start && (swIsMaster() || swIsManager()))
+    {
+        swWarn("cannot use timer in master and manager process.");
+        return SW_ERR;
+    }
 
-    SwooleG.timer.heap = swHeap_new(1024, SW_MIN_HEAP);
-    if (!SwooleG.timer.heap)
+    if (swTimer_create(&SwooleG.timer, SwooleG.timer_backend) < 0)
     {
         return SW_ERR;
     }
+    SwooleG.timer._next_msec = msec;
 
     if (swIsTaskWorker())
     {
@@ -70,10 +146,25 @@ int swTimer_init(long msec)
 
 void swTimer_free(swTimer *timer)
 {
+    void *batch;
+
     if (timer->heap)
     {
         swHeap_free(timer->heap);
+        timer->heap = NULL;
+    }
+    if (timer->wheel)
+    {
+        sw_free(timer->wheel);
+        timer->wheel = NULL;
+    }
+    while (timer->node_batch)
+    {
+        batch = timer->node_batch;
+        timer->node_batch = *(void **) batch;
+        sw_free(batch);
     }
+    timer->node_pool = NULL;
 }
 
 static int swReactorTimer_init(long exec_msec)
@@ -93,15 +184,14 @@ static int swReactorTimer_set(swTimer *timer, long exec_msec)
 
 swTimer_node* swTimer_add(swTimer *timer, int _msec, int interval, void *data)
 {
-    swTimer_node *tnode = sw_malloc(sizeof(swTimer_node));
-    if (!tnode)
+    int64_t now_msec = swTimer_get_relative_msec(timer);
+    if (now_msec < 0)
     {
-        swSysError("malloc(%ld) failed.", sizeof(swTimer_node));
         return NULL;
     }
 
-    int64_t now_msec = swTimer_get_relative_msec();
-    if (now_msec < 0)
+    swTimer_node *tnode = swTimer_node_alloc(timer);
+    if (!tnode)
     {
         return NULL;
     }
@@ -110,6 +200,7 @@ swTimer_node* swTimer_add(swTimer *timer, int _msec, int interval, void *data)
     tnode->exec_msec = now_msec + _msec;
     tnode->interval = interval ? _msec : 0;
     tnode->remove = 0;
+    tnode->heap_node = NULL;
 
     if (timer->_next_msec > _msec)
     {
@@ -117,35 +208,84 @@ swTimer_node* swTimer_add(swTimer *timer, int _msec, int interval, void *data)
     }
 
     tnode->id = timer->_next_id++;
-    timer->num++;
 
-    tnode->heap_node = swHeap_push(timer->heap, tnode->exec_msec, tnode);
-    if (tnode->heap_node == NULL)
+    if (timer->wheel)
     {
-        sw_free(tnode);
-        return NULL;
+        //the wheel may have been idle for a long time
+        if (timer->num == 0)
+        {
+            timer->wheel->current = now_msec;
+        }
+        swTimerWheel_add(timer->wheel, tnode);
+    }
+    else
+    {
+        tnode->heap_node = swHeap_push(timer->heap, tnode->exec_msec, tnode);
+        if (tnode->heap_node == NULL)
+        {
+            swTimer_node_free(timer, tnode);
+            return NULL;
+        }
     }
+    timer->num++;
     return tnode;
 }
 
 void swTimer_del(swTimer *timer, swTimer_node *tnode)
 {
-    swHeap_remove(timer->heap, tnode->heap_node);
-    if (tnode->heap_node)
+    if (timer->wheel)
+    {
+        *tnode->pprev = tnode->next;
+        if (tnode->next)
+        {
+            tnode->next->pprev = tnode->pprev;
+        }
+    }
+    else
+    {
+        swHeap_remove(timer->heap, tnode->heap_node);
+        if (tnode->heap_node)
+        {
+            sw_free(tnode->heap_node);
+        }
+    }
+    timer->num--;
+    swTimer_node_free(timer, tnode);
+}
+
+/**
+ * next exec_msec of a tick timer
+ */
+static sw_inline void swTimer_next_tick(swTimer *timer, swTimer_node *tnode, int64_t now_msec)
+{
+    int64_t _now_msec = swTimer_get_relative_msec(timer);
+    if (_now_msec <= 0)
+    {
+        tnode->exec_msec = now_msec + tnode->interval;
+    }
+    else if (tnode->exec_msec + tnode->interval < _now_msec)
+    {
+        tnode->exec_msec = _now_msec + tnode->interval;
+    }
+    else
     {
-        sw_free(tnode->heap_node);
+        tnode->exec_msec += tnode->interval;
     }
-    sw_free(tnode);
 }
 
 int swTimer_select(swTimer *timer)
 {
-    int64_t now_msec = swTimer_get_relative_msec();
+    int64_t now_msec = swTimer_get_relative_msec(timer);
     if (now_msec < 0)
     {
         return SW_ERR;
     }
 
+    if (timer->wheel)
+    {
+        return swTimerWheel_select(timer, now_msec);
+    }
+
     swTimer_node *tnode = NULL;
     swHeap_node *tmp;
 
@@ -162,19 +302,7 @@ int swTimer_select(swTimer *timer)
             timer->onTick(timer, tnode);
             if (!tnode->remove)
             {
-                int64_t _now_msec = swTimer_get_relative_msec();
-                if (_now_msec <= 0)
-                {
-                    tnode->exec_msec = now_msec + tnode->interval;
-                }
-                else if (tnode->exec_msec + tnode->interval < _now_msec)
-                {
-                    tnode->exec_msec = _now_msec + tnode->interval;
-                }
-                else
-                {
-                    tnode->exec_msec += tnode->interval;
-                }
+                swTimer_next_tick(timer, tnode, now_msec);
                 swHeap_change_priority(timer->heap, tnode->exec_msec, tmp);
                 continue;
             }
@@ -186,7 +314,7 @@ int swTimer_select(swTimer *timer)
         }
         timer->num --;
         swHeap_pop(timer->heap);
-        sw_free(tnode);
+        swTimer_node_free(timer, tnode);
     }
 
     if (!tnode)
@@ -199,3 +327,165 @@ int swTimer_select(swTimer *timer)
     }
     return SW_OK;
 }
+
+/**
+ * level n holds the nodes which expire in [2^(6n), 2^(6(n+1))) msec, the slot is picked by the absolute time,
+ * so a whole slot can be moved down when the lower level wraps.
+ */
+static void swTimerWheel_add(swTimerWheel *wheel, swTimer_node *tnode)
+{
+    int64_t expires = tnode->exec_msec;
+    int level = 0;
+
+    if (expires < wheel->current)
+    {
+        expires = wheel->current;
+    }
+    else if (expires - wheel->current >= SW_TIMER_WHEEL_MAX)
+    {
+        //re-checked when it is cascaded
+        expires = wheel->current + SW_TIMER_WHEEL_MAX - 1;
+    }
+    while (expires - wheel->current >= (1LL << (SW_TIMER_WHEEL_BITS * (level + 1))))
+    {
+        level++;
+    }
+
+    swTimer_node **slot = &wheel->slots[level][(expires >> (SW_TIMER_WHEEL_BITS * level)) & SW_TIMER_WHEEL_MASK];
+    tnode->next = *slot;
+    tnode->pprev = slot;
+    if (*slot)
+    {
+        (*slot)->pprev = &tnode->next;
+    }
+    *slot = tnode;
+}
+
+/**
+ * move the nodes of the current slot at the level down
+ */
+static int swTimerWheel_cascade(swTimerWheel *wheel, int level)
+{
+    int index = (wheel->current >> (SW_TIMER_WHEEL_BITS * level)) & SW_TIMER_WHEEL_MASK;
+    swTimer_node *tnode = wheel->slots[level][index];
+    swTimer_node *next;
+
+    wheel->slots[level][index] = NULL;
+    while (tnode)
+    {
+        next = tnode->next;
+        swTimerWheel_add(wheel, tnode);
+        tnode = next;
+    }
+    return index;
+}
+
+/**
+ * msec from the current tick to the first tick which has work to do, -1 if the wheel is empty.
+ * A cascade may bring down a node which expires before the first busy slot of level 0,
+ * so the boundaries of the upper levels are always taken into account.
+ */
+static int64_t swTimerWheel_next(swTimerWheel *wheel)
+{
+    int64_t block, msec, min_msec = -1;
+    int level, i, start;
+
+    for (i = 0; i < SW_TIMER_WHEEL_SIZE; i++)
+    {
+        if (wheel->slots[0][(wheel->current + i) & SW_TIMER_WHEEL_MASK])
+        {
+            min_msec = i;
+            break;
+        }
+    }
+    //the upper levels only need a wakeup to cascade
+    for (level = 1; level < SW_TIMER_WHEEL_LEVEL; level++)
+    {
+        block = wheel->current >> (SW_TIMER_WHEEL_BITS * level);
+        //the current tick is on the boundary and its cascade has not run yet
+        start = (wheel->current & ((1LL << (SW_TIMER_WHEEL_BITS * level)) - 1)) == 0 ? 0 : 1;
+        for (i = start; i < start + SW_TIMER_WHEEL_SIZE; i++)
+        {
+            if (wheel->slots[level][(block + i) & SW_TIMER_WHEEL_MASK])
+            {
+                msec = ((block + i) << (SW_TIMER_WHEEL_BITS * level)) - wheel->current;
+                if (min_msec < 0 || msec < min_msec)
+                {
+                    min_msec = msec;
+                }
+                break;
+            }
+        }
+    }
+    return min_msec;
+}
+
+static int swTimerWheel_select(swTimer *timer, int64_t now_msec)
+{
+    swTimerWheel *wheel = timer->wheel;
+    swTimer_node *tnode;
+    swTimer_node **slot;
+    int64_t next_msec;
+    int level;
+
+    while (wheel->current <= now_msec)
+    {
+        //jump to the next busy tick, no boundary with a busy slot is crossed so nothing is left behind
+        next_msec = timer->num > 0 ? swTimerWheel_next(wheel) : -1;
+        if (next_msec < 0 || wheel->current + next_msec > now_msec)
+        {
+            wheel->current = now_msec + 1;
+            break;
+        }
+        wheel->current += next_msec;
+
+        for (level = 1; level < SW_TIMER_WHEEL_LEVEL; level++)
+        {
+            if ((wheel->current & ((1LL << (SW_TIMER_WHEEL_BITS * level)) - 1)) != 0)
+            {
+                break;
+            }
+            swTimerWheel_cascade(wheel, level);
+        }
+
+        slot = &wheel->slots[0][wheel->current & SW_TIMER_WHEEL_MASK];
+        wheel->pending = *slot;
+        *slot = NULL;
+        if (wheel->pending)
+        {
+            wheel->pending->pprev = &wheel->pending;
+        }
+
+        while ((tnode = wheel->pending))
+        {
+            wheel->pending = tnode->next;
+            if (tnode->next)
+            {
+                tnode->next->pprev = &wheel->pending;
+            }
+            //tick timer
+            if (tnode->interval > 0)
+            {
+                timer->onTick(timer, tnode);
+                if (!tnode->remove)
+                {
+                    swTimer_next_tick(timer, tnode, now_msec);
+                    swTimerWheel_add(wheel, tnode);
+                    continue;
+                }
+            }
+            //after timer
+            else
+            {
+                timer->onAfter(timer, tnode);
+            }
+            timer->num--;
+            swTimer_node_free(timer, tnode);
+        }
+        wheel->current++;
+    }
+
+    next_msec = timer->num > 0 ? swTimerWheel_next(wheel) : -1;
+    timer->set(timer, next_msec < 0 ? -1 : wheel->current + next_msec - now_msec);
+    return SW_OK;
+}
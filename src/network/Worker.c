@@ -21,13 +21,19 @@
 #include <grp.h>
 
 static int swWorker_onPipeReceive(swReactor *reactor, swEvent *event);
+static int swWorker_onRingReceive(swReactor *reactor, swEvent *event);
+static void swWorker_ring_receive(swServer *serv);
+static void swWorker_ring_recover(swServer *serv);
 
 int swWorker_create(swWorker *worker)
 {
     /**
      * Create shared memory storage
      */
-    worker->send_shm = sw_shm_malloc(SwooleG.serv->buffer_output_size);
+    swServer *serv = SwooleG.serv;
+    worker->send_shm_num = SW_WORKER_SEND_SHM_NUM * (serv->buffer_output_size / SW_WORKER_SEND_CHUNK_SIZE + 1);
+    //zero filled by mmap, the pages are not touched until a big response is sent
+    worker->send_shm = sw_shm_malloc(worker->send_shm_num * sizeof(swResponse_chunk));
     if (worker->send_shm == NULL)
     {
         swWarn("malloc for worker->store failed.");
@@ -46,6 +52,125 @@ void swWorker_free(swWorker *worker)
     }
 }
 
+/**
+ * [Worker] take a free chunk for the big response, wait a while if all of them are in flight.
+ * NULL if the slow clients still hold them, the response is copied through the pipe then.
+ */
+swResponse_chunk* swWorker_alloc_chunk(swWorker *worker)
+{
+    swResponse_chunk *chunk;
+    uint32_t i;
+    int wait;
+
+    for (wait = 0; wait <= SW_WORKER_SEND_SHM_WAIT_MAX; wait++)
+    {
+        if (wait > 0)
+        {
+            usleep(SW_WORKER_SEND_SHM_WAIT_USEC);
+        }
+        for (i = 0; i < worker->send_shm_num; i++)
+        {
+            chunk = swWorker_get_chunk(worker, worker->send_shm_cursor++ % worker->send_shm_num);
+            if (__atomic_load_n(&chunk->used, __ATOMIC_ACQUIRE) == SW_RESPONSE_CHUNK_FREE)
+            {
+                chunk->used = SW_RESPONSE_CHUNK_FILLING;
+                chunk->worker_id = worker->id;
+                return chunk;
+            }
+        }
+    }
+    return NULL;
+}
+
+/**
+ * [Manager] the chunks which were being written by the dead worker are never sent,
+ * the ones referenced by the messages are released by the reactor threads.
+ */
+int swWorker_reclaim_chunks(swWorker *worker)
+{
+    uint32_t i;
+    int n = 0;
+
+    if (worker->send_shm == NULL)
+    {
+        return 0;
+    }
+    for (i = 0; i < worker->send_shm_num; i++)
+    {
+        if (sw_atomic_cmp_set(&swWorker_get_chunk(worker, i)->used, SW_RESPONSE_CHUNK_FILLING, SW_RESPONSE_CHUNK_FREE))
+        {
+            n++;
+        }
+    }
+    return n;
+}
+
+/**
+ * [Worker] copy the data into the chunks once, the chunk ids are written into the response.
+ * The chunks are SENT with one reference held by the caller, SW_ERR if there are not enough free chunks.
+ */
+int swWorker_fill_chunks(swWorker *worker, swPackage_response *response, char *data, uint32_t length)
+{
+    swResponse_chunk *chunk;
+    uint32_t i;
+
+    response->num = (length + SW_WORKER_SEND_CHUNK_SIZE - 1) / SW_WORKER_SEND_CHUNK_SIZE;
+    if (worker->send_shm == NULL || response->num > worker->send_shm_num)
+    {
+        return SW_ERR;
+    }
+    response->length = length;
+    response->worker_id = worker->id;
+
+    for (i = 0; i < response->num; i++)
+    {
+        chunk = swWorker_alloc_chunk(worker);
+        if (chunk == NULL)
+        {
+            while (i > 0)
+            {
+                swWorker_release_chunk(swWorker_get_chunk(worker, response->chunk_id[--i]));
+            }
+            return SW_ERR;
+        }
+        chunk->length = length - i * SW_WORKER_SEND_CHUNK_SIZE;
+        if (chunk->length > SW_WORKER_SEND_CHUNK_SIZE)
+        {
+            chunk->length = SW_WORKER_SEND_CHUNK_SIZE;
+        }
+        memcpy(chunk->data, data + i * SW_WORKER_SEND_CHUNK_SIZE, chunk->length);
+        response->chunk_id[i] = chunk - (swResponse_chunk *) worker->send_shm;
+    }
+
+    //the chunks are owned by the message from now on
+    for (i = 0; i < response->num; i++)
+    {
+        chunk = swWorker_get_chunk(worker, response->chunk_id[i]);
+        chunk->refcount = 1;
+        chunk->used = SW_RESPONSE_CHUNK_SENT;
+    }
+    return SW_OK;
+}
+
+/**
+ * the chunk is sent or dropped, it can be reused by the worker
+ */
+void swWorker_release_chunk(swResponse_chunk *chunk)
+{
+    __atomic_store_n(&chunk->used, SW_RESPONSE_CHUNK_FREE, __ATOMIC_RELEASE);
+}
+
+/**
+ * drop a reference of a broadcast chunk, the last one releases it
+ */
+void swWorker_unref_chunk(swResponse_chunk *chunk)
+{
+    if (sw_atomic_fetch_sub(&chunk->refcount, 1) == 1)
+    {
+        swWorker_release_chunk(chunk);
+    }
+}
+
 void swWorker_signal_init(void)
 {
     swSignal_add(SIGHUP, NULL);
@@ -167,6 +292,7 @@ int swWorker_onTask(swFactory *factory, swEventData *task)
     swServer *serv = factory->ptr;
     swString *package = NULL;
     swDgramPacket *header;
+    uint64_t start_usec;
 
 #ifdef SW_USE_OPENSSL
     swConnection *conn;
@@ -189,9 +315,12 @@ int swWorker_onTask(swFactory *factory, swEventData *task)
         }
         do_task:
         {
+            start_usec = swoole_monotonic_usec();
             serv->onReceive(serv, task);
+            swWorker_record_latency(serv, start_usec);
             SwooleWG.request_count++;
             sw_atomic_fetch_add(&SwooleStats->request_count, 1);
+            sw_atomic_fetch_add(&serv->workers[SwooleWG.id].request_count, 1);
         }
         if (task->info.type == SW_EVENT_PACKAGE_END)
         {
@@ -236,7 +365,10 @@ int swWorker_onTask(swFactory *factory, swEventData *task)
         {
             SwooleWG.request_count++;
             sw_atomic_fetch_add(&SwooleStats->request_count, 1);
+            sw_atomic_fetch_add(&serv->workers[SwooleWG.id].request_count, 1);
+            start_usec = swoole_monotonic_usec();
             serv->onPacket(serv, task);
+            swWorker_record_latency(serv, start_usec);
             swString_clear(package);
         }
         break;
@@ -285,6 +417,13 @@ int swWorker_onTask(swFactory *factory, swEventData *task)
     //worker idle
     serv->workers[SwooleWG.id].status = SW_WORKER_IDLE;
 
+    //the message from the reactor thread is finished
+    if (serv->factory_mode == SW_MODE_PROCESS && task->info.type != SW_EVENT_FINISH
+            && task->info.type != SW_EVENT_PIPE_MESSAGE)
+    {
+        sw_atomic_fetch_sub(&serv->workers[SwooleWG.id].dispatch_count, 1);
+    }
+
     //maximum number of requests, process will exit.
     if (!SwooleWG.run_always && SwooleWG.request_count >= SwooleWG.max_request)
     {
@@ -463,6 +602,15 @@ int swWorker_loop(swFactory *factory, int worker_id)
     SwooleG.main_reactor->setHandle(SwooleG.main_reactor, SW_FD_PIPE, swWorker_onPipeReceive);
     SwooleG.main_reactor->setHandle(SwooleG.main_reactor, SW_FD_PIPE | SW_FD_WRITE, swReactor_onWrite);
 
+    int ring_mode = serv->ipc_mode == SW_IPC_RING && worker_id < serv->worker_num;
+    if (ring_mode)
+    {
+        swPipe *notify = &serv->ipc_ring_notify[worker_id];
+        SwooleG.main_reactor->add(SwooleG.main_reactor, notify->getFd(notify, 0), SW_FD_RING | SW_EVENT_READ);
+        SwooleG.main_reactor->setHandle(SwooleG.main_reactor, SW_FD_RING, swWorker_onRingReceive);
+        swWorker_ring_recover(serv);
+    }
+
     /**
      * set pipe buffer size
      */
@@ -485,6 +633,11 @@ int swWorker_loop(swFactory *factory, int worker_id)
         swSignalfd_setup(SwooleG.main_reactor);
     }
 #endif
+    //messages left by the previous worker process
+    if (ring_mode)
+    {
+        swWorker_ring_receive(serv);
+    }
     //main loop
     SwooleG.main_reactor->wait(SwooleG.main_reactor, NULL);
     //clear pipe buffer
@@ -525,6 +678,136 @@ int swWorker_send2reactor(swEventData *ev_data, size_t sendn, int fd)
     return ret;
 }
 
+/**
+ * Send data to ReactorThread through the response ring, big data is split into several messages.
+ */
+int swWorker_send2reactor_ring(swDataHead *info, char *data, uint32_t length)
+{
+    swServer *serv = SwooleG.serv;
+    swShmRing *ring = swServer_response_ring(serv, SwooleWG.id, info->from_id);
+    uint32_t max_length = swShmRing_max_message(ring) - sizeof(swDataHead);
+    swPipe *notify = &serv->ipc_ring_notify[SwooleWG.id];
+    int notify_fd = notify->getFd(notify, 0);
+    int rearm = 0;
+    uint64_t flag;
+    uint32_t n;
+
+    do
+    {
+        n = length > max_length ? max_length : length;
+        //the real length is taken from the ring message
+        info->len = n > SW_BUFFER_SIZE ? 0 : n;
+        while (swShmRing_push(ring, info, sizeof(swDataHead), data, n) < 0)
+        {
+            //the reactor thread wakes us up after it drained the ring
+            ring->waiting = 1;
+            sw_atomic_memory_barrier();
+            if (swShmRing_push(ring, info, sizeof(swDataHead), data, n) == SW_OK)
+            {
+                break;
+            }
+            swServer_ring_notify(serv, serv->worker_num + info->from_id);
+            swSocket_wait(notify_fd, SW_IPC_RING_WAIT_MSEC, SW_EVENT_READ);
+            if (read(notify_fd, &flag, sizeof(flag)) > 0)
+            {
+                serv->ipc_ring_signaled[SwooleWG.id] = 0;
+                sw_atomic_memory_barrier();
+                rearm = 1;
+            }
+        }
+        data += n;
+        length -= n;
+    } while (length > 0);
+
+    swServer_ring_notify(serv, serv->worker_num + info->from_id);
+    //the notification of the request rings is consumed, signal it again for the reactor of this worker
+    if (rearm)
+    {
+        swServer_ring_notify(serv, SwooleWG.id);
+    }
+    return SW_OK;
+}
+
+/**
+ * drain the request rings of this worker
+ */
+static void swWorker_ring_receive(swServer *serv)
+{
+    swFactory *factory = &serv->factory;
+    swShmRing *ring;
+    swEventData *task;
+    swString *package;
+    uint32_t length, extra;
+    char *data;
+    int i;
+
+    for (i = 0; i < serv->reactor_num; i++)
+    {
+        ring = swServer_request_ring(serv, i, SwooleWG.id);
+        while (SwooleG.main_reactor->running && (data = swShmRing_front(ring, &length)) != NULL)
+        {
+            task = (swEventData *) data;
+            extra = length - sizeof(task->info) - task->info.len;
+            ring->busy = 1;
+            //whole package, see swReactorThread_dispatch
+            if (extra > 0)
+            {
+                package = swWorker_get_buffer(serv, task->info.from_id);
+                swString_append_ptr(package, task->data + task->info.len, extra);
+                swWorker_onTask(factory, task);
+                package->length = 0;
+            }
+            else
+            {
+                swWorker_onTask(factory, task);
+            }
+            swShmRing_pop(ring);
+            ring->busy = 0;
+        }
+        if (ring->waiting)
+        {
+            ring->waiting = 0;
+            swServer_ring_notify(serv, serv->worker_num + i);
+        }
+    }
+}
+
+static int swWorker_onRingReceive(swReactor *reactor, swEvent *event)
+{
+    swServer *serv = reactor->ptr;
+    uint64_t flag;
+
+    if (read(event->fd, &flag, sizeof(flag)) < 0 && errno != EAGAIN)
+    {
+        swSysError("read(ring_notify) failed.");
+    }
+    serv->ipc_ring_signaled[SwooleWG.id] = 0;
+    sw_atomic_memory_barrier();
+    swWorker_ring_receive(serv);
+    return SW_OK;
+}
+
+/**
+ * the previous worker process exited in the middle of a message, drop it.
+ */
+static void swWorker_ring_recover(swServer *serv)
+{
+    swShmRing *ring;
+    uint32_t length;
+    int i;
+
+    for (i = 0; i < serv->reactor_num; i++)
+    {
+        ring = swServer_request_ring(serv, i, SwooleWG.id);
+        if (ring->busy && swShmRing_front(ring, &length))
+        {
+            swWarn("discard the unfinished message[%d bytes] from reactor#%d.", length, i);
+            swShmRing_pop(ring);
+        }
+        ring->busy = 0;
+    }
+}
+
 /**
  * receive data from reactor
  */
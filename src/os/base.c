@@ -53,6 +53,12 @@ int swAio_init(void)
         break;
 #endif
 
+#ifdef HAVE_IO_URING
+    case SW_AIO_URING:
+        ret = swAioUring_init(SW_AIO_EVENT_NUM);
+        break;
+#endif
+
 #ifdef HAVE_GCC_AIO
     case SW_AIO_GCC:
         ret = swAioGcc_init(SW_AIO_EVENT_NUM);
@@ -0,0 +1,514 @@
+/*
+  +----------------------------------------------------------------------+
+  | Swoole                                                               |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 2.0 of the Apache license,    |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.apache.org/licenses/LICENSE-2.0.html                      |
+  | If you did not receive a copy of the Apache2.0 license and are unable|
+  | to obtain it through the world-wide-web, please send a note to       |
+  | license@swoole.com so we can mail you a copy immediately.            |
+  +----------------------------------------------------------------------+
+  | Author: Tianfeng Han  <mikan.tenny@gmail.com>                        |
+  +----------------------------------------------------------------------+
+*/
+
+#include "swoole.h"
+#include "async.h"
+
+#ifdef HAVE_IO_URING
+
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <linux/io_uring.h>
+
+typedef struct
+{
+    int fd;
+    uint8_t type;
+    off_t offset;
+    size_t nbytes;
+    void *buf;
+    int next;
+} swAioUring_request;
+
+typedef struct
+{
+    int fd;
+    uint32_t sq_entries;
+    uint32_t cq_entries;
+
+    void *sq_ring;
+    void *cq_ring;
+    size_t sq_ring_size;
+    size_t cq_ring_size;
+    struct io_uring_sqe *sqes;
+
+    uint32_t *sq_head;
+    uint32_t *sq_tail;
+    uint32_t *sq_mask;
+    uint32_t *sq_array;
+    uint32_t *cq_head;
+    uint32_t *cq_tail;
+    uint32_t *cq_mask;
+    struct io_uring_cqe *cqes;
+
+    /**
+     * queued but not submitted
+     */
+    uint32_t sq_pending;
+    uint8_t flush_scheduled;
+
+    swAioUring_request *requests;
+    int free_request;
+
+    /**
+     * registered buffers
+     */
+    char *buffers;
+    int *free_buffers;
+    int free_buffer_num;
+} swAioUring;
+
+static swAioUring swoole_aio_uring;
+
+static int swAioUring_onFinish(swReactor *reactor, swEvent *event);
+static int swAioUring_write(int fd, void *inbuf, size_t size, off_t offset);
+static int swAioUring_read(int fd, void *outbuf, size_t size, off_t offset);
+static void swAioUring_destroy();
+static void swAioUring_flush(void *data);
+
+static sw_inline int io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+    return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static sw_inline int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static sw_inline int io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args)
+{
+    return syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static int swAioUring_buffer_init(swAioUring *ring)
+{
+    struct iovec iov[SW_AIO_URING_BUFFER_NUM];
+    int i;
+
+    if (posix_memalign((void **) &ring->buffers, getpagesize(), SW_AIO_URING_BUFFER_NUM * SW_AIO_URING_BUFFER_SIZE) != 0)
+    {
+        ring->buffers = NULL;
+        return SW_ERR;
+    }
+    ring->free_buffers = sw_malloc(sizeof(int) * SW_AIO_URING_BUFFER_NUM);
+    if (ring->free_buffers == NULL)
+    {
+        goto _free;
+    }
+    for (i = 0; i < SW_AIO_URING_BUFFER_NUM; i++)
+    {
+        iov[i].iov_base = ring->buffers + i * SW_AIO_URING_BUFFER_SIZE;
+        iov[i].iov_len = SW_AIO_URING_BUFFER_SIZE;
+        ring->free_buffers[i] = SW_AIO_URING_BUFFER_NUM - 1 - i;
+    }
+    //pinned memory is limited by RLIMIT_MEMLOCK, run without registered buffers
+    if (io_uring_register(ring->fd, IORING_REGISTER_BUFFERS, iov, SW_AIO_URING_BUFFER_NUM) < 0)
+    {
+        swNotice("io_uring_register(IORING_REGISTER_BUFFERS) failed. Error: %s[%d]", strerror(errno), errno);
+        sw_free(ring->free_buffers);
+        goto _free;
+    }
+    ring->free_buffer_num = SW_AIO_URING_BUFFER_NUM;
+    return SW_OK;
+
+    _free:
+    free(ring->buffers);
+    ring->buffers = NULL;
+    ring->free_buffers = NULL;
+    return SW_ERR;
+}
+
+static sw_inline int swAioUring_buffer_index(swAioUring *ring, void *buf, size_t size)
+{
+    char *p = buf;
+    if (ring->buffers == NULL || p < ring->buffers || p >= ring->buffers + SW_AIO_URING_BUFFER_NUM * SW_AIO_URING_BUFFER_SIZE)
+    {
+        return -1;
+    }
+    int index = (p - ring->buffers) / SW_AIO_URING_BUFFER_SIZE;
+    if (p + size > ring->buffers + (index + 1) * SW_AIO_URING_BUFFER_SIZE)
+    {
+        return -1;
+    }
+    return index;
+}
+
+/**
+ * buffers for io_uring mode, taken from the registered buffers if there is a free one.
+ */
+void* swAioUring_malloc(size_t size)
+{
+    swAioUring *ring = &swoole_aio_uring;
+    if (ring->free_buffer_num > 0 && size <= SW_AIO_URING_BUFFER_SIZE)
+    {
+        ring->free_buffer_num--;
+        return ring->buffers + ring->free_buffers[ring->free_buffer_num] * SW_AIO_URING_BUFFER_SIZE;
+    }
+    return sw_malloc(size);
+}
+
+void swAioUring_free(void *ptr)
+{
+    swAioUring *ring = &swoole_aio_uring;
+    int index = swAioUring_buffer_index(ring, ptr, 0);
+    if (index < 0)
+    {
+        sw_free(ptr);
+        return;
+    }
+    ring->free_buffers[ring->free_buffer_num++] = index;
+}
+
+int swAioUring_init(int max_aio_events)
+{
+    swAioUring *ring = &swoole_aio_uring;
+    struct io_uring_params params;
+    int i;
+
+    bzero(ring, sizeof(swAioUring));
+    bzero(&params, sizeof(params));
+
+    ring->fd = io_uring_setup(SW_AIO_URING_ENTRIES, &params);
+    if (ring->fd < 0)
+    {
+        swWarn("io_uring_setup() failed. Error: %s[%d]", strerror(errno), errno);
+        return SW_ERR;
+    }
+
+    ring->sq_entries = params.sq_entries;
+    ring->cq_entries = params.cq_entries;
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (ring->cq_ring_size > ring->sq_ring_size)
+        {
+            ring->sq_ring_size = ring->cq_ring_size;
+        }
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED)
+    {
+        swWarn("mmap(IORING_OFF_SQ_RING) failed. Error: %s[%d]", strerror(errno), errno);
+        goto _close;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        ring->cq_ring = ring->sq_ring;
+    }
+    else
+    {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED)
+        {
+            swWarn("mmap(IORING_OFF_CQ_RING) failed. Error: %s[%d]", strerror(errno), errno);
+            munmap(ring->sq_ring, ring->sq_ring_size);
+            goto _close;
+        }
+    }
+    ring->sqes = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+    {
+        swWarn("mmap(IORING_OFF_SQES) failed. Error: %s[%d]", strerror(errno), errno);
+        goto _unmap;
+    }
+
+    ring->sq_head = ring->sq_ring + params.sq_off.head;
+    ring->sq_tail = ring->sq_ring + params.sq_off.tail;
+    ring->sq_mask = ring->sq_ring + params.sq_off.ring_mask;
+    ring->sq_array = ring->sq_ring + params.sq_off.array;
+    ring->cq_head = ring->cq_ring + params.cq_off.head;
+    ring->cq_tail = ring->cq_ring + params.cq_off.tail;
+    ring->cq_mask = ring->cq_ring + params.cq_off.ring_mask;
+    ring->cqes = ring->cq_ring + params.cq_off.cqes;
+
+    /**
+     * in-flight requests never exceed the completion queue, so it can not overflow
+     */
+    ring->requests = sw_calloc(ring->cq_entries, sizeof(swAioUring_request));
+    if (ring->requests == NULL)
+    {
+        swWarn("calloc(%d) failed.", (int) (ring->cq_entries * sizeof(swAioUring_request)));
+        goto _unmap_sqes;
+    }
+    for (i = 0; i < ring->cq_entries; i++)
+    {
+        ring->requests[i].next = i + 1;
+    }
+    ring->requests[ring->cq_entries - 1].next = -1;
+    ring->free_request = 0;
+
+    if (swPipeNotify_auto(&swoole_aio_pipe, 0, 0) < 0)
+    {
+        goto _free_requests;
+    }
+    int efd = swoole_aio_pipe.getFd(&swoole_aio_pipe, 0);
+    if (io_uring_register(ring->fd, IORING_REGISTER_EVENTFD, &efd, 1) < 0)
+    {
+        swWarn("io_uring_register(IORING_REGISTER_EVENTFD) failed. Error: %s[%d]", strerror(errno), errno);
+        swoole_aio_pipe.close(&swoole_aio_pipe);
+        goto _free_requests;
+    }
+
+    swAioUring_buffer_init(ring);
+
+    SwooleG.main_reactor->setHandle(SwooleG.main_reactor, SW_FD_AIO, swAioUring_onFinish);
+    SwooleG.main_reactor->add(SwooleG.main_reactor, efd, SW_FD_AIO);
+
+    SwooleAIO.callback = swAio_callback_test;
+    SwooleAIO.destroy = swAioUring_destroy;
+    SwooleAIO.read = swAioUring_read;
+    SwooleAIO.write = swAioUring_write;
+
+    return SW_OK;
+
+    _free_requests:
+    sw_free(ring->requests);
+    _unmap_sqes:
+    munmap(ring->sqes, ring->sq_entries * sizeof(struct io_uring_sqe));
+    _unmap:
+    if (ring->cq_ring != ring->sq_ring)
+    {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    _close:
+    close(ring->fd);
+    return SW_ERR;
+}
+
+static sw_inline void swAioUring_complete(swAioUring *ring, int index, int res)
+{
+    swAioUring_request *request = &ring->requests[index];
+    swAio_event aio_ev;
+
+    aio_ev.fd = request->fd;
+    aio_ev.type = request->type;
+    aio_ev.offset = request->offset;
+    aio_ev.nbytes = request->nbytes;
+    aio_ev.buf = request->buf;
+    aio_ev.req = NULL;
+    if (res < 0)
+    {
+        aio_ev.ret = -1;
+        aio_ev.error = -res;
+    }
+    else
+    {
+        aio_ev.ret = res;
+        aio_ev.error = 0;
+    }
+
+    //the callback may queue a new request
+    request->next = ring->free_request;
+    ring->free_request = index;
+    SwooleAIO.task_num--;
+
+    SwooleAIO.callback(&aio_ev);
+}
+
+/**
+ * submit all the queued requests with one system call
+ */
+static void swAioUring_flush(void *data)
+{
+    swAioUring *ring = &swoole_aio_uring;
+    int ret = 0;
+
+    ring->flush_scheduled = 0;
+    while (ring->sq_pending > 0)
+    {
+        ret = io_uring_enter(ring->fd, ring->sq_pending, 0, 0);
+        if (ret > 0)
+        {
+            ring->sq_pending -= ret;
+            continue;
+        }
+        if (ret < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        //the completion queue is busy, try again in the next loop
+        if (ret < 0 && (errno == EAGAIN || errno == EBUSY))
+        {
+            ring->flush_scheduled = 1;
+            SwooleG.main_reactor->defer(SwooleG.main_reactor, swAioUring_flush, NULL);
+            return;
+        }
+        swWarn("io_uring_enter() failed. Error: %s[%d]", strerror(errno), errno);
+        break;
+    }
+
+    if (ring->sq_pending == 0)
+    {
+        return;
+    }
+
+    //take back the requests which the kernel refused
+    int error = ret < 0 ? errno : EIO;
+    uint32_t tail = *ring->sq_tail - ring->sq_pending;
+    uint32_t pending = ring->sq_pending;
+    uint32_t i;
+
+    int indexes[SW_AIO_URING_ENTRIES];
+
+    //the callbacks may queue new requests at the tail
+    for (i = 0; i < pending; i++)
+    {
+        indexes[i] = (int) ring->sqes[ring->sq_array[(tail + i) & *ring->sq_mask]].user_data;
+    }
+    __atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+    ring->sq_pending = 0;
+    for (i = 0; i < pending; i++)
+    {
+        swAioUring_complete(ring, indexes[i], -error);
+    }
+}
+
+static int swAioUring_queue(int fd, uint8_t type, void *buf, size_t size, off_t offset)
+{
+    swAioUring *ring = &swoole_aio_uring;
+
+    if (ring->free_request < 0)
+    {
+        swWarn("too many aio requests, max is %d.", ring->cq_entries);
+        return SW_ERR;
+    }
+    if (ring->sq_pending == ring->sq_entries)
+    {
+        swAioUring_flush(NULL);
+        if (ring->sq_pending == ring->sq_entries)
+        {
+            swWarn("the submission queue of io_uring is full.");
+            return SW_ERR;
+        }
+    }
+
+    int index = ring->free_request;
+    swAioUring_request *request = &ring->requests[index];
+    ring->free_request = request->next;
+
+    request->fd = fd;
+    request->type = type;
+    request->offset = offset;
+    request->nbytes = size;
+    request->buf = buf;
+
+    uint32_t tail = *ring->sq_tail;
+    uint32_t sq_index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[sq_index];
+    int buf_index = swAioUring_buffer_index(ring, buf, size);
+
+    bzero(sqe, sizeof(struct io_uring_sqe));
+    if (buf_index < 0)
+    {
+        sqe->opcode = type == SW_AIO_READ ? IORING_OP_READ : IORING_OP_WRITE;
+    }
+    else
+    {
+        sqe->opcode = type == SW_AIO_READ ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+        sqe->buf_index = buf_index;
+    }
+    sqe->fd = fd;
+    sqe->addr = (unsigned long) buf;
+    sqe->len = size;
+    sqe->off = offset;
+    sqe->user_data = index;
+
+    ring->sq_array[sq_index] = sq_index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ring->sq_pending++;
+    SwooleAIO.task_num++;
+
+    //submitted once at the end of this loop
+    if (!ring->flush_scheduled)
+    {
+        ring->flush_scheduled = 1;
+        SwooleG.main_reactor->defer(SwooleG.main_reactor, swAioUring_flush, NULL);
+    }
+    return SW_OK;
+}
+
+static int swAioUring_read(int fd, void *outbuf, size_t size, off_t offset)
+{
+    return swAioUring_queue(fd, SW_AIO_READ, outbuf, size, offset);
+}
+
+static int swAioUring_write(int fd, void *inbuf, size_t size, off_t offset)
+{
+    return swAioUring_queue(fd, SW_AIO_WRITE, inbuf, size, offset);
+}
+
+static int swAioUring_onFinish(swReactor *reactor, swEvent *event)
+{
+    swAioUring *ring = &swoole_aio_uring;
+    uint64_t finished_aio;
+    struct io_uring_cqe *cqe;
+    uint32_t head, tail;
+    int index, res;
+
+    if (read(event->fd, &finished_aio, sizeof(finished_aio)) != sizeof(finished_aio))
+    {
+        swWarn("read() failed. Error: %s[%d]", strerror(errno), errno);
+        return SW_ERR;
+    }
+
+    head = *ring->cq_head;
+    while (1)
+    {
+        tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        if (head == tail)
+        {
+            break;
+        }
+        cqe = &ring->cqes[head & *ring->cq_mask];
+        index = (int) cqe->user_data;
+        res = cqe->res;
+        head++;
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+        swAioUring_complete(ring, index, res);
+    }
+    return SW_OK;
+}
+
+static void swAioUring_destroy()
+{
+    swAioUring *ring = &swoole_aio_uring;
+
+    swoole_aio_pipe.close(&swoole_aio_pipe);
+    munmap(ring->sqes, ring->sq_entries * sizeof(struct io_uring_sqe));
+    if (ring->cq_ring != ring->sq_ring)
+    {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+
+    sw_free(ring->requests);
+    if (ring->buffers)
+    {
+        free(ring->buffers);
+        sw_free(ring->free_buffers);
+    }
+    bzero(ring, sizeof(swAioUring));
+}
+
+#endif
@@ -45,35 +45,34 @@ int swProtocol_get_package_length(swProtocol *protocol, swConnection *conn, char
     return protocol->package_body_offset + body_length;
 }
 
+/**
+ * buffer->offset is the position where the next scan starts, the received data is scanned only once.
+ */
 static sw_inline int swProtocol_split_package_by_eof(swProtocol *protocol, void *object, swString *buffer)
 {
-#if 0
-    static count;
-    count ++;
-#endif
-
-    char stack_buf[SW_BUFFER_SIZE_BIG];
+    uint32_t eof_len = protocol->package_eof_len;
     int eof_pos;
-    if (buffer->length - buffer->offset < protocol->package_eof_len)
+
+    if (buffer->length - buffer->offset < eof_len)
     {
         eof_pos = -1;
     }
     else
     {
-        eof_pos = swoole_strnpos(buffer->str + buffer->offset, buffer->length - buffer->offset, protocol->package_eof, protocol->package_eof_len);
+        eof_pos = swoole_strnpos(buffer->str + buffer->offset, buffer->length - buffer->offset, protocol->package_eof, eof_len);
     }
 
-    //swNotice("#[0] count=%d, length=%ld, size=%ld, offset=%ld", count, buffer->length, buffer->size, buffer->offset);
-
     //waiting for more data
     if (eof_pos < 0)
     {
-        buffer->offset = buffer->length - protocol->package_eof_len;
+        if (buffer->length >= eof_len)
+        {
+            buffer->offset = buffer->length - eof_len + 1;
+        }
         return buffer->length;
     }
 
-    uint32_t length = buffer->offset + eof_pos + protocol->package_eof_len;
-    //swNotice("#[4] count=%d, length=%d", count, length);
+    uint32_t length = buffer->offset + eof_pos + eof_len;
     protocol->onPackage(object, buffer->str, length);
 
     //there are remaining data
@@ -81,36 +80,33 @@ static sw_inline int swProtocol_split_package_by_eof(swProtocol *protocol, void
     {
         uint32_t remaining_length = buffer->length - length;
         char *remaining_data = buffer->str + length;
-        //swNotice("#[5] count=%d, remaining_length=%d", count, remaining_length);
 
         while (1)
         {
-            if (remaining_length < protocol->package_eof_len)
+            if (remaining_length < eof_len)
+            {
+                eof_pos = -1;
+            }
+            else
             {
-                goto wait_more_data;
+                eof_pos = swoole_strnpos(remaining_data, remaining_length, protocol->package_eof, eof_len);
             }
-            eof_pos = swoole_strnpos(remaining_data, remaining_length, protocol->package_eof, protocol->package_eof_len);
             if (eof_pos < 0)
             {
-                wait_more_data:
-                //swNotice("#[1] count=%d, remaining_length=%d, length=%d", count, remaining_length, length);
-                memcpy(stack_buf, remaining_data, remaining_length);
-                memcpy(buffer->str, stack_buf, remaining_length);
+                memmove(buffer->str, remaining_data, remaining_length);
                 buffer->length = remaining_length;
-                buffer->offset = 0;
+                buffer->offset = remaining_length >= eof_len ? remaining_length - eof_len + 1 : 0;
                 return remaining_length;
             }
             else
             {
-                length = eof_pos + protocol->package_eof_len;
+                length = eof_pos + eof_len;
                 protocol->onPackage(object, remaining_data, length);
-                //swNotice("#[2] count=%d, remaining_length=%d, length=%d", count, remaining_length, length);
                 remaining_data += length;
                 remaining_length -= length;
             }
         }
     }
-    //swNotice("#[3] length=%ld, size=%ld, offset=%ld", buffer->length, buffer->size, buffer->offset);
     swString_clear(buffer);
     return 0;
 }
@@ -139,6 +139,10 @@ void swHttpRequest_free(swConnection *conn)
     {
         swString_free(request->buffer);
     }
+    if (request->index)
+    {
+        sw_free(request->index);
+    }
     bzero(request, sizeof(swHttpRequest));
     sw_free(request);
     conn->object = NULL;
@@ -256,21 +260,185 @@ int swHttpRequest_has_expect_header(swHttpRequest *request)
 #endif
 
 /**
- * POST get header-length
+ * get header-length, buffer->offset is moved forward so that the received data is scanned only once
  */
 int swHttpRequest_get_header_length(swHttpRequest *request)
 {
     swString *buffer = request->buffer;
 
-    int n = swoole_strnpos(buffer->str, buffer->length, "\r\n\r\n", 4);
+    if (buffer->length < buffer->offset + 4)
+    {
+        return SW_ERR;
+    }
+
+    int n = swoole_strnpos(buffer->str + buffer->offset, buffer->length - buffer->offset, "\r\n\r\n", 4);
     if (n < 0)
     {
+        buffer->offset = buffer->length - 3;
         return SW_ERR;
     }
     else
     {
         //strlen(header) + sizeof("\r\n\r\n")
-        request->header_length = n + 4;
+        request->header_length = buffer->offset + n + 4;
         return SW_OK;
     }
 }
+
+/**
+ * parse the request line and the headers in one pass, the header must be complete (request->header_length).
+ * request->index is always built, index->method = 0 if the header cannot be indexed.
+ */
+int swHttpRequest_parse_header(swHttpRequest *request)
+{
+    if (request->index == NULL)
+    {
+        request->index = sw_malloc(sizeof(swHttpIndex) + SW_HTTP_INDEX_MAX_HEADER * sizeof(swHttpIndex_header));
+        if (request->index == NULL)
+        {
+            swSysError("malloc() failed.");
+            return SW_ERR;
+        }
+    }
+
+    swHttpIndex *index = request->index;
+    bzero(index, sizeof(swHttpIndex));
+    index->method_length = request->offset - 1;
+    index->header_length = request->header_length;
+
+    char *buf = request->buffer->str;
+    //the last "\r\n" of the header
+    char *pe = buf + request->header_length - 2;
+    char *p, *eol, *colon, *value, *value_end;
+
+    //request uri
+    p = buf + request->offset;
+    eol = memchr(p, SW_SPACE, pe - p);
+    if (eol == NULL)
+    {
+        return SW_ERR;
+    }
+    index->path_offset = p - buf;
+    for (; p < eol && *p != '?' && *p != '#'; p++);
+    index->path_length = p - buf - index->path_offset;
+    if (p < eol && *p == '?')
+    {
+        index->query_offset = ++p - buf;
+        for (; p < eol && *p != '#'; p++);
+        index->query_length = p - buf - index->query_offset;
+    }
+
+    //http version
+    if (pe - eol > 8 && memcmp(eol + 1, "HTTP/1.1", 8) == 0)
+    {
+        request->version = HTTP_VERSION_11;
+    }
+    else if (pe - eol > 8 && memcmp(eol + 1, "HTTP/1.0", 8) == 0)
+    {
+        request->version = HTTP_VERSION_10;
+    }
+    else
+    {
+        return SW_ERR;
+    }
+    index->version = request->version;
+    index->keepalive = request->version == HTTP_VERSION_11;
+
+    p = memchr(eol, '\n', pe - eol);
+    if (p == NULL)
+    {
+        return SW_ERR;
+    }
+
+    int indexed = 1;
+    swHttpIndex_header *header;
+
+    for (p++; p < pe; p = eol + 2)
+    {
+        eol = swoole_strnstr(p, "\r\n", pe - p + 2);
+        if (eol == NULL)
+        {
+            return SW_ERR;
+        }
+        colon = memchr(p, ':', eol - p);
+        //obsolete line folding or invalid header, leave it to the worker
+        if (colon == NULL || colon == p || *p == SW_SPACE || *p == '\t')
+        {
+            indexed = 0;
+            continue;
+        }
+        for (value = colon + 1; value < eol && (*value == SW_SPACE || *value == '\t'); value++);
+        for (value_end = eol; value_end > value && (value_end[-1] == SW_SPACE || value_end[-1] == '\t'); value_end--);
+
+        if (indexed && index->header_num < SW_HTTP_INDEX_MAX_HEADER)
+        {
+            header = &index->headers[index->header_num++];
+            header->name_offset = p - buf;
+            header->name_length = colon - p;
+            header->value_offset = value - buf;
+            header->value_length = value_end - value;
+        }
+        else
+        {
+            indexed = 0;
+        }
+
+        if (colon - p == sizeof("Content-Length") - 1 && strncasecmp(p, SW_STRL("Content-Length") - 1) == 0)
+        {
+            request->content_length = index->content_length = strtoul(value, NULL, 10);
+        }
+        else if (colon - p == sizeof("Connection") - 1 && strncasecmp(p, SW_STRL("Connection") - 1) == 0)
+        {
+            if (value_end - value == sizeof("close") - 1 && strncasecmp(value, SW_STRL("close") - 1) == 0)
+            {
+                index->keepalive = 0;
+            }
+            else if (value_end - value == sizeof("keep-alive") - 1 && strncasecmp(value, SW_STRL("keep-alive") - 1) == 0)
+            {
+                index->keepalive = 1;
+            }
+        }
+        //the reactor does not decode the chunked body
+        else if (colon - p == sizeof("Transfer-Encoding") - 1 && strncasecmp(p, SW_STRL("Transfer-Encoding") - 1) == 0)
+        {
+            indexed = 0;
+        }
+    }
+
+    if (indexed)
+    {
+        index->method = request->method;
+    }
+    else
+    {
+        index->header_num = 0;
+    }
+    return SW_OK;
+}
+
+/**
+ * [worker] find the index after the request and copy it to the buffer, see swHttpIndex
+ */
+swHttpIndex* swHttpIndex_get(char *data, uint32_t length, swHttpIndex_buffer *buffer, uint32_t *request_length)
+{
+    swHttpIndex *index = &buffer->index;
+    uint32_t n;
+
+    if (length < sizeof(swHttpIndex) + sizeof(uint32_t))
+    {
+        return NULL;
+    }
+    memcpy(&n, data + length - sizeof(uint32_t), sizeof(n));
+    if (n > length - sizeof(swHttpIndex) - sizeof(uint32_t))
+    {
+        return NULL;
+    }
+    memcpy(index, data + n, sizeof(swHttpIndex));
+    if (index->header_num > SW_HTTP_INDEX_MAX_HEADER || n + swHttpIndex_size(index) + sizeof(uint32_t) != length)
+    {
+        return NULL;
+    }
+    memcpy(index->headers, data + n + sizeof(swHttpIndex), index->header_num * sizeof(swHttpIndex_header));
+    *request_length = n;
+    return index;
+}
@@ -19,6 +19,15 @@
 #include "Connection.h"
 #include <sys/time.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static uint32_t swWebSocket_mask_seed;
+static pid_t swWebSocket_mask_pid;
+
 /*  The following is websocket data frame:
  +-+-+-+-+-------+-+-------------+-------------------------------+
  0                   1                   2                   3   |
@@ -89,55 +98,156 @@ int swWebSocket_get_package_length(swProtocol *protocol, swConnection *conn, cha
     return header_length + payload_length;
 }
 
-void swWebSocket_encode(swString *buffer, char *data, size_t length, char opcode, int finish, int mask)
+/**
+ * dst = src ^ mask_key, dst can be the same as src.
+ * The key is periodic with 4 bytes, so it is widened to a register and xor-ed in blocks.
+ */
+void swWebSocket_mask(char *dst, char *src, size_t length, char *mask_key)
+{
+    size_t i = 0;
+    uint32_t key32;
+    uint64_t key64, block;
+
+    memcpy(&key32, mask_key, SW_WEBSOCKET_MASK_LEN);
+
+#ifdef __AVX2__
+    __m256i key256 = _mm256_set1_epi32(key32);
+    for (; i + 32 <= length; i += 32)
+    {
+        __m256i v = _mm256_loadu_si256((__m256i *) (src + i));
+        _mm256_storeu_si256((__m256i *) (dst + i), _mm256_xor_si256(v, key256));
+    }
+#endif
+#if defined(__AVX2__) || defined(__SSE2__)
+    __m128i key128 = _mm_set1_epi32(key32);
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((__m128i *) (src + i));
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_xor_si128(v, key128));
+    }
+#endif
+
+    key64 = ((uint64_t) key32 << 32) | key32;
+    for (; i + 8 <= length; i += 8)
+    {
+        memcpy(&block, src + i, sizeof(block));
+        block ^= key64;
+        memcpy(dst + i, &block, sizeof(block));
+    }
+    for (; i < length; i++)
+    {
+        dst[i] = src[i] ^ mask_key[i & 3];
+    }
+}
+
+/**
+ * RFC6455 only requires the key to be unpredictable for the intermediaries, xorshift is enough.
+ * Seeded once per process, forked children get a new seed.
+ */
+void swWebSocket_mask_key(char *mask_key)
+{
+    uint32_t x;
+
+    if (swWebSocket_mask_seed == 0 || swWebSocket_mask_pid != SwooleG.pid)
+    {
+        swWebSocket_mask_pid = SwooleG.pid;
+        swWebSocket_mask_seed = (uint32_t) swoole_system_random(1, 0x7fffffff) ^ ((uint32_t) time(NULL) << 8)
+                ^ (uint32_t) SwooleG.pid;
+        if (swWebSocket_mask_seed == 0)
+        {
+            swWebSocket_mask_seed = 0x9e3779b9;
+        }
+    }
+    x = swWebSocket_mask_seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    swWebSocket_mask_seed = x;
+    memcpy(mask_key, &x, SW_WEBSOCKET_MASK_LEN);
+}
+
+/**
+ * write the frame header (with the masking key) into header[SW_WEBSOCKET_HEADER_MAX_LEN], return the header length.
+ */
+int swWebSocket_encode_header(char *header, size_t length, char opcode, int finish, int mask)
 {
     int pos = 0;
-    char frame_header[16];
 
-    frame_header[pos++] = FRAME_SET_FIN(finish) | FRAME_SET_OPCODE(opcode);
+    header[pos++] = FRAME_SET_FIN(finish) | FRAME_SET_OPCODE(opcode);
     if (length < 126)
     {
-        frame_header[pos++] = FRAME_SET_MASK(mask) | FRAME_SET_LENGTH(length, 0);
+        header[pos++] = FRAME_SET_MASK(mask) | FRAME_SET_LENGTH(length, 0);
     }
     else
     {
         if (length < 65536)
         {
-            frame_header[pos++] = FRAME_SET_MASK(mask) | 126;
+            header[pos++] = FRAME_SET_MASK(mask) | 126;
         }
         else
         {
-            frame_header[pos++] = FRAME_SET_MASK(mask) | 127;
-            frame_header[pos++] = FRAME_SET_LENGTH(length, 7);
-            frame_header[pos++] = FRAME_SET_LENGTH(length, 6);
-            frame_header[pos++] = FRAME_SET_LENGTH(length, 5);
-            frame_header[pos++] = FRAME_SET_LENGTH(length, 4);
-            frame_header[pos++] = FRAME_SET_LENGTH(length, 3);
-            frame_header[pos++] = FRAME_SET_LENGTH(length, 2);
+            header[pos++] = FRAME_SET_MASK(mask) | 127;
+            header[pos++] = FRAME_SET_LENGTH(length, 7);
+            header[pos++] = FRAME_SET_LENGTH(length, 6);
+            header[pos++] = FRAME_SET_LENGTH(length, 5);
+            header[pos++] = FRAME_SET_LENGTH(length, 4);
+            header[pos++] = FRAME_SET_LENGTH(length, 3);
+            header[pos++] = FRAME_SET_LENGTH(length, 2);
         }
-        frame_header[pos++] = FRAME_SET_LENGTH(length, 1);
-        frame_header[pos++] = FRAME_SET_LENGTH(length, 0);
+        header[pos++] = FRAME_SET_LENGTH(length, 1);
+        header[pos++] = FRAME_SET_LENGTH(length, 0);
     }
 
     if (mask)
     {
-        int i;
-        char masks[SW_WEBSOCKET_MASK_LEN];
-        for (i = 0; i < SW_WEBSOCKET_MASK_LEN; i++)
-        {
-            srand((int) time(0));
-            masks[i] = (rand() % 26) + 'a';
-            frame_header[pos++] = masks[i];
-        }
-        for (i = 0; i < length; i++)
-        {
-            data[i] ^= masks[i % SW_WEBSOCKET_MASK_LEN];
-        }
+        swWebSocket_mask_key(header + pos);
+        pos += SW_WEBSOCKET_MASK_LEN;
+    }
+    return pos;
+}
+
+/**
+ * zero-copy encode, iov[0] is the header, iov[1] is the payload.
+ * The payload is masked in place when mask is set.
+ */
+int swWebSocket_encode_iov(struct iovec *iov, char *header, char *data, size_t length, char opcode, int finish, int mask)
+{
+    int n = swWebSocket_encode_header(header, length, opcode, finish, mask);
+    if (mask)
+    {
+        swWebSocket_mask(data, data, length, header + n - SW_WEBSOCKET_MASK_LEN);
+    }
+    iov[0].iov_base = header;
+    iov[0].iov_len = n;
+    iov[1].iov_base = data;
+    iov[1].iov_len = length;
+    return length > 0 ? 2 : 1;
+}
+
+/**
+ * append the frame to the buffer, data is not modified.
+ */
+int swWebSocket_encode(swString *buffer, char *data, size_t length, char opcode, int finish, int mask)
+{
+    char header[SW_WEBSOCKET_HEADER_MAX_LEN];
+    int n = swWebSocket_encode_header(header, length, opcode, finish, mask);
+
+    if (buffer->size < buffer->length + n + length && swString_extend(buffer, buffer->length + n + length) < 0)
+    {
+        return SW_ERR;
     }
-    //websocket frame header
-    swString_append_ptr(buffer, frame_header, pos);
-    //websocket frame body
-    swString_append_ptr(buffer, data, length);
+    memcpy(buffer->str + buffer->length, header, n);
+    buffer->length += n;
+    if (mask)
+    {
+        swWebSocket_mask(buffer->str + buffer->length, data, length, header + n - SW_WEBSOCKET_MASK_LEN);
+    }
+    else
+    {
+        memcpy(buffer->str + buffer->length, data, length);
+    }
+    buffer->length += length;
+    return SW_OK;
 }
 
 void swWebSocket_decode(swWebSocket_frame *frame, swString *data)
@@ -168,11 +278,7 @@ void swWebSocket_decode(swWebSocket_frame *frame, swString *data)
         memcpy(mask_key, data->str + header_length, SW_WEBSOCKET_MASK_LEN);
         header_length += SW_WEBSOCKET_MASK_LEN;
         buf = data->str + header_length;
-        int i;
-        for (i = 0; i < payload_length; i++)
-        {
-            buf[i] ^= mask_key[i % SW_WEBSOCKET_MASK_LEN];
-        }
+        swWebSocket_mask(buf, buf, payload_length, mask_key);
     }
     frame->payload_length = payload_length;
     frame->header_length = header_length;
@@ -21,6 +21,7 @@
 static void swReactor_onTimeout_and_Finish(swReactor *reactor);
 static void swReactor_onTimeout(swReactor *reactor);
 static void swReactor_onFinish(swReactor *reactor);
+static void swReactor_defer_run(swReactor *reactor);
 static int swReactor_defer(swReactor *reactor, swCallback callback, void *data);
 
 int swReactor_create(swReactor *reactor, int max_event)
@@ -230,6 +231,8 @@ static void swReactor_onTimeout_and_Finish(swReactor *reactor)
 
 static void swReactor_onTimeout(swReactor *reactor)
 {
+    //the wait does not block when there are defer callbacks
+    swReactor_defer_run(reactor);
     swReactor_onTimeout_and_Finish(reactor);
 
     if (reactor->disable_accept)
@@ -239,15 +242,8 @@ static void swReactor_onTimeout(swReactor *reactor)
     }
 }
 
-static void swReactor_onFinish(swReactor *reactor)
+static void swReactor_defer_run(swReactor *reactor)
 {
-    //check signal
-    if (reactor->singal_no)
-    {
-        swSignal_callback(reactor->singal_no);
-        reactor->singal_no = 0;
-    }
-    //defer callback
     swDefer_callback *cb, *tmp;
     LL_FOREACH(reactor->defer_callback_list, cb)
     {
@@ -258,6 +254,18 @@ static void swReactor_onFinish(swReactor *reactor)
         sw_free(cb);
     }
     reactor->defer_callback_list = NULL;
+}
+
+static void swReactor_onFinish(swReactor *reactor)
+{
+    //check signal
+    if (reactor->singal_no)
+    {
+        swSignal_callback(reactor->singal_no);
+        reactor->singal_no = 0;
+    }
+    //defer callback
+    swReactor_defer_run(reactor);
     swReactor_onTimeout_and_Finish(reactor);
 }
 
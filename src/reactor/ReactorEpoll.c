@@ -222,7 +222,7 @@ static int swReactorEpoll_wait(swReactor *reactor, struct timeval *timeo)
 
     while (reactor->running > 0)
     {
-        msec = reactor->timeout_msec;
+        msec = reactor->defer_callback_list ? 0 : reactor->timeout_msec;
         n = epoll_wait(epoll_fd, events, max_event_num, msec);
         if (n < 0)
         {
@@ -278,7 +278,13 @@ static int swReactorKqueue_wait(swReactor *reactor, struct timeval *timeo)
 
     while (reactor->running > 0)
     {
-        if (reactor->timeout_msec > 0)
+        if (reactor->defer_callback_list)
+        {
+            t.tv_sec = 0;
+            t.tv_nsec = 0;
+            t_ptr = &t;
+        }
+        else if (reactor->timeout_msec > 0)
         {
             t.tv_sec = reactor->timeout_msec / 1000;
             t.tv_nsec = (reactor->timeout_msec - t.tv_sec * 1000) * 1000;
@@ -215,7 +215,7 @@ static int swReactorPoll_wait(swReactor *reactor, struct timeval *timeo)
 
     while (reactor->running > 0)
     {
-        msec = reactor->timeout_msec;
+        msec = reactor->defer_callback_list ? 0 : reactor->timeout_msec;
         ret = poll(object->events, reactor->event_num, msec);
         if (ret < 0)
         {
@@ -200,7 +200,12 @@ int swReactorSelect_wait(swReactor *reactor, struct timeval *timeo)
             }
         }
 
-        if (reactor->timeout_msec < 0)
+        if (reactor->defer_callback_list)
+        {
+            timeout.tv_sec = 0;
+            timeout.tv_usec = 0;
+        }
+        else if (reactor->timeout_msec < 0)
         {
             timeout.tv_sec = SW_MAX_UINT;
             timeout.tv_usec = 0;
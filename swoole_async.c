@@ -56,6 +56,12 @@ static sw_inline void swoole_aio_free(void *ptr)
     {
         free(ptr);
     }
+#ifdef HAVE_IO_URING
+    else if (SwooleAIO.mode == SW_AIO_URING)
+    {
+        swAioUring_free(ptr);
+    }
+#endif
     else
     {
         efree(ptr);
@@ -78,6 +84,12 @@ static sw_inline void* swoole_aio_malloc(size_t __size)
             return memory;
         }
     }
+#ifdef HAVE_IO_URING
+    else if (SwooleAIO.mode == SW_AIO_URING)
+    {
+        return swAioUring_malloc(__size);
+    }
+#endif
     else
     {
         return emalloc(__size);
@@ -91,6 +103,9 @@ void swoole_async_init(int module_number TSRMLS_DC)
     REGISTER_LONG_CONSTANT("SWOOLE_AIO_BASE", SW_AIO_BASE, CONST_CS | CONST_PERSISTENT);
     REGISTER_LONG_CONSTANT("SWOOLE_AIO_GCC", SW_AIO_GCC, CONST_CS | CONST_PERSISTENT);
     REGISTER_LONG_CONSTANT("SWOOLE_AIO_LINUX", SW_AIO_LINUX, CONST_CS | CONST_PERSISTENT);
+#ifdef HAVE_IO_URING
+    REGISTER_LONG_CONSTANT("SWOOLE_AIO_URING", SW_AIO_URING, CONST_CS | CONST_PERSISTENT);
+#endif
 
     php_swoole_open_files = swHashMap_new(SW_HASHMAP_INIT_BUCKET_N, NULL);
     if (php_swoole_open_files == NULL)
@@ -343,7 +358,9 @@ PHP_FUNCTION(swoole_async_read)
         RETURN_FALSE;
     }
 
-    void *fcnt = swoole_aio_malloc(buf_size);
+    //the registered buffers of io_uring are created with the aio context
+    php_swoole_check_aio();
+    void *fcnt = swoole_aio_malloc(buf_size + 1);
     if (fcnt == NULL)
     {
         swoole_php_sys_error(E_WARNING, "malloc failed.");
@@ -371,7 +388,6 @@ PHP_FUNCTION(swoole_async_read)
     sw_zval_add_ref(&filename);
 
     swHashMap_add_int(php_swoole_aio_request, fd, req);
-    php_swoole_check_aio();
     SW_CHECK_RETURN(SwooleAIO.read(fd, fcnt, buf_size, offset));
     RETURN_TRUE;
 }
@@ -406,8 +422,8 @@ PHP_FUNCTION(swoole_async_write)
     }
     else
     {
-        wt_cnt = fcnt;
-        wt_cnt = emalloc(fcnt_len);
+        php_swoole_check_aio();
+        wt_cnt = swoole_aio_malloc(fcnt_len);
     }
 
     file_request *req = swHashMap_find(php_swoole_open_files, Z_STRVAL_P(filename), Z_STRLEN_P(filename));
@@ -543,7 +559,8 @@ PHP_FUNCTION(swoole_async_readfile)
     else
     {
         buf_len = file_stat.st_size;
-        fcnt = emalloc(buf_len + 1);
+        php_swoole_check_aio();
+        fcnt = swoole_aio_malloc(buf_len + 1);
         if (fcnt == NULL)
         {
             swoole_php_fatal_error(E_WARNING, "malloc failed. Error: %s[%d]", strerror(errno), errno);
@@ -621,7 +638,8 @@ PHP_FUNCTION(swoole_async_writefile)
         RETURN_FALSE;
     }
 #else
-    wt_cnt = emalloc(fcnt_len);
+    php_swoole_check_aio();
+    wt_cnt = swoole_aio_malloc(fcnt_len);
 #endif
 
     file_request *req = emalloc(sizeof(file_request));
@@ -699,6 +717,15 @@ PHP_FUNCTION(swoole_async_set)
         convert_to_boolean(v);
         SwooleG.socket_dontwait = Z_BVAL_P(v);
     }
+
+    /**
+     * must be set before the first timer is added
+     */
+    if (sw_zend_hash_find(vht, ZEND_STRS("timer_wheel"), (void **) &v) == SUCCESS)
+    {
+        convert_to_boolean(v);
+        SwooleG.timer_backend = Z_BVAL_P(v) ? SW_TIMER_BACKEND_WHEEL : SW_TIMER_BACKEND_HEAP;
+    }
 }
 
 PHP_FUNCTION(swoole_async_dns_lookup)
@@ -1121,6 +1121,7 @@ static PHP_METHOD(swoole_client, recv)
 
         swString *buffer = cli->buffer;
         int eof = -1;
+        uint32_t scan_offset = 0;
 
         while (1)
         {
@@ -1152,17 +1153,17 @@ static PHP_METHOD(swoole_client, recv)
                 continue;
             }
 
-            eof = swoole_strnpos(buffer->str, buffer->length, protocol->package_eof, protocol->package_eof_len);
+            //only scan the received data once
+            eof = swoole_strnpos(buffer->str + scan_offset, buffer->length - scan_offset, protocol->package_eof, protocol->package_eof_len);
             if (eof >= 0)
             {
-                eof += protocol->package_eof_len;
+                eof += scan_offset + protocol->package_eof_len;
                 SW_RETVAL_STRINGL(buffer->str, eof, 1);
 
                 if (buffer->length > eof)
                 {
                     buffer->length -= eof;
-                    memcpy(stack_buf, buffer->str + eof, buffer->length);
-                    memcpy(buffer->str, stack_buf, buffer->length);
+                    memmove(buffer->str, buffer->str + eof, buffer->length);
                 }
                 else
                 {
@@ -1172,6 +1173,7 @@ static PHP_METHOD(swoole_client, recv)
             }
             else
             {
+                scan_offset = buffer->length - protocol->package_eof_len + 1;
                 if (buffer->length == protocol->package_max_length)
                 {
                     swoole_php_error(E_WARNING, "no package eof");
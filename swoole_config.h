@@ -55,6 +55,11 @@
 //#define SW_DEBUG                 //debug
 #define SW_LOG_NO_SRCINFO          //no source info
 #define SW_LOG_TRACE_OPEN          0
+#define SW_LOG_ASYNC                    //written by a thread of each process
+#define SW_LOG_RING_SIZE           1024 //power of 2
+#define SW_LOG_WRITEV_MAX          64
+#define SW_LOG_RATE_LIMIT          100  //lines per error code per second
+#define SW_LOG_LIMIT_SLOTS         256
 //#define SW_BUFFER_SIZE           65495 //65535 - 28 - 12(UDP最大包 - 包头 - 3个INT)
 #define SW_CLIENT_BUFFER_SIZE      65535
 //#define SW_CLIENT_RECV_AGAIN
@@ -105,6 +110,9 @@
 #define SW_AIO_EVENT_NUM                 128
 //#define SW_AIO_THREAD_USE_CHANNEL
 #define SW_AIO_MAX_EVENTS                128
+#define SW_AIO_URING_ENTRIES             128      //power of 2
+#define SW_AIO_URING_BUFFER_NUM          16       //registered buffers
+#define SW_AIO_URING_BUFFER_SIZE         65536
 //#define SW_THREADPOOL_USE_CHANNEL
 #define SW_THREADPOOL_QUEUE_LEN          10000
 #define SW_IP_MAX_LENGTH                 32
@@ -130,7 +138,7 @@
 #define SW_REACTOR_MINEVENTS             128
 #define SW_REACTOR_MAXEVENTS             4096
 #define SW_REACTOR_USE_SESSION
-#define SW_SESSION_LIST_SIZE             (1024*1024)
+#define SW_SESSION_LIST_SIZE             (1024*1024)  //power of 2
 
 #define SW_MSGMAX                        8192
 
@@ -172,6 +180,27 @@
 #define SW_BUFFER_INPUT_SIZE             (1024*1024*2)
 #define SW_PIPE_BUFFER_SIZE              (1024*1024*32)
 
+/**
+ * big responses of the worker, written into the chunks of worker->send_shm and sent by the reactor without copy
+ */
+#define SW_WORKER_SEND_CHUNK_SIZE        SW_BUFFER_SIZE_BIG
+#define SW_WORKER_SEND_SHM_NUM           4      //big responses in flight per worker
+#define SW_WORKER_SEND_SHM_WAIT_USEC     1000   //worker sleep when all the chunks are in flight
+#define SW_WORKER_SEND_SHM_WAIT_MAX      10     //then the big response is copied through the pipe
+
+/**
+ * free trunks cached by every size class of the per-thread swBuffer_pool
+ */
+#define SW_BUFFER_POOL_MAX_SIZE          (1024*1024*4)
+
+/**
+ * ipc_mode = SW_IPC_RING, size of each reactor<->worker ring
+ */
+#define SW_IPC_RING_SIZE                 (1024*256)
+#define SW_IPC_RING_MIN_SIZE             (1024*64)
+#define SW_IPC_RING_WAIT_MSEC            1000   //producer waits for the notify fd when the ring is full
+#define SW_CACHELINE_SIZE                64
+
 #define SW_MEMORY_POOL_SLAB_PAGE         10     //内存池的页数
 
 #define SW_USE_FIXED_BUFFER
@@ -196,12 +225,24 @@
 
 #define SW_TASK_TMP_FILE                 "/tmp/swoole.task.XXXXXX"
 #define SW_TASK_TMPDIR_SIZE              128
+#define SW_TASK_ARENA_SIZE               (1024*1024*32)
+#define SW_ARENA_PAGE_SIZE               (1024*1024)
+#define SW_ARENA_MIN_SLICE               (1024*16)
+#define SW_ARENA_CLASS_NUM               7      //16K ~ 1M
 
 #define SW_FILE_CHUNK_SIZE               65536
 
-#define SW_TABLE_CONFLICT_PROPORTION     0.2 //20%
-#define SW_TABLE_COMPRESS_PROPORTION     0.5 //50% skip, will compress the row list
+#define SW_TIMER_WHEEL_BITS              6
+#define SW_TIMER_WHEEL_SIZE              (1 << SW_TIMER_WHEEL_BITS)
+#define SW_TIMER_WHEEL_LEVEL             5     //2^30 ms, about 12 days
+#define SW_TIMER_NODE_BATCH              256   //timer nodes allocated at once
+
+#define SW_TABLE_LOAD_FACTOR             0.75 //grow the index when 75% slots are used
+#define SW_TABLE_GROWTH_LIMIT            4    //default max_size = size * 4
+#define SW_TABLE_REHASH_STEP             64   //index slots migrated per write during rehash
+#define SW_TABLE_STRIPE_BITS             4    //the key index is split into 16 stripes, set/del of different stripes run in parallel
 #define SW_TABLE_KEY_SIZE                64
+#define SW_TABLE_SKIPLIST_LEVEL          16
 //#define SW_TABLE_USE_PHP_HASH
 //#define SW_TABLE_DEBUG
 
@@ -229,6 +270,7 @@
 #define SW_HTTP_COOKIE_VALLEN            4096
 #define SW_HTTP_RESPONSE_INIT_SIZE       65536
 #define SW_HTTP_HEADER_MAX_SIZE          8192
+#define SW_HTTP_INDEX_MAX_HEADER         64
 #define SW_HTTP_COMPRESS_GZIP
 #define SW_HTTP_UPLOAD_TMP_FILE          "/tmp/swoole.upfile.XXXXXX"
 #define SW_HTTP_DATE_FORMAT              "D, d M Y H:i:s T"
@@ -239,6 +281,10 @@
 #define SW_HTTP2_MAX_WINDOW              ((1u << 31) - 1)
 
 #define SW_HTTP_CLIENT_USERAGENT         "swoole-http-client"
+#define SW_HTTP_CLIENT_POOL_MAX_IDLE     32
+#define SW_HTTP_CLIENT_POOL_MAX_PER_HOST 0      //0: no limit
+#define SW_HTTP_CLIENT_POOL_IDLE_TIMEOUT 60
+#define SW_HTTP_CLIENT_POOL_WAIT_TIMEOUT 3      //seconds, a waiter of the pool fails with ETIMEDOUT
 
 #define SW_WEBSOCKET_SERVER_SOFTWARE     "swoole-websocket-server"
 #define SW_WEBSOCKET_VERSION             "13"
@@ -247,5 +293,14 @@
 #define SW_MYSQL_QUERY_INIT_SIZE         8192
 #define SW_MYSQL_DEFAULT_PORT            3306
 #define SW_MYSQL_CONNECT_TIMEOUT         1.0
+#define SW_MYSQL_STMT_CACHE_SIZE         128     //prepared statements cached per connection
+
+#define SW_REDIS_DEFAULT_PORT            6379
+
+#define SW_CONNPOOL_MIN                  1
+#define SW_CONNPOOL_MAX                  32
+#define SW_CONNPOOL_WAIT_TIMEOUT         1.0     //seconds, 0: wait forever
+#define SW_CONNPOOL_IDLE_TIMEOUT         60      //idle connections above min are closed
+#define SW_CONNPOOL_CHECK_INTERVAL       5       //seconds, 0: no health check
 
 #endif /* SWOOLE_CONFIG_H_ */
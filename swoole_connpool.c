@@ -0,0 +1,757 @@
+/*
+ +----------------------------------------------------------------------+
+ | Swoole                                                               |
+ +----------------------------------------------------------------------+
+ | Copyright (c) 2012-2015 The Swoole Group                             |
+ +----------------------------------------------------------------------+
+ | This source file is subject to version 2.0 of the Apache license,    |
+ | that is bundled with this package in the file LICENSE, and is        |
+ | available through the world-wide-web at the following url:           |
+ | http://www.apache.org/licenses/LICENSE-2.0.html                      |
+ | If you did not receive a copy of the Apache2.0 license and are unable|
+ | to obtain it through the world-wide-web, please send a note to       |
+ | license@swoole.com so we can mail you a copy immediately.            |
+ +----------------------------------------------------------------------+
+ | Author: Tianfeng Han  <mikan.tenny@gmail.com>                        |
+ +----------------------------------------------------------------------+
+ */
+
+#include "php_swoole.h"
+
+enum swoole_connpool_type
+{
+    SW_CONNPOOL_MYSQL = 1,
+    SW_CONNPOOL_REDIS = 2,
+};
+
+enum connpool_object_state
+{
+    CONNPOOL_OBJECT_CONNECTING,
+    CONNPOOL_OBJECT_IDLE,
+    CONNPOOL_OBJECT_BUSY,
+};
+
+/**
+ * a swoole_mysql or swoole_redis object of the pool
+ */
+typedef struct _connpool_object
+{
+    zval *object;
+#if PHP_MAJOR_VERSION >= 7
+    zval _object;
+#endif
+    uint8_t state;
+    time_t idle_since;
+    struct _connpool *pool;
+    struct _connpool_object *prev, *next;
+} connpool_object;
+
+/**
+ * a get() waiting for a connection, or the callback of get() to be called
+ */
+typedef struct _connpool_waiter
+{
+    zval *callback;
+    zval *pool_object;
+#if PHP_MAJOR_VERSION >= 7
+    zval _callback;
+    zval _pool_object;
+#endif
+    long timer_id;
+    struct _connpool *pool;
+    connpool_object *conn;
+    struct _connpool_waiter *prev, *next;
+} connpool_waiter;
+
+typedef struct _connpool
+{
+    uint8_t type;
+    uint8_t closed;
+
+    char *host;
+    int port;
+    char *user;
+    char *password;
+    char *database;
+
+    uint32_t min;
+    uint32_t max;
+    /**
+     * msec, 0: wait forever
+     */
+    uint32_t wait_timeout;
+    uint32_t idle_timeout;
+    uint32_t check_interval;
+    long check_timer;
+
+    /**
+     * the most recently used one is at the tail
+     */
+    connpool_object *idle_list;
+    /**
+     * object handle => connpool_object in use
+     */
+    swHashMap *busy_map;
+    connpool_waiter *wait_list;
+
+    /**
+     * idle, in use and connecting
+     */
+    uint32_t conn_num;
+    uint32_t idle_num;
+    uint32_t busy_num;
+    uint32_t connecting_num;
+    uint32_t wait_num;
+
+    struct
+    {
+        long get;
+        long hit;
+        long wait;
+        long timeout;
+        long connect;
+        long connect_failed;
+        long closed;
+    } stats;
+
+    zval *object;
+#if PHP_MAJOR_VERSION >= 7
+    zval _object;
+#endif
+} connpool;
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_connpool_construct, 0, 0, 2)
+    ZEND_ARG_INFO(0, type)
+    ZEND_ARG_ARRAY_INFO(0, config, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_connpool_get, 0, 0, 1)
+    ZEND_ARG_INFO(0, callback)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_connpool_release, 0, 0, 1)
+    ZEND_ARG_INFO(0, connection)
+ZEND_END_ARG_INFO()
+
+static PHP_METHOD(swoole_connpool, __construct);
+static PHP_METHOD(swoole_connpool, __destruct);
+static PHP_METHOD(swoole_connpool, get);
+static PHP_METHOD(swoole_connpool, release);
+static PHP_METHOD(swoole_connpool, getStats);
+static PHP_METHOD(swoole_connpool, close);
+
+static int connpool_connect(connpool *pool TSRMLS_DC);
+static void connpool_onConnect(zval *zobject, int success, void *data);
+static void connpool_onCheck(long timer_id, void *data);
+static void connpool_onWaitTimeout(long timer_id, void *data);
+static void connpool_onDispatch(void *data);
+
+static zend_class_entry swoole_connpool_ce;
+static zend_class_entry *swoole_connpool_class_entry_ptr;
+
+static const zend_function_entry swoole_connpool_methods[] =
+{
+    PHP_ME(swoole_connpool, __construct, arginfo_swoole_connpool_construct, ZEND_ACC_PUBLIC | ZEND_ACC_CTOR)
+    PHP_ME(swoole_connpool, __destruct, NULL, ZEND_ACC_PUBLIC | ZEND_ACC_DTOR)
+    PHP_ME(swoole_connpool, get, arginfo_swoole_connpool_get, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_connpool, release, arginfo_swoole_connpool_release, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_connpool, getStats, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_connpool, close, NULL, ZEND_ACC_PUBLIC)
+    PHP_FE_END
+};
+
+void swoole_connpool_init(int module_number TSRMLS_DC)
+{
+    SWOOLE_INIT_CLASS_ENTRY(swoole_connpool_ce, "swoole_connpool", "Swoole\\ConnectionPool", swoole_connpool_methods);
+    swoole_connpool_class_entry_ptr = zend_register_internal_class(&swoole_connpool_ce TSRMLS_CC);
+
+    REGISTER_LONG_CONSTANT("SWOOLE_CONNPOOL_MYSQL", SW_CONNPOOL_MYSQL, CONST_CS | CONST_PERSISTENT);
+#ifdef SW_USE_REDIS
+    REGISTER_LONG_CONSTANT("SWOOLE_CONNPOOL_REDIS", SW_CONNPOOL_REDIS, CONST_CS | CONST_PERSISTENT);
+#endif
+}
+
+static int connpool_object_is_ready(connpool *pool, connpool_object *conn)
+{
+#ifdef SW_USE_REDIS
+    if (pool->type == SW_CONNPOOL_REDIS)
+    {
+        return php_swoole_redis_is_ready(conn->object);
+    }
+#endif
+    return php_swoole_mysql_is_ready(conn->object);
+}
+
+static void connpool_object_free(connpool_object *conn TSRMLS_DC)
+{
+    sw_zval_ptr_dtor(&conn->object);
+    efree(conn);
+}
+
+static void connpool_object_close(connpool *pool, connpool_object *conn TSRMLS_DC)
+{
+    zval *zobject = conn->object;
+    zval *retval = NULL;
+
+    pool->conn_num--;
+    pool->stats.closed++;
+
+    if (pool->type == SW_CONNPOOL_MYSQL)
+    {
+        zval *connected = sw_zend_read_property(Z_OBJCE_P(zobject), zobject, ZEND_STRL("connected"), 1 TSRMLS_CC);
+        if (!zend_is_true(connected))
+        {
+            connpool_object_free(conn TSRMLS_CC);
+            return;
+        }
+    }
+    sw_zend_call_method_with_0_params(&zobject, NULL, NULL, "close", &retval);
+    if (retval)
+    {
+        sw_zval_ptr_dtor(&retval);
+    }
+    connpool_object_free(conn TSRMLS_CC);
+}
+
+static void connpool_waiter_free(connpool_waiter *waiter TSRMLS_DC)
+{
+    sw_zval_ptr_dtor(&waiter->callback);
+    //the pool may be released here
+    sw_zval_ptr_dtor(&waiter->pool_object);
+    efree(waiter);
+}
+
+/**
+ * the callback of get() is called in the next round of the reactor, conn is NULL on failure
+ */
+static void connpool_dispatch(connpool *pool, connpool_waiter *waiter, connpool_object *conn TSRMLS_DC)
+{
+    if (waiter->timer_id > 0)
+    {
+        php_swoole_clear_timer(waiter->timer_id TSRMLS_CC);
+        waiter->timer_id = 0;
+    }
+    if (conn)
+    {
+        conn->state = CONNPOOL_OBJECT_BUSY;
+        swHashMap_add_int(pool->busy_map, Z_OBJ_HANDLE_P(conn->object), conn);
+        pool->busy_num++;
+    }
+    waiter->conn = conn;
+    SwooleG.main_reactor->defer(SwooleG.main_reactor, connpool_onDispatch, waiter);
+}
+
+static connpool_waiter* connpool_wakeup(connpool *pool)
+{
+    connpool_waiter *waiter = pool->wait_list;
+    DL_DELETE(pool->wait_list, waiter);
+    pool->wait_num--;
+    return waiter;
+}
+
+/**
+ * the connection is connected or released, it goes to the first waiter or back to the idle list
+ */
+static void connpool_put(connpool *pool, connpool_object *conn TSRMLS_DC)
+{
+    if (pool->wait_list)
+    {
+        connpool_dispatch(pool, connpool_wakeup(pool), conn TSRMLS_CC);
+    }
+    else if (pool->closed)
+    {
+        connpool_object_close(pool, conn TSRMLS_CC);
+    }
+    else
+    {
+        conn->state = CONNPOOL_OBJECT_IDLE;
+        conn->idle_since = time(NULL);
+        DL_APPEND(pool->idle_list, conn);
+        pool->idle_num++;
+    }
+}
+
+/**
+ * the most recently used idle connection, the broken ones are closed
+ */
+static connpool_object* connpool_pop(connpool *pool TSRMLS_DC)
+{
+    connpool_object *conn;
+    while (pool->idle_list)
+    {
+        conn = pool->idle_list->prev;
+        DL_DELETE(pool->idle_list, conn);
+        pool->idle_num--;
+        if (connpool_object_is_ready(pool, conn))
+        {
+            return conn;
+        }
+        connpool_object_close(pool, conn TSRMLS_CC);
+    }
+    return NULL;
+}
+
+/**
+ * swoole_mysql connects in blocking mode and calls connpool_onConnect() at once, swoole_redis is asynchronous.
+ * see the limit in the comment of swoole_connpool::__construct()
+ */
+static int connpool_connect(connpool *pool TSRMLS_DC)
+{
+    connpool_object *conn = emalloc(sizeof(connpool_object));
+    bzero(conn, sizeof(connpool_object));
+    conn->pool = pool;
+    conn->state = CONNPOOL_OBJECT_CONNECTING;
+#if PHP_MAJOR_VERSION < 7
+    SW_ALLOC_INIT_ZVAL(conn->object);
+#else
+    conn->object = &conn->_object;
+#endif
+
+    pool->conn_num++;
+    pool->stats.connect++;
+
+#ifdef SW_USE_REDIS
+    if (pool->type == SW_CONNPOOL_REDIS)
+    {
+        //the pool is alive until the connection is established
+        sw_zval_add_ref(&pool->object);
+        pool->connecting_num++;
+        if (php_swoole_redis_connect(conn->object, pool->host, pool->port, connpool_onConnect, conn TSRMLS_CC) < 0)
+        {
+            connpool_onConnect(conn->object, 0, conn);
+            return SW_ERR;
+        }
+        return SW_OK;
+    }
+#endif
+
+    int ret = php_swoole_mysql_connect(conn->object, pool->host, pool->port, pool->user, pool->password, pool->database TSRMLS_CC);
+    connpool_onConnect(conn->object, ret == SW_OK, conn);
+    return ret;
+}
+
+static void connpool_onConnect(zval *zobject, int success, void *data)
+{
+#if PHP_MAJOR_VERSION < 7
+    TSRMLS_FETCH_FROM_CTX(sw_thread_ctx ? sw_thread_ctx : NULL);
+#endif
+    connpool_object *conn = data;
+    connpool *pool = conn->pool;
+    zval *pool_object = NULL;
+
+    if (pool->type == SW_CONNPOOL_REDIS)
+    {
+        pool->connecting_num--;
+        pool_object = pool->object;
+    }
+
+    if (!success)
+    {
+        pool->conn_num--;
+        pool->stats.connect_failed++;
+        connpool_object_free(conn TSRMLS_CC);
+        //no other connection is coming for the waiter
+        if (pool->wait_num > pool->connecting_num)
+        {
+            connpool_dispatch(pool, connpool_wakeup(pool), NULL TSRMLS_CC);
+        }
+    }
+    else
+    {
+        connpool_put(pool, conn TSRMLS_CC);
+    }
+
+    if (pool_object)
+    {
+        sw_zval_ptr_dtor(&pool_object);
+    }
+}
+
+static void connpool_onDispatch(void *data)
+{
+#if PHP_MAJOR_VERSION < 7
+    TSRMLS_FETCH_FROM_CTX(sw_thread_ctx ? sw_thread_ctx : NULL);
+#endif
+    connpool_waiter *waiter = data;
+    zval *result;
+    zval *retval = NULL;
+    zval **args[2];
+
+    if (waiter->conn)
+    {
+        result = waiter->conn->object;
+    }
+    else
+    {
+        SW_MAKE_STD_ZVAL(result);
+        ZVAL_FALSE(result);
+    }
+
+    args[0] = &waiter->pool_object;
+    args[1] = &result;
+    if (sw_call_user_function_ex(EG(function_table), NULL, waiter->callback, &retval, 2, args, 0, NULL TSRMLS_CC) != SUCCESS)
+    {
+        swoole_php_fatal_error(E_WARNING, "swoole_connpool callback handler error.");
+    }
+    if (EG(exception))
+    {
+        zend_exception_error(EG(exception), E_ERROR TSRMLS_CC);
+    }
+    if (retval)
+    {
+        sw_zval_ptr_dtor(&retval);
+    }
+    if (!waiter->conn)
+    {
+        sw_zval_ptr_dtor(&result);
+    }
+    connpool_waiter_free(waiter TSRMLS_CC);
+}
+
+static void connpool_onWaitTimeout(long timer_id, void *data)
+{
+    connpool_waiter *waiter = data;
+    connpool *pool = waiter->pool;
+
+    waiter->timer_id = 0;
+    DL_DELETE(pool->wait_list, waiter);
+    pool->wait_num--;
+    pool->stats.timeout++;
+    waiter->conn = NULL;
+    connpool_onDispatch(waiter);
+}
+
+/**
+ * close the broken and the expired idle connections, keep min connections
+ */
+static void connpool_onCheck(long timer_id, void *data)
+{
+#if PHP_MAJOR_VERSION < 7
+    TSRMLS_FETCH_FROM_CTX(sw_thread_ctx ? sw_thread_ctx : NULL);
+#endif
+    connpool *pool = data;
+    connpool_object *conn, *tmp;
+    time_t now = time(NULL);
+
+    DL_FOREACH_SAFE(pool->idle_list, conn, tmp)
+    {
+        if (!connpool_object_is_ready(pool, conn) || (pool->idle_timeout > 0 && pool->conn_num > pool->min
+                && now - conn->idle_since >= pool->idle_timeout))
+        {
+            DL_DELETE(pool->idle_list, conn);
+            pool->idle_num--;
+            connpool_object_close(pool, conn TSRMLS_CC);
+        }
+    }
+
+    while (pool->conn_num < pool->min)
+    {
+        if (connpool_connect(pool TSRMLS_CC) < 0)
+        {
+            break;
+        }
+    }
+}
+
+/**
+ * new swoole_connpool(SWOOLE_CONNPOOL_MYSQL | SWOOLE_CONNPOOL_REDIS, array $config)
+ * $config: host, port, user, password, database, min, max, wait_timeout, idle_timeout, check_interval
+ *
+ * get(callable $callback): $callback(swoole_connpool $pool, $connection) is called in the next round of the reactor,
+ * $connection is false if no connection is ready in wait_timeout seconds or the connect failed.
+ * release($connection): return the connection, a broken one is closed and not reused.
+ *
+ * Limit: the handshake of swoole_mysql is synchronous, so a new MySQL connection blocks the worker for up to
+ * SW_MYSQL_CONNECT_TIMEOUT seconds, in the constructor (min connections), in get() when the pool grows, and in the
+ * health check. wait_timeout does not bound this. Keep min close to the usual load so that get() rarely connects.
+ */
+#define connpool_config_string(vht, key)   (php_swoole_array_get_value(vht, key, ztmp) ? \
+        (convert_to_string(ztmp), estrndup(Z_STRVAL_P(ztmp), Z_STRLEN_P(ztmp))) : estrdup(""))
+
+static PHP_METHOD(swoole_connpool, __construct)
+{
+    long type;
+    zval *zset;
+    zval *ztmp;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "la", &type, &zset) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+
+    if (type != SW_CONNPOOL_MYSQL
+#ifdef SW_USE_REDIS
+            && type != SW_CONNPOOL_REDIS
+#endif
+    )
+    {
+        swoole_php_fatal_error(E_ERROR, "unknown connection pool type[%ld].", type);
+        RETURN_FALSE;
+    }
+
+    HashTable *vht = Z_ARRVAL_P(zset);
+    if (!php_swoole_array_get_value(vht, "host", ztmp))
+    {
+        swoole_php_fatal_error(E_ERROR, "host is required.");
+        RETURN_FALSE;
+    }
+
+    connpool *pool = emalloc(sizeof(connpool));
+    bzero(pool, sizeof(connpool));
+    pool->type = type;
+    pool->min = SW_CONNPOOL_MIN;
+    pool->max = SW_CONNPOOL_MAX;
+    pool->wait_timeout = SW_CONNPOOL_WAIT_TIMEOUT * 1000;
+    pool->idle_timeout = SW_CONNPOOL_IDLE_TIMEOUT;
+    pool->check_interval = SW_CONNPOOL_CHECK_INTERVAL;
+
+    convert_to_string(ztmp);
+    pool->host = estrndup(Z_STRVAL_P(ztmp), Z_STRLEN_P(ztmp));
+
+    pool->port = type == SW_CONNPOOL_MYSQL ? SW_MYSQL_DEFAULT_PORT : SW_REDIS_DEFAULT_PORT;
+    if (php_swoole_array_get_value(vht, "port", ztmp))
+    {
+        convert_to_long(ztmp);
+        pool->port = (int) Z_LVAL_P(ztmp);
+    }
+    if (type == SW_CONNPOOL_MYSQL)
+    {
+        pool->user = connpool_config_string(vht, "user");
+        pool->password = connpool_config_string(vht, "password");
+        pool->database = connpool_config_string(vht, "database");
+    }
+    /**
+     * connections kept by the health check, and the limit of the connections
+     */
+    if (php_swoole_array_get_value(vht, "min", ztmp))
+    {
+        convert_to_long(ztmp);
+        pool->min = (uint32_t) Z_LVAL_P(ztmp);
+    }
+    if (php_swoole_array_get_value(vht, "max", ztmp))
+    {
+        convert_to_long(ztmp);
+        pool->max = (uint32_t) Z_LVAL_P(ztmp);
+    }
+    if (pool->max == 0)
+    {
+        pool->max = 1;
+    }
+    if (pool->min > pool->max)
+    {
+        pool->min = pool->max;
+    }
+    /**
+     * seconds of get() waiting for a connection
+     */
+    if (php_swoole_array_get_value(vht, "wait_timeout", ztmp))
+    {
+        convert_to_double(ztmp);
+        pool->wait_timeout = (uint32_t) (Z_DVAL_P(ztmp) * 1000);
+    }
+    if (php_swoole_array_get_value(vht, "idle_timeout", ztmp))
+    {
+        convert_to_long(ztmp);
+        pool->idle_timeout = (uint32_t) Z_LVAL_P(ztmp);
+    }
+    if (php_swoole_array_get_value(vht, "check_interval", ztmp))
+    {
+        convert_to_long(ztmp);
+        pool->check_interval = (uint32_t) Z_LVAL_P(ztmp);
+    }
+
+    pool->busy_map = swHashMap_new(SW_HASHMAP_INIT_BUCKET_N, NULL);
+    pool->object = getThis();
+    sw_copy_to_stack(pool->object, pool->_object);
+    swoole_set_object(getThis(), pool);
+
+    php_swoole_check_reactor();
+
+    while (pool->conn_num < pool->min)
+    {
+        if (connpool_connect(pool TSRMLS_CC) < 0)
+        {
+            break;
+        }
+    }
+    if (pool->check_interval > 0)
+    {
+        pool->check_timer = php_swoole_add_timer_ex(pool->check_interval * 1000, 1, connpool_onCheck, pool TSRMLS_CC);
+    }
+}
+
+static void connpool_close(connpool *pool TSRMLS_DC)
+{
+    pool->closed = 1;
+    if (pool->check_timer > 0)
+    {
+        php_swoole_clear_timer(pool->check_timer TSRMLS_CC);
+        pool->check_timer = 0;
+    }
+    while (pool->idle_list)
+    {
+        connpool_object *conn = pool->idle_list;
+        DL_DELETE(pool->idle_list, conn);
+        pool->idle_num--;
+        connpool_object_close(pool, conn TSRMLS_CC);
+    }
+    while (pool->wait_list)
+    {
+        connpool_dispatch(pool, connpool_wakeup(pool), NULL TSRMLS_CC);
+    }
+}
+
+static PHP_METHOD(swoole_connpool, __destruct)
+{
+    connpool *pool = swoole_get_object(getThis());
+    if (!pool)
+    {
+        return;
+    }
+    if (!pool->closed)
+    {
+        connpool_close(pool TSRMLS_CC);
+    }
+
+    //the connections in use are owned by the callbacks now
+    connpool_object *conn;
+    uint64_t handle;
+    swHashMap_each_reset(pool->busy_map);
+    while ((conn = swHashMap_each_int(pool->busy_map, &handle)))
+    {
+        connpool_object_free(conn TSRMLS_CC);
+    }
+    swHashMap_free(pool->busy_map);
+
+    efree(pool->host);
+    swoole_efree(pool->user);
+    swoole_efree(pool->password);
+    swoole_efree(pool->database);
+    efree(pool);
+    swoole_set_object(getThis(), NULL);
+}
+
+static PHP_METHOD(swoole_connpool, get)
+{
+    zval *callback;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "z", &callback) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+
+    char *func_name = NULL;
+    if (!sw_zend_is_callable(callback, 0, &func_name TSRMLS_CC))
+    {
+        swoole_php_fatal_error(E_WARNING, "Function '%s' is not callable", func_name);
+        efree(func_name);
+        RETURN_FALSE;
+    }
+    efree(func_name);
+
+    connpool *pool = swoole_get_object(getThis());
+    if (pool->closed)
+    {
+        swoole_php_fatal_error(E_WARNING, "the connection pool is closed.");
+        RETURN_FALSE;
+    }
+    pool->stats.get++;
+
+    connpool_waiter *waiter = emalloc(sizeof(connpool_waiter));
+    bzero(waiter, sizeof(connpool_waiter));
+    waiter->pool = pool;
+    waiter->callback = callback;
+    sw_copy_to_stack(waiter->callback, waiter->_callback);
+    sw_zval_add_ref(&waiter->callback);
+    waiter->pool_object = getThis();
+    sw_copy_to_stack(waiter->pool_object, waiter->_pool_object);
+    sw_zval_add_ref(&waiter->pool_object);
+
+    connpool_object *conn = connpool_pop(pool TSRMLS_CC);
+    if (conn)
+    {
+        pool->stats.hit++;
+        connpool_dispatch(pool, waiter, conn TSRMLS_CC);
+        RETURN_TRUE;
+    }
+
+    DL_APPEND(pool->wait_list, waiter);
+    pool->wait_num++;
+    pool->stats.wait++;
+    if (pool->wait_timeout > 0)
+    {
+        waiter->timer_id = php_swoole_add_timer_ex(pool->wait_timeout, 0, connpool_onWaitTimeout, waiter TSRMLS_CC);
+    }
+    //the new connection goes to the first waiter
+    if (pool->conn_num < pool->max)
+    {
+        connpool_connect(pool TSRMLS_CC);
+    }
+    RETURN_TRUE;
+}
+
+static PHP_METHOD(swoole_connpool, release)
+{
+    zval *zobject;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "o", &zobject) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+
+    connpool *pool = swoole_get_object(getThis());
+    connpool_object *conn = swHashMap_find_int(pool->busy_map, Z_OBJ_HANDLE_P(zobject));
+    if (conn == NULL)
+    {
+        swoole_php_fatal_error(E_WARNING, "the object is not a connection in use of the pool.");
+        RETURN_FALSE;
+    }
+    swHashMap_del_int(pool->busy_map, Z_OBJ_HANDLE_P(zobject));
+    pool->busy_num--;
+
+    if (!connpool_object_is_ready(pool, conn))
+    {
+        connpool_object_close(pool, conn TSRMLS_CC);
+        //the waiter takes the slot
+        if (pool->wait_num > pool->connecting_num && !pool->closed)
+        {
+            connpool_connect(pool TSRMLS_CC);
+        }
+    }
+    else
+    {
+        connpool_put(pool, conn TSRMLS_CC);
+    }
+    RETURN_TRUE;
+}
+
+static PHP_METHOD(swoole_connpool, getStats)
+{
+    connpool *pool = swoole_get_object(getThis());
+
+    array_init(return_value);
+    sw_add_assoc_long_ex(return_value, ZEND_STRS("connection_num"), pool->conn_num);
+    sw_add_assoc_long_ex(return_value, ZEND_STRS("idle_num"), pool->idle_num);
+    sw_add_assoc_long_ex(return_value, ZEND_STRS("busy_num"), pool->busy_num);
+    sw_add_assoc_long_ex(return_value, ZEND_STRS("connecting_num"), pool->connecting_num);
+    sw_add_assoc_long_ex(return_value, ZEND_STRS("wait_num"), pool->wait_num);
+    sw_add_assoc_long_ex(return_value, ZEND_STRS("get"), pool->stats.get);
+    sw_add_assoc_long_ex(return_value, ZEND_STRS("hit"), pool->stats.hit);
+    sw_add_assoc_long_ex(return_value, ZEND_STRS("wait"), pool->stats.wait);
+    sw_add_assoc_long_ex(return_value, ZEND_STRS("timeout"), pool->stats.timeout);
+    sw_add_assoc_long_ex(return_value, ZEND_STRS("connect"), pool->stats.connect);
+    sw_add_assoc_long_ex(return_value, ZEND_STRS("connect_failed"), pool->stats.connect_failed);
+    sw_add_assoc_long_ex(return_value, ZEND_STRS("closed"), pool->stats.closed);
+}
+
+static PHP_METHOD(swoole_connpool, close)
+{
+    connpool *pool = swoole_get_object(getThis());
+    if (pool->closed)
+    {
+        swoole_php_fatal_error(E_WARNING, "the connection pool is closed.");
+        RETURN_FALSE;
+    }
+    connpool_close(pool TSRMLS_CC);
+    RETURN_TRUE;
+}
@@ -99,6 +99,11 @@ typedef struct
     swString *buffer;
     uint8_t priority;
     uint32_t stream_id;
+    /**
+     * the body which is blocked by the flow control
+     */
+    swString *send_buffer;
+    int32_t send_window;
 #endif
 
     http_request request;
@@ -145,9 +150,14 @@ typedef struct _swoole_http_client
 
 #ifdef SW_USE_HTTP2
     swHashMap *streams;
-    nghttp2_hd_inflater *deflater;
+    nghttp2_hd_deflater *deflater;
     nghttp2_hd_inflater *inflater;
-    uint32_t window_size;
+    /**
+     * connection send window and the settings of the peer
+     */
+    int32_t window_size;
+    uint32_t remote_window_size;
+    uint32_t max_frame_size;
 #endif
 
     http_context context;
@@ -181,6 +191,7 @@ int swoole_http_parse_form_data(http_context *ctx, const char *boundary_str, int
  */
 int swoole_http2_onFrame(swoole_http_client *client, swEventData *req);
 int swoole_http2_do_response(http_context *ctx, swString *body);
+void swoole_http2_free(swoole_http_client *client);
 #endif
 
 extern zend_class_entry swoole_http_server_ce;
@@ -69,7 +69,7 @@ typedef struct
 
 } http_client_property;
 
-typedef struct
+typedef struct _http_client
 {
     swClient *cli;
     char *host;
@@ -91,9 +91,68 @@ typedef struct
     uint8_t keep_alive;  //0 no 1 keep
     uint8_t upgrade;
     uint8_t gzip;
+    uint8_t ssl;
+
+    /**
+     * connection pool, setting: pool/pool_max_idle/pool_max_per_host/pool_idle_timeout/pool_wait_timeout
+     */
+    uint8_t pool;
+    uint32_t pool_max_idle;
+    uint32_t pool_max_per_host;
+    uint32_t pool_idle_timeout;
+    double pool_wait_timeout;
+    /**
+     * host:port:ssl and the ssl settings, see http_client_pool_key()
+     */
+    swString *pool_key;
+    /**
+     * the pool of the connection in use, or the pool waited for
+     */
+    struct _http_client_pool *pool_bucket;
+    zval *pool_object;
+    long pool_timer;
+    struct _http_client *prev, *next;
 
 } http_client;
 
+/**
+ * an idle connection, the most recently used one is at the tail
+ */
+typedef struct _http_client_pool_conn
+{
+    swClient *cli;
+    time_t idle_since;
+    struct _http_client_pool *pool;
+    struct _http_client_pool_conn *prev, *next;
+} http_client_pool_conn;
+
+/**
+ * connections of the same host:port:ssl and ssl settings in this worker
+ */
+typedef struct _http_client_pool
+{
+    http_client_pool_conn *idle_list;
+    http_client *wait_list;
+    uint32_t idle_num;
+    uint32_t wait_num;
+    /**
+     * idle and in use
+     */
+    uint32_t conn_num;
+    uint32_t max_idle;
+    uint32_t max_per_host;
+    uint32_t idle_timeout;
+} http_client_pool;
+
+static swHashMap *http_client_pools;
+static struct
+{
+    long hit;
+    long miss;
+    long wait;
+    long timeout;
+} http_client_pool_stats;
+
 static int http_client_parser_on_header_field(php_http_parser *parser, const char *at, size_t length);
 static int http_client_parser_on_header_value(php_http_parser *parser, const char *at, size_t length);
 static int http_client_parser_on_body(php_http_parser *parser, const char *at, size_t length);
@@ -108,6 +167,12 @@ static int http_client_error_callback(zval *zobject, swEvent *event, int error T
 static int http_client_send_http_request(zval *zobject TSRMLS_DC);
 static http_client* http_client_create(zval *object TSRMLS_DC);
 static int http_client_execute(zval *zobject, char *uri, zend_size_t uri_len, zval *callback TSRMLS_DC);
+static int http_client_connect(zval *zobject, http_client *http TSRMLS_DC);
+
+static int http_client_pool_acquire(zval *zobject, http_client *http TSRMLS_DC);
+static void http_client_pool_release(zval *zobject, http_client *http TSRMLS_DC);
+static void http_client_pool_lost(http_client *http TSRMLS_DC);
+static void http_client_pool_onWaitTimeout(long timer_id, void *data);
 
 static sw_inline void http_client_swString_append_headers(swString* swStr, char* key, zend_size_t key_len, char* data, zend_size_t data_len)
 {
@@ -161,6 +226,7 @@ static PHP_METHOD(swoole_http_client, on);
 static PHP_METHOD(swoole_http_client, get);
 static PHP_METHOD(swoole_http_client, post);
 static PHP_METHOD(swoole_http_client, upgrade);
+static PHP_METHOD(swoole_http_client, getPoolStats);
 
 static const zend_function_entry swoole_http_client_methods[] =
 {
@@ -179,9 +245,341 @@ static const zend_function_entry swoole_http_client_methods[] =
     PHP_ME(swoole_http_client, isConnected, NULL, ZEND_ACC_PUBLIC)
     PHP_ME(swoole_http_client, close, NULL, ZEND_ACC_PUBLIC)
     PHP_ME(swoole_http_client, on, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_http_client, getPoolStats, NULL, ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
     PHP_FE_END
 };
 
+static void http_client_pool_free_client(void *data)
+{
+    swClient *cli = data;
+    efree(cli->server_str);
+    swClient_free(cli);
+    efree(cli);
+}
+
+static void http_client_pool_free_object(void *data)
+{
+#if PHP_MAJOR_VERSION < 7
+    TSRMLS_FETCH_FROM_CTX(sw_thread_ctx ? sw_thread_ctx : NULL);
+#endif
+    zval *zobject = data;
+    sw_zval_ptr_dtor(&zobject);
+}
+
+static void http_client_pool_remove(http_client_pool_conn *conn)
+{
+    http_client_pool *pool = conn->pool;
+    swClient *cli = conn->cli;
+
+    DL_DELETE(pool->idle_list, conn);
+    pool->idle_num--;
+    pool->conn_num--;
+    sw_free(conn);
+    //may be called by cli->close(), free it later
+    SwooleG.main_reactor->defer(SwooleG.main_reactor, http_client_pool_free_client, cli);
+}
+
+static void http_client_pool_close(http_client_pool_conn *conn)
+{
+    swClient *cli = conn->cli;
+    cli->onClose = NULL;
+    http_client_pool_remove(conn);
+    cli->close(cli);
+}
+
+/**
+ * the idle connection is closed by the server
+ */
+static void http_client_pool_onClose(swClient *cli)
+{
+    http_client_pool_remove(cli->object);
+}
+
+static void http_client_pool_onReceive(swClient *cli, char *data, uint32_t length)
+{
+    swWarn("unexpected data on the idle connection#%d, length=%d.", cli->socket->fd, length);
+    http_client_pool_close(cli->object);
+}
+
+/**
+ * a connection is only reused by the clients which would do the same ssl handshake
+ */
+static swString* http_client_pool_key(http_client *http, HashTable *vht)
+{
+    static char *ssl_options[] = { "ssl_method", "ssl_cert_file", "ssl_key_file", "ssl_cafile", "ssl_verify_peer", "ssl_host_name" };
+    zval *ztmp;
+    int i;
+
+    swString *key = swString_new(SW_LONG_CONNECTION_KEY_LEN);
+    if (key == NULL)
+    {
+        return NULL;
+    }
+    key->length = snprintf(key->str, key->size, "%s:%ld:%d", http->host, http->port, http->ssl);
+    for (i = 0; http->ssl && vht && i < sizeof(ssl_options) / sizeof(ssl_options[0]); i++)
+    {
+        if (sw_zend_hash_find(vht, ssl_options[i], strlen(ssl_options[i]) + 1, (void **) &ztmp) == SUCCESS && !ZVAL_IS_NULL(ztmp))
+        {
+            convert_to_string(ztmp);
+            swString_append_ptr(key, ZEND_STRL(":"));
+            swString_append_ptr(key, ssl_options[i], strlen(ssl_options[i]));
+            swString_append_ptr(key, ZEND_STRL("="));
+            swString_append_ptr(key, Z_STRVAL_P(ztmp), Z_STRLEN_P(ztmp));
+        }
+    }
+    return key;
+}
+
+static http_client_pool* http_client_pool_get(http_client *http)
+{
+    http_client_pool *pool = swHashMap_find(http_client_pools, http->pool_key->str, http->pool_key->length);
+    if (pool == NULL)
+    {
+        pool = sw_malloc(sizeof(http_client_pool));
+        if (pool == NULL)
+        {
+            swWarn("malloc(%ld) failed.", sizeof(http_client_pool));
+            return NULL;
+        }
+        bzero(pool, sizeof(http_client_pool));
+        if (swHashMap_add(http_client_pools, http->pool_key->str, http->pool_key->length, pool) < 0)
+        {
+            sw_free(pool);
+            return NULL;
+        }
+    }
+    pool->max_idle = http->pool_max_idle;
+    pool->max_per_host = http->pool_max_per_host;
+    pool->idle_timeout = http->pool_idle_timeout;
+    return pool;
+}
+
+static void http_client_pool_attach(zval *zobject, http_client *http, swClient *cli TSRMLS_DC)
+{
+    http_client_property *hcc = swoole_get_property(zobject, 0);
+
+    cli->object = zobject;
+    sw_copy_to_stack(cli->object, hcc->_object);
+    sw_zval_add_ref(&zobject);
+
+    cli->onReceive = http_client_onReceive;
+    cli->onConnect = http_client_onConnect;
+    cli->onClose = http_client_onClose;
+    cli->onError = http_client_onError;
+
+    http->cli = cli;
+    zend_update_property_long(swoole_http_client_class_entry_ptr, zobject, ZEND_STRL("sock"), cli->socket->fd TSRMLS_CC);
+}
+
+/**
+ * @return SW_OK: got an idle connection, SW_WAIT: max_per_host is reached, SW_ERR: create a new connection
+ */
+static int http_client_pool_acquire(zval *zobject, http_client *http TSRMLS_DC)
+{
+    http_client_pool *pool = http_client_pool_get(http);
+    http_client_pool_conn *conn;
+    swClient *cli;
+    time_t now = time(NULL);
+    char tmp;
+    int ret;
+
+    if (pool == NULL)
+    {
+        return SW_ERR;
+    }
+
+    //the oldest connections are at the head
+    while (pool->idle_list && now - pool->idle_list->idle_since >= pool->idle_timeout)
+    {
+        http_client_pool_close(pool->idle_list);
+    }
+
+    while (pool->idle_list)
+    {
+        conn = pool->idle_list->prev;
+        cli = conn->cli;
+        //closed by the server, or there is unexpected data
+        ret = recv(cli->socket->fd, &tmp, sizeof(tmp), MSG_DONTWAIT | MSG_PEEK);
+        if (ret >= 0 || swConnection_error(errno) == SW_CLOSE)
+        {
+            http_client_pool_close(conn);
+            continue;
+        }
+        DL_DELETE(pool->idle_list, conn);
+        pool->idle_num--;
+        sw_free(conn);
+
+        http->pool_bucket = pool;
+        http_client_pool_attach(zobject, http, cli TSRMLS_CC);
+        http_client_pool_stats.hit++;
+        return SW_OK;
+    }
+
+    if (pool->max_per_host > 0 && pool->conn_num >= pool->max_per_host)
+    {
+        http_client_property *hcc = swoole_get_property(zobject, 0);
+        http->pool_object = zobject;
+        sw_copy_to_stack(http->pool_object, hcc->_object);
+        sw_zval_add_ref(&zobject);
+
+        http->pool_bucket = pool;
+        http->state = HTTP_CLIENT_STATE_WAIT;
+        DL_APPEND(pool->wait_list, http);
+        pool->wait_num++;
+        http_client_pool_stats.wait++;
+        if (http->pool_wait_timeout > 0)
+        {
+            http->pool_timer = php_swoole_add_timer_ex((int) (http->pool_wait_timeout * 1000), 0, http_client_pool_onWaitTimeout, http TSRMLS_CC);
+        }
+        return SW_WAIT;
+    }
+
+    http->pool_bucket = pool;
+    http_client_pool_stats.miss++;
+    return SW_ERR;
+}
+
+static http_client* http_client_pool_wakeup(http_client_pool *pool TSRMLS_DC)
+{
+    http_client *waiter = pool->wait_list;
+    DL_DELETE(pool->wait_list, waiter);
+    pool->wait_num--;
+    waiter->state = HTTP_CLIENT_STATE_READY;
+    if (waiter->pool_timer > 0)
+    {
+        php_swoole_clear_timer(waiter->pool_timer TSRMLS_CC);
+        waiter->pool_timer = 0;
+    }
+    return waiter;
+}
+
+/**
+ * no connection of the pool is released in time, the request fails with ETIMEDOUT
+ */
+static void http_client_pool_onWaitTimeout(long timer_id, void *data)
+{
+#if PHP_MAJOR_VERSION < 7
+    TSRMLS_FETCH_FROM_CTX(sw_thread_ctx ? sw_thread_ctx : NULL);
+#endif
+
+    http_client *http = data;
+    http_client_pool *pool = http->pool_bucket;
+    zval *zobject = http->pool_object;
+    zval *retval = NULL;
+    zval **args[1];
+
+    http->pool_timer = 0;
+    DL_DELETE(pool->wait_list, http);
+    pool->wait_num--;
+    http_client_pool_stats.timeout++;
+    http->pool_bucket = NULL;
+    http->state = HTTP_CLIENT_STATE_READY;
+
+    swoole_php_fatal_error(E_WARNING, "no connection of the pool [%s:%ld] is released in %.3f seconds.", http->host, http->port, http->pool_wait_timeout);
+    zend_update_property_long(swoole_http_client_class_entry_ptr, zobject, ZEND_STRL("errCode"), ETIMEDOUT TSRMLS_CC);
+
+    http_client_property *hcc = swoole_get_property(zobject, 0);
+    if (hcc && hcc->onError && !ZVAL_IS_NULL(hcc->onError))
+    {
+        args[0] = &zobject;
+        if (sw_call_user_function_ex(EG(function_table), NULL, hcc->onError, &retval, 1, args, 0, NULL TSRMLS_CC) == FAILURE)
+        {
+            swoole_php_fatal_error(E_WARNING, "onError handler error");
+        }
+        if (EG(exception))
+        {
+            zend_exception_error(EG(exception), E_ERROR TSRMLS_CC);
+        }
+        if (retval)
+        {
+            sw_zval_ptr_dtor(&retval);
+        }
+    }
+    //the reference of the waiter
+    sw_zval_ptr_dtor(&zobject);
+}
+
+/**
+ * the response is finished, the connection goes back to the pool or to the first waiter
+ */
+static void http_client_pool_release(zval *zobject, http_client *http TSRMLS_DC)
+{
+    http_client_pool *pool = http->pool_bucket;
+    swClient *cli = http->cli;
+
+    //Connection: close
+    if (!php_http_should_keep_alive(&http->parser))
+    {
+        cli->close(cli);
+        return;
+    }
+
+    http->cli = NULL;
+    http->pool_bucket = NULL;
+
+    if (pool->wait_list)
+    {
+        http_client *waiter = http_client_pool_wakeup(pool TSRMLS_CC);
+        waiter->pool_bucket = pool;
+        http_client_pool_attach(waiter->pool_object, waiter, cli TSRMLS_CC);
+        http_client_pool_stats.hit++;
+        http_client_send_http_request(waiter->pool_object TSRMLS_CC);
+        SwooleG.main_reactor->defer(SwooleG.main_reactor, http_client_pool_free_object, waiter->pool_object);
+    }
+    else
+    {
+        http_client_pool_conn *conn = sw_malloc(sizeof(http_client_pool_conn));
+        if (conn == NULL)
+        {
+            cli->onClose = NULL;
+            cli->close(cli);
+            pool->conn_num--;
+            SwooleG.main_reactor->defer(SwooleG.main_reactor, http_client_pool_free_client, cli);
+        }
+        else
+        {
+            conn->cli = cli;
+            conn->pool = pool;
+            conn->idle_since = time(NULL);
+            cli->object = conn;
+            cli->onReceive = http_client_pool_onReceive;
+            cli->onClose = http_client_pool_onClose;
+            cli->onError = http_client_pool_onClose;
+            DL_APPEND(pool->idle_list, conn);
+            pool->idle_num++;
+            if (pool->idle_num > pool->max_idle)
+            {
+                http_client_pool_close(pool->idle_list);
+            }
+        }
+    }
+    //the reference of the connection, the parser of the object is still running
+    SwooleG.main_reactor->defer(SwooleG.main_reactor, http_client_pool_free_object, zobject);
+}
+
+/**
+ * the connection in use is closed or failed to connect, a waiter takes the slot
+ */
+static void http_client_pool_lost(http_client *http TSRMLS_DC)
+{
+    http_client_pool *pool = http->pool_bucket;
+    http->pool_bucket = NULL;
+    pool->conn_num--;
+
+    if (pool->wait_list)
+    {
+        http_client *waiter = http_client_pool_wakeup(pool TSRMLS_CC);
+        zval *zobject = waiter->pool_object;
+        waiter->pool_bucket = pool;
+        http_client_pool_stats.miss++;
+        if (http_client_connect(zobject, waiter TSRMLS_CC) < 0)
+        {
+            swoole_php_fatal_error(E_WARNING, "connect to server [%s:%ld] failed.", waiter->host, waiter->port);
+        }
+        SwooleG.main_reactor->defer(SwooleG.main_reactor, http_client_pool_free_object, zobject);
+    }
+}
+
 static int http_client_execute(zval *zobject, char *uri, zend_size_t uri_len, zval *callback TSRMLS_DC)
 {
     if (uri_len <= 0)
@@ -195,6 +593,18 @@ static int http_client_execute(zval *zobject, char *uri, zend_size_t uri_len, zv
     //http is not null when keeping alive
     if (http)
     {
+        if (http->state == HTTP_CLIENT_STATE_WAIT)
+        {
+            swoole_php_fatal_error(E_WARNING, "waiting for a connection of the pool.");
+            return SW_ERR;
+        }
+        //the pooled connection is closed, get another one
+        else if (http->pool && http->cli && http->cli->socket->closed)
+        {
+            SwooleG.main_reactor->defer(SwooleG.main_reactor, http_client_pool_free_client, http->cli);
+            http->cli = NULL;
+            http->state = HTTP_CLIENT_STATE_READY;
+        }
         //http not ready
         if (http->state != HTTP_CLIENT_STATE_READY)
         {
@@ -208,7 +618,7 @@ static int http_client_execute(zval *zobject, char *uri, zend_size_t uri_len, zv
 
             return SW_ERR;
         }
-        else if (!http->cli->socket->active)
+        else if (http->cli && !http->cli->socket->active)
         {
             swoole_php_fatal_error(E_WARNING, "connection#%d is closed.", http->cli->socket->fd);
             return SW_ERR;
@@ -263,9 +673,31 @@ static int http_client_execute(zval *zobject, char *uri, zend_size_t uri_len, zv
         return SW_OK;
     }
 
+    if (http->pool)
+    {
+        switch (http_client_pool_acquire(zobject, http TSRMLS_CC))
+        {
+        case SW_OK:
+            http_client_send_http_request(zobject TSRMLS_CC);
+            return SW_OK;
+        case SW_WAIT:
+            return SW_OK;
+        default:
+            break;
+        }
+    }
+
+    return http_client_connect(zobject, http TSRMLS_CC);
+}
+
+static int http_client_connect(zval *zobject, http_client *http TSRMLS_DC)
+{
+    http_client_property *hcc = swoole_get_property(zobject, 0);
+
     swClient *cli = php_swoole_client_new(zobject, http->host, http->host_len, http->port);
     if (cli == NULL)
     {
+        http->pool_bucket = NULL;
         return SW_ERR;
     }
     http->cli = cli;
@@ -286,7 +718,16 @@ static int http_client_execute(zval *zobject, char *uri, zend_size_t uri_len, zv
     cli->onClose = http_client_onClose;
     cli->onError = http_client_onError;
 
-    return cli->connect(cli, http->host, http->port, http->timeout, 0);
+    if (http->pool_bucket)
+    {
+        http->pool_bucket->conn_num++;
+    }
+    int ret = cli->connect(cli, http->host, http->port, http->timeout, 0);
+    if (ret < 0 && http->pool_bucket)
+    {
+        http_client_pool_lost(http TSRMLS_CC);
+    }
+    return ret;
 }
 
 void swoole_http_client_init(int module_number TSRMLS_DC)
@@ -297,6 +738,8 @@ void swoole_http_client_init(int module_number TSRMLS_DC)
     zend_declare_property_long(swoole_http_client_class_entry_ptr, SW_STRL("errCode")-1, 0, ZEND_ACC_PUBLIC TSRMLS_CC);
     zend_declare_property_long(swoole_http_client_class_entry_ptr, SW_STRL("sock")-1, 0, ZEND_ACC_PUBLIC TSRMLS_CC);
 
+    http_client_pools = swHashMap_new(SW_HASHMAP_INIT_BUCKET_N, NULL);
+
     http_client_buffer = swString_new(SW_HTTP_RESPONSE_INIT_SIZE);
     if (!http_client_buffer)
     {
@@ -331,6 +774,10 @@ static void http_client_onClose(swClient *cli)
     {
         return;
     }
+    if (http->pool_bucket)
+    {
+        http_client_pool_lost(http TSRMLS_CC);
+    }
 
     http_client_property *hcc = swoole_get_property(zobject, 0);
     if (!hcc)
@@ -386,6 +833,10 @@ static void http_client_onError(swClient *cli)
         swoole_php_fatal_error(E_WARNING, "object is not instanceof swoole_http_client.");
         return;
     }
+    if (http->pool_bucket)
+    {
+        http_client_pool_lost(http TSRMLS_CC);
+    }
 
     http_client_property *hcc = swoole_get_property(zobject, 0);
     if (!hcc)
@@ -826,8 +1277,16 @@ static http_client* http_client_create(zval *object TSRMLS_DC)
     convert_to_long(ztmp);
     http->port = Z_LVAL_P(ztmp);
 
+    ztmp = sw_zend_read_property(swoole_client_class_entry_ptr, object, ZEND_STRL("type"), 0 TSRMLS_CC);
+    http->ssl = (Z_LVAL_P(ztmp) & SW_SOCK_SSL) ? 1 : 0;
+
     http->timeout = SW_CLIENT_DEFAULT_TIMEOUT;
     http->keep_alive = 0;
+    http->pool_max_idle = SW_HTTP_CLIENT_POOL_MAX_IDLE;
+    http->pool_max_per_host = SW_HTTP_CLIENT_POOL_MAX_PER_HOST;
+    http->pool_idle_timeout = SW_HTTP_CLIENT_POOL_IDLE_TIMEOUT;
+    http->pool_wait_timeout = SW_HTTP_CLIENT_POOL_WAIT_TIMEOUT;
+    vht = NULL;
 
     zval *zset = sw_zend_read_property(swoole_http_client_class_entry_ptr, object, ZEND_STRL("setting"), 1 TSRMLS_CC);
     if (zset && !ZVAL_IS_NULL(zset))
@@ -849,6 +1308,44 @@ static http_client* http_client_create(zval *object TSRMLS_DC)
             convert_to_boolean(ztmp);
             http->keep_alive = (int) Z_LVAL_P(ztmp);
         }
+        /**
+         * connection pool of this worker, shared by the clients of the same host:port:ssl
+         */
+        if (php_swoole_array_get_value(vht, "pool", ztmp))
+        {
+            convert_to_boolean(ztmp);
+            http->pool = Z_BVAL_P(ztmp);
+        }
+        if (php_swoole_array_get_value(vht, "pool_max_idle", ztmp))
+        {
+            convert_to_long(ztmp);
+            http->pool_max_idle = (uint32_t) Z_LVAL_P(ztmp);
+        }
+        if (php_swoole_array_get_value(vht, "pool_max_per_host", ztmp))
+        {
+            convert_to_long(ztmp);
+            http->pool_max_per_host = (uint32_t) Z_LVAL_P(ztmp);
+        }
+        if (php_swoole_array_get_value(vht, "pool_idle_timeout", ztmp))
+        {
+            convert_to_long(ztmp);
+            http->pool_idle_timeout = (uint32_t) Z_LVAL_P(ztmp);
+        }
+        if (php_swoole_array_get_value(vht, "pool_wait_timeout", ztmp))
+        {
+            convert_to_double(ztmp);
+            http->pool_wait_timeout = Z_DVAL_P(ztmp);
+        }
+    }
+    //the pooled connections are kept alive
+    if (http->pool)
+    {
+        http->keep_alive = 1;
+        http->pool_key = http_client_pool_key(http, vht);
+        if (http->pool_key == NULL)
+        {
+            http->pool = 0;
+        }
     }
 
     http->state = HTTP_CLIENT_STATE_READY;
@@ -938,6 +1435,10 @@ static PHP_METHOD(swoole_http_client, __destruct)
         {
             swString_free(http->buffer);
         }
+        if (http->pool_key)
+        {
+            swString_free(http->pool_key);
+        }
         efree(http);
     }
 
@@ -1299,6 +1800,11 @@ static int http_client_parser_on_message_complete(php_http_parser *parser)
     {
         http->cli->close(http->cli);
     }
+    //not reused by the callback
+    else if (http->pool_bucket && http->state == HTTP_CLIENT_STATE_READY)
+    {
+        http_client_pool_release(zobject, http TSRMLS_CC);
+    }
     return 0;
 }
 
@@ -1444,8 +1950,38 @@ static PHP_METHOD(swoole_http_client, push)
     }
 
     swString_clear(http_client_buffer);
-    swWebSocket_encode(http_client_buffer, data, length, opcode, (int) fin, 0);
+    //client frames must be masked, RFC6455 5.3
+    swWebSocket_encode(http_client_buffer, data, length, opcode, (int) fin, 1);
     SW_CHECK_RETURN(http->cli->send(http->cli, http_client_buffer->str, http_client_buffer->length, 0));
 }
 
+static PHP_METHOD(swoole_http_client, getPoolStats)
+{
+    http_client_pool *pool;
+    char *key;
+    long idle_num = 0, wait_num = 0, conn_num = 0;
+
+    swHashMap_each_reset(http_client_pools);
+    while (1)
+    {
+        pool = swHashMap_each(http_client_pools, &key);
+        if (pool == NULL)
+        {
+            break;
+        }
+        idle_num += pool->idle_num;
+        wait_num += pool->wait_num;
+        conn_num += pool->conn_num;
+    }
+
+    array_init(return_value);
+    sw_add_assoc_long_ex(return_value, ZEND_STRS("hit"), http_client_pool_stats.hit);
+    sw_add_assoc_long_ex(return_value, ZEND_STRS("miss"), http_client_pool_stats.miss);
+    sw_add_assoc_long_ex(return_value, ZEND_STRS("wait"), http_client_pool_stats.wait);
+    sw_add_assoc_long_ex(return_value, ZEND_STRS("timeout"), http_client_pool_stats.timeout);
+    sw_add_assoc_long_ex(return_value, ZEND_STRS("connection_num"), conn_num);
+    sw_add_assoc_long_ex(return_value, ZEND_STRS("idle_num"), idle_num);
+    sw_add_assoc_long_ex(return_value, ZEND_STRS("wait_num"), wait_num);
+}
+
 #endif
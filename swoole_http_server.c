@@ -96,6 +96,7 @@ static int http_request_on_header_field(php_http_parser *parser, const char *at,
 static int http_request_on_header_value(php_http_parser *parser, const char *at, size_t length);
 static int http_request_on_headers_complete(php_http_parser *parser);
 static int http_request_message_complete(php_http_parser *parser);
+static int http_request_build(http_context *ctx, swHttpIndex *index, char *data);
 
 static int multipart_body_on_header_field(multipart_parser* p, const char *at, size_t length);
 static int multipart_body_on_header_value(multipart_parser* p, const char *at, size_t length);
@@ -999,6 +1000,44 @@ static int http_request_message_complete(php_http_parser *parser)
     return 0;
 }
 
+/**
+ * build the request with the header index of the reactor, the header is not parsed again
+ */
+static int http_request_build(http_context *ctx, swHttpIndex *index, char *data)
+{
+    php_http_parser *parser = &ctx->parser;
+    swHttpIndex_header *header;
+    int i;
+
+    //enum php_http_method starts from 0
+    parser->method = index->method - 1;
+    parser->http_major = 1;
+    parser->http_minor = index->version == HTTP_VERSION_11 ? 1 : 0;
+
+    http_request_on_path(parser, data + index->path_offset, index->path_length);
+    if (index->query_length > 0)
+    {
+        http_request_on_query_string(parser, data + index->query_offset, index->query_length);
+    }
+    for (i = 0; i < index->header_num; i++)
+    {
+        header = &index->headers[i];
+        http_request_on_header_field(parser, data + header->name_offset, header->name_length);
+        if (http_request_on_header_value(parser, data + header->value_offset, header->value_length) < 0)
+        {
+            return SW_ERR;
+        }
+    }
+    http_request_on_headers_complete(parser);
+    if (index->content_length > 0)
+    {
+        http_request_on_body(parser, data + index->header_length, index->content_length);
+    }
+    http_request_message_complete(parser);
+    ctx->keepalive = index->keepalive;
+    return SW_OK;
+}
+
 static void http_onClose(swServer *serv, swDataHead *info)
 {
     swConnection *conn = swWorker_get_connection(SwooleG.serv, info->fd);
@@ -1024,6 +1063,12 @@ static void http_onClose(swServer *serv, swDataHead *info)
 #endif
             swoole_http_context_free(ctx TSRMLS_CC);
         }
+#ifdef SW_USE_HTTP2
+        if (client->http2)
+        {
+            swoole_http2_free(client);
+        }
+#endif
     }
 
     if (php_sw_server_callbacks[SW_SERVER_CB_onClose] != NULL)
@@ -1087,7 +1132,38 @@ static int http_onReceive(swServer *serv, swEventData *req)
 
     swTrace("httpRequest %d bytes:\n---------------------------------------\n%s\n", Z_STRLEN_P(zdata), Z_STRVAL_P(zdata));
 
-    long n = php_http_parser_execute(parser, &http_parser_settings, Z_STRVAL_P(zdata), Z_STRLEN_P(zdata));
+    long n;
+    swHttpIndex *index = NULL;
+    swHttpIndex_buffer index_buffer;
+    uint32_t request_length = Z_STRLEN_P(zdata);
+    int indexed = 0;
+
+    if (serv->http_header_index)
+    {
+        index = swHttpIndex_get(Z_STRVAL_P(zdata), Z_STRLEN_P(zdata), &index_buffer, &request_length);
+        if (index == NULL)
+        {
+            swWarn("invalid http header index.");
+            request_length = Z_STRLEN_P(zdata);
+        }
+    }
+    if (index && index->method)
+    {
+        indexed = 1;
+        n = http_request_build(ctx, index, Z_STRVAL_P(zdata));
+    }
+    //not indexed by the reactor
+    else
+    {
+        n = php_http_parser_execute(parser, &http_parser_settings, Z_STRVAL_P(zdata), request_length);
+    }
+    //remove the index, $request->rawcontent() reads the raw request
+    if (request_length < Z_STRLEN_P(zdata))
+    {
+        Z_STRLEN_P(zdata) = request_length;
+        Z_STRVAL_P(zdata)[request_length] = 0;
+    }
+
     if (n < 0)
     {
         sw_zval_ptr_dtor(&zdata);
@@ -1111,7 +1187,10 @@ static int http_onReceive(swServer *serv, swEventData *req)
             http_global_init(TSRMLS_C);
         }
 
-        ctx->keepalive = php_http_should_keep_alive(parser);
+        if (!indexed)
+        {
+            ctx->keepalive = php_http_should_keep_alive(parser);
+        }
         char *method_name = http_get_method_name(parser->method);
 
         sw_add_assoc_string(zserver, "request_method", method_name, 1);
@@ -1436,6 +1515,7 @@ void swoole_http_context_free(http_context *ctx TSRMLS_DC)
     if (ctx->buffer)
     {
         swString_free(ctx->buffer);
+        ctx->buffer = NULL;
     }
 #endif
     ctx->end = 1;
@@ -1643,6 +1723,7 @@ static PHP_METHOD(swoole_http_server, start)
 
     serv->onReceive = http_onReceive;
     serv->onClose = http_onClose;
+    serv->http_header_index = 1;
 
     zval *zsetting = sw_zend_read_property(swoole_server_class_entry_ptr, getThis(), ZEND_STRL("setting"), 1 TSRMLS_CC);
     if (zsetting == NULL || ZVAL_IS_NULL(zsetting))
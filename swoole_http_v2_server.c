@@ -30,6 +30,197 @@ static sw_inline void http2_add_header(nghttp2_nv *headers, char *k, int kl, cha
     headers->valuelen = vl;
 }
 
+static int http2_client_init(swoole_http_client *client)
+{
+    int ret = nghttp2_hd_deflate_new(&client->deflater, SW_HTTP2_DEFAULT_HEADER_TABLE_SIZE);
+    if (ret != 0)
+    {
+        swWarn("nghttp2_hd_deflate_new() failed, Error: %s[%d].", nghttp2_strerror(ret), ret);
+        return SW_ERR;
+    }
+    client->window_size = SW_HTTP2_DEFAULT_WINDOW_SIZE;
+    client->remote_window_size = SW_HTTP2_DEFAULT_WINDOW_SIZE;
+    client->max_frame_size = SW_HTTP2_DEFAULT_MAX_FRAME_SIZE;
+    return SW_OK;
+}
+
+void swoole_http2_free(swoole_http_client *client)
+{
+#if PHP_MAJOR_VERSION < 7
+    TSRMLS_FETCH_FROM_CTX(sw_thread_ctx ? sw_thread_ctx : NULL);
+#endif
+
+    if (client->streams)
+    {
+        http_context *ctx;
+        uint64_t stream_id;
+
+        swHashMap_each_reset(client->streams);
+        while ((ctx = swHashMap_each_int(client->streams, &stream_id)))
+        {
+            if (!ctx->end)
+            {
+                swoole_http_context_free(ctx TSRMLS_CC);
+            }
+            if (ctx->send_buffer)
+            {
+                swString_free(ctx->send_buffer);
+            }
+            efree(ctx);
+        }
+        swHashMap_free(client->streams);
+        client->streams = NULL;
+    }
+    if (client->inflater)
+    {
+        nghttp2_hd_inflate_del(client->inflater);
+        client->inflater = NULL;
+    }
+    if (client->deflater)
+    {
+        nghttp2_hd_deflate_del(client->deflater);
+        client->deflater = NULL;
+    }
+    client->http2 = 0;
+}
+
+/**
+ * append the DATA frames allowed by the windows and SETTINGS_MAX_FRAME_SIZE to swoole_http_buffer
+ */
+static size_t http2_append_data(swoole_http_client *client, http_context *ctx, char *data, size_t length)
+{
+    char frame_header[SW_HTTP2_FRAME_HEADER_SIZE];
+    size_t sent = 0;
+    int32_t n;
+
+    while (sent < length)
+    {
+        n = length - sent > client->max_frame_size ? client->max_frame_size : length - sent;
+        if (n > ctx->send_window)
+        {
+            n = ctx->send_window;
+        }
+        if (n > client->window_size)
+        {
+            n = client->window_size;
+        }
+        if (n <= 0)
+        {
+            break;
+        }
+        swHttp2_set_frame_header(frame_header, SW_HTTP2_TYPE_DATA, n, sent + n == length ? SW_HTTP2_FLAG_END_STREAM : 0, ctx->stream_id);
+        swString_append_ptr(swoole_http_buffer, frame_header, SW_HTTP2_FRAME_HEADER_SIZE);
+        swString_append_ptr(swoole_http_buffer, data + sent, n);
+        sent += n;
+        ctx->send_window -= n;
+        client->window_size -= n;
+    }
+    return sent;
+}
+
+/**
+ * send the blocked bodies after WINDOW_UPDATE or SETTINGS
+ */
+static void http2_flush(swoole_http_client *client)
+{
+    http_context *ctx;
+    uint64_t stream_id;
+    size_t n;
+
+    if (!client->streams)
+    {
+        return;
+    }
+
+    swHashMap_each_reset(client->streams);
+    while (client->window_size > 0 && (ctx = swHashMap_each_int(client->streams, &stream_id)))
+    {
+        if (!ctx->send_buffer || ctx->send_window <= 0)
+        {
+            continue;
+        }
+        swString_clear(swoole_http_buffer);
+        n = http2_append_data(client, ctx, ctx->send_buffer->str + ctx->send_buffer->offset, ctx->send_buffer->length - ctx->send_buffer->offset);
+        if (swServer_tcp_send(SwooleG.serv, client->fd, swoole_http_buffer->str, swoole_http_buffer->length) < 0)
+        {
+            return;
+        }
+        ctx->send_buffer->offset += n;
+        if (ctx->send_buffer->offset == ctx->send_buffer->length)
+        {
+            swString_free(ctx->send_buffer);
+            swHashMap_del_int(client->streams, stream_id);
+            efree(ctx);
+            //the iterator is invalid after deleting
+            swHashMap_each_reset(client->streams);
+        }
+    }
+}
+
+static void http2_send_window_update(int fd, int stream_id, uint32_t increment)
+{
+    char frame[SW_HTTP2_FRAME_HEADER_SIZE + SW_HTTP2_WINDOW_UPDATE_SIZE];
+    swHttp2_set_frame_header(frame, SW_HTTP2_TYPE_WINDOW_UPDATE, SW_HTTP2_WINDOW_UPDATE_SIZE, 0, stream_id);
+    *(uint32_t *) (frame + SW_HTTP2_FRAME_HEADER_SIZE) = htonl(increment);
+    swServer_tcp_send(SwooleG.serv, fd, frame, sizeof(frame));
+}
+
+static void http2_send_goaway(int fd, int last_stream_id, uint32_t error_code)
+{
+    char frame[SW_HTTP2_FRAME_HEADER_SIZE + SW_HTTP2_GOAWAY_SIZE];
+    swHttp2_set_frame_header(frame, SW_HTTP2_TYPE_GOAWAY, SW_HTTP2_GOAWAY_SIZE, 0, 0);
+    *(uint32_t *) (frame + SW_HTTP2_FRAME_HEADER_SIZE) = htonl(last_stream_id);
+    *(uint32_t *) (frame + SW_HTTP2_FRAME_HEADER_SIZE + 4) = htonl(error_code);
+    swServer_tcp_send(SwooleG.serv, fd, frame, sizeof(frame));
+}
+
+static void http2_parse_settings(swoole_http_client *client, char *buf, uint32_t length)
+{
+    uint16_t id;
+    uint32_t value;
+    http_context *ctx;
+    uint64_t stream_id;
+
+    for (; length >= SW_HTTP2_SETTING_OPTION_SIZE; length -= SW_HTTP2_SETTING_OPTION_SIZE, buf += SW_HTTP2_SETTING_OPTION_SIZE)
+    {
+        id = ntohs(*(uint16_t *) buf);
+        value = ntohl(*(uint32_t *) (buf + 2));
+        swTraceLog(SW_TRACE_HTTP2, "setting: id=%d, value=%d", id, value);
+
+        switch (id)
+        {
+        case SW_HTTP2_SETTING_HEADER_TABLE_SIZE:
+            //the deflater never uses more than SW_HTTP2_DEFAULT_HEADER_TABLE_SIZE
+            nghttp2_hd_deflate_change_table_size(client->deflater, value);
+            break;
+        case SW_HTTP2_SETTINGS_INIT_WINDOW_SIZE:
+            if (value > SW_HTTP2_MAX_WINDOW)
+            {
+                break;
+            }
+            //applies to all the open streams
+            if (client->streams)
+            {
+                swHashMap_each_reset(client->streams);
+                while ((ctx = swHashMap_each_int(client->streams, &stream_id)))
+                {
+                    ctx->send_window += (int32_t) (value - client->remote_window_size);
+                }
+            }
+            client->remote_window_size = value;
+            break;
+        case SW_HTTP2_SETTINGS_MAX_FRAME_SIZE:
+            if (value >= SW_HTTP2_DEFAULT_MAX_FRAME_SIZE && value <= SW_HTTP2_MAX_FRAME_SIZE)
+            {
+                client->max_frame_size = value;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
 static void http2_onRequest(http_context *ctx TSRMLS_DC)
 {
     zval *retval;
@@ -216,13 +407,8 @@ static int http2_build_header(http_context *ctx, uchar *buffer, int body_length
     size_t i;
     size_t sum = 0;
 
-    nghttp2_hd_deflater *deflater;
-    ret = nghttp2_hd_deflate_new(&deflater, 4096);
-    if (ret != 0)
-    {
-        swoole_php_error(E_WARNING, "nghttp2_hd_deflate_init failed with error: %s\n", nghttp2_strerror(ret));
-        return SW_ERR;
-    }
+    //the dynamic table lives as long as the connection
+    nghttp2_hd_deflater *deflater = ctx->client->deflater;
 
     for (i = 0; i < index; ++i)
     {
@@ -230,20 +416,25 @@ static int http2_build_header(http_context *ctx, uchar *buffer, int body_length
     }
 
     buflen = nghttp2_hd_deflate_bound(deflater, nv, index);
-    rv = nghttp2_hd_deflate_hd(deflater, (uchar *) buffer, buflen, nv, index);
-    if (rv < 0)
+    if (buflen > SW_HTTP_HEADER_MAX_SIZE)
     {
-        swoole_php_error(E_WARNING, "nghttp2_hd_deflate_hd() failed with error: %s\n", nghttp2_strerror((int ) rv));
-        return SW_ERR;
+        buflen = SW_HTTP_HEADER_MAX_SIZE;
     }
+    rv = nghttp2_hd_deflate_hd(deflater, (uchar *) buffer, buflen, nv, index);
 
     if (date_str)
     {
         efree(date_str);
     }
 
-    nghttp2_hd_deflate_del(deflater);
-
+    if (rv < 0)
+    {
+        swoole_php_error(E_WARNING, "nghttp2_hd_deflate_hd() failed with error: %s\n", nghttp2_strerror((int ) rv));
+        //the dynamic table is out of sync with the peer's decoder, the connection can not be used any more
+        http2_send_goaway(ctx->fd, ctx->stream_id, SW_HTTP2_ERROR_COMPRESSION_ERROR);
+        SwooleG.serv->factory.end(&SwooleG.serv->factory, ctx->fd);
+        return SW_ERR;
+    }
     return rv;
 }
 
@@ -253,9 +444,15 @@ int swoole_http2_do_response(http_context *ctx, swString *body)
     TSRMLS_FETCH_FROM_CTX(sw_thread_ctx ? sw_thread_ctx : NULL);
 #endif
 
-    char header_buffer[8192];
+    swoole_http_client *client = ctx->client;
+    char header_buffer[SW_HTTP_HEADER_MAX_SIZE];
 
     int n = http2_build_header(ctx, (uchar *) header_buffer, body->length TSRMLS_CC);
+    if (n < 0)
+    {
+        ctx->send_header = 0;
+        return SW_ERR;
+    }
     swString_clear(swoole_http_buffer);
 
     /**
@@ -271,14 +468,22 @@ int swoole_http2_do_response(http_context *ctx, swString *body)
      |                           Padding (*)                       ...
      +---------------------------------------------------------------+
      */
-    char frame_header[9];
-    swHttp2_set_frame_header(frame_header, SW_HTTP2_TYPE_HEADERS, n, SW_HTTP2_FLAG_END_HEADERS, ctx->stream_id);
-    swString_append_ptr(swoole_http_buffer, frame_header, 9);
+    char frame_header[SW_HTTP2_FRAME_HEADER_SIZE];
+    int flags = SW_HTTP2_FLAG_END_HEADERS;
+    size_t sent = 0;
+
+    if (body->length == 0)
+    {
+        flags |= SW_HTTP2_FLAG_END_STREAM;
+    }
+    swHttp2_set_frame_header(frame_header, SW_HTTP2_TYPE_HEADERS, n, flags, ctx->stream_id);
+    swString_append_ptr(swoole_http_buffer, frame_header, SW_HTTP2_FRAME_HEADER_SIZE);
     swString_append_ptr(swoole_http_buffer, header_buffer, n);
 
-    swHttp2_set_frame_header(frame_header, SW_HTTP2_TYPE_DATA, body->length, SW_HTTP2_FLAG_END_STREAM, ctx->stream_id);
-    swString_append_ptr(swoole_http_buffer, frame_header, 9);
-    swString_append(swoole_http_buffer, body);
+    if (body->length > 0)
+    {
+        sent = http2_append_data(client, ctx, body->str, body->length);
+    }
 
     int ret = swServer_tcp_send(SwooleG.serv, ctx->fd, swoole_http_buffer->str, swoole_http_buffer->length);
     if (ret < 0)
@@ -288,9 +493,24 @@ int swoole_http2_do_response(http_context *ctx, swString *body)
     }
     swoole_http_context_free(ctx TSRMLS_CC);
 
-    if (ctx->client->streams)
+    //the rest is sent after WINDOW_UPDATE
+    if (sent < body->length)
+    {
+        ctx->send_buffer = swString_dup(body->str + sent, body->length - sent);
+        if (!client->streams)
+        {
+            client->streams = swHashMap_new(SW_HTTP2_MAX_CONCURRENT_STREAMS, NULL);
+        }
+        if (!swHashMap_find_int(client->streams, ctx->stream_id))
+        {
+            swHashMap_add_int(client->streams, ctx->stream_id, ctx);
+        }
+        return SW_OK;
+    }
+
+    if (client->streams)
     {
-        swHashMap_del_int(ctx->client->streams, ctx->stream_id);
+        swHashMap_del_int(client->streams, ctx->stream_id);
     }
     efree(ctx);
 
@@ -479,6 +699,12 @@ int swoole_http2_onFrame(swoole_http_client *client, swEventData *req)
 
     swTraceLog(SW_TRACE_HTTP2, "[%s]\tflags=%d, stream_id=%d, length=%d", swHttp2_get_type(type), flags, stream_id, length);
 
+    if (!client->deflater && http2_client_init(client) < 0)
+    {
+        sw_zval_ptr_dtor(&zdata);
+        return SW_ERR;
+    }
+
     if (type == SW_HTTP2_TYPE_HEADERS)
     {
         ctx = swoole_http_context_new(client TSRMLS_CC);
@@ -491,6 +717,7 @@ int swoole_http2_onFrame(swoole_http_client *client, swEventData *req)
 
         ctx->http2 = 1;
         ctx->stream_id = stream_id;
+        ctx->send_window = client->remote_window_size;
 
         http2_parse_header(client, ctx, flags, buf + SW_HTTP2_FRAME_HEADER_SIZE, length);
 
@@ -545,6 +772,11 @@ int swoole_http2_onFrame(swoole_http_client *client, swEventData *req)
             ctx->buffer = buffer;
         }
         swString_append_ptr(buffer, buf + SW_HTTP2_FRAME_HEADER_SIZE, length);
+        //the stream window is SW_HTTP2_MAX_WINDOW, only the connection window is consumed
+        if (length > 0)
+        {
+            http2_send_window_update(fd, 0, length);
+        }
 
         if (flags & SW_HTTP2_FLAG_END_STREAM)
         {
@@ -576,9 +808,45 @@ int swoole_http2_onFrame(swoole_http_client *client, swEventData *req)
         memcpy(ping_frame + SW_HTTP2_FRAME_HEADER_SIZE, buf + SW_HTTP2_FRAME_HEADER_SIZE, SW_HTTP2_FRAME_PING_PAYLOAD_SIZE);
         swServer_tcp_send(SwooleG.serv, fd, ping_frame, SW_HTTP2_FRAME_HEADER_SIZE + SW_HTTP2_FRAME_PING_PAYLOAD_SIZE);
     }
+    else if (type == SW_HTTP2_TYPE_RST_STREAM)
+    {
+        ctx = client->streams ? swHashMap_find_int(client->streams, stream_id) : NULL;
+        //drop the blocked body
+        if (ctx && ctx->send_buffer)
+        {
+            swString_free(ctx->send_buffer);
+            swHashMap_del_int(client->streams, stream_id);
+            efree(ctx);
+        }
+    }
+    else if (type == SW_HTTP2_TYPE_SETTINGS)
+    {
+        if (!(flags & SW_HTTP2_FLAG_ACK))
+        {
+            http2_parse_settings(client, buf + SW_HTTP2_FRAME_HEADER_SIZE, length);
+
+            char setting_frame[SW_HTTP2_FRAME_HEADER_SIZE];
+            swHttp2_set_frame_header(setting_frame, SW_HTTP2_TYPE_SETTINGS, 0, SW_HTTP2_FLAG_ACK, 0);
+            swServer_tcp_send(SwooleG.serv, fd, setting_frame, SW_HTTP2_FRAME_HEADER_SIZE);
+            http2_flush(client);
+        }
+    }
     else if (type == SW_HTTP2_TYPE_WINDOW_UPDATE)
     {
-        client->window_size = *(int *) (buf + SW_HTTP2_FRAME_HEADER_SIZE);
+        uint32_t increment = ntohl(*(uint32_t *) (buf + SW_HTTP2_FRAME_HEADER_SIZE)) & 0x7fffffff;
+        if (stream_id == 0)
+        {
+            client->window_size += increment;
+        }
+        else
+        {
+            ctx = client->streams ? swHashMap_find_int(client->streams, stream_id) : NULL;
+            if (ctx)
+            {
+                ctx->send_window += increment;
+            }
+        }
+        http2_flush(client);
     }
     sw_zval_ptr_dtor(&zdata);
     return SW_OK;
@@ -22,6 +22,7 @@
 static PHP_METHOD(swoole_mysql, __construct);
 static PHP_METHOD(swoole_mysql, __destruct);
 static PHP_METHOD(swoole_mysql, query);
+static PHP_METHOD(swoole_mysql, execute);
 static PHP_METHOD(swoole_mysql, close);
 static PHP_METHOD(swoole_mysql, on);
 
@@ -36,13 +37,28 @@ static const zend_function_entry swoole_mysql_methods[] =
     PHP_ME(swoole_mysql, __construct, NULL, ZEND_ACC_PUBLIC | ZEND_ACC_CTOR)
     PHP_ME(swoole_mysql, __destruct, NULL, ZEND_ACC_PUBLIC | ZEND_ACC_DTOR)
     PHP_ME(swoole_mysql, query, NULL, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_mysql, execute, NULL, ZEND_ACC_PUBLIC)
     PHP_ME(swoole_mysql, close, NULL, ZEND_ACC_PUBLIC)
     PHP_ME(swoole_mysql, on, NULL, ZEND_ACC_PUBLIC)
     PHP_FE_END
 };
 
-static int mysql_request(swString *sql, swString *buffer);
+static int mysql_request(int command, swString *sql, swString *buffer);
 static int mysql_handshake(mysql_connector *connector, char *buf, int len);
+static int mysql_stmt_execute(mysql_statement *stmt, zval *params, swString *buffer TSRMLS_DC);
+static int mysql_response(mysql_client *client);
+static void mysql_response_reset(mysql_client *client);
+
+static mysql_pending_request* mysql_request_new(mysql_client *client, int command, zval *callback TSRMLS_DC);
+static void mysql_request_free(mysql_client *client, mysql_pending_request *request TSRMLS_DC);
+static void mysql_request_callback(mysql_client *client, mysql_pending_request *request, zval *result TSRMLS_DC);
+static int mysql_client_enqueue(mysql_client *client, mysql_pending_request *request, swString *packet TSRMLS_DC);
+static void mysql_client_flush(mysql_client *client TSRMLS_DC);
+static void mysql_client_complete(mysql_client *client TSRMLS_DC);
+static void mysql_client_free_requests(mysql_client *client TSRMLS_DC);
+static void mysql_client_free_statements(mysql_client *client);
+static void mysql_statement_uncache(mysql_client *client, mysql_statement *stmt);
+static void mysql_statement_release(mysql_client *client, mysql_statement *stmt);
 
 #ifdef SW_MYSQL_DEBUG
 static void mysql_client_info(mysql_client *client);
@@ -63,53 +79,29 @@ void swoole_mysql_init(int module_number TSRMLS_DC)
     swoole_mysql_exception_class_entry = sw_zend_register_internal_class_ex(&swoole_mysql_exception_ce, zend_exception_get_default(TSRMLS_C), NULL TSRMLS_CC);
 }
 
-static PHP_METHOD(swoole_mysql, __construct)
+/**
+ * connect and authenticate in blocking mode, errno and error are set on failure
+ */
+static swClient* mysql_connect(mysql_connector *connector, int type, int *errcode, char **error)
 {
-    if (!mysql_request_buffer)
-    {
-        mysql_request_buffer = swString_new(SW_MYSQL_QUERY_INIT_SIZE);
-        if (!mysql_request_buffer)
-        {
-            swoole_php_fatal_error(E_ERROR, "[1] swString_new(%d) failed.", SW_HTTP_RESPONSE_INIT_SIZE);
-            RETURN_FALSE;
-        }
-    }
-
-    char *unixsocket = NULL;
-    zend_size_t unixsocket_len = 0;
-
-    mysql_connector connector;
-    connector.port = SW_MYSQL_DEFAULT_PORT;
-
-    if (zend_parse_parameters(ZEND_NUM_ARGS()TSRMLS_CC, "ssss|ls", &connector.host, &connector.host_len,
-            &connector.user, &connector.user_len, &connector.password, &connector.password_len, &connector.database,
-            &connector.database_len, &connector.port, &unixsocket, &unixsocket_len) == FAILURE)
-    {
-        RETURN_FALSE;
-    }
-
     swClient *cli = emalloc(sizeof(swClient));
-    int type = SW_SOCK_TCP;
-    if (unixsocket)
-    {
-        type = SW_SOCK_UNIX_STREAM;
-        connector.host = unixsocket;
-        connector.host_len = unixsocket_len;
-    }
     if (swClient_create(cli, type, 0) < 0)
     {
-        zend_throw_exception(swoole_mysql_exception_class_entry, "swClient_create failed.", 1 TSRMLS_CC);
-        RETURN_FALSE;
+        efree(cli);
+        *errcode = 1;
+        *error = "swClient_create failed.";
+        return NULL;
     }
-    if (cli->connect(cli, connector.host, connector.port, SW_MYSQL_CONNECT_TIMEOUT, 0) < 0)
+    if (cli->connect(cli, connector->host, connector->port, SW_MYSQL_CONNECT_TIMEOUT, 0) < 0)
     {
-        zend_throw_exception(swoole_mysql_exception_class_entry, "connect to mysql server[%s:%d] failed.", 2 TSRMLS_CC);
-        RETURN_FALSE;
+        *errcode = 2;
+        *error = "connect to mysql server[%s:%d] failed.";
+        goto fail;
     }
     int tcp_nodelay = 1;
     if (setsockopt(cli->socket->fd, IPPROTO_TCP, TCP_NODELAY, (const void *) &tcp_nodelay, sizeof(int)) == -1)
     {
-        swoole_php_sys_error(E_WARNING, "setsockopt(%d, IPPROTO_TCP, TCP_NODELAY) failed.", cli->socket->fd);
+        swSysError("setsockopt(%d, IPPROTO_TCP, TCP_NODELAY) failed.", cli->socket->fd);
     }
 
     char buf[2048];
@@ -117,39 +109,54 @@ static PHP_METHOD(swoole_mysql, __construct)
     int n = cli->recv(cli, buf, sizeof(buf), 0);
     if (n < 0)
     {
-        zend_throw_exception(swoole_mysql_exception_class_entry, "recvfrom mysql server failed.", 3 TSRMLS_CC);
-        RETURN_FALSE;
+        *errcode = 3;
+        *error = "recvfrom mysql server failed.";
+        goto fail;
     }
 
-    if (mysql_handshake(&connector, buf, n) == SW_ERR)
+    if (mysql_handshake(connector, buf, n) == SW_ERR)
     {
-        zend_throw_exception(swoole_mysql_exception_class_entry, "handshake with mysql server failed.", 4 TSRMLS_CC);
-        RETURN_FALSE;
+        *errcode = 4;
+        *error = "handshake with mysql server failed.";
+        goto fail;
     }
 
-    if (cli->send(cli, connector.buf, connector.packet_length + 4, 0) < 0)
+    if (cli->send(cli, connector->buf, connector->packet_length + 4, 0) < 0)
     {
-        zend_throw_exception(swoole_mysql_exception_class_entry, "sendto mysql server failed.", 5 TSRMLS_CC);
-        RETURN_FALSE;
+        *errcode = 5;
+        *error = "sendto mysql server failed.";
+        goto fail;
     }
 
     if (cli->recv(cli, buf, sizeof(buf), 0) < 0)
     {
-        zend_throw_exception(swoole_mysql_exception_class_entry, "recvfrom mysql server failed.", 6 TSRMLS_CC);
-        RETURN_FALSE;
+        *errcode = 6;
+        *error = "recvfrom mysql server failed.";
+        goto fail;
     }
+    return cli;
+
+    fail:
+    cli->close(cli);
+    swClient_free(cli);
+    efree(cli);
+    return NULL;
+}
 
+static void mysql_client_attach(zval *zobject, swClient *cli TSRMLS_DC)
+{
     mysql_client *client = emalloc(sizeof(mysql_client));
     bzero(client, sizeof(mysql_client));
     client->buffer = swString_new(SW_BUFFER_SIZE_BIG);
     client->fd = cli->socket->fd;
-    client->object = getThis();
+    client->object = zobject;
     client->cli = cli;
+    client->statements = swHashMap_new(SW_HASHMAP_INIT_BUCKET_N, NULL);
     sw_copy_to_stack(client->object, client->_object);
 
-    zend_update_property_bool(swoole_mysql_class_entry_ptr, getThis(), ZEND_STRL("connected"), 1 TSRMLS_CC);
+    zend_update_property_bool(swoole_mysql_class_entry_ptr, zobject, ZEND_STRL("connected"), 1 TSRMLS_CC);
 
-    swoole_set_object(getThis(), client);
+    swoole_set_object(zobject, client);
 
     php_swoole_check_reactor();
     swSetNonBlock(cli->socket->fd);
@@ -165,17 +172,225 @@ static PHP_METHOD(swoole_mysql, __construct)
     socket->object = client;
 }
 
-static int mysql_request(swString *sql, swString *buffer)
+static int mysql_request_buffer_init(TSRMLS_D)
+{
+    if (!mysql_request_buffer)
+    {
+        mysql_request_buffer = swString_new(SW_MYSQL_QUERY_INIT_SIZE);
+        if (!mysql_request_buffer)
+        {
+            swoole_php_fatal_error(E_ERROR, "[1] swString_new(%d) failed.", SW_HTTP_RESPONSE_INIT_SIZE);
+            return SW_ERR;
+        }
+    }
+    return SW_OK;
+}
+
+static PHP_METHOD(swoole_mysql, __construct)
+{
+    if (mysql_request_buffer_init(TSRMLS_C) < 0)
+    {
+        RETURN_FALSE;
+    }
+
+    char *unixsocket = NULL;
+    zend_size_t unixsocket_len = 0;
+
+    mysql_connector connector;
+    connector.port = SW_MYSQL_DEFAULT_PORT;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS()TSRMLS_CC, "ssss|ls", &connector.host, &connector.host_len,
+            &connector.user, &connector.user_len, &connector.password, &connector.password_len, &connector.database,
+            &connector.database_len, &connector.port, &unixsocket, &unixsocket_len) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+
+    int type = SW_SOCK_TCP;
+    if (unixsocket)
+    {
+        type = SW_SOCK_UNIX_STREAM;
+        connector.host = unixsocket;
+        connector.host_len = unixsocket_len;
+    }
+
+    int errcode;
+    char *error;
+    swClient *cli = mysql_connect(&connector, type, &errcode, &error);
+    if (cli == NULL)
+    {
+        zend_throw_exception(swoole_mysql_exception_class_entry, error, errcode TSRMLS_CC);
+        RETURN_FALSE;
+    }
+    mysql_client_attach(getThis(), cli TSRMLS_CC);
+}
+
+/**
+ * create a connected swoole_mysql object in zobject, used by swoole_connpool
+ */
+int php_swoole_mysql_connect(zval *zobject, char *host, int port, char *user, char *password, char *database TSRMLS_DC)
+{
+    if (mysql_request_buffer_init(TSRMLS_C) < 0)
+    {
+        return SW_ERR;
+    }
+
+    mysql_connector connector;
+    connector.host = host;
+    connector.host_len = strlen(host);
+    connector.user = user;
+    connector.user_len = strlen(user);
+    connector.password = password;
+    connector.password_len = strlen(password);
+    connector.database = database;
+    connector.database_len = strlen(database);
+    connector.port = port;
+
+    int errcode;
+    char *error;
+    swClient *cli = mysql_connect(&connector, SW_SOCK_TCP, &errcode, &error);
+    if (cli == NULL)
+    {
+        swoole_php_error(E_WARNING, "%s", error);
+        return SW_ERR;
+    }
+    object_init_ex(zobject, swoole_mysql_class_entry_ptr);
+    mysql_client_attach(zobject, cli TSRMLS_CC);
+    return SW_OK;
+}
+
+/**
+ * connected and not closed by the server, the requests are pipelined so a busy connection is ready too
+ */
+int php_swoole_mysql_is_ready(zval *zobject)
+{
+    mysql_client *client = swoole_get_object(zobject);
+    if (!client || !client->cli)
+    {
+        return SW_FALSE;
+    }
+    if (client->request_head)
+    {
+        return SW_TRUE;
+    }
+    char tmp;
+    int ret = recv(client->fd, &tmp, sizeof(tmp), MSG_DONTWAIT | MSG_PEEK);
+    if (ret >= 0 || swConnection_error(errno) == SW_CLOSE)
+    {
+        return SW_FALSE;
+    }
+    return SW_TRUE;
+}
+
+static int mysql_request(int command, swString *sql, swString *buffer)
 {
     bzero(buffer->str, 5);
     //length
     mysql_pack_length(sql->length + 1, buffer->str);
     //command
-    buffer->str[4] = SW_MYSQL_COM_QUERY;
+    buffer->str[4] = command;
     buffer->length = 5;
     return swString_append(buffer, sql);
 }
 
+/**
+ * COM_STMT_EXECUTE with the params in binary protocol
+ */
+static int mysql_stmt_execute(mysql_statement *stmt, zval *params, swString *buffer TSRMLS_DC)
+{
+    zval *value;
+    char num[16];
+    double dval;
+    int i = 0, n;
+
+    if (php_swoole_array_length(params) != stmt->num_params)
+    {
+        swoole_php_fatal_error(E_WARNING, "the statement requires %d params, %d given.", stmt->num_params, (int) php_swoole_array_length(params));
+        return SW_ERR;
+    }
+
+    //command, statement_id, flags, iteration_count
+    int null_offset = 14;
+    //NULL-bitmap, new_params_bound_flag, types
+    int type_offset = null_offset + ((stmt->num_params + 7) >> 3) + 1;
+    int value_offset = type_offset + stmt->num_params * 2;
+
+    if (buffer->size < value_offset && swString_extend(buffer, value_offset * 2) < 0)
+    {
+        return SW_ERR;
+    }
+    bzero(buffer->str, value_offset);
+    buffer->str[4] = SW_MYSQL_COM_STMT_EXECUTE;
+    mysql_int4store(buffer->str + 5, stmt->id);
+    mysql_int4store(buffer->str + 10, 1);
+    buffer->length = 14;
+
+    if (stmt->num_params > 0)
+    {
+        buffer->str[type_offset - 1] = 1;
+        buffer->length = value_offset;
+
+        SW_HASHTABLE_FOREACH_START(Z_ARRVAL_P(params), value)
+            switch (Z_TYPE_P(value))
+            {
+            case IS_NULL:
+                buffer->str[null_offset + (i >> 3)] |= (1 << (i & 7));
+                buffer->str[type_offset + i * 2] = SW_MYSQL_TYPE_NULL;
+                break;
+            case IS_LONG:
+                buffer->str[type_offset + i * 2] = SW_MYSQL_TYPE_LONGLONG;
+                mysql_int8store(num, Z_LVAL_P(value));
+                swString_append_ptr(buffer, num, 8);
+                break;
+            case IS_DOUBLE:
+                buffer->str[type_offset + i * 2] = SW_MYSQL_TYPE_DOUBLE;
+                dval = Z_DVAL_P(value);
+                memcpy(num, &dval, 8);
+                swString_append_ptr(buffer, num, 8);
+                break;
+#if PHP_MAJOR_VERSION < 7
+            case IS_BOOL:
+#else
+            case IS_TRUE:
+            case IS_FALSE:
+#endif
+                buffer->str[type_offset + i * 2] = SW_MYSQL_TYPE_TINY;
+                num[0] = Z_BVAL_P(value) ? 1 : 0;
+                swString_append_ptr(buffer, num, 1);
+                break;
+            case IS_STRING:
+                buffer->str[type_offset + i * 2] = SW_MYSQL_TYPE_VAR_STRING;
+                n = mysql_write_lcb(num, Z_STRLEN_P(value));
+                swString_append_ptr(buffer, num, n);
+                swString_append_ptr(buffer, Z_STRVAL_P(value), Z_STRLEN_P(value));
+                break;
+            default:
+            {
+                zval str_value = *value;
+                zval_copy_ctor(&str_value);
+                convert_to_string(&str_value);
+                buffer->str[type_offset + i * 2] = SW_MYSQL_TYPE_VAR_STRING;
+                n = mysql_write_lcb(num, Z_STRLEN(str_value));
+                swString_append_ptr(buffer, num, n);
+                swString_append_ptr(buffer, Z_STRVAL(str_value), Z_STRLEN(str_value));
+                zval_dtor(&str_value);
+                break;
+            }
+            }
+            i++;
+        SW_HASHTABLE_FOREACH_END();
+    }
+
+    if (buffer->length - 4 >= 0xffffff)
+    {
+        swoole_php_fatal_error(E_WARNING, "the packet is too big, length=%ld.", buffer->length);
+        return SW_ERR;
+    }
+    mysql_pack_length(buffer->length - 4, buffer->str);
+    buffer->str[3] = 0;
+    return SW_OK;
+}
+
 static int mysql_handshake(mysql_connector *connector, char *buf, int len)
 {
     char *tmp = buf;
@@ -312,78 +527,126 @@ static int mysql_handshake(mysql_connector *connector, char *buf, int len)
     return SW_OK;
 }
 
+static sw_inline void mysql_read_error(mysql_client *client, char *p, uint32_t n_buf)
+{
+    client->response.response_type = 0xff;
+    client->response.error_code = mysql_uint2korr(p + 1);
+    /* sql state marker 1byte (#), skip.. */
+    memcpy(client->response.status_msg, p + 4, 5);
+    client->response.server_msg = p + 9;
+    client->response.server_msg_len = n_buf > 9 ? n_buf - 9 : 0;
+    client->state = SW_MYSQL_STATE_READ_END;
+}
+
+/**
+ * parse the response of the request at the head of the queue, only the whole packets are consumed
+ * @return SW_OK: the response is complete, SW_ERR: wait for more data (wait_recv=1) or bad packet
+ */
 static int mysql_response(mysql_client *client)
 {
     swString *buffer = client->buffer;
-
-    char *p = buffer->str + buffer->offset;
-    int ret;
+    mysql_pending_request *request = client->request_head;
+    mysql_field *field;
+    char *p;
+    uint32_t n_buf;
+    ulong_t value;
     char nul;
-    int n_buf = buffer->length - buffer->offset;
+    int ret;
 
-    while (n_buf > 0)
+    client->response.wait_recv = 0;
+
+    while (1)
     {
-        switch (client->state)
+        p = buffer->str + buffer->offset;
+        n_buf = buffer->length - buffer->offset;
+        if (n_buf < 4 || n_buf - 4 < mysql_uint3korr(p))
         {
-        case SW_MYSQL_STATE_READ_START:
-            if (buffer->length - buffer->offset < 5)
-            {
-                client->response.wait_recv = 1;
-                return SW_ERR;
-            }
-            client->response.packet_length = mysql_uint3korr(p);
-            client->response.packet_number = p[3];
-            p += 4;
-            n_buf -= 4;
+            client->response.wait_recv = 1;
+            return SW_ERR;
+        }
 
-            if (n_buf < client->response.packet_length)
-            {
-                client->response.wait_recv = 1;
-                return SW_ERR;
-            }
+        client->response.packet_length = mysql_uint3korr(p);
+        client->response.packet_number = p[3];
+        p += 4;
+        n_buf = client->response.packet_length;
+        buffer->offset += n_buf + 4;
 
-            client->response.response_type = p[0];
-            p ++;
-            n_buf --;
+        if (n_buf == 0)
+        {
+            return SW_ERR;
+        }
 
+        switch (client->state)
+        {
+        case SW_MYSQL_STATE_READ_START:
+            client->response.response_type = p[0];
             /* error */
-            if (client->response.response_type == 0xFF)
+            if (client->response.response_type == 0xff)
             {
-                client->response.error_code = mysql_uint2korr(p);
-                /* status flag 1byte (#), skip.. */
-                memcpy(client->response.status_msg, p + 3, 5);
-                client->response.server_msg = p + 8;
-                client->state = SW_MYSQL_STATE_READ_END;
+                mysql_read_error(client, p, n_buf);
                 return SW_OK;
             }
-            /* eof */
-            else if (client->response.response_type == 254)
+            /* prepare ok */
+            else if (client->response.response_type == 0 && request->command == SW_MYSQL_COM_STMT_PREPARE)
             {
-                client->response.warnings = mysql_uint2korr(p);
-                client->response.status_code = mysql_uint2korr(p + 2);
-                client->state = SW_MYSQL_STATE_READ_END;
-                return SW_ERR;
+                if (n_buf < 12)
+                {
+                    return SW_ERR;
+                }
+                client->response.stmt_id = mysql_uint4korr(p + 1);
+                client->response.num_column = mysql_uint2korr(p + 5);
+                client->response.num_param = mysql_uint2korr(p + 7);
+                client->response.warnings = mysql_uint2korr(p + 10);
+                /* definitions of the params and the columns, each ends with EOF */
+                client->response.skip_packets = 0;
+                if (client->response.num_param > 0)
+                {
+                    client->response.skip_packets += client->response.num_param + 1;
+                }
+                if (client->response.num_column > 0)
+                {
+                    client->response.skip_packets += client->response.num_column + 1;
+                }
+                client->response.num_column = 0;
+                if (client->response.skip_packets == 0)
+                {
+                    client->state = SW_MYSQL_STATE_READ_END;
+                    return SW_OK;
+                }
+                client->state = SW_MYSQL_STATE_READ_PREPARE;
+                break;
             }
             /* ok */
             else if (client->response.response_type == 0)
             {
+                p++;
+                n_buf--;
+
                 /* affected rows */
-                ret = mysql_length_coded_binary(p, (ulong_t *) &client->response.affected_rows, &nul, n_buf);
+                ret = mysql_length_coded_binary(p, &client->response.affected_rows, &nul, n_buf);
+                if (ret < 0)
+                {
+                    return SW_ERR;
+                }
                 n_buf -= ret;
                 p += ret;
 
                 /* insert id */
-                ret = mysql_length_coded_binary(p, (ulong_t *) &client->response.insert_id, &nul, n_buf);
+                ret = mysql_length_coded_binary(p, &client->response.insert_id, &nul, n_buf);
+                if (ret < 0)
+                {
+                    return SW_ERR;
+                }
                 n_buf -= ret;
                 p += ret;
 
-                /* server status */
-                client->response.status_code = mysql_uint2korr(p);
-                n_buf -= 2;
-                p += 2;
-
-                /* server warnings */
-                client->response.warnings = mysql_uint2korr(p);
+                if (n_buf >= 4)
+                {
+                    /* server status */
+                    client->response.status_code = mysql_uint2korr(p);
+                    /* server warnings */
+                    client->response.warnings = mysql_uint2korr(p + 2);
+                }
 
                 client->state = SW_MYSQL_STATE_READ_END;
                 return SW_OK;
@@ -391,34 +654,83 @@ static int mysql_response(mysql_client *client)
             /* result set */
             else
             {
-                client->buffer->offset += 5;
-                client->response.num_column = client->response.response_type;
+                ret = mysql_length_coded_binary(p, &value, &nul, n_buf);
+                if (ret < 0 || value == 0 || value > 0xffff)
+                {
+                    return SW_ERR;
+                }
+                client->response.num_column = value;
                 client->response.columns = ecalloc(client->response.num_column, sizeof(mysql_field));
+                client->response.index = 0;
                 client->state = SW_MYSQL_STATE_READ_FIELD;
                 break;
             }
 
         case SW_MYSQL_STATE_READ_FIELD:
-            if (mysql_read_columns(client) < 0)
+            if (client->response.index < client->response.num_column)
             {
-                return SW_ERR;
+                field = &client->response.columns[client->response.index];
+                if (mysql_decode_field(p, n_buf, field) < 0)
+                {
+                    return SW_ERR;
+                }
+                //the packet will be overwritten
+                field->name = estrndup(field->name, field->name_length);
+                field->org_name = field->table = field->org_table = field->db = field->catalog = field->def = NULL;
+                client->response.index++;
+                break;
             }
-            else
+            /* eof */
+            if ((uchar) p[0] != 0xfe)
             {
-                client->state = SW_MYSQL_STATE_READ_ROW;
-                break;
+                return SW_ERR;
             }
+            SW_ALLOC_INIT_ZVAL(client->response.result_array);
+            array_init(client->response.result_array);
+            client->state = SW_MYSQL_STATE_READ_ROW;
+            break;
 
         case SW_MYSQL_STATE_READ_ROW:
-            if (mysql_read_rows(client) < 0)
+            /* eof */
+            if ((uchar) p[0] == 0xfe && n_buf < 9)
             {
-                return SW_ERR;
+                if (n_buf >= 5)
+                {
+                    client->response.warnings = mysql_uint2korr(p + 1);
+                    client->response.status_code = mysql_uint2korr(p + 3);
+                }
+                client->state = SW_MYSQL_STATE_READ_END;
+                return SW_OK;
+            }
+            /* error */
+            else if ((uchar) p[0] == 0xff)
+            {
+                mysql_read_error(client, p, n_buf);
+                return SW_OK;
+            }
+            if (request->command == SW_MYSQL_COM_STMT_EXECUTE)
+            {
+                ret = mysql_decode_binary_row(client, p, n_buf);
             }
             else
+            {
+                ret = mysql_decode_row(client, p, n_buf);
+            }
+            if (ret < 0)
+            {
+                return SW_ERR;
+            }
+            client->response.num_row++;
+            break;
+
+        case SW_MYSQL_STATE_READ_PREPARE:
+            client->response.skip_packets--;
+            if (client->response.skip_packets == 0)
             {
                 client->state = SW_MYSQL_STATE_READ_END;
                 return SW_OK;
             }
+            break;
 
         default:
             return SW_ERR;
@@ -428,6 +740,27 @@ static int mysql_response(mysql_client *client)
     return SW_OK;
 }
 
+static void mysql_response_reset(mysql_client *client)
+{
+    int i;
+    if (client->response.columns)
+    {
+        for (i = 0; i < client->response.index; i++)
+        {
+            efree(client->response.columns[i].name);
+        }
+        efree(client->response.columns);
+    }
+    if (client->response.result_array)
+    {
+        sw_zval_ptr_dtor(&client->response.result_array);
+#if PHP_MAJOR_VERSION > 5
+        efree(client->response.result_array);
+#endif
+    }
+    bzero(&client->response, sizeof(client->response));
+}
+
 #ifdef SW_MYSQL_DEBUG
 
 static void mysql_client_info(mysql_client *client)
@@ -465,61 +798,368 @@ static void mysql_column_info(mysql_field *field)
 
 #endif
 
-static PHP_METHOD(swoole_mysql, query)
+static mysql_pending_request* mysql_request_new(mysql_client *client, int command, zval *callback TSRMLS_DC)
 {
-    zval *callback;
-    swString sql;
-    bzero(&sql, sizeof(sql));
-
-    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "sz", &sql.str, &sql.length, &callback) == FAILURE)
+    mysql_pending_request *request = emalloc(sizeof(mysql_pending_request));
+    bzero(request, sizeof(mysql_pending_request));
+    request->command = command;
+    if (callback)
     {
-        return;
+        request->callback = callback;
+        sw_copy_to_stack(request->callback, request->_callback);
+        sw_zval_add_ref(&request->callback);
+        sw_zval_add_ref(&client->object);
     }
+    return request;
+}
 
-    if (sql.length <= 0)
+static void mysql_request_free(mysql_client *client, mysql_pending_request *request TSRMLS_DC)
+{
+    if (request->statement)
     {
-        swoole_php_fatal_error(E_WARNING, "Query is empty.");
-        RETURN_FALSE;
+        mysql_statement_release(client, request->statement);
     }
-
-    mysql_client *client = swoole_get_object(getThis());
-    if (!client)
+    if (request->packet)
     {
-        swoole_php_fatal_error(E_WARNING, "object is not instanceof swoole_mysql.");
-        RETURN_FALSE;
+        swString_free(request->packet);
     }
-
-    if (!client->cli)
+    if (request->params)
     {
-        swoole_php_fatal_error(E_WARNING, "mysql connection#%d is closed.", client->fd);
-        RETURN_FALSE;
+        sw_zval_ptr_dtor(&request->params);
     }
-
-    if (client->state != SW_MYSQL_STATE_QUERY)
+    if (request->callback)
     {
-        swoole_php_fatal_error(E_WARNING, "mysql client is waiting response, cannot send new sql query.");
-        RETURN_FALSE;
+        sw_zval_ptr_dtor(&request->callback);
+        sw_zval_ptr_dtor(&client->object);
     }
+    efree(request);
+}
 
-    client->callback = callback;
-    sw_copy_to_stack(client->callback, client->_callback);
+static void mysql_request_callback(mysql_client *client, mysql_pending_request *request, zval *result TSRMLS_DC)
+{
+    zval *zobject = client->object;
+    zval *retval = NULL;
+    zval **args[2];
 
-    sw_zval_add_ref(&client->callback);
-    sw_zval_add_ref(&client->object);
-    swString_clear(mysql_request_buffer);
+    args[0] = &zobject;
+    args[1] = &result;
+    if (sw_call_user_function_ex(EG(function_table), NULL, request->callback, &retval, 2, args, 0, NULL TSRMLS_CC) != SUCCESS)
+    {
+        swoole_php_fatal_error(E_WARNING, "swoole_async_mysql callback[2] handler error.");
+    }
+    if (retval)
+    {
+        sw_zval_ptr_dtor(&retval);
+    }
+    sw_zval_ptr_dtor(&result);
+#if PHP_MAJOR_VERSION > 5
+    efree(result);
+#endif
+}
+
+/**
+ * the packet is sent at once if no request is waiting to be sent before it
+ */
+static int mysql_client_enqueue(mysql_client *client, mysql_pending_request *request, swString *packet TSRMLS_DC)
+{
+    if (client->state == SW_MYSQL_STATE_QUERY)
+    {
+        //add to eventloop
+        if (SwooleG.main_reactor->add(SwooleG.main_reactor, client->fd, PHP_SWOOLE_FD_MYSQL | SW_EVENT_READ) < 0)
+        {
+            swoole_php_fatal_error(E_WARNING, "swoole_event_add failed.");
+            return SW_ERR;
+        }
+        client->state = SW_MYSQL_STATE_READ_START;
+    }
+
+    if (packet && client->request_unsent == NULL)
+    {
+        if (SwooleG.main_reactor->write(SwooleG.main_reactor, client->fd, packet->str, packet->length) < 0)
+        {
+            if (client->request_num == 0)
+            {
+                SwooleG.main_reactor->del(SwooleG.main_reactor, client->fd);
+                client->state = SW_MYSQL_STATE_QUERY;
+            }
+            return SW_ERR;
+        }
+    }
+    else
+    {
+        if (packet)
+        {
+            request->packet = swString_dup2(packet);
+        }
+        if (client->request_unsent == NULL)
+        {
+            client->request_unsent = request;
+        }
+    }
+
+    if (client->request_tail)
+    {
+        client->request_tail->next = request;
+    }
+    else
+    {
+        client->request_head = request;
+    }
+    client->request_tail = request;
+    client->request_num++;
+    return SW_OK;
+}
+
+/**
+ * send the requests held by a statement being prepared
+ */
+static void mysql_client_flush(mysql_client *client TSRMLS_DC)
+{
+    mysql_pending_request *request;
+    swString *packet;
+
+    while ((request = client->request_unsent) != NULL)
+    {
+        packet = request->packet;
+        if (request->command == SW_MYSQL_COM_STMT_EXECUTE)
+        {
+            if (request->statement->state == SW_MYSQL_STMT_PREPARING)
+            {
+                break;
+            }
+            swString_clear(mysql_request_buffer);
+            if (request->statement->state == SW_MYSQL_STMT_READY
+                    && mysql_stmt_execute(request->statement, request->params, mysql_request_buffer TSRMLS_CC) == SW_OK)
+            {
+                packet = mysql_request_buffer;
+            }
+            else
+            {
+                request->error = 1;
+            }
+        }
+        if (packet && SwooleG.main_reactor->write(SwooleG.main_reactor, client->fd, packet->str, packet->length) < 0)
+        {
+            swoole_php_fatal_error(E_WARNING, "send to mysql connection#%d failed.", client->fd);
+        }
+        if (request->packet)
+        {
+            swString_free(request->packet);
+            request->packet = NULL;
+        }
+        client->request_unsent = request->next;
+    }
+}
+
+static mysql_pending_request* mysql_client_pop(mysql_client *client)
+{
+    mysql_pending_request *request = client->request_head;
+    client->request_head = request->next;
+    if (client->request_head == NULL)
+    {
+        client->request_tail = NULL;
+    }
+    client->request_num--;
+    client->state = SW_MYSQL_STATE_READ_START;
+    return request;
+}
+
+/**
+ * the response of the head request is complete
+ */
+static void mysql_client_complete(mysql_client *client TSRMLS_DC)
+{
+    mysql_pending_request *request = mysql_client_pop(client);
+    mysql_statement *stmt;
+    zval *zobject = client->object;
+    zval *result = NULL;
+
+    //ERROR
+    if (client->response.response_type == 0xff)
+    {
+        zend_update_property_stringl(swoole_mysql_class_entry_ptr, zobject, ZEND_STRL("error"), client->response.server_msg, client->response.server_msg_len TSRMLS_CC);
+        zend_update_property_long(swoole_mysql_class_entry_ptr, zobject, ZEND_STRL("errno"), client->response.error_code TSRMLS_CC);
+    }
 
-    if (mysql_request(&sql, mysql_request_buffer) < 0)
+    if (request->command == SW_MYSQL_COM_STMT_PREPARE)
     {
+        stmt = request->statement;
+        if (client->response.response_type == 0xff)
+        {
+            stmt->state = SW_MYSQL_STMT_ERROR;
+            mysql_statement_uncache(client, stmt);
+        }
+        else
+        {
+            stmt->id = client->response.stmt_id;
+            stmt->num_params = client->response.num_param;
+            stmt->state = SW_MYSQL_STMT_READY;
+        }
+        mysql_response_reset(client);
+        mysql_request_free(client, request TSRMLS_CC);
+        mysql_client_flush(client TSRMLS_CC);
+    }
+    else
+    {
+        zend_update_property_long(swoole_mysql_class_entry_ptr, zobject, ZEND_STRL("affected_rows"), client->response.affected_rows TSRMLS_CC);
+        zend_update_property_long(swoole_mysql_class_entry_ptr, zobject, ZEND_STRL("insert_id"), client->response.insert_id TSRMLS_CC);
+
+        //OK
+        if (client->response.response_type == 0)
+        {
+            SW_ALLOC_INIT_ZVAL(result);
+            ZVAL_BOOL(result, 1);
+        }
+        //ERROR
+        else if (client->response.response_type == 0xff)
+        {
+            SW_ALLOC_INIT_ZVAL(result);
+            ZVAL_BOOL(result, 0);
+        }
+        //ResultSet
+        else
+        {
+            result = client->response.result_array;
+            client->response.result_array = NULL;
+        }
+        mysql_response_reset(client);
+        mysql_request_callback(client, request, result TSRMLS_CC);
+        mysql_request_free(client, request TSRMLS_CC);
+    }
+
+    //the statement failed to prepare, they are not sent
+    while (client->cli && client->request_head && client->request_head->error)
+    {
+        request = mysql_client_pop(client);
+        SW_ALLOC_INIT_ZVAL(result);
+        ZVAL_BOOL(result, 0);
+        mysql_request_callback(client, request, result TSRMLS_CC);
+        mysql_request_free(client, request TSRMLS_CC);
+    }
+
+    if (client->cli && client->request_num == 0)
+    {
+        //remove from eventloop
+        SwooleG.main_reactor->del(SwooleG.main_reactor, client->fd);
+        client->state = SW_MYSQL_STATE_QUERY;
+    }
+}
+
+static void mysql_client_free_requests(mysql_client *client TSRMLS_DC)
+{
+    mysql_pending_request *request;
+    zval *result;
+
+    client->request_unsent = NULL;
+    while (client->request_head)
+    {
+        request = mysql_client_pop(client);
+        if (request->callback)
+        {
+            SW_ALLOC_INIT_ZVAL(result);
+            ZVAL_BOOL(result, 0);
+            mysql_request_callback(client, request, result TSRMLS_CC);
+        }
+        mysql_request_free(client, request TSRMLS_CC);
+    }
+}
+
+static void mysql_client_free_statements(mysql_client *client)
+{
+    mysql_statement *stmt;
+    char *key;
+
+    if (!client->statements)
+    {
+        return;
+    }
+    swHashMap_each_reset(client->statements);
+    while ((stmt = swHashMap_each(client->statements, &key)) != NULL)
+    {
+        //freed by the last request
+        if (stmt->ref > 0)
+        {
+            stmt->cached = 0;
+            continue;
+        }
+        efree(stmt->sql);
+        efree(stmt);
+    }
+    swHashMap_free(client->statements);
+    client->statements = NULL;
+    client->statement_num = 0;
+}
+
+static void mysql_statement_uncache(mysql_client *client, mysql_statement *stmt)
+{
+    if (stmt->cached)
+    {
+        swHashMap_del(client->statements, stmt->sql, stmt->sql_len);
+        stmt->cached = 0;
+        client->statement_num--;
+    }
+}
+
+static void mysql_statement_release(mysql_client *client, mysql_statement *stmt)
+{
+    stmt->ref--;
+    if (stmt->ref > 0 || stmt->cached)
+    {
+        return;
+    }
+    //not in the cache, close it on the server, there is no response
+    if (stmt->state == SW_MYSQL_STMT_READY && client->cli)
+    {
+        char buf[9];
+        mysql_pack_length(5, buf);
+        buf[3] = 0;
+        buf[4] = SW_MYSQL_COM_STMT_CLOSE;
+        mysql_int4store(buf + 5, stmt->id);
+        SwooleG.main_reactor->write(SwooleG.main_reactor, client->fd, buf, sizeof(buf));
+    }
+    efree(stmt->sql);
+    efree(stmt);
+}
+
+static PHP_METHOD(swoole_mysql, query)
+{
+    zval *callback;
+    swString sql;
+    bzero(&sql, sizeof(sql));
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "sz", &sql.str, &sql.length, &callback) == FAILURE)
+    {
+        return;
+    }
+
+    if (sql.length <= 0)
+    {
+        swoole_php_fatal_error(E_WARNING, "Query is empty.");
         RETURN_FALSE;
     }
-    //add to eventloop
-    if (SwooleG.main_reactor->add(SwooleG.main_reactor, client->fd, PHP_SWOOLE_FD_MYSQL | SW_EVENT_READ) < 0)
+
+    mysql_client *client = swoole_get_object(getThis());
+    if (!client)
     {
-        swoole_php_fatal_error(E_WARNING, "swoole_event_add failed.");
+        swoole_php_fatal_error(E_WARNING, "object is not instanceof swoole_mysql.");
         RETURN_FALSE;
     }
-    //send query
-    if (SwooleG.main_reactor->write(SwooleG.main_reactor, client->fd, mysql_request_buffer->str, mysql_request_buffer->length) < 0)
+
+    if (!client->cli)
+    {
+        swoole_php_fatal_error(E_WARNING, "mysql connection#%d is closed.", client->fd);
+        RETURN_FALSE;
+    }
+
+    swString_clear(mysql_request_buffer);
+    if (mysql_request(SW_MYSQL_COM_QUERY, &sql, mysql_request_buffer) < 0)
+    {
+        RETURN_FALSE;
+    }
+
+    //pipelined, the response is matched in order
+    mysql_pending_request *request = mysql_request_new(client, SW_MYSQL_COM_QUERY, callback TSRMLS_CC);
+    if (mysql_client_enqueue(client, request, mysql_request_buffer TSRMLS_CC) < 0)
     {
         //connection is closed
         if (swConnection_error(errno) == SW_CLOSE)
@@ -527,13 +1167,116 @@ static PHP_METHOD(swoole_mysql, query)
             zend_update_property_bool(swoole_mysql_class_entry_ptr, getThis(), ZEND_STRL("connected"), 0 TSRMLS_CC);
             zend_update_property_bool(swoole_mysql_class_entry_ptr, getThis(), ZEND_STRL("errno"), 2006 TSRMLS_CC);
         }
+        mysql_request_free(client, request TSRMLS_CC);
         RETURN_FALSE;
     }
+    RETURN_TRUE;
+}
+
+/**
+ * prepared statement, cached by the sql in the connection
+ */
+static PHP_METHOD(swoole_mysql, execute)
+{
+    zval *params;
+    zval *callback;
+    mysql_pending_request *request;
+    swString *packet = NULL;
+    swString sql;
+    bzero(&sql, sizeof(sql));
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "saz", &sql.str, &sql.length, &params, &callback) == FAILURE)
+    {
+        return;
+    }
+
+    if (sql.length <= 0)
+    {
+        swoole_php_fatal_error(E_WARNING, "Query is empty.");
+        RETURN_FALSE;
+    }
+
+    mysql_client *client = swoole_get_object(getThis());
+    if (!client)
+    {
+        swoole_php_fatal_error(E_WARNING, "object is not instanceof swoole_mysql.");
+        RETURN_FALSE;
+    }
+
+    if (!client->cli)
+    {
+        swoole_php_fatal_error(E_WARNING, "mysql connection#%d is closed.", client->fd);
+        RETURN_FALSE;
+    }
+
+    mysql_statement *stmt = NULL;
+    if (sql.length <= 0xffff)
+    {
+        stmt = swHashMap_find(client->statements, sql.str, sql.length);
+    }
+
+    if (stmt == NULL)
+    {
+        stmt = emalloc(sizeof(mysql_statement));
+        bzero(stmt, sizeof(mysql_statement));
+        stmt->sql = estrndup(sql.str, sql.length);
+        stmt->sql_len = sql.length;
+        stmt->state = SW_MYSQL_STMT_PREPARING;
+        //the statement is closed after the execution if the cache is full
+        if (sql.length <= 0xffff && client->statement_num < SW_MYSQL_STMT_CACHE_SIZE
+                && swHashMap_add(client->statements, stmt->sql, stmt->sql_len, stmt) == SW_OK)
+        {
+            stmt->cached = 1;
+            client->statement_num++;
+        }
+
+        request = mysql_request_new(client, SW_MYSQL_COM_STMT_PREPARE, NULL TSRMLS_CC);
+        request->statement = stmt;
+        stmt->ref++;
+
+        swString_clear(mysql_request_buffer);
+        if (mysql_request(SW_MYSQL_COM_STMT_PREPARE, &sql, mysql_request_buffer) < 0
+                || mysql_client_enqueue(client, request, mysql_request_buffer TSRMLS_CC) < 0)
+        {
+            mysql_statement_uncache(client, stmt);
+            mysql_request_free(client, request TSRMLS_CC);
+            RETURN_FALSE;
+        }
+    }
+    else if (stmt->state == SW_MYSQL_STMT_READY && php_swoole_array_length(params) != stmt->num_params)
+    {
+        swoole_php_fatal_error(E_WARNING, "the statement requires %d params, %d given.", stmt->num_params, (int) php_swoole_array_length(params));
+        RETURN_FALSE;
+    }
+
+    request = mysql_request_new(client, SW_MYSQL_COM_STMT_EXECUTE, callback TSRMLS_CC);
+    request->statement = stmt;
+    stmt->ref++;
+
+    if (stmt->state == SW_MYSQL_STMT_READY && client->request_unsent == NULL)
+    {
+        swString_clear(mysql_request_buffer);
+        if (mysql_stmt_execute(stmt, params, mysql_request_buffer TSRMLS_CC) < 0)
+        {
+            mysql_request_free(client, request TSRMLS_CC);
+            RETURN_FALSE;
+        }
+        packet = mysql_request_buffer;
+    }
+    //sent after the statement is prepared
     else
     {
-        client->state = SW_MYSQL_STATE_READ_START;
-        RETURN_TRUE;
+        request->params = params;
+        sw_copy_to_stack(request->params, request->_params);
+        sw_zval_add_ref(&request->params);
+    }
+
+    if (mysql_client_enqueue(client, request, packet TSRMLS_CC) < 0)
+    {
+        mysql_request_free(client, request TSRMLS_CC);
+        RETURN_FALSE;
     }
+    RETURN_TRUE;
 }
 
 static PHP_METHOD(swoole_mysql, __destruct)
@@ -553,6 +1296,7 @@ static PHP_METHOD(swoole_mysql, __destruct)
 //            sw_zval_ptr_dtor(&retval);
 //        }
 //    }
+    mysql_client_free_statements(client);
     efree(client);
     swoole_set_object(getThis(), NULL);
 }
@@ -572,6 +1316,10 @@ static PHP_METHOD(swoole_mysql, close)
         RETURN_FALSE;
     }
 
+    zval *object = getThis();
+    //the object may be released by the callbacks of the pending requests
+    sw_zval_add_ref(&object);
+
     zend_update_property_bool(swoole_mysql_class_entry_ptr, getThis(), ZEND_STRL("connected"), 0 TSRMLS_CC);
     if (client->state != SW_MYSQL_STATE_QUERY)
     {
@@ -583,9 +1331,14 @@ static PHP_METHOD(swoole_mysql, close)
     efree(client->cli);
     client->cli = NULL;
 
+    mysql_client_free_requests(client TSRMLS_CC);
+    mysql_client_free_statements(client);
+    mysql_response_reset(client);
+    client->state = SW_MYSQL_STATE_CLOSED;
+    swString_clear(client->buffer);
+
     zval *retval = NULL;
     zval **args[1];
-    zval *object = getThis();
     if (client->onClose)
     {
         args[0] = &object;
@@ -598,6 +1351,7 @@ static PHP_METHOD(swoole_mysql, close)
             sw_zval_ptr_dtor(&retval);
         }
     }
+    sw_zval_ptr_dtor(&object);
 }
 
 static PHP_METHOD(swoole_mysql, on)
@@ -651,6 +1405,68 @@ static int swoole_mysql_onError(swReactor *reactor, swEvent *event)
     return SW_OK;
 }
 
+/**
+ * dispatch the complete responses in order
+ */
+static int mysql_client_parse(mysql_client *client, int closed TSRMLS_DC)
+{
+    swString *buffer = client->buffer;
+    zval *retval = NULL;
+
+#if PHP_MAJOR_VERSION >= 7
+    zval _zobject = *client->object;
+    zval *zobject = &_zobject;
+#else
+    zval *zobject = client->object;
+#endif
+
+    //the object may be released by the callbacks
+    sw_zval_add_ref(&zobject);
+
+    while (client->request_head)
+    {
+        if (mysql_response(client) < 0)
+        {
+            if (!client->response.wait_recv)
+            {
+                swoole_php_fatal_error(E_WARNING, "bad packet from mysql server, connection#%d.", client->fd);
+                closed = 1;
+            }
+            break;
+        }
+        mysql_client_complete(client TSRMLS_CC);
+        //closed in the callback
+        if (!client->cli)
+        {
+            goto free_object;
+        }
+    }
+
+    if (closed)
+    {
+        sw_zend_call_method_with_0_params(&zobject, swoole_mysql_class_entry_ptr, NULL, "close", &retval);
+        if (retval)
+        {
+            sw_zval_ptr_dtor(&retval);
+        }
+    }
+    else if (buffer->offset == buffer->length || !client->request_head)
+    {
+        swString_clear(buffer);
+    }
+    //move the next response to the head of the buffer
+    else if (buffer->offset > 0)
+    {
+        memmove(buffer->str, buffer->str + buffer->offset, buffer->length - buffer->offset);
+        buffer->length -= buffer->offset;
+        buffer->offset = 0;
+    }
+
+    free_object:
+    sw_zval_ptr_dtor(&zobject);
+    return SW_OK;
+}
+
 static int swoole_mysql_onRead(swReactor *reactor, swEvent *event)
 {
 #if PHP_MAJOR_VERSION < 7
@@ -660,16 +1476,9 @@ static int swoole_mysql_onRead(swReactor *reactor, swEvent *event)
     mysql_client *client = event->socket->object;
     int sock = event->fd;
 
-    zval *zobject = client->object;
     swString *buffer = client->buffer;
     int ret;
 
-    zval **args[2];
-
-    zval *callback = NULL;
-    zval *retval = NULL;
-    zval *result = NULL;
-
     while(1)
     {
         ret = recv(sock, buffer->str + buffer->length, buffer->size - buffer->length, 0);
@@ -698,44 +1507,8 @@ static int swoole_mysql_onRead(swReactor *reactor, swEvent *event)
         else if (ret == 0)
         {
             close_fd:
-            if (client->state == SW_MYSQL_STATE_READ_END)
-            {
-                goto parse_response;
-            }
-
-            sw_zend_call_method_with_0_params(&zobject, swoole_mysql_class_entry_ptr, NULL, "close", &retval);
-            if (retval)
-            {
-                sw_zval_ptr_dtor(&retval);
-            }
-
-            if (client->callback)
-            {
-                args[0] = &zobject;
-                args[1] = &result;
-
-                SW_ALLOC_INIT_ZVAL(result);
-                ZVAL_BOOL(result, 0);
-
-                callback = client->callback;
-                if (sw_call_user_function_ex(EG(function_table), NULL, callback, &retval, 2, args, 0, NULL TSRMLS_CC) != SUCCESS)
-                {
-                    swoole_php_fatal_error(E_WARNING, "swoole_async_mysql callback[2] handler error.");
-                }
-                if (result)
-                {
-                    sw_zval_ptr_dtor(&result);
-                }
-                sw_zval_ptr_dtor(&callback);
-                client->callback = NULL;
-                client->state = SW_MYSQL_STATE_QUERY;
-                if (retval)
-                {
-                    sw_zval_ptr_dtor(&retval);
-                }
-            }
-
-            return SW_OK;
+            //the responses received before the connection is closed
+            return mysql_client_parse(client, 1 TSRMLS_CC);
         }
         else
         {
@@ -752,81 +1525,7 @@ static int swoole_mysql_onRead(swReactor *reactor, swEvent *event)
             }
 
             parse_response:
-            if (mysql_response(client) < 0)
-            {
-                return SW_OK;
-            }
-
-            //remove from eventloop
-            reactor->del(reactor, event->fd);
-
-            zend_update_property_long(swoole_mysql_class_entry_ptr, zobject, ZEND_STRL("affected_rows"), client->response.affected_rows TSRMLS_CC);
-            zend_update_property_long(swoole_mysql_class_entry_ptr, zobject, ZEND_STRL("insert_id"), client->response.insert_id TSRMLS_CC);
-            client->state = SW_MYSQL_STATE_QUERY;
-
-            args[0] = &zobject;
-
-            //OK
-            if (client->response.response_type == 0)
-            {
-                SW_ALLOC_INIT_ZVAL(result);
-                ZVAL_BOOL(result, 1);
-            }
-            //ERROR
-            else if (client->response.response_type == 255)
-            {
-                SW_ALLOC_INIT_ZVAL(result);
-                ZVAL_BOOL(result, 0);
-
-                zend_update_property_string(swoole_mysql_class_entry_ptr, zobject, ZEND_STRL("error"), client->response.server_msg TSRMLS_CC);
-                zend_update_property_long(swoole_mysql_class_entry_ptr, zobject, ZEND_STRL("errno"), client->response.error_code TSRMLS_CC);
-            }
-            //ResultSet
-            else
-            {
-                result = client->response.result_array;
-            }
-
-            args[1] = &result;
-            callback = client->callback;
-            if (sw_call_user_function_ex(EG(function_table), NULL, callback, &retval, 2, args, 0, NULL TSRMLS_CC) != SUCCESS)
-            {
-                swoole_php_fatal_error(E_WARNING, "swoole_async_mysql callback[2] handler error.");
-                reactor->del(SwooleG.main_reactor, event->fd);
-            }
-
-            /* free memory */
-            if (retval)
-            {
-                sw_zval_ptr_dtor(&retval);
-            }
-            if (result)
-            {
-                sw_zval_ptr_dtor(&result);
-#if PHP_MAJOR_VERSION > 5
-                efree(result);
-#endif
-            }
-            //free callback object
-            sw_zval_ptr_dtor(&callback);
-            //clear buffer
-            swString_clear(client->buffer);
-            if (client->response.columns)
-            {
-                efree(client->response.columns);
-            }
-            if (client->object)
-            {
-                sw_zval_ptr_dtor(&client->object);
-            }
-#if PHP_MAJOR_VERSION > 5
-            if (client->response.result_array)
-            {
-                efree(client->response.result_array);
-            }
-#endif
-            bzero(&client->response, sizeof(client->response));
-            return SW_OK;
+            return mysql_client_parse(client, 0 TSRMLS_CC);
         }
     }
     return SW_OK;
@@ -63,6 +63,7 @@ enum mysql_read_state
     SW_MYSQL_STATE_READ_START,
     SW_MYSQL_STATE_READ_FIELD,
     SW_MYSQL_STATE_READ_ROW,
+    SW_MYSQL_STATE_READ_PREPARE,
     SW_MYSQL_STATE_READ_END,
     SW_MYSQL_STATE_CLOSED,
 };
@@ -133,6 +134,15 @@ enum mysql_field_types
 #define SW_MYSQL_CLIENT_CONNECT_ATTRS            (1UL << 20)
 #define SW_MYSQL_CLIENT_SECURE_CONNECTION        32768
 
+#define SW_MYSQL_UNSIGNED_FLAG                   32
+
+enum mysql_statement_state
+{
+    SW_MYSQL_STMT_PREPARING,
+    SW_MYSQL_STMT_READY,
+    SW_MYSQL_STMT_ERROR,
+};
+
 typedef struct
 {
     int packet_length;
@@ -212,25 +222,76 @@ typedef union
     double mdouble;
 } mysql_row;
 
+typedef struct
+{
+    uint32_t id;
+    uint16_t num_params;
+    uint8_t state;
+    /**
+     * in the statement cache of the connection, or closed after the execution
+     */
+    uint8_t cached;
+    /**
+     * pending requests of the statement
+     */
+    uint32_t ref;
+    char *sql;
+    zend_size_t sql_len;
+} mysql_statement;
+
+typedef struct _mysql_pending_request
+{
+    uint8_t command;
+    /**
+     * the statement failed to prepare, it is not sent and has no response
+     */
+    uint8_t error;
+    mysql_statement *statement;
+    /**
+     * the packet waiting to be sent, or the params of the execution
+     */
+    swString *packet;
+    zval *params;
+    zval *callback;
+
+#if PHP_MAJOR_VERSION >= 7
+    zval _params;
+    zval _callback;
+#endif
+    struct _mysql_pending_request *next;
+} mysql_pending_request;
+
 typedef struct
 {
     uint8_t state;
     swString *buffer;
     swClient *cli;
     zval *object;
-    zval *callback;
     zval *onClose;
     int fd;
 
 #if PHP_MAJOR_VERSION >= 7
     zval _object;
-    zval _callback;
     zval _onClose;
 #endif
+    /**
+     * pipelined requests, the responses are matched in order
+     */
+    mysql_pending_request *request_head;
+    mysql_pending_request *request_tail;
+    mysql_pending_request *request_unsent;
+    uint32_t request_num;
+    /**
+     * prepared statements, sql => mysql_statement
+     */
+    swHashMap *statements;
+    uint32_t statement_num;
+
     struct
     {
         mysql_field *columns;
         uint16_t num_column;
+        uint16_t index;
         uint32_t num_row;
         uint8_t wait_recv;
         uint8_t response_type;
@@ -241,9 +302,14 @@ typedef struct
         uint16_t status_code;
         char status_msg[6];
         char *server_msg;
+        uint32_t server_msg_len;
         ulong_t affected_rows;
         ulong_t insert_id;
         zval *result_array;
+        //COM_STMT_PREPARE
+        uint32_t stmt_id;
+        uint16_t num_param;
+        uint32_t skip_packets;
     } response;
 
 } mysql_client;
@@ -267,6 +333,22 @@ typedef struct
                                     (((uint32_t) ((zend_uchar) (A)[6])) << 16) +\
                                     (((uint32_t) ((zend_uchar) (A)[7])) << 24))) << 32))
 
+#define mysql_int2store(T,A)  do { uint32_t __v = (uint32_t) (A);\
+                               *((zend_uchar*) (T)) = (zend_uchar) (__v);\
+                               *((zend_uchar*) (T) + 1) = (zend_uchar) (__v >> 8); } while (0)
+#define mysql_int3store(T,A)  do { uint32_t __v = (uint32_t) (A);\
+                               *((zend_uchar*) (T)) = (zend_uchar) (__v);\
+                               *((zend_uchar*) (T) + 1) = (zend_uchar) (__v >> 8);\
+                               *((zend_uchar*) (T) + 2) = (zend_uchar) (__v >> 16); } while (0)
+#define mysql_int4store(T,A)  do { uint32_t __v = (uint32_t) (A);\
+                               *((zend_uchar*) (T)) = (zend_uchar) (__v);\
+                               *((zend_uchar*) (T) + 1) = (zend_uchar) (__v >> 8);\
+                               *((zend_uchar*) (T) + 2) = (zend_uchar) (__v >> 16);\
+                               *((zend_uchar*) (T) + 3) = (zend_uchar) (__v >> 24); } while (0)
+#define mysql_int8store(T,A)  do { uint64_t __v8 = (uint64_t) (A);\
+                               mysql_int4store((T), (uint32_t) __v8);\
+                               mysql_int4store((T) + 4, (uint32_t) (__v8 >> 32)); } while (0)
+
 static sw_inline void mysql_pack_length(int length, char *buf)
 {
     buf[2] = length >> 16;
@@ -320,6 +402,36 @@ static sw_inline int mysql_lcb_ll(char *m, ulong_t *r, char *nul, int len)
     }
 }
 
+/**
+ * @return the bytes of the length coded binary
+ */
+static sw_inline int mysql_write_lcb(char *m, ulong_t length)
+{
+    if (length < 251)
+    {
+        m[0] = length;
+        return 1;
+    }
+    else if (length < 65536)
+    {
+        m[0] = (char) 252;
+        mysql_int2store(m + 1, length);
+        return 3;
+    }
+    else if (length < 16777216)
+    {
+        m[0] = (char) 253;
+        mysql_int3store(m + 1, length);
+        return 4;
+    }
+    else
+    {
+        m[0] = (char) 254;
+        mysql_int8store(m + 1, length);
+        return 9;
+    }
+}
+
 static sw_inline int mysql_length_coded_binary(char *m, ulong_t *r, char *nul, int len)
 {
     ulong_t val = 0;
@@ -652,131 +764,256 @@ static sw_inline int mysql_decode_row(mysql_client *client, char *buf, int packe
     return read_n;
 }
 
-static sw_inline int mysql_read_eof(mysql_client *client, char *buffer, int n_buf)
+/**
+ * fractional seconds of TIME/DATETIME/TIMESTAMP, the same digits as the text protocol
+ */
+static sw_inline int mysql_decode_microsecond(char *buf, uint32_t microsecond, uint32_t decimals)
 {
-    //EOF, length (3byte) + id(1byte) + 0xFE + warning(2byte) + status(2byte)
-    if (n_buf < 9)
-    {
-        client->response.wait_recv = 1;
-        return SW_ERR;
-    }
-
-    client->response.packet_length = mysql_uint3korr(buffer);
-    client->response.packet_number = buffer[3];
-
-    //not EOF packet
-    uint8_t eof = buffer[4];
-    if (eof != 0xfe)
+    if (decimals == 0 || decimals > 6)
     {
-        return SW_ERR;
+        return 0;
     }
-
-    client->response.warnings = mysql_uint2korr(buffer + 5);
-    client->response.status_code = mysql_uint2korr(buffer + 7);
-
-    return SW_OK;
+    sprintf(buf, ".%06u", microsecond);
+    buf[decimals + 1] = '\0';
+    return decimals + 1;
 }
 
-static sw_inline int mysql_read_columns(mysql_client *client)
+static sw_inline int mysql_decode_datetime(char *buf, int len, mysql_field *field, char *value)
 {
-    int i;
-    char *buffer = client->buffer->str + client->buffer->offset;
-    uint32_t n_buf = client->buffer->length - client->buffer->offset;
-    int ret;
+    int year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0;
+    uint32_t microsecond = 0;
+    int n;
 
-    for (i = client->response.packet_number - 1; i < client->response.num_column; i++)
+    if (len >= 4)
     {
-        client->response.packet_length = mysql_uint3korr(buffer);
-        client->response.packet_number = buffer[3];
-        buffer += 4;
-        n_buf -= 4;
-
-        //no enough data
-        if (n_buf < client->response.packet_length)
-        {
-            wait_recv: client->buffer->offset += buffer - (client->buffer->str + client->buffer->offset);
-            client->response.wait_recv = 1;
-            return SW_ERR;
-        }
-
-        ret = mysql_decode_field(buffer, client->response.packet_length, &client->response.columns[i]);
-        if (ret > 0)
-        {
-            buffer += client->response.packet_length;
-            n_buf -= client->response.packet_length;
-        }
-        else
-        {
-            break;
-        }
+        year = mysql_uint2korr(buf);
+        month = (uchar) buf[2];
+        day = (uchar) buf[3];
+    }
+    if (len >= 7)
+    {
+        hour = (uchar) buf[4];
+        minute = (uchar) buf[5];
+        second = (uchar) buf[6];
+    }
+    if (len >= 11)
+    {
+        microsecond = mysql_uint4korr(buf + 7);
     }
 
-    if (mysql_read_eof(client, buffer, n_buf) < 0)
+    if (field->type == SW_MYSQL_TYPE_DATE)
     {
-        goto wait_recv;
+        return sprintf(value, "%04d-%02d-%02d", year, month, day);
     }
+    n = sprintf(value, "%04d-%02d-%02d %02d:%02d:%02d", year, month, day, hour, minute, second);
+    return n + mysql_decode_microsecond(value + n, microsecond, field->decimals);
+}
 
-    buffer += 9;
-    n_buf -= 9;
+static sw_inline int mysql_decode_time(char *buf, int len, mysql_field *field, char *value)
+{
+    int negative = 0, hour = 0, minute = 0, second = 0;
+    uint32_t day = 0, microsecond = 0;
+    int n;
 
-    zval *result_array = client->response.result_array;
-    if (!result_array)
+    if (len >= 8)
     {
-        SW_ALLOC_INIT_ZVAL(result_array);
-        array_init(result_array);
-        client->response.result_array = result_array;
+        negative = buf[0];
+        day = mysql_uint4korr(buf + 1);
+        hour = (uchar) buf[5];
+        minute = (uchar) buf[6];
+        second = (uchar) buf[7];
+    }
+    if (len >= 12)
+    {
+        microsecond = mysql_uint4korr(buf + 8);
     }
-    client->buffer->offset += buffer - (client->buffer->str + client->buffer->offset);
 
-    return SW_OK;
+    n = sprintf(value, "%s%02u:%02d:%02d", negative ? "-" : "", day * 24 + hour, minute, second);
+    return n + mysql_decode_microsecond(value + n, microsecond, field->decimals);
 }
 
-static sw_inline int mysql_read_rows(mysql_client *client)
+/**
+ * binary protocol row of COM_STMT_EXECUTE: 0x00, NULL-bitmap (offset 2), values
+ */
+static sw_inline int mysql_decode_binary_row(mysql_client *client, char *buf, int packet_len)
 {
-    char *buffer = client->buffer->str + client->buffer->offset;
-    uint32_t n_buf = client->buffer->length - client->buffer->offset;
-    int ret;
+    int read_n = 1 + ((client->response.num_column + 9) >> 3);
+    int i, n, tmp_len;
+    ulong_t len;
+    char nul;
+    char *null_bitmap = buf + 1;
+    char value_buffer[64];
+    mysql_field *field;
+    mysql_row row;
 
-    //RecordSet parse
-    while (n_buf > 0)
+    if (read_n > packet_len)
     {
-        if (n_buf < 4)
-        {
-            client->response.wait_recv = 1;
-            return SW_ERR;
-        }
-        else if (n_buf == 9 && mysql_read_eof(client, buffer, n_buf) == 0)
-        {
-            return SW_OK;
-        }
+        return -SW_MYSQL_ERR_LEN_OVER_BUFFER;
+    }
 
-        client->response.packet_length = mysql_uint3korr(buffer);
-        client->response.packet_number = buffer[3];
-        buffer += 4;
-        n_buf -= 4;
+    zval *result_array = client->response.result_array;
+    zval *row_array = NULL;
+    SW_ALLOC_INIT_ZVAL(row_array);
+    array_init(row_array);
 
-        //no enough data
-        if (n_buf < client->response.packet_length)
+    for (i = 0; i < client->response.num_column; i++)
+    {
+        field = &client->response.columns[i];
+        if (null_bitmap[(i + 2) >> 3] & (1 << ((i + 2) & 7)))
         {
-            client->response.wait_recv = 1;
-            return SW_ERR;
+            add_assoc_null(row_array, field->name);
+            continue;
         }
 
-        //decode
-        ret = mysql_decode_row(client, buffer, client->response.packet_length);
-        if (ret < 0)
+        switch (field->type)
         {
+        case SW_MYSQL_TYPE_NULL:
+            add_assoc_null(row_array, field->name);
+            break;
+        /* Integer */
+        case SW_MYSQL_TYPE_TINY:
+            if (read_n + 1 > packet_len)
+            {
+                goto error;
+            }
+            if (field->flags & SW_MYSQL_UNSIGNED_FLAG)
+            {
+                add_assoc_long(row_array, field->name, (uchar) buf[read_n]);
+            }
+            else
+            {
+                add_assoc_long(row_array, field->name, (signed char) buf[read_n]);
+            }
+            read_n += 1;
+            break;
+        case SW_MYSQL_TYPE_SHORT:
+        case SW_MYSQL_TYPE_YEAR:
+            if (read_n + 2 > packet_len)
+            {
+                goto error;
+            }
+            row.small = mysql_uint2korr(buf + read_n);
+            if (field->flags & SW_MYSQL_UNSIGNED_FLAG)
+            {
+                add_assoc_long(row_array, field->name, row.small);
+            }
+            else
+            {
+                add_assoc_long(row_array, field->name, (short) row.small);
+            }
+            read_n += 2;
+            break;
+        case SW_MYSQL_TYPE_INT24:
+        case SW_MYSQL_TYPE_LONG:
+            if (read_n + 4 > packet_len)
+            {
+                goto error;
+            }
+            row.uint = mysql_uint4korr(buf + read_n);
+            if (field->flags & SW_MYSQL_UNSIGNED_FLAG)
+            {
+                add_assoc_long(row_array, field->name, row.uint);
+            }
+            else
+            {
+                add_assoc_long(row_array, field->name, (int32_t) row.uint);
+            }
+            read_n += 4;
+            break;
+        case SW_MYSQL_TYPE_LONGLONG:
+            if (read_n + 8 > packet_len)
+            {
+                goto error;
+            }
+            row.ubigint = mysql_uint8korr(buf + read_n);
+            //out of the range of PHP integer
+            if ((field->flags & SW_MYSQL_UNSIGNED_FLAG) && row.ubigint > LONG_MAX)
+            {
+                n = sprintf(value_buffer, "%llu", row.ubigint);
+                sw_add_assoc_stringl(row_array, field->name, value_buffer, n, 1);
+            }
+            else
+            {
+                add_assoc_long(row_array, field->name, (long) row.ubigint);
+            }
+            read_n += 8;
+            break;
+        case SW_MYSQL_TYPE_FLOAT:
+            if (read_n + 4 > packet_len)
+            {
+                goto error;
+            }
+            memcpy(&row.mfloat, buf + read_n, 4);
+            add_assoc_double(row_array, field->name, row.mfloat);
+            read_n += 4;
+            break;
+        case SW_MYSQL_TYPE_DOUBLE:
+            if (read_n + 8 > packet_len)
+            {
+                goto error;
+            }
+            memcpy(&row.mdouble, buf + read_n, 8);
+            add_assoc_double(row_array, field->name, row.mdouble);
+            read_n += 8;
+            break;
+        /* Date Time */
+        case SW_MYSQL_TYPE_DATE:
+        case SW_MYSQL_TYPE_DATETIME:
+        case SW_MYSQL_TYPE_TIMESTAMP:
+        case SW_MYSQL_TYPE_TIME:
+            if (read_n + 1 > packet_len)
+            {
+                goto error;
+            }
+            len = (uchar) buf[read_n];
+            read_n += 1;
+            if (read_n + len > packet_len)
+            {
+                goto error;
+            }
+            if (field->type == SW_MYSQL_TYPE_TIME)
+            {
+                n = mysql_decode_time(buf + read_n, len, field, value_buffer);
+            }
+            else
+            {
+                n = mysql_decode_datetime(buf + read_n, len, field, value_buffer);
+            }
+            sw_add_assoc_stringl(row_array, field->name, value_buffer, n, 1);
+            read_n += len;
+            break;
+        /* String */
+        default:
+            tmp_len = mysql_length_coded_binary(&buf[read_n], &len, &nul, packet_len - read_n);
+            if (tmp_len == -1)
+            {
+                goto error;
+            }
+            read_n += tmp_len;
+            if (read_n + len > packet_len)
+            {
+                goto error;
+            }
+            sw_add_assoc_stringl(row_array, field->name, buf + read_n, len, 1);
+            read_n += len;
             break;
         }
-
-        //next row
-        client->response.num_row++;
-        buffer += client->response.packet_length;
-        n_buf -= client->response.packet_length;
-        client->buffer->offset += client->response.packet_length + 4;
     }
 
-    return SW_ERR;
+    add_next_index_zval(result_array, row_array);
+
+#if PHP_MAJOR_VERSION > 5
+    efree(row_array);
+#endif
+
+    return read_n;
+
+    error:
+    sw_zval_ptr_dtor(&row_array);
+#if PHP_MAJOR_VERSION > 5
+    efree(row_array);
+#endif
+    return -SW_MYSQL_ERR_LEN_OVER_BUFFER;
 }
 
 #endif /* SWOOLE_MYSQL_H_ */
@@ -41,6 +41,12 @@ typedef struct
     zval _message_callback;
 #endif
 
+    /**
+     * called instead of connect_callback, set by php_swoole_redis_connect()
+     */
+    php_swoole_redis_connect_callback connect_handler;
+    void *connect_data;
+
     zval *object;
     zval _object;
 } swRedisClient;
@@ -136,19 +142,25 @@ void swoole_redis_init(int module_number TSRMLS_DC)
     swoole_redis_class_entry_ptr = zend_register_internal_class(&swoole_redis_ce TSRMLS_CC);
 }
 
-static PHP_METHOD(swoole_redis, __construct)
+static swRedisClient* swoole_redis_create(zval *zobject)
 {
     swRedisClient *redis = emalloc(sizeof(swRedisClient));
     bzero(redis, sizeof(swRedisClient));
 
 #if PHP_MAJOR_VERSION < 7
-    redis->object = getThis();
+    redis->object = zobject;
 #else
     redis->object = &redis->_object;
-    memcpy(redis->object, getThis(), sizeof(zval));
+    memcpy(redis->object, zobject, sizeof(zval));
 #endif
 
-    swoole_set_object(getThis(), redis);
+    swoole_set_object(zobject, redis);
+    return redis;
+}
+
+static PHP_METHOD(swoole_redis, __construct)
+{
+    swoole_redis_create(getThis());
 }
 
 static PHP_METHOD(swoole_redis, on)
@@ -191,36 +203,14 @@ static PHP_METHOD(swoole_redis, on)
     RETURN_TRUE;
 }
 
-static PHP_METHOD(swoole_redis, connect)
+static int swoole_redis_connect(swRedisClient *redis, char *host, int port TSRMLS_DC)
 {
-    char *host;
-    zend_size_t host_len;
-    long port;
-    zval *callback;
-
-    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "slz", &host, &host_len, &port, &callback) == FAILURE)
-    {
-        RETURN_FALSE;
-    }
-
-    if (host_len <= 0)
-    {
-        swoole_php_error(E_WARNING, "host is empty.");
-        RETURN_FALSE;
-    }
-
-    if (port <= 1 || port > 65535)
-    {
-        swoole_php_error(E_WARNING, "port is invalid.");
-        RETURN_FALSE;
-    }
-
-    swRedisClient *redis = swoole_get_object(getThis());
-    redisAsyncContext *context = redisAsyncConnect(host, (int) port);
+    redisAsyncContext *context = redisAsyncConnect(host, port);
     if (context->err)
     {
-        swoole_php_error(E_WARNING, "connect to redis-server[%s:%d] failed, Erorr: %s[%d]", host, (int) port, context->errstr, context->err);
-        RETURN_FALSE;
+        swoole_php_error(E_WARNING, "connect to redis-server[%s:%d] failed, Erorr: %s[%d]", host, port, context->errstr, context->err);
+        redisAsyncFree(context);
+        return SW_ERR;
     }
 
     php_swoole_check_reactor();
@@ -235,10 +225,6 @@ static PHP_METHOD(swoole_redis, connect)
     redisAsyncSetConnectCallback(context, swoole_redis_onConnect);
     redisAsyncSetDisconnectCallback(context, swoole_redis_onClose);
 
-    zend_update_property(swoole_redis_class_entry_ptr, getThis(), ZEND_STRL("onConnect"), callback TSRMLS_CC);
-    redis->connect_callback = sw_zend_read_property(swoole_redis_class_entry_ptr, getThis(), ZEND_STRL("onConnect"), 0 TSRMLS_CC);
-    sw_copy_to_stack(redis->connect_callback, redis->_connect_callback);
-
     redis->context = context;
     context->ev.addRead = swoole_redis_event_AddRead;
     context->ev.delRead = swoole_redis_event_DelRead;
@@ -247,25 +233,81 @@ static PHP_METHOD(swoole_redis, connect)
     context->ev.cleanup = swoole_redis_event_Cleanup;
     context->ev.data = redis;
 
-    zend_update_property_string(swoole_redis_class_entry_ptr, getThis(), ZEND_STRL("host"), host TSRMLS_CC);
-    zend_update_property_long(swoole_redis_class_entry_ptr, getThis(), ZEND_STRL("port"), port TSRMLS_CC);
+    zend_update_property_string(swoole_redis_class_entry_ptr, redis->object, ZEND_STRL("host"), host TSRMLS_CC);
+    zend_update_property_long(swoole_redis_class_entry_ptr, redis->object, ZEND_STRL("port"), port TSRMLS_CC);
 
     if (SwooleG.main_reactor->add(SwooleG.main_reactor, redis->context->c.fd, PHP_SWOOLE_FD_REDIS | SW_EVENT_WRITE) < 0)
     {
         swoole_php_fatal_error(E_WARNING, "swoole_event_add failed. Erorr: %s[%d].", redis->context->errstr, redis->context->err);
-        RETURN_FALSE;
+        return SW_ERR;
     }
 
     sw_zval_add_ref(&redis->object);
 
     swConnection *conn = swReactor_get(SwooleG.main_reactor, redis->context->c.fd);
     conn->object = redis;
+    return SW_OK;
+}
+
+static PHP_METHOD(swoole_redis, connect)
+{
+    char *host;
+    zend_size_t host_len;
+    long port;
+    zval *callback;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "slz", &host, &host_len, &port, &callback) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+
+    if (host_len <= 0)
+    {
+        swoole_php_error(E_WARNING, "host is empty.");
+        RETURN_FALSE;
+    }
+
+    if (port <= 1 || port > 65535)
+    {
+        swoole_php_error(E_WARNING, "port is invalid.");
+        RETURN_FALSE;
+    }
+
+    swRedisClient *redis = swoole_get_object(getThis());
+
+    zend_update_property(swoole_redis_class_entry_ptr, getThis(), ZEND_STRL("onConnect"), callback TSRMLS_CC);
+    redis->connect_callback = sw_zend_read_property(swoole_redis_class_entry_ptr, getThis(), ZEND_STRL("onConnect"), 0 TSRMLS_CC);
+    sw_copy_to_stack(redis->connect_callback, redis->_connect_callback);
+
+    if (swoole_redis_connect(redis, host, (int) port TSRMLS_CC) < 0)
+    {
+        redis->connect_callback = NULL;
+        RETURN_FALSE;
+    }
+}
+
+/**
+ * create a swoole_redis object in zobject and connect it, used by swoole_connpool
+ */
+int php_swoole_redis_connect(zval *zobject, char *host, int port, php_swoole_redis_connect_callback callback, void *data TSRMLS_DC)
+{
+    object_init_ex(zobject, swoole_redis_class_entry_ptr);
+    swRedisClient *redis = swoole_redis_create(zobject);
+    redis->connect_handler = callback;
+    redis->connect_data = data;
+    return swoole_redis_connect(redis, host, port TSRMLS_CC);
+}
+
+int php_swoole_redis_is_ready(zval *zobject)
+{
+    swRedisClient *redis = swoole_get_object(zobject);
+    return redis && redis->state == SWOOLE_REDIS_STATE_READY;
 }
 
 static PHP_METHOD(swoole_redis, close)
 {
     swRedisClient *redis = swoole_get_object(getThis());
-    if (redis->state != SWOOLE_REDIS_STATE_CLOSED)
+    if (redis->context && redis->state != SWOOLE_REDIS_STATE_CLOSED)
     {
         redisAsyncDisconnect(redis->context);
     }
@@ -278,7 +320,7 @@ static PHP_METHOD(swoole_redis, __destruct)
     {
         return;
     }
-    if (redis->state != SWOOLE_REDIS_STATE_CLOSED)
+    if (redis->context && redis->state != SWOOLE_REDIS_STATE_CLOSED)
     {
         redisAsyncDisconnect(redis->context);
     }
@@ -555,6 +597,13 @@ static void swoole_redis_onResult(redisAsyncContext *c, void *r, void *privdata)
 #endif
 }
 
+static void swoole_redis_connect_handler(swRedisClient *redis, int success)
+{
+    php_swoole_redis_connect_callback handler = redis->connect_handler;
+    redis->connect_handler = NULL;
+    handler(redis->object, success, redis->connect_data);
+}
+
 void swoole_redis_onConnect(const redisAsyncContext *c, int status)
 {
 #if PHP_MAJOR_VERSION < 7
@@ -577,6 +626,13 @@ void swoole_redis_onConnect(const redisAsyncContext *c, int status)
         redis->state = SWOOLE_REDIS_STATE_READY;
     }
 
+    if (redis->connect_handler)
+    {
+        sw_zval_ptr_dtor(&result);
+        swoole_redis_connect_handler(redis, status == REDIS_OK);
+        return;
+    }
+
     zval **args[2];
     zval *callback = redis->connect_callback;
     args[0] = &redis->object;
@@ -624,7 +680,13 @@ void swoole_redis_onClose(const redisAsyncContext *c, int status)
 static int swoole_redis_onError(swReactor *reactor, swEvent *event)
 {
     swRedisClient *redis = event->socket->object;
-    if (redis->connect_callback)
+    if (redis->connect_handler)
+    {
+        redis->state = SWOOLE_REDIS_STATE_CLOSED;
+        swoole_redis_event_Cleanup(redis);
+        swoole_redis_connect_handler(redis, 0);
+    }
+    else if (redis->connect_callback)
     {
 #if PHP_MAJOR_VERSION < 7
         TSRMLS_FETCH_FROM_CTX(sw_thread_ctx ? sw_thread_ctx : NULL);
@@ -201,7 +201,7 @@ static zval* php_swoole_get_task_result(swEventData *task_result TSRMLS_DC)
     /**
      * Large result package
      */
-    if (swTask_type(task_result) & SW_TASK_TMPFILE)
+    if (swTask_is_large(task_result))
     {
         swTaskWorker_large_unpack(task_result, emalloc, data_str, data_len);
         /**
@@ -454,7 +454,7 @@ static void php_swoole_onPipeMessage(swServer *serv, swEventData *req)
 
     ZVAL_LONG(zworker_id, (long) req->info.from_id);
 
-    if (swTask_type(req) & SW_TASK_TMPFILE)
+    if (swTask_is_large(req))
     {
         int data_len;
         char *buf = NULL;
@@ -705,7 +705,7 @@ static int php_swoole_onTask(swServer *serv, swEventData *req)
 
     SW_MAKE_STD_ZVAL(zdata);
 
-    if (swTask_type(req) & SW_TASK_TMPFILE)
+    if (swTask_is_large(req))
     {
         int data_len;
         char *buf = NULL;
@@ -1469,6 +1469,14 @@ PHP_METHOD(swoole_server, set)
         SwooleG.task_tmpdir = strndup(SW_TASK_TMP_FILE, sizeof (SW_TASK_TMP_FILE));
         SwooleG.task_tmpdir_len = sizeof (SW_TASK_TMP_FILE);
     }
+    /**
+     * shared memory for large task payloads, 0 to always use task_tmpdir
+     */
+    if (php_swoole_array_get_value(vht, "task_arena_size", v))
+    {
+        convert_to_long(v);
+        SwooleG.task_arena_size = (size_t) Z_LVAL_P(v);
+    }
     //task_max_request
     if (php_swoole_array_get_value(vht, "task_max_request", v))
     {
@@ -1579,6 +1587,51 @@ PHP_METHOD(swoole_server, set)
         convert_to_long(v);
         serv->pipe_buffer_size = (int) Z_LVAL_P(v);
     }
+    /**
+     * stats in Prometheus text format
+     */
+    if (php_swoole_array_get_value(vht, "stats_port", v))
+    {
+        convert_to_long(v);
+        serv->stats_port = (int) Z_LVAL_P(v);
+    }
+    if (php_swoole_array_get_value(vht, "stats_host", v))
+    {
+        convert_to_string(v);
+        serv->stats_host = strndup(Z_STRVAL_P(v), Z_STRLEN_P(v));
+    }
+    /**
+     * reactor <-> worker transport
+     */
+    if (php_swoole_array_get_value(vht, "ipc_mode", v))
+    {
+        convert_to_long(v);
+        serv->ipc_mode = (int) Z_LVAL_P(v);
+        if (serv->ipc_mode != SW_IPC_UNSOCK && serv->ipc_mode != SW_IPC_RING)
+        {
+            swoole_php_fatal_error(E_WARNING, "ipc_mode must be SWOOLE_IPC_UNSOCK or SWOOLE_IPC_RING.");
+            serv->ipc_mode = SW_IPC_UNSOCK;
+        }
+    }
+    if (php_swoole_array_get_value(vht, "ipc_ring_size", v))
+    {
+        convert_to_long(v);
+        serv->ipc_ring_size = (int) Z_LVAL_P(v);
+    }
+    /**
+     * accept in the reactor threads with SO_REUSEPORT
+     */
+    if (php_swoole_array_get_value(vht, "reactor_accept", v))
+    {
+        convert_to_boolean(v);
+        serv->reactor_accept = Z_BVAL_P(v);
+    }
+    //steer the new connections to the reactor thread running on the same cpu
+    if (php_swoole_array_get_value(vht, "reactor_accept_cbpf", v))
+    {
+        convert_to_boolean(v);
+        serv->reactor_accept_cbpf = Z_BVAL_P(v);
+    }
     //message queue key
     if (php_swoole_array_get_value(vht, "message_queue_key", v))
     {
@@ -2040,6 +2093,24 @@ PHP_METHOD(swoole_server, close)
     SW_CHECK_RETURN(serv->factory.end(&serv->factory, Z_LVAL_P(zfd)));
 }
 
+/**
+ * usec, the percentiles are approximate
+ */
+static void php_swoole_stats_histogram(zval *zarray, char *name, swHistogram *hist)
+{
+    zval *item;
+    SW_MAKE_STD_ZVAL(item);
+    array_init(item);
+    sw_add_assoc_long_ex(item, ZEND_STRS("count"), hist->count);
+    sw_add_assoc_long_ex(item, ZEND_STRS("avg"), hist->count > 0 ? hist->sum / hist->count : 0);
+    sw_add_assoc_long_ex(item, ZEND_STRS("p50"), swHistogram_percentile(hist, 50));
+    sw_add_assoc_long_ex(item, ZEND_STRS("p90"), swHistogram_percentile(hist, 90));
+    sw_add_assoc_long_ex(item, ZEND_STRS("p99"), swHistogram_percentile(hist, 99));
+    sw_add_assoc_long_ex(item, ZEND_STRS("p999"), swHistogram_percentile(hist, 99.9));
+    sw_add_assoc_long_ex(item, ZEND_STRS("max"), hist->max);
+    add_assoc_zval(zarray, name, item);
+}
+
 PHP_METHOD(swoole_server, stats)
 {
     if (SwooleGS->start == 0)
@@ -2057,6 +2128,58 @@ PHP_METHOD(swoole_server, stats)
     sw_add_assoc_long_ex(return_value, ZEND_STRS("request_count"), SwooleStats->request_count);
     sw_add_assoc_long_ex(return_value, ZEND_STRS("worker_request_count"), SwooleWG.request_count);
 
+    swServer *serv = SwooleG.serv;
+    if (serv->factory_mode == SW_MODE_PROCESS)
+    {
+        int i;
+        zval *workers;
+        zval *item;
+        SW_MAKE_STD_ZVAL(workers);
+        array_init(workers);
+        for (i = 0; i < serv->worker_num; i++)
+        {
+            SW_MAKE_STD_ZVAL(item);
+            array_init(item);
+            sw_add_assoc_long_ex(item, ZEND_STRS("request_count"), serv->workers[i].request_count);
+            sw_add_assoc_long_ex(item, ZEND_STRS("dispatch_count"), (int32_t) serv->workers[i].dispatch_count);
+            sw_add_assoc_long_ex(item, ZEND_STRS("pipe_buffer_length"), swServer_get_worker_stats(serv, i)->pipe_buffer_length);
+            php_swoole_stats_histogram(item, "latency", &swServer_get_worker_stats(serv, i)->request_latency);
+            php_swoole_stats_histogram(item, "task_wait", &swServer_get_worker_stats(serv, i)->task_wait);
+            add_next_index_zval(workers, item);
+        }
+        add_assoc_zval(return_value, "workers", workers);
+    }
+
+    if (SwooleG.task_worker_num > 0)
+    {
+        int i;
+        zval *task_workers;
+        zval *item;
+        SW_MAKE_STD_ZVAL(task_workers);
+        array_init(task_workers);
+        for (i = serv->worker_num; i < serv->worker_num + SwooleG.task_worker_num; i++)
+        {
+            SW_MAKE_STD_ZVAL(item);
+            array_init(item);
+            php_swoole_stats_histogram(item, "latency", &swServer_get_worker_stats(serv, i)->request_latency);
+            add_next_index_zval(task_workers, item);
+        }
+        add_assoc_zval(return_value, "task_workers", task_workers);
+    }
+
+    int reactor_num = serv->factory_mode == SW_MODE_PROCESS ? serv->reactor_num : 1;
+    uint64_t buffer_pool_hit = 0, buffer_pool_miss = 0, overflow_count = 0;
+    int i;
+    for (i = 0; i < reactor_num; i++)
+    {
+        buffer_pool_hit += serv->reactor_threads[i].buffer_pool.hit;
+        buffer_pool_miss += serv->reactor_threads[i].buffer_pool.miss;
+        overflow_count += serv->reactor_threads[i].overflow_count;
+    }
+    sw_add_assoc_long_ex(return_value, ZEND_STRS("buffer_pool_hit"), buffer_pool_hit);
+    sw_add_assoc_long_ex(return_value, ZEND_STRS("buffer_pool_miss"), buffer_pool_miss);
+    sw_add_assoc_long_ex(return_value, ZEND_STRS("output_overflow_count"), overflow_count);
+
     if (SwooleG.task_ipc_mode > SW_IPC_UNSOCK && SwooleGS->task_workers.queue)
     {
         int queue_num = -1;
@@ -2184,9 +2307,16 @@ PHP_METHOD(swoole_server, taskwait)
     buf.info.from_id = SwooleWG.id;
     swTask_type(&buf) = 0;
 
-    //clear result buffer
+    //clear result buffer, the result of a timed out taskwait may still hold a large package
+    swWorker *worker = swServer_get_worker(SwooleG.serv, SwooleWG.id);
     swEventData *task_result = &(SwooleG.task_result[SwooleWG.id]);
+    worker->lock.lock(&worker->lock);
+    if (swTask_is_large(task_result))
+    {
+        swTaskWorker_large_free(task_result);
+    }
     bzero(task_result, sizeof(SwooleG.task_result[SwooleWG.id]));
+    worker->lock.unlock(&worker->lock);
 
     uint64_t notify;
 
@@ -2235,14 +2365,20 @@ PHP_METHOD(swoole_server, taskwait)
     //clear history task
     while (read(efd, &notify, sizeof(notify)) > 0);
 
+    uint64_t start_usec = swoole_monotonic_usec();
     if (swProcessPool_dispatch_blocking(&SwooleGS->task_workers, &buf, (int*) &dst_worker_id) >= 0)
     {
         task_notify_pipe->timeout = timeout;
         sw_atomic_fetch_add(&SwooleStats->tasking_num, 1);
         int ret = task_notify_pipe->read(task_notify_pipe, &notify, sizeof(notify));
+        swHistogram_record(&swServer_get_worker_stats(SwooleG.serv, SwooleWG.id)->task_wait, swoole_monotonic_usec() - start_usec);
         if (ret > 0)
         {
+            worker->lock.lock(&worker->lock);
             zval *task_notify_data = php_swoole_get_task_result(task_result TSRMLS_CC);
+            //unpacked, the large package is released
+            swTask_type(task_result) = 0;
+            worker->lock.unlock(&worker->lock);
             RETURN_ZVAL(task_notify_data, 0, 0);
         }
         else
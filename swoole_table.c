@@ -31,6 +31,7 @@ ZEND_END_ARG_INFO()
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_table_construct, 0, 0, 1)
     ZEND_ARG_INFO(0, table_size)
+    ZEND_ARG_INFO(0, max_size)
 ZEND_END_ARG_INFO()
 
 ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_table_column, 0, 0, 1)
@@ -39,6 +40,18 @@ ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_table_column, 0, 0, 1)
     ZEND_ARG_INFO(0, size)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_table_index, 0, 0, 2)
+    ZEND_ARG_INFO(0, column)
+    ZEND_ARG_INFO(0, type)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_table_find, 0, 0, 3)
+    ZEND_ARG_INFO(0, column)
+    ZEND_ARG_INFO(0, operator)
+    ZEND_ARG_INFO(0, value)
+    ZEND_ARG_INFO(0, limit)
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_table_set, 0, 0, 2)
     ZEND_ARG_INFO(0, key)
     ZEND_ARG_INFO(0, value)
@@ -64,15 +77,33 @@ ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_table_decr, 0, 0, 2)
     ZEND_ARG_INFO(0, decrby)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_table_cas, 0, 0, 4)
+    ZEND_ARG_INFO(0, key)
+    ZEND_ARG_INFO(0, column)
+    ZEND_ARG_INFO(0, cmp_value)
+    ZEND_ARG_INFO(0, set_value)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_table_minmax, 0, 0, 3)
+    ZEND_ARG_INFO(0, key)
+    ZEND_ARG_INFO(0, column)
+    ZEND_ARG_INFO(0, value)
+ZEND_END_ARG_INFO()
+
 static PHP_METHOD(swoole_table, __construct);
 static PHP_METHOD(swoole_table, column);
+static PHP_METHOD(swoole_table, index);
 static PHP_METHOD(swoole_table, create);
 static PHP_METHOD(swoole_table, set);
 static PHP_METHOD(swoole_table, get);
 static PHP_METHOD(swoole_table, del);
 static PHP_METHOD(swoole_table, exist);
+static PHP_METHOD(swoole_table, find);
 static PHP_METHOD(swoole_table, incr);
 static PHP_METHOD(swoole_table, decr);
+static PHP_METHOD(swoole_table, cas);
+static PHP_METHOD(swoole_table, min);
+static PHP_METHOD(swoole_table, max);
 static PHP_METHOD(swoole_table, lock);
 static PHP_METHOD(swoole_table, unlock);
 static PHP_METHOD(swoole_table, count);
@@ -90,6 +121,7 @@ static const zend_function_entry swoole_table_methods[] =
 {
     PHP_ME(swoole_table, __construct, arginfo_swoole_table_construct, ZEND_ACC_PUBLIC | ZEND_ACC_CTOR)
     PHP_ME(swoole_table, column,      arginfo_swoole_table_column, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_table, index,       arginfo_swoole_table_index, ZEND_ACC_PUBLIC)
     PHP_ME(swoole_table, create,      arginfo_swoole_table_void, ZEND_ACC_PUBLIC)
     PHP_ME(swoole_table, destroy,     arginfo_swoole_table_void, ZEND_ACC_PUBLIC)
     PHP_ME(swoole_table, set,         arginfo_swoole_table_set, ZEND_ACC_PUBLIC)
@@ -97,8 +129,12 @@ static const zend_function_entry swoole_table_methods[] =
     PHP_ME(swoole_table, count,       arginfo_swoole_table_void, ZEND_ACC_PUBLIC)
     PHP_ME(swoole_table, del,         arginfo_swoole_table_del, ZEND_ACC_PUBLIC)
     PHP_ME(swoole_table, exist,       arginfo_swoole_table_get, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_table, find,        arginfo_swoole_table_find, ZEND_ACC_PUBLIC)
     PHP_ME(swoole_table, incr,        arginfo_swoole_table_incr, ZEND_ACC_PUBLIC)
     PHP_ME(swoole_table, decr,        arginfo_swoole_table_decr, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_table, cas,         arginfo_swoole_table_cas, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_table, min,         arginfo_swoole_table_minmax, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_table, max,         arginfo_swoole_table_minmax, ZEND_ACC_PUBLIC)
     PHP_ME(swoole_table, lock,        arginfo_swoole_table_void, ZEND_ACC_PUBLIC)
     PHP_ME(swoole_table, unlock,      arginfo_swoole_table_void, ZEND_ACC_PUBLIC)
 #ifdef HAVE_PCRE
@@ -175,6 +211,17 @@ void swoole_table_init(int module_number TSRMLS_DC)
     zend_declare_class_constant_long(swoole_table_class_entry_ptr, SW_STRL("TYPE_INT")-1, SW_TABLE_INT TSRMLS_CC);
     zend_declare_class_constant_long(swoole_table_class_entry_ptr, SW_STRL("TYPE_STRING")-1, SW_TABLE_STRING TSRMLS_CC);
     zend_declare_class_constant_long(swoole_table_class_entry_ptr, SW_STRL("TYPE_FLOAT")-1, SW_TABLE_FLOAT TSRMLS_CC);
+
+    zend_declare_class_constant_long(swoole_table_class_entry_ptr, SW_STRL("INDEX_HASH")-1, SW_TABLE_INDEX_HASH TSRMLS_CC);
+    zend_declare_class_constant_long(swoole_table_class_entry_ptr, SW_STRL("INDEX_ORDERED")-1, SW_TABLE_INDEX_ORDERED TSRMLS_CC);
+
+    zend_declare_class_constant_long(swoole_table_class_entry_ptr, SW_STRL("FIND_EQ")-1, SW_TABLE_FIND_EQ TSRMLS_CC);
+    zend_declare_class_constant_long(swoole_table_class_entry_ptr, SW_STRL("FIND_NEQ")-1, SW_TABLE_FIND_NEQ TSRMLS_CC);
+    zend_declare_class_constant_long(swoole_table_class_entry_ptr, SW_STRL("FIND_GT")-1, SW_TABLE_FIND_GT TSRMLS_CC);
+    zend_declare_class_constant_long(swoole_table_class_entry_ptr, SW_STRL("FIND_LT")-1, SW_TABLE_FIND_LT TSRMLS_CC);
+    zend_declare_class_constant_long(swoole_table_class_entry_ptr, SW_STRL("FIND_LEFTLIKE")-1, SW_TABLE_FIND_LEFTLIKE TSRMLS_CC);
+    zend_declare_class_constant_long(swoole_table_class_entry_ptr, SW_STRL("FIND_RIGHTLIKE")-1, SW_TABLE_FIND_RIGHTLIKE TSRMLS_CC);
+    zend_declare_class_constant_long(swoole_table_class_entry_ptr, SW_STRL("FIND_LIKE")-1, SW_TABLE_FIND_LIKE TSRMLS_CC);
 }
 
 void swoole_table_column_free(swTableColumn *col)
@@ -185,17 +232,18 @@ void swoole_table_column_free(swTableColumn *col)
 PHP_METHOD(swoole_table, __construct)
 {
     long table_size;
+    long max_size = 0;
 
-    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "l", &table_size) == FAILURE)
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "l|l", &table_size, &max_size) == FAILURE)
     {
         RETURN_FALSE;
     }
-    if (table_size < 1)
+    if (table_size < 1 || max_size < 0)
     {
         RETURN_FALSE;
     }
 
-    swTable *table = swTable_new(table_size);
+    swTable *table = swTable_new(table_size, max_size);
     swoole_set_object(getThis(), table);
 }
 
@@ -225,6 +273,20 @@ PHP_METHOD(swoole_table, column)
     RETURN_TRUE;
 }
 
+static PHP_METHOD(swoole_table, index)
+{
+    char *name;
+    zend_size_t len;
+    long type;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "sl", &name, &len, &type) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+    swTable *table = swoole_get_object(getThis());
+    SW_CHECK_RETURN(swTableColumn_add_index(table, name, len, type));
+}
+
 static PHP_METHOD(swoole_table, create)
 {
     swTable *table = swoole_get_object(getThis());
@@ -255,11 +317,9 @@ static PHP_METHOD(swoole_table, set)
     }
 
     swTable *table = swoole_get_object(getThis());
-    sw_atomic_t *_lock = NULL;
-    swTableRow *row = swTableRow_set(table, key, keylen, &_lock);
+    swTableRow *row = swTableRow_set(table, key, keylen);
     if (!row)
     {
-        sw_spinlock_release(_lock);
         swoole_php_error(E_WARNING, "Unable to allocate memory.");
         RETURN_FALSE;
     }
@@ -295,80 +355,122 @@ static PHP_METHOD(swoole_table, set)
         }
     }
     SW_HASHTABLE_FOREACH_END();
-    sw_spinlock_release(_lock);
+    swTableRow_commit(table, row);
     RETURN_TRUE;
 }
 
-static PHP_METHOD(swoole_table, incr)
+/**
+ * value == NULL means 1, sign is -1 for decr
+ */
+static void php_swoole_table_atomic(zval *object, char *key, int key_len, char *col, int col_len, int op, int sign,
+        zval *value, zval *compare, zval *return_value TSRMLS_DC)
 {
-    char *key;
-    zend_size_t key_len;
-    char *col;
-    zend_size_t col_len;
-    zval* incrby = NULL;
+    swTable *table = swoole_get_object(object);
+    swTableColumn *column = swTableColumn_get(table, col, col_len);
+    swTable_number _value, _compare, result;
 
-    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "ss|z", &key, &key_len, &col, &col_len, &incrby) == FAILURE)
-    {
-        RETURN_FALSE;
-    }
-
-    sw_atomic_t *_lock = NULL;
-    swTable *table = swoole_get_object(getThis());
-    swTableRow *row = swTableRow_set(table, key, key_len, &_lock);
-    if (!row)
-    {
-        sw_spinlock_release(_lock);
-        swoole_php_fatal_error(E_WARNING, "Unable to allocate memory.");
-        RETURN_FALSE;
-    }
-
-    swTableColumn *column;
-    column = swTableColumn_get(table, col, col_len);
     if (column == NULL)
     {
-        sw_spinlock_release(_lock);
         swoole_php_fatal_error(E_WARNING, "column[%s] not exist.", col);
         RETURN_FALSE;
     }
     else if (column->type == SW_TABLE_STRING)
     {
-        sw_spinlock_release(_lock);
-        swoole_php_fatal_error(E_WARNING, "cannot use incr with string column.");
+        swoole_php_fatal_error(E_WARNING, "cannot use atomic operation with string column.");
         RETURN_FALSE;
     }
-    else if (column->type == SW_TABLE_FLOAT)
+
+    if (column->type == SW_TABLE_FLOAT)
     {
-        double set_value = 0;
-        memcpy(&set_value, row->data + column->index, sizeof(set_value));
-        if (incrby)
+        if (value)
         {
-            convert_to_double(incrby);
-            set_value += Z_DVAL_P(incrby);
+            convert_to_double(value);
+            _value.dval = Z_DVAL_P(value) * sign;
         }
         else
         {
-            set_value += 1;
+            _value.dval = sign;
+        }
+        if (compare)
+        {
+            convert_to_double(compare);
+            _compare.dval = Z_DVAL_P(compare);
         }
-        swTableRow_set_value(row, column, &set_value, 0);
-        RETVAL_DOUBLE(set_value);
     }
     else
     {
-        uint64_t set_value = 0;
-        memcpy(&set_value, row->data + column->index, column->size);
-        if (incrby)
+        if (value)
         {
-            convert_to_long(incrby);
-            set_value += Z_LVAL_P(incrby);
+            convert_to_long(value);
+            _value.lval = Z_LVAL_P(value) * sign;
         }
         else
         {
-            set_value += 1;
+            _value.lval = sign;
         }
-        swTableRow_set_value(row, column, &set_value, 0);
-        RETVAL_LONG(set_value);
+        if (compare)
+        {
+            convert_to_long(compare);
+            //compare in the width of the column
+            switch (column->type)
+            {
+            case SW_TABLE_INT8:
+                _compare.lval = (int8_t) Z_LVAL_P(compare);
+                break;
+            case SW_TABLE_INT16:
+                _compare.lval = (int16_t) Z_LVAL_P(compare);
+                break;
+            case SW_TABLE_INT32:
+                _compare.lval = (int32_t) Z_LVAL_P(compare);
+                break;
+            default:
+                _compare.lval = Z_LVAL_P(compare);
+                break;
+            }
+        }
+    }
+
+    if (swTableRow_atomic(table, key, key_len, column, op, &_value, compare ? &_compare : NULL, &result) < 0)
+    {
+        swoole_php_fatal_error(E_WARNING, "Unable to allocate memory.");
+        RETURN_FALSE;
+    }
+
+    if (op == SW_TABLE_ATOMIC_CAS)
+    {
+        if (column->type == SW_TABLE_FLOAT)
+        {
+            RETURN_BOOL(result.dval == _compare.dval);
+        }
+        else
+        {
+            RETURN_BOOL(result.lval == _compare.lval);
+        }
+    }
+    else if (column->type == SW_TABLE_FLOAT)
+    {
+        RETURN_DOUBLE(result.dval);
+    }
+    else
+    {
+        RETURN_LONG(result.lval);
+    }
+}
+
+static PHP_METHOD(swoole_table, incr)
+{
+    char *key;
+    zend_size_t key_len;
+    char *col;
+    zend_size_t col_len;
+    zval *incrby = NULL;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "ss|z", &key, &key_len, &col, &col_len, &incrby) == FAILURE)
+    {
+        RETURN_FALSE;
     }
-    sw_spinlock_release(_lock);
+    php_swoole_table_atomic(getThis(), key, key_len, col, col_len, SW_TABLE_ATOMIC_ADD, 1, incrby, NULL,
+            return_value TSRMLS_CC);
 }
 
 static PHP_METHOD(swoole_table, decr)
@@ -383,64 +485,57 @@ static PHP_METHOD(swoole_table, decr)
     {
         RETURN_FALSE;
     }
+    php_swoole_table_atomic(getThis(), key, key_len, col, col_len, SW_TABLE_ATOMIC_ADD, -1, decrby, NULL,
+            return_value TSRMLS_CC);
+}
 
-    sw_atomic_t *_lock = NULL;
-    swTable *table = swoole_get_object(getThis());
-    swTableRow *row = swTableRow_set(table, key, key_len, &_lock);
-    if (!row)
+static PHP_METHOD(swoole_table, cas)
+{
+    char *key;
+    zend_size_t key_len;
+    char *col;
+    zend_size_t col_len;
+    zval *cmp_value;
+    zval *set_value;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "sszz", &key, &key_len, &col, &col_len, &cmp_value, &set_value) == FAILURE)
     {
-        sw_spinlock_release(_lock);
-        swoole_php_fatal_error(E_WARNING, "Unable to allocate memory.");
         RETURN_FALSE;
     }
+    php_swoole_table_atomic(getThis(), key, key_len, col, col_len, SW_TABLE_ATOMIC_CAS, 1, set_value, cmp_value,
+            return_value TSRMLS_CC);
+}
 
-    swTableColumn *column;
-    column = swTableColumn_get(table, col, col_len);
-    if (column == NULL)
+static PHP_METHOD(swoole_table, min)
+{
+    char *key;
+    zend_size_t key_len;
+    char *col;
+    zend_size_t col_len;
+    zval *value;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "ssz", &key, &key_len, &col, &col_len, &value) == FAILURE)
     {
-        sw_spinlock_release(_lock);
-        swoole_php_fatal_error(E_WARNING, "column[%s] not exist.", col);
         RETURN_FALSE;
     }
-    else if (column->type == SW_TABLE_STRING)
+    php_swoole_table_atomic(getThis(), key, key_len, col, col_len, SW_TABLE_ATOMIC_MIN, 1, value, NULL,
+            return_value TSRMLS_CC);
+}
+
+static PHP_METHOD(swoole_table, max)
+{
+    char *key;
+    zend_size_t key_len;
+    char *col;
+    zend_size_t col_len;
+    zval *value;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "ssz", &key, &key_len, &col, &col_len, &value) == FAILURE)
     {
-        sw_spinlock_release(_lock);
-        swoole_php_fatal_error(E_WARNING, "cannot use incr with string column.");
         RETURN_FALSE;
     }
-    else if (column->type == SW_TABLE_FLOAT)
-    {
-        double set_value = 0;
-        memcpy(&set_value, row->data + column->index, sizeof(set_value));
-        if (decrby)
-        {
-            convert_to_double(decrby);
-            set_value -= Z_DVAL_P(decrby);
-        }
-        else
-        {
-            set_value -= 1;
-        }
-        swTableRow_set_value(row, column, &set_value, 0);
-        RETVAL_DOUBLE(set_value);
-    }
-    else
-    {
-        uint64_t set_value = 0;
-        memcpy(&set_value, row->data + column->index, column->size);
-        if (decrby)
-        {
-            convert_to_long(decrby);
-            set_value -= Z_LVAL_P(decrby);
-        }
-        else
-        {
-            set_value -= 1;
-        }
-        swTableRow_set_value(row, column, &set_value, 0);
-        RETVAL_LONG(set_value);
-    }
-    sw_spinlock_release(_lock);
+    php_swoole_table_atomic(getThis(), key, key_len, col, col_len, SW_TABLE_ATOMIC_MAX, 1, value, NULL,
+            return_value TSRMLS_CC);
 }
 
 static PHP_METHOD(swoole_table, get)
@@ -452,18 +547,13 @@ static PHP_METHOD(swoole_table, get)
     {
         RETURN_FALSE;
     }
-    sw_atomic_t *_lock = NULL;
     swTable *table = swoole_get_object(getThis());
-    swTableRow *row = swTableRow_get(table, key, keylen, &_lock);
+    swTableRow *row = swTableRow_copy(table, key, keylen);
     if (!row)
     {
-        RETVAL_FALSE;
-    }
-    else
-    {
-        php_swoole_table_row2array(table, row, return_value);
+        RETURN_FALSE;
     }
-    sw_spinlock_release(_lock);
+    php_swoole_table_row2array(table, row, return_value);
 }
 
 static PHP_METHOD(swoole_table, exist)
@@ -476,18 +566,85 @@ static PHP_METHOD(swoole_table, exist)
         RETURN_FALSE;
     }
 
-    sw_atomic_t *_lock = NULL;
     swTable *table = swoole_get_object(getThis());
-    swTableRow *row = swTableRow_get(table, key, keylen, &_lock);
-    sw_spinlock_release(_lock);
-    if (!row)
+    RETURN_BOOL(swTableRow_exist(table, key, keylen));
+}
+
+static PHP_METHOD(swoole_table, find)
+{
+    char *name;
+    zend_size_t len;
+    long op;
+    zval *value;
+    long limit = 0;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "slz|l", &name, &len, &op, &value, &limit) == FAILURE)
+    {
+        RETURN_FALSE;
+    }
+
+    if (op < SW_TABLE_FIND_EQ || op > SW_TABLE_FIND_LIKE)
+    {
+        swoole_php_fatal_error(E_WARNING, "unknown operator[%ld].", op);
+        RETURN_FALSE;
+    }
+
+    swTable *table = swoole_get_object(getThis());
+    swTableColumn *col = swTableColumn_get(table, name, len);
+    if (col == NULL)
     {
+        swoole_php_fatal_error(E_WARNING, "column[%s] not exist.", name);
         RETURN_FALSE;
     }
+
+    void *_value;
+    int vlen = 0;
+    if (col->type == SW_TABLE_STRING)
+    {
+        convert_to_string(value);
+        _value = Z_STRVAL_P(value);
+        vlen = Z_STRLEN_P(value);
+    }
+    else if (col->type == SW_TABLE_FLOAT)
+    {
+        convert_to_double(value);
+        _value = &Z_DVAL_P(value);
+    }
     else
     {
-        RETURN_TRUE;
+        convert_to_long(value);
+        _value = &Z_LVAL_P(value);
     }
+
+    int max = table->row_num + 1;
+    if (limit > 0 && limit < max)
+    {
+        max = limit;
+    }
+    char *buf = emalloc(col->size);
+    swTableColumn_write(col, buf, _value, vlen);
+    swTableRow **rows = emalloc(sizeof(swTableRow *) * max);
+    int i, n = swTable_find(table, col, op, buf, rows, max);
+
+    char key[SW_TABLE_KEY_SIZE + 1];
+    array_init(return_value);
+    for (i = 0; i < n; i++)
+    {
+        swTableRow *row = swTableRow_copy_row(table, rows[i]);
+        //changed or reused after the scan
+        if (!row || !swTableColumn_match(col, row->data + col->index, op, buf))
+        {
+            continue;
+        }
+        zval *item;
+        SW_MAKE_STD_ZVAL(item);
+        php_swoole_table_row2array(table, row, item);
+        memcpy(key, row->key, row->key_len);
+        key[row->key_len] = 0;
+        sw_add_assoc_zval_ex(return_value, key, row->key_len + 1, item);
+    }
+    efree(rows);
+    efree(buf);
 }
 
 static PHP_METHOD(swoole_table, del)
@@ -552,6 +709,10 @@ static PHP_METHOD(swoole_table, current)
 {
     swTable *table = swoole_get_object(getThis());
     swTableRow *row = swTable_iterator_current(table);
+    if (!row)
+    {
+        RETURN_FALSE;
+    }
     php_swoole_table_row2array(table, row, return_value);
 }
 
@@ -559,7 +720,11 @@ static PHP_METHOD(swoole_table, key)
 {
     swTable *table = swoole_get_object(getThis());
     swTableRow *row = swTable_iterator_current(table);
-    SW_RETURN_STRING(row->key, 1);
+    if (!row)
+    {
+        RETURN_FALSE;
+    }
+    SW_RETURN_STRINGL(row->key, row->key_len, 1);
 }
 
 static PHP_METHOD(swoole_table, next)
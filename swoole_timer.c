@@ -33,6 +33,11 @@ typedef struct _swTimer_callback
 #endif
     int interval;
     int type;
+    /**
+     * timer of the extension, the C handler is called instead of the PHP callback
+     */
+    php_swoole_timer_handler handler;
+    void *privdata;
 } swTimer_callback;
 
 static swHashMap *timer_map;
@@ -157,6 +162,15 @@ static void php_swoole_onTimeout(swTimer *timer, swTimer_node *tnode)
     zval **args[1];
     int argc = 0;
 
+    if (cb->handler)
+    {
+        timer->_current_id = tnode->id;
+        cb->handler(tnode->id, cb->privdata);
+        timer->_current_id = -1;
+        php_swoole_del_timer(tnode TSRMLS_CC);
+        return;
+    }
+
     if (cb->data)
     {
         args[0] = &cb->data;
@@ -196,6 +210,18 @@ static void php_swoole_onInterval(swTimer *timer, swTimer_node *tnode)
 
     swTimer_callback *cb = tnode->data;
 
+    if (cb->handler)
+    {
+        timer->_current_id = tnode->id;
+        cb->handler(tnode->id, cb->privdata);
+        timer->_current_id = -1;
+        if (tnode->remove)
+        {
+            php_swoole_del_timer(tnode TSRMLS_CC);
+        }
+        return;
+    }
+
     SW_MAKE_STD_ZVAL(ztimer_id);
     ZVAL_LONG(ztimer_id, tnode->id);
 
@@ -232,6 +258,58 @@ static void php_swoole_onInterval(swTimer *timer, swTimer_node *tnode)
     }
 }
 
+/**
+ * timer of the extension, handler(timer_id, data) is called in the reactor
+ */
+long php_swoole_add_timer_ex(int ms, int is_tick, php_swoole_timer_handler handler, void *data TSRMLS_DC)
+{
+    if (!swIsTaskWorker())
+    {
+        php_swoole_check_reactor();
+    }
+
+    php_swoole_check_timer(ms);
+    swTimer_callback *cb = emalloc(sizeof(swTimer_callback));
+    bzero(cb, sizeof(swTimer_callback));
+    cb->type = is_tick ? SW_TIMER_TICK : SW_TIMER_AFTER;
+    cb->handler = handler;
+    cb->privdata = data;
+
+    swTimer_node *tnode = swTimer_add(&SwooleG.timer, ms, is_tick, cb);
+    if (tnode == NULL)
+    {
+        efree(cb);
+        swoole_php_fatal_error(E_WARNING, "addtimer failed.");
+        return SW_ERR;
+    }
+    swHashMap_add_int(timer_map, tnode->id, tnode);
+    return tnode->id;
+}
+
+int php_swoole_clear_timer(long id TSRMLS_DC)
+{
+    swTimer_node *tnode = swHashMap_find_int(timer_map, id);
+    if (tnode == NULL)
+    {
+        swoole_php_error(E_WARNING, "timer#%ld is not found.", id);
+        return SW_ERR;
+    }
+
+    //current timer, cannot remove here.
+    if (tnode->id == SwooleG.timer._current_id)
+    {
+        tnode->remove = 1;
+        return SW_OK;
+    }
+
+    if (php_swoole_del_timer(tnode TSRMLS_CC) < 0)
+    {
+        return SW_ERR;
+    }
+    swTimer_del(&SwooleG.timer, tnode);
+    return SW_OK;
+}
+
 void php_swoole_check_timer(int msec)
 {
     if (SwooleG.timer.fd == 0)
@@ -302,27 +380,5 @@ PHP_FUNCTION(swoole_timer_clear)
         return;
     }
 
-    swTimer_node *tnode = swHashMap_find_int(timer_map, id);
-    if (tnode == NULL)
-    {
-        swoole_php_error(E_WARNING, "timer#%ld is not found.", id);
-        RETURN_FALSE;
-    }
-
-    //current timer, cannot remove here.
-    if (tnode->id == SwooleG.timer._current_id)
-    {
-        tnode->remove = 1;
-        RETURN_TRUE;
-    }
-
-    if (php_swoole_del_timer(tnode TSRMLS_CC) < 0)
-    {
-        RETURN_FALSE;
-    }
-    else
-    {
-        swTimer_del(&SwooleG.timer, tnode);
-        RETURN_TRUE;
-    }
+    SW_CHECK_RETURN(php_swoole_clear_timer(id TSRMLS_CC));
 }
@@ -44,6 +44,7 @@ static zval _websocket_callbacks[2];
 
 static PHP_METHOD(swoole_websocket_server, on);
 static PHP_METHOD(swoole_websocket_server, push);
+static PHP_METHOD(swoole_websocket_server, broadcast);
 static PHP_METHOD(swoole_websocket_server, exist);
 static PHP_METHOD(swoole_websocket_server, pack);
 static PHP_METHOD(swoole_websocket_server, unpack);
@@ -60,6 +61,13 @@ ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_websocket_server_push, 0, 0, 2)
     ZEND_ARG_INFO(0, finish)
 ZEND_END_ARG_INFO()
 
+ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_websocket_server_broadcast, 0, 0, 2)
+    ZEND_ARG_ARRAY_INFO(0, fds, 0)
+    ZEND_ARG_INFO(0, data)
+    ZEND_ARG_INFO(0, opcode)
+    ZEND_ARG_INFO(0, finish)
+ZEND_END_ARG_INFO()
+
 ZEND_BEGIN_ARG_INFO_EX(arginfo_swoole_websocket_server_pack, 0, 0, 1)
     ZEND_ARG_INFO(0, data)
     ZEND_ARG_INFO(0, opcode)
@@ -79,6 +87,7 @@ const zend_function_entry swoole_websocket_server_methods[] =
 {
     PHP_ME(swoole_websocket_server, on,         arginfo_swoole_websocket_server_on, ZEND_ACC_PUBLIC)
     PHP_ME(swoole_websocket_server, push,       arginfo_swoole_websocket_server_push, ZEND_ACC_PUBLIC)
+    PHP_ME(swoole_websocket_server, broadcast,  arginfo_swoole_websocket_server_broadcast, ZEND_ACC_PUBLIC)
     PHP_ME(swoole_websocket_server, exist,      arginfo_swoole_websocket_server_exist, ZEND_ACC_PUBLIC)
     PHP_ME(swoole_websocket_server, pack,       arginfo_swoole_websocket_server_pack, ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
     PHP_ME(swoole_websocket_server, unpack,     arginfo_swoole_websocket_server_unpack, ZEND_ACC_PUBLIC | ZEND_ACC_STATIC)
@@ -422,9 +431,72 @@ static PHP_METHOD(swoole_websocket_server, push)
         swoole_php_fatal_error(E_WARNING, "connection[%d] is not a websocket client.", (int ) fd);
         RETURN_FALSE;
     }
+    //the payload is not copied into a frame buffer, the server frames are not masked
+    char header[SW_WEBSOCKET_HEADER_MAX_LEN];
+    struct iovec iov[2];
+    int iovcnt = swWebSocket_encode_iov(iov, header, data, length, opcode, (int) fin, 0);
+    SW_CHECK_RETURN(swServer_tcp_sendv(SwooleG.serv, fd, iov, iovcnt));
+}
+
+/**
+ * the frame is encoded once, and sent to the reactor threads once
+ */
+static PHP_METHOD(swoole_websocket_server, broadcast)
+{
+    zval *zfds;
+    zval *zdata;
+    zval *value;
+    long opcode = WEBSOCKET_OPCODE_TEXT_FRAME;
+    zend_bool fin = 1;
+
+    if (zend_parse_parameters(ZEND_NUM_ARGS() TSRMLS_CC, "az|lb", &zfds, &zdata, &opcode, &fin) == FAILURE)
+    {
+        return;
+    }
+
+    if (opcode > WEBSOCKET_OPCODE_PONG)
+    {
+        swoole_php_fatal_error(E_WARNING, "opcode max 10");
+        RETURN_FALSE;
+    }
+
+    char *data;
+    int length = php_swoole_get_send_data(zdata, &data TSRMLS_CC);
+    if (length < 0)
+    {
+        RETURN_FALSE;
+    }
+    else if (length == 0)
+    {
+        php_error_docref(NULL TSRMLS_CC, E_WARNING, "data is empty.");
+        RETURN_FALSE;
+    }
+
+    HashTable *vht = Z_ARRVAL_P(zfds);
+    uint32_t *session_list = emalloc(sizeof(uint32_t) * (zend_hash_num_elements(vht) + 1));
+    uint32_t num = 0;
+    swConnection *conn;
+
+    SW_HASHTABLE_FOREACH_START(vht, value)
+        convert_to_long(value);
+        if (Z_LVAL_P(value) <= 0)
+        {
+            continue;
+        }
+        conn = swWorker_get_connection(SwooleG.serv, Z_LVAL_P(value));
+        //not a websocket client
+        if (!conn || conn->websocket_status < WEBSOCKET_STATUS_HANDSHAKE)
+        {
+            continue;
+        }
+        session_list[num++] = Z_LVAL_P(value);
+    SW_HASHTABLE_FOREACH_END();
+
     swString_clear(swoole_http_buffer);
     swWebSocket_encode(swoole_http_buffer, data, length, opcode, (int) fin, 0);
-    SW_CHECK_RETURN(swServer_tcp_send(SwooleG.serv, fd, swoole_http_buffer->str, swoole_http_buffer->length));
+    int ret = swServer_broadcast(SwooleG.serv, session_list, num, swoole_http_buffer->str, swoole_http_buffer->length);
+    efree(session_list);
+    SW_CHECK_RETURN(ret);
 }
 
 static PHP_METHOD(swoole_websocket_server, pack)
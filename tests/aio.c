@@ -85,3 +85,69 @@ swUnitTest(aio_test)
 	//printf("buf: %s\n", buf);
 	return 0;
 }
+
+#ifdef HAVE_IO_URING
+static int aio_uring_completed = 0;
+
+static void aio_uring_callback(swAio_event *event)
+{
+	char *buf = event->buf;
+	if (event->ret != 4096 || buf[0] != 'A' + event->offset / 4096)
+	{
+		printf("io_uring aio failed. ret=%d, error=%d\n", event->ret, event->error);
+	}
+	swAioUring_free(buf);
+	if (++aio_uring_completed == 8)
+	{
+		SwooleG.main_reactor->running = 0;
+	}
+}
+
+swUnitTest(aio_test3)
+{
+	swReactor reactor;
+	char *test_file = "aio_test_file";
+	int i;
+	int fd = open(test_file, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+	{
+		perror("open");
+		return 3;
+	}
+	//the fd keeps the file until it is closed, no file is left on the early returns
+	unlink(test_file);
+	if (swReactor_create(&reactor, 128) < 0)
+	{
+		return 1;
+	}
+	bzero(&SwooleAIO, sizeof(SwooleAIO));
+	SwooleAIO.mode = SW_AIO_URING;
+	SwooleG.main_reactor = &reactor;
+	if (swAio_init() < 0)
+	{
+		return 2;
+	}
+	SwooleAIO.callback = aio_uring_callback;
+
+	//queued in the same loop, submitted at once
+	for (i = 0; i < 8; i++)
+	{
+		char *buf = swAioUring_malloc(4096);
+		memset(buf, 'A' + i, 4096);
+		SwooleAIO.write(fd, buf, 4096, i * 4096);
+	}
+	reactor.wait(&reactor, NULL);
+
+	aio_uring_completed = 0;
+	reactor.running = 1;
+	for (i = 0; i < 8; i++)
+	{
+		SwooleAIO.read(fd, swAioUring_malloc(4096), 4096, i * 4096);
+	}
+	reactor.wait(&reactor, NULL);
+
+	SwooleAIO.destroy();
+	close(fd);
+	return aio_uring_completed == 8 ? 0 : 4;
+}
+#endif
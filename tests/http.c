@@ -81,4 +81,72 @@ swUnitTest(http_test2)
     swString_free(content);
     return 0;
 }
-#endif
\ No newline at end of file
+#endif
+
+#include "swoole.h"
+#include "tests.h"
+#include "http.h"
+
+static swHttpRequest* http_request_new(char *data)
+{
+    swHttpRequest *request = sw_calloc(1, sizeof(swHttpRequest));
+    request->buffer = swString_dup(data, strlen(data));
+    assert(swHttpRequest_get_protocol(request) == SW_OK);
+    assert(swHttpRequest_get_header_length(request) == SW_OK);
+    assert(swHttpRequest_parse_header(request) == SW_OK);
+    return request;
+}
+
+static void http_request_free(swHttpRequest *request)
+{
+    swString_free(request->buffer);
+    sw_free(request->index);
+    sw_free(request);
+}
+
+#define http_index_equal(index, str, field, value) \
+    (index->field##_length == sizeof(value) - 1 && memcmp(str + index->field##_offset, value, sizeof(value) - 1) == 0)
+
+swUnitTest(http_test3)
+{
+    swHttpRequest *request = http_request_new("POST /api/user?id=1&name=swoole#top HTTP/1.1\r\n"
+            "Host: 127.0.0.1\r\n"
+            "Content-Type:application/x-www-form-urlencoded  \r\n"
+            "Connection: close\r\n"
+            "Content-Length: 11\r\n\r\n"
+            "hello=world");
+    swHttpIndex *index = request->index;
+    char *str = request->buffer->str;
+
+    assert(index->method == HTTP_POST && index->version == HTTP_VERSION_11 && index->keepalive == 0);
+    assert(http_index_equal(index, str, path, "/api/user"));
+    assert(http_index_equal(index, str, query, "id=1&name=swoole"));
+    assert(index->header_num == 4);
+    assert(index->content_length == 11 && request->content_length == 11);
+    assert(index->header_length + index->content_length == request->buffer->length);
+
+    swHttpIndex_header *header = &index->headers[1];
+    assert(memcmp(str + header->name_offset, "Content-Type", header->name_length) == 0);
+    assert(memcmp(str + header->value_offset, "application/x-www-form-urlencoded", header->value_length) == 0);
+    assert(header->value_length == sizeof("application/x-www-form-urlencoded") - 1);
+
+    //shipped after the request
+    uint32_t length = request->buffer->length, request_length;
+    swHttpIndex_buffer index_buffer;
+    swString_append_ptr(request->buffer, (char *) index, swHttpIndex_size(index));
+    swString_append_ptr(request->buffer, (char *) &length, sizeof(length));
+    index = swHttpIndex_get(request->buffer->str, request->buffer->length, &index_buffer, &request_length);
+    assert(index && index->method == HTTP_POST && index->header_num == 4 && request_length == length);
+    http_request_free(request);
+
+    request = http_request_new("GET / HTTP/1.0\r\n\r\n");
+    assert(request->index->method == HTTP_GET && request->index->keepalive == 0 && request->index->header_num == 0);
+    assert(http_index_equal(request->index, request->buffer->str, path, "/") && request->index->query_length == 0);
+    http_request_free(request);
+
+    //obsolete line folding is left to the worker
+    request = http_request_new("GET /a HTTP/1.1\r\nX-A: 1\r\n 2\r\nContent-Length: 0\r\n\r\n");
+    assert(request->index->method == 0 && request->index->header_num == 0);
+    http_request_free(request);
+    return 0;
+}
@@ -0,0 +1,126 @@
+/*
+ +----------------------------------------------------------------------+
+ | Swoole                                                               |
+ +----------------------------------------------------------------------+
+ | This source file is subject to version 2.0 of the Apache license,    |
+ | that is bundled with this package in the file LICENSE, and is        |
+ | available through the world-wide-web at the following url:           |
+ | http://www.apache.org/licenses/LICENSE-2.0.html                      |
+ | If you did not receive a copy of the Apache2.0 license and are unable|
+ | to obtain it through the world-wide-web, please send a note to       |
+ | license@swoole.com so we can mail you a copy immediately.            |
+ +----------------------------------------------------------------------+
+ | Author: Tianfeng Han  <mikan.tenny@gmail.com>                        |
+ +----------------------------------------------------------------------+
+ */
+
+#include "swoole.h"
+#include "tests.h"
+
+#define LOG_TEST_FILE      "/tmp/swoole_log_test.log"
+#define LOG_TEST_NUM       500
+
+swUnitTest(log_test1)
+{
+	int i;
+	char buf[64];
+
+	unlink(LOG_TEST_FILE);
+	if (swLog_init(LOG_TEST_FILE) < 0)
+	{
+		return 1;
+	}
+	for (i = 0; i < LOG_TEST_NUM; i++)
+	{
+		sprintf(buf, "log line %d", i);
+		swLog_put(SW_LOG_INFO, buf);
+	}
+	//the writer is stopped and the ring is drained
+	swLog_free();
+	SwooleG.log_fd = STDOUT_FILENO;
+
+	FILE *fp = fopen(LOG_TEST_FILE, "r");
+	char line[SW_ERROR_MSG_SIZE];
+	int lines = 0;
+	while (fgets(line, sizeof(line), fp))
+	{
+		sprintf(buf, "log line %d\n", lines);
+		if (strstr(line, buf) == NULL)
+		{
+			printf("wrong line %d: %s", lines, line);
+			return 2;
+		}
+		lines++;
+	}
+	fclose(fp);
+	unlink(LOG_TEST_FILE);
+	printf("lines=%d\n", lines);
+	return lines == LOG_TEST_NUM ? 0 : 3;
+}
+
+swUnitTest(log_test2)
+{
+	int i, n = 0;
+	for (i = 0; i < SW_LOG_RATE_LIMIT * 2; i++)
+	{
+		if (swLog_limit(SW_ERROR_SESSION_CLOSED_BY_SERVER) == SW_OK)
+		{
+			n++;
+		}
+	}
+	printf("passed=%d\n", n);
+	return n == SW_LOG_RATE_LIMIT ? 0 : 1;
+}
+
+#define LOG_THREAD_N       4
+
+static void* log_test_thread(void *arg)
+{
+	int i;
+	long id = (long) arg;
+	for (i = 0; i < LOG_TEST_NUM / LOG_THREAD_N; i++)
+	{
+		swWarn("thread %ld line %d", id, i);
+	}
+	return NULL;
+}
+
+swUnitTest(log_test3)
+{
+	pthread_t threads[LOG_THREAD_N];
+	long i;
+
+	unlink(LOG_TEST_FILE);
+	if (swLog_init(LOG_TEST_FILE) < 0)
+	{
+		return 1;
+	}
+	//the threads race to start the writer, sw_error is not shared
+	for (i = 0; i < LOG_THREAD_N; i++)
+	{
+		pthread_create(&threads[i], NULL, log_test_thread, (void *) i);
+	}
+	for (i = 0; i < LOG_THREAD_N; i++)
+	{
+		pthread_join(threads[i], NULL);
+	}
+	swLog_free();
+	SwooleG.log_fd = STDOUT_FILENO;
+
+	FILE *fp = fopen(LOG_TEST_FILE, "r");
+	char line[SW_ERROR_MSG_SIZE];
+	int lines = 0;
+	while (fgets(line, sizeof(line), fp))
+	{
+		if (strstr(line, "log_test_thread: thread ") == NULL)
+		{
+			printf("wrong line %d: %s", lines, line);
+			return 2;
+		}
+		lines++;
+	}
+	fclose(fp);
+	unlink(LOG_TEST_FILE);
+	printf("lines=%d\n", lines);
+	return lines == LOG_TEST_NUM ? 0 : 3;
+}
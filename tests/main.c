@@ -15,8 +15,16 @@ int main(int argc, char **argv)
 	swUnitTest_steup(mem_test2, 1, "tests for fixed memory pool");
 	swUnitTest_steup(mem_test3, 1, "tests for global memory pool");
 	swUnitTest_steup(mem_test4, 1, "tests for ring buffer memory pool");
+	swUnitTest_steup(mem_test5, 1, "tests for shared memory arena");
+	swUnitTest_steup(mem_test6, 1, "tests for shared buffer trunk");
+	swUnitTest_steup(mem_test7, 1, "tests for buffer trunk pool");
 
 	swUnitTest_steup(server_test, 1, "socket server test");
+	swUnitTest_steup(heartbeat_test1, 1, "heartbeat wheel test");
+	swUnitTest_steup(buffer_send_test1, 1, "gather send test");
+	swUnitTest_steup(buffer_send_test2, 1, "gather send benchmark");
+	swUnitTest_steup(session_test1, 1, "session allocator test and benchmark");
+	swUnitTest_steup(chunk_test1, 1, "response chunk alloc/reclaim test");
 	swUnitTest_steup(client_test, 1, "socket client test");
 
 	swUnitTest_steup(chan_test, 1, "channel test");
@@ -30,21 +38,44 @@ int main(int argc, char **argv)
 
 	swUnitTest_steup(aio_test, 1, "linux native aio test");
 	swUnitTest_steup(aio_test2, 1, "thread pool aio test");
+#ifdef HAVE_IO_URING
+	swUnitTest_steup(aio_test3, 1, "io_uring aio test");
+#endif
 
 	swUnitTest_steup(rbtree_test, 1, "rbtree data struct test");
 	swUnitTest_steup(linkedlist_test, 1, "linkedlist data struct test");
+	swUnitTest_steup(histogram_test1, 1, "latency histogram test");
 	//swUnitTest_steup(pool_thread, 1);
 
 	swUnitTest_steup(type_test1, 1, "type test");
 
 	//swUnitTest_steup(ws_test1, 1, "websocket decode test");
+	swUnitTest_steup(ws_test2, 1, "websocket mask/encode test");
+	swUnitTest_steup(ws_test3, 1, "websocket mask benchmark");
 
 	//swUnitTest_steup(http_test1, 1, "http get test");
 	//swUnitTest_steup(http_test2, 1, "http post test");
+	swUnitTest_steup(http_test3, 1, "http header index test");
+
+	swUnitTest_steup(eof_test1, 1, "eof split test");
+	swUnitTest_steup(eof_test2, 1, "eof search benchmark");
 
 
 	swUnitTest_steup(heap_test1, 1, "heap test");
+	swUnitTest_steup(timer_test1, 1, "timer wheel test");
+	swUnitTest_steup(timer_test2, 1, "timer heap/wheel benchmark");
+
+	swUnitTest_steup(log_test1, 1, "async log test");
+	swUnitTest_steup(log_test2, 1, "log rate limit test");
+	swUnitTest_steup(log_test3, 1, "multi-thread log test");
 
 	swUnitTest_steup(ringbuffer_test1, 1, "ringbuffer test");
+	swUnitTest_steup(shmring_test1, 1, "shm spsc ring test");
+
+	swUnitTest_steup(table_test1, 1, "table rehash test");
+	swUnitTest_steup(table_test2, 1, "table seqlock read test");
+	swUnitTest_steup(table_test3, 1, "table atomic column test");
+	swUnitTest_steup(table_test4, 1, "table secondary index test");
+	swUnitTest_steup(table_test5, 1, "table parallel set/del test");
 	return swUnitTest_run(&test);
 }
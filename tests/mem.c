@@ -7,6 +7,7 @@
 
 #include "swoole.h"
 #include "tests.h"
+#include "buffer.h"
 
 swUnitTest(mem_test1)
 {
@@ -199,3 +200,170 @@ swUnitTest(mem_test4)
 	}
 	return 0;
 }
+
+swUnitTest(mem_test5)
+{
+	swArena *arena = swArena_new(1024 * 1024 * 4);
+	uint32_t offset[256], size;
+	char *m;
+	int i, n = 0;
+
+	if (arena == NULL)
+	{
+		return 1;
+	}
+	//200K report task, 4 pages can hold 16 slices of 256K
+	for (i = 0; i < 256; i++)
+	{
+		m = swArena_alloc(arena, 200 * 1024, &offset[i]);
+		if (m == NULL)
+		{
+			break;
+		}
+		memset(m, i, 200 * 1024);
+		n++;
+	}
+	printf("arena: %d slices of 200K\n", n);
+	if (n != 16 || swArena_alloc(arena, 1024, &size) != NULL)
+	{
+		return 2;
+	}
+	for (i = 0; i < n; i++)
+	{
+		m = swArena_get(arena, offset[i]);
+		if (m[0] != (char) i || m[200 * 1024 - 1] != (char) i)
+		{
+			return 3;
+		}
+		swArena_free(arena, offset[i]);
+	}
+	//freed slices are reused by the same class
+	for (i = 0; i < n; i++)
+	{
+		if (swArena_alloc(arena, 150 * 1024, &offset[i]) == NULL)
+		{
+			return 4;
+		}
+	}
+	if (swArena_alloc(arena, 2 * 1024 * 1024, &size) != NULL)
+	{
+		return 5;
+	}
+	//fully freed pages go back to the pool and can serve a smaller class
+	for (i = 0; i < n; i++)
+	{
+		swArena_free(arena, offset[i]);
+	}
+	for (i = 0; i < 256; i++)
+	{
+		if (swArena_alloc(arena, 16 * 1024, &offset[i]) == NULL)
+		{
+			return 6;
+		}
+	}
+	if (swArena_alloc(arena, 1024, &size) != NULL)
+	{
+		return 7;
+	}
+	swArena_destroy(arena);
+	return 0;
+}
+
+swUnitTest(mem_test6)
+{
+	swBuffer *buffers[3];
+	char data[] = "hello world";
+	int i;
+
+	swBuffer_shared *shared = swBuffer_shared_new(data, sizeof(data));
+	for (i = 0; i < 3; i++)
+	{
+		buffers[i] = swBuffer_new(SW_BUFFER_SIZE);
+		swBuffer_append_shared(buffers[i], shared, i);
+	}
+	if (shared->refcount != 4 || buffers[2]->head->offset != 2 || buffers[1]->length != sizeof(data))
+	{
+		printf("shared trunk error, refcount=%d\n", shared->refcount);
+		return 1;
+	}
+	//the creator
+	swBuffer_shared_release(shared);
+
+	swBuffer_pop_trunk(buffers[0], swBuffer_get_trunk(buffers[0]));
+	if (shared->refcount != 2 || !swBuffer_empty(buffers[0]))
+	{
+		printf("pop shared trunk error, refcount=%d\n", shared->refcount);
+		return 2;
+	}
+	swBuffer_free(buffers[0]);
+	swBuffer_free(buffers[1]);
+	if (shared->refcount != 1 || memcmp(buffers[2]->head->store.ptr, data, sizeof(data)) != 0)
+	{
+		printf("free buffer error, refcount=%d\n", shared->refcount);
+		return 3;
+	}
+	swBuffer_free(buffers[2]);
+	printf("shared buffer trunk test OK\n");
+	return 0;
+}
+
+swUnitTest(mem_test7)
+{
+	swBuffer_pool pool;
+	//big enough for the largest append
+	char data[4096];
+	int len = sizeof("hello world");
+	int i;
+
+	memset(data, 'A', sizeof(data));
+	memcpy(data, "hello world", len);
+	bzero(&pool, sizeof(pool));
+	SwooleTG.buffer_pool = &pool;
+
+	swBuffer *buffer = swBuffer_new(SW_BUFFER_SIZE);
+	swBuffer_append(buffer, data, len);
+	swBuffer_append(buffer, data, 2000);
+	swBuffer_new_trunk(buffer, SW_CHUNK_CLOSE, 0);
+	if (pool.miss != 3 || pool.hit != 0 || buffer->head->store.ptr != buffer->head->data
+			|| memcmp(buffer->head->store.ptr, data, len) != 0
+			|| memcmp(buffer->head->next->store.ptr, data, 2000) != 0)
+	{
+		printf("new trunk error, miss=%ld\n", pool.miss);
+		return 1;
+	}
+	swBuffer_free(buffer);
+	if (pool.free_num[0] != 1 || pool.free_num[1] != 1 || pool.free_num[3] != 1)
+	{
+		printf("release trunk error\n");
+		return 2;
+	}
+
+	//reused by the same size class, bigger than SW_BUFFER_SIZE_BIG is never cached
+	buffer = swBuffer_new(SW_BUFFER_SIZE);
+	for (i = 0; i < 3; i++)
+	{
+		swBuffer_append(buffer, data, 100);
+	}
+	swBuffer_append(buffer, data, 3000);
+	swBuffer_new_trunk(buffer, SW_CHUNK_DATA, SW_BUFFER_SIZE_BIG + 1);
+	if (pool.hit != 2 || pool.miss != 6 || pool.free_num[1] != 0 || pool.free_num[3] != 0)
+	{
+		printf("reuse trunk error, hit=%ld, miss=%ld\n", pool.hit, pool.miss);
+		return 3;
+	}
+	while (!swBuffer_empty(buffer))
+	{
+		swBuffer_pop_trunk(buffer, swBuffer_get_trunk(buffer));
+	}
+	swBuffer_free(buffer);
+	if (pool.free_num[1] != 3 || pool.free_num[3] != 1 || pool.free_num[5] != 0)
+	{
+		printf("pop trunk error\n");
+		return 4;
+	}
+
+	swBuffer_pool_free(&pool);
+	SwooleTG.buffer_pool = NULL;
+	printf("buffer trunk pool test OK\n");
+	return 0;
+}
@@ -0,0 +1,172 @@
+/*
+  +----------------------------------------------------------------------+
+  | Swoole                                                               |
+  +----------------------------------------------------------------------+
+  | This source file is subject to version 2.0 of the Apache license,    |
+  | that is bundled with this package in the file LICENSE, and is        |
+  | available through the world-wide-web at the following url:           |
+  | http://www.apache.org/licenses/LICENSE-2.0.html                      |
+  | If you did not receive a copy of the Apache2.0 license and are unable|
+  | to obtain it through the world-wide-web, please send a note to       |
+  | license@swoole.com so we can mail you a copy immediately.            |
+  +----------------------------------------------------------------------+
+  | Author: Tianfeng Han  <mikan.tenny@gmail.com>                        |
+  +----------------------------------------------------------------------+
+*/
+#include "swoole.h"
+#include "tests.h"
+
+#define EOF_TEST_PACKAGE_N    1000
+
+static int eof_test_package_n;
+static int eof_test_error;
+
+static int eof_strnpos_bytewise(char *haystack, uint32_t haystack_length, char *needle, uint32_t needle_length)
+{
+	uint32_t i;
+	for (i = 0; i + needle_length <= haystack_length; i++)
+	{
+		if (haystack[i] == needle[0] && memcmp(haystack + i, needle, needle_length) == 0)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+static int eof_test_onPackage(swConnection *conn, char *data, uint32_t length)
+{
+	char expect[64];
+	int n = snprintf(expect, sizeof(expect), "package-%d\r\n\r\n", eof_test_package_n);
+	if (length != n || memcmp(data, expect, n) != 0)
+	{
+		printf("package#%d error, length=%d: %.*s\n", eof_test_package_n, length, length, data);
+		eof_test_error++;
+	}
+	eof_test_package_n++;
+	return SW_OK;
+}
+
+swUnitTest(eof_test1)
+{
+	char haystack[300];
+	char *alphabet = "ab\r\n";
+	char *needles = "\r\n\r\nab\r\n";
+	int i, j;
+
+	srand(1);
+	for (i = 0; i < 100000; i++)
+	{
+		int haystack_length = rand() % sizeof(haystack);
+		int needle_length = 1 + rand() % 8;
+		char *needle = needles + rand() % (9 - needle_length);
+		for (j = 0; j < haystack_length; j++)
+		{
+			haystack[j] = alphabet[rand() % 4];
+		}
+		int pos = swoole_strnpos(haystack, haystack_length, needle, needle_length);
+		if (pos != eof_strnpos_bytewise(haystack, haystack_length, needle, needle_length))
+		{
+			printf("swoole_strnpos error, haystack_length=%d, needle_length=%d, pos=%d\n", haystack_length, needle_length, pos);
+			return 1;
+		}
+	}
+
+	//pipelined packages arrive in random pieces
+	int sock[2];
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sock) < 0)
+	{
+		return 2;
+	}
+	swSetNonBlock(sock[1]);
+
+	swConnection conn;
+	bzero(&conn, sizeof(conn));
+	conn.fd = sock[1];
+
+	swProtocol protocol;
+	bzero(&protocol, sizeof(protocol));
+	memcpy(protocol.package_eof, SW_STRL("\r\n\r\n"));
+	protocol.package_eof_len = 4;
+	protocol.split_by_eof = 1;
+	protocol.package_max_length = 65536;
+	protocol.onPackage = eof_test_onPackage;
+
+	swString *stream = swString_new(65536);
+	swString *buffer = swString_new(64);
+	char tmp[64];
+	for (i = 0; i < EOF_TEST_PACKAGE_N; i++)
+	{
+		swString_append_ptr(stream, tmp, snprintf(tmp, sizeof(tmp), "package-%d\r\n\r\n", i));
+	}
+
+	eof_test_package_n = 0;
+	eof_test_error = 0;
+	for (i = 0; i < stream->length; i += j)
+	{
+		j = 1 + rand() % 37;
+		if (i + j > stream->length)
+		{
+			j = stream->length - i;
+		}
+		if (write(sock[0], stream->str + i, j) != j)
+		{
+			return 3;
+		}
+		if (swProtocol_recv_check_eof(&protocol, &conn, buffer) < 0)
+		{
+			return 4;
+		}
+	}
+	printf("packages=%d, errors=%d, buffer_length=%ld\n", eof_test_package_n, eof_test_error, buffer->length);
+	int ret = (eof_test_package_n == EOF_TEST_PACKAGE_N && eof_test_error == 0 && buffer->length == 0) ? 0 : 5;
+
+	close(sock[0]);
+	close(sock[1]);
+	swString_free(stream);
+	swString_free(buffer);
+	return ret;
+}
+
+swUnitTest(eof_test2)
+{
+	size_t sizes[] = {32, 128, 1024, 8192};
+	size_t total = 64 * 1024 * 1024;
+	char *data = sw_malloc(total);
+	struct timeval start, end;
+	int i, k, n1, n2;
+	size_t j;
+
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		//pipelined packages of sizes[i] bytes, each ends with \r\n\r\n
+		for (j = 0; j < total; j++)
+		{
+			data[j] = 'a' + j % 26;
+		}
+		for (j = sizes[i]; j <= total; j += sizes[i])
+		{
+			memcpy(data + j - 4, "\r\n\r\n", 4);
+		}
+
+		gettimeofday(&start, NULL);
+		for (j = 0, n1 = 0; (k = eof_strnpos_bytewise(data + j, total - j, "\r\n\r\n", 4)) != -1; n1++)
+		{
+			j += k + 4;
+		}
+		gettimeofday(&end, NULL);
+		double t1 = (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_usec - start.tv_usec) / 1000.0;
+
+		gettimeofday(&start, NULL);
+		for (j = 0, n2 = 0; (k = swoole_strnpos(data + j, total - j, "\r\n\r\n", 4)) != -1; n2++)
+		{
+			j += k + 4;
+		}
+		gettimeofday(&end, NULL);
+		double t2 = (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_usec - start.tv_usec) / 1000.0;
+
+		printf("package=%ld, 64M bytes: bytewise %.2f ms (%d), swoole_strnpos %.2f ms (%d)\n", sizes[i], t1, n1, t2, n2);
+	}
+	sw_free(data);
+	return 0;
+}
@@ -202,3 +202,59 @@ static void thread_read(int i)
     printf("worker #%d finish, recv_count=%d\n", i, recv_count);
 }
 
+
+swUnitTest(shmring_test1)
+{
+    int i, n = 200000;
+    uint32_t size = 1024 * 64, length, j;
+    char buf[4096];
+    char *data;
+    pid_t pid;
+
+    swShmRing *ring = sw_shm_malloc(swShmRing_memory_size(size));
+    if (!ring || swShmRing_init(ring, size) < 0)
+    {
+        return 1;
+    }
+
+    pid = fork();
+    if (pid == 0)
+    {
+        for (i = 0; i < n; i++)
+        {
+            length = 4 + (i * 7919) % 3000;
+            memset(buf, i & 0xff, length);
+            while (swShmRing_push(ring, &i, sizeof(i), buf, length) < 0)
+            {
+                swYield();
+            }
+        }
+        exit(0);
+    }
+
+    for (i = 0; i < n; i++)
+    {
+        while ((data = swShmRing_front(ring, &length)) == NULL)
+        {
+            swYield();
+        }
+        if (*(int *) data != i || length != sizeof(i) + 4 + (i * 7919) % 3000)
+        {
+            printf("message#%d is wrong, serial_num=%d, length=%d\n", i, *(int *) data, length);
+            return 2;
+        }
+        for (j = sizeof(i); j < length; j++)
+        {
+            if ((uint8_t) data[j] != (i & 0xff))
+            {
+                printf("message#%d is broken at %d\n", i, j);
+                return 3;
+            }
+        }
+        swShmRing_pop(ring);
+    }
+    waitpid(pid, NULL, 0);
+    printf("shm ring: %d messages ok\n", n);
+    sw_shm_free(ring);
+    return 0;
+}
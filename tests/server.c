@@ -1,6 +1,7 @@
 #include "tests.h"
 #include "swoole.h"
 #include "Server.h"
+#include <inttypes.h>
 
 int my_onReceive(swFactory *factory, swEventData *req);
 void my_onStart(swServer *serv);
@@ -120,3 +121,409 @@ void my_onClose(swServer *serv, swDataHead *info)
 {
     printf("PID=%d\tClose fd=%d|from_id=%d\n", getpid(), info->fd, info->from_id);
 }
+
+static int heartbeat_expired;
+
+static void heartbeat_onExpire(swHeartbeat *hb, swConnection *conn, void *arg)
+{
+	heartbeat_expired++;
+	//the odd connections are expected to expire first
+	assert(conn->fd % 2 == *(int *) arg);
+	conn->active = 0;
+}
+
+swUnitTest(heartbeat_test1)
+{
+	swHeartbeat hb;
+	swConnection *list = sw_calloc(128, sizeof(swConnection));
+	int i, odd = 1, even = 0;
+
+	assert(swHeartbeat_create(&hb, list, 5, 1000) == SW_OK);
+	for (i = 1; i <= 100; i++)
+	{
+		list[i].fd = i;
+		list[i].active = 1;
+		list[i].last_time = 1000;
+		swHeartbeat_add(&hb, &list[i]);
+	}
+	assert(hb.num == 100);
+
+	//receive data
+	for (i = 2; i <= 100; i += 2)
+	{
+		list[i].last_time = 1003;
+	}
+	//closed before expired
+	swHeartbeat_del(&hb, &list[99]);
+	swHeartbeat_del(&hb, &list[100]);
+	assert(hb.num == 98);
+
+	assert(swHeartbeat_check(&hb, 1004, heartbeat_onExpire, &odd) == 0);
+	assert(swHeartbeat_check(&hb, 1005, heartbeat_onExpire, &odd) == 49);
+	assert(hb.num == 49);
+	assert(swHeartbeat_check(&hb, 1007, heartbeat_onExpire, &even) == 0);
+	assert(swHeartbeat_check(&hb, 1008, heartbeat_onExpire, &even) == 49);
+	assert(hb.num == 0 && heartbeat_expired == 98);
+
+	swHeartbeat_free(&hb);
+	sw_free(list);
+	return 0;
+}
+
+static int buffer_send_drain(int fd, swString *out)
+{
+	char buf[65536];
+	int n, total = 0;
+	while ((n = read(fd, buf, sizeof(buf))) > 0)
+	{
+		swString_append_ptr(out, buf, n);
+		total += n;
+	}
+	return total;
+}
+
+swUnitTest(buffer_send_test1)
+{
+	int sock[2], i, calls = 0;
+	int sndbuf = 8192;
+	char data[1024];
+	swString *expect = swString_new(1024 * 1024);
+	swString *recv_data = swString_new(1024 * 1024);
+
+	assert(socketpair(AF_UNIX, SOCK_STREAM, 0, sock) == 0);
+	setsockopt(sock[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+	swSetNonBlock(sock[0]);
+	swSetNonBlock(sock[1]);
+
+	swConnection conn;
+	bzero(&conn, sizeof(conn));
+	conn.fd = sock[0];
+	conn.socket_type = SW_SOCK_UNIX_STREAM;
+	conn.out_buffer = swBuffer_new(SW_BUFFER_SIZE);
+
+	//small responses of different sizes, an empty trunk and a shared trunk, then close
+	for (i = 0; i < 500; i++)
+	{
+		int n = 1 + (i * 37) % sizeof(data);
+		memset(data, 'a' + i % 26, n);
+		swBuffer_append(conn.out_buffer, data, n);
+		swString_append_ptr(expect, data, n);
+		if (i == 100)
+		{
+			swBuffer_new_trunk(conn.out_buffer, SW_CHUNK_DATA, 0);
+			swBuffer_shared *shared = swBuffer_shared_new(SW_STRL("shared"));
+			swBuffer_append_shared(conn.out_buffer, shared, 2);
+			swBuffer_shared_release(shared);
+			swString_append_ptr(expect, SW_STRL("ared"));
+		}
+	}
+	swBuffer_new_trunk(conn.out_buffer, SW_CHUNK_CLOSE, 0);
+
+	//the loop of swReactorThread_onWrite, the reader drains the socket when it is full
+	while (swBuffer_get_trunk(conn.out_buffer)->type != SW_CHUNK_CLOSE)
+	{
+		calls++;
+		if (swConnection_buffer_send(&conn) < 0)
+		{
+			assert(conn.send_wait == 1);
+			conn.send_wait = 0;
+			buffer_send_drain(sock[1], recv_data);
+		}
+	}
+	buffer_send_drain(sock[1], recv_data);
+	printf("trunks=%d, swConnection_buffer_send calls=%d, bytes=%ld\n", 502, calls, recv_data->length);
+
+	int ret = (recv_data->length == expect->length && memcmp(recv_data->str, expect->str, expect->length) == 0) ? 0 : 1;
+	swBuffer_free(conn.out_buffer);
+	swString_free(expect);
+	swString_free(recv_data);
+	close(sock[0]);
+	close(sock[1]);
+	if (ret != 0)
+	{
+		return ret;
+	}
+
+	//the messages of a dgram pipe are never joined
+	assert(socketpair(AF_UNIX, SOCK_DGRAM, 0, sock) == 0);
+	bzero(&conn, sizeof(conn));
+	conn.fd = sock[0];
+	conn.fdtype = SW_FD_PIPE;
+	conn.out_buffer = swBuffer_new(SW_BUFFER_SIZE);
+	for (i = 0; i < 3; i++)
+	{
+		swBuffer_append(conn.out_buffer, data, 10);
+	}
+	while (!swBuffer_empty(conn.out_buffer))
+	{
+		swConnection_buffer_send(&conn);
+	}
+	for (i = 0; i < 3; i++)
+	{
+		if (read(sock[1], data, sizeof(data)) != 10)
+		{
+			ret = 2;
+		}
+	}
+	swBuffer_free(conn.out_buffer);
+	close(sock[0]);
+	close(sock[1]);
+	return ret;
+}
+
+swUnitTest(buffer_send_test2)
+{
+	int sock[2], i, j, calls;
+	int n = 100000, pipeline = 40;
+	char data[128];
+	struct timeval start, end;
+	swBuffer_trunk *trunk;
+
+	memset(data, 'A', sizeof(data));
+	assert(socketpair(AF_UNIX, SOCK_STREAM, 0, sock) == 0);
+
+	swConnection conn;
+	bzero(&conn, sizeof(conn));
+	conn.fd = sock[0];
+	conn.socket_type = SW_SOCK_UNIX_STREAM;
+	conn.out_buffer = swBuffer_new(SW_BUFFER_SIZE);
+
+	//one send() for each trunk
+	calls = 0;
+	gettimeofday(&start, NULL);
+	for (i = 0; i < n / pipeline; i++)
+	{
+		for (j = 0; j < pipeline; j++)
+		{
+			swBuffer_append(conn.out_buffer, data, sizeof(data));
+		}
+		while (!swBuffer_empty(conn.out_buffer))
+		{
+			trunk = swBuffer_get_trunk(conn.out_buffer);
+			assert(swConnection_send(&conn, trunk->store.ptr, trunk->length, 0) == trunk->length);
+			swBuffer_pop_trunk(conn.out_buffer, trunk);
+			calls++;
+		}
+		for (j = 0; j < pipeline * sizeof(data); j += read(sock[1], data, sizeof(data)));
+	}
+	gettimeofday(&end, NULL);
+	printf("%d responses, pipeline=%d: send %d calls, %.2f ms\n", n, pipeline, calls,
+			(end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_usec - start.tv_usec) / 1000.0);
+
+	//gather send
+	calls = 0;
+	gettimeofday(&start, NULL);
+	for (i = 0; i < n / pipeline; i++)
+	{
+		for (j = 0; j < pipeline; j++)
+		{
+			swBuffer_append(conn.out_buffer, data, sizeof(data));
+		}
+		while (!swBuffer_empty(conn.out_buffer))
+		{
+			assert(swConnection_buffer_send(&conn) == SW_OK);
+			calls++;
+		}
+		for (j = 0; j < pipeline * sizeof(data); j += read(sock[1], data, sizeof(data)));
+	}
+	gettimeofday(&end, NULL);
+	printf("%d responses, pipeline=%d: swConnection_buffer_send %d calls, %.2f ms\n", n, pipeline, calls,
+			(end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_usec - start.tv_usec) / 1000.0);
+
+	swBuffer_free(conn.out_buffer);
+	close(sock[0]);
+	close(sock[1]);
+	return 0;
+}
+
+#define SESSION_TEST_THREADS    4
+#define SESSION_TEST_N          1000000
+
+static swServer session_serv;
+static uint8_t *session_used;
+static int session_error;
+
+static void* session_test_thread(void *arg)
+{
+	long id = (long) arg;
+	uint32_t held[64];
+	int i, j;
+
+	for (i = 0; i < SESSION_TEST_N / SESSION_TEST_THREADS / 64; i++)
+	{
+		for (j = 0; j < 64; j++)
+		{
+			held[j] = swServer_session_alloc(&session_serv, 100 + j, id);
+			//two threads hold the same slot
+			if (held[j] == 0 || __sync_lock_test_and_set(&session_used[held[j] % SW_SESSION_LIST_SIZE], 1))
+			{
+				__sync_fetch_and_add(&session_error, 1);
+			}
+		}
+		for (j = 0; j < 64; j++)
+		{
+			__sync_lock_release(&session_used[held[j] % SW_SESSION_LIST_SIZE]);
+			swServer_session_free(&session_serv, held[j]);
+		}
+	}
+	return NULL;
+}
+
+swUnitTest(session_test1)
+{
+	pthread_t threads[SESSION_TEST_THREADS];
+	struct timeval start, end;
+	uint32_t *sessions;
+	uint32_t first, second;
+	long i;
+
+	bzero(&session_serv, sizeof(session_serv));
+	if (swServer_session_init(&session_serv) < 0)
+	{
+		return 1;
+	}
+	session_used = calloc(SW_SESSION_LIST_SIZE, 1);
+
+	//the slot is reused with a new generation, the old session id is invalid
+	first = swServer_session_alloc(&session_serv, 10, 0);
+	swServer_session_free(&session_serv, first);
+	for (i = 0; i < SW_SESSION_LIST_SIZE - 2; i++)
+	{
+		swServer_session_free(&session_serv, swServer_session_alloc(&session_serv, 10, 0));
+	}
+	second = swServer_session_alloc(&session_serv, 10, 0);
+	printf("first=%u, second=%u\n", first, second);
+	if (second % SW_SESSION_LIST_SIZE != first % SW_SESSION_LIST_SIZE || second == first)
+	{
+		return 2;
+	}
+	swServer_session_free(&session_serv, second);
+	swServer_session_free(&session_serv, second);
+
+	//the generation wraps in 24 bits, the session is never taken for udp
+	for (i = 0; i < 20 * (SW_SESSION_LIST_SIZE - 1); i++)
+	{
+		second = swServer_session_alloc(&session_serv, 10, 0);
+		if (second == 0 || swServer_is_udp(second))
+		{
+			printf("session_id=%u\n", second);
+			return 4;
+		}
+		swServer_session_free(&session_serv, second);
+	}
+
+	//near the max connection, a slot being freed by another thread is not in the queue yet
+	sessions = malloc(sizeof(uint32_t) * SW_SESSION_LIST_SIZE);
+	for (i = 0; i < SW_SESSION_LIST_SIZE - 1 - SESSION_TEST_THREADS * 64 * 2; i++)
+	{
+		sessions[i] = swServer_session_alloc(&session_serv, 10, 0);
+		session_used[sessions[i] % SW_SESSION_LIST_SIZE] = 1;
+	}
+
+	gettimeofday(&start, NULL);
+	for (i = 0; i < SESSION_TEST_THREADS; i++)
+	{
+		pthread_create(&threads[i], NULL, session_test_thread, (void *) i);
+	}
+	for (i = 0; i < SESSION_TEST_THREADS; i++)
+	{
+		pthread_join(threads[i], NULL);
+	}
+	gettimeofday(&end, NULL);
+	printf("%d threads, %d sessions: %.2f ms, errors=%d\n", SESSION_TEST_THREADS, SESSION_TEST_N,
+			(end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_usec - start.tv_usec) / 1000.0, session_error);
+
+	free(sessions);
+	free(session_used);
+	return session_error == 0 ? 0 : 3;
+}
+
+#define CHUNK_TEST_NUM     8
+
+swUnitTest(chunk_test1)
+{
+	swWorker worker;
+	swResponse_chunk *chunk;
+	int i;
+
+	bzero(&worker, sizeof(worker));
+	worker.send_shm_num = CHUNK_TEST_NUM;
+	worker.send_shm = sw_shm_calloc(CHUNK_TEST_NUM, sizeof(swResponse_chunk));
+	if (worker.send_shm == NULL)
+	{
+		return 1;
+	}
+
+	for (i = 0; i < CHUNK_TEST_NUM; i++)
+	{
+		chunk = swWorker_alloc_chunk(&worker);
+		if (chunk == NULL)
+		{
+			return 2;
+		}
+		//half of them are sent to the reactor
+		if (i % 2 == 0)
+		{
+			chunk->used = SW_RESPONSE_CHUNK_SENT;
+		}
+	}
+	//all in flight, the caller copies the response
+	if (swWorker_alloc_chunk(&worker) != NULL)
+	{
+		return 3;
+	}
+	//the dead worker was filling the others
+	if (swWorker_reclaim_chunks(&worker) != CHUNK_TEST_NUM / 2)
+	{
+		return 4;
+	}
+	for (i = 0; i < CHUNK_TEST_NUM / 2; i++)
+	{
+		if (swWorker_alloc_chunk(&worker) == NULL)
+		{
+			return 5;
+		}
+	}
+	sw_shm_free(worker.send_shm);
+	return 0;
+}
+
+swUnitTest(histogram_test1)
+{
+	static swHistogram hist;
+	uint64_t v, p;
+	uint32_t i;
+
+	//every value is counted by one bucket, the bucket max is not less than the value
+	for (v = 0; v < 1000000; v += 7)
+	{
+		i = swHistogram_bucket_index(v);
+		if (swHistogram_bucket_max(i) < v || (i > 0 && swHistogram_bucket_max(i - 1) >= v))
+		{
+			printf("value=%" PRIu64 ", index=%u\n", v, i);
+			return 1;
+		}
+	}
+	if (swHistogram_bucket_index(1ULL << 40) != SW_HISTOGRAM_BUCKET_NUM - 1)
+	{
+		return 2;
+	}
+
+	for (v = 1; v <= 100000; v++)
+	{
+		swHistogram_record(&hist, v);
+	}
+	printf("count=%" PRIu64 ", max=%" PRIu64 ", p50=%" PRIu64 ", p99=%" PRIu64 ", p999=%" PRIu64 "\n", hist.count, hist.max, swHistogram_percentile(&hist, 50),
+			swHistogram_percentile(&hist, 99), swHistogram_percentile(&hist, 99.9));
+	p = swHistogram_percentile(&hist, 50);
+	if (p < 50000 || p > 50000 + 50000 / SW_HISTOGRAM_SUB_NUM)
+	{
+		return 3;
+	}
+	p = swHistogram_percentile(&hist, 99);
+	if (p < 99000 || p > 99000 + 99000 / SW_HISTOGRAM_SUB_NUM)
+	{
+		return 4;
+	}
+	return swHistogram_percentile(&hist, 100) == 100000 ? 0 : 5;
+}
@@ -0,0 +1,461 @@
+/*
+ +----------------------------------------------------------------------+
+ | Swoole                                                               |
+ +----------------------------------------------------------------------+
+ | This source file is subject to version 2.0 of the Apache license,    |
+ | that is bundled with this package in the file LICENSE, and is        |
+ | available through the world-wide-web at the following url:           |
+ | http://www.apache.org/licenses/LICENSE-2.0.html                      |
+ | If you did not receive a copy of the Apache2.0 license and are unable|
+ | to obtain it through the world-wide-web, please send a note to       |
+ | license@swoole.com so we can mail you a copy immediately.            |
+ +----------------------------------------------------------------------+
+ | Author: Tianfeng Han  <mikan.tenny@gmail.com>                        |
+ +----------------------------------------------------------------------+
+ */
+
+#include "swoole.h"
+#include "table.h"
+#include "tests.h"
+
+#define TABLE_SIZE       1024
+#define TABLE_MAX_SIZE   8192
+
+swUnitTest(table_test1)
+{
+    swTable *table = swTable_new(TABLE_SIZE, TABLE_MAX_SIZE);
+    if (!table)
+    {
+        return 1;
+    }
+    swTableColumn_add(table, SW_STRL("id")-1, SW_TABLE_INT, 4);
+    swTableColumn_add(table, SW_STRL("name")-1, SW_TABLE_STRING, 32);
+    if (swTable_create(table) < 0)
+    {
+        return 2;
+    }
+
+    swTableColumn *col_id = swTableColumn_get(table, SW_STRL("id")-1);
+    swTableRow *row;
+    char key[32];
+    int i, keylen;
+    int32_t value;
+
+    //more rows than the initial size, the index is rehashed online
+    for (i = 0; i < TABLE_MAX_SIZE; i++)
+    {
+        keylen = snprintf(key, sizeof(key), "key_%d", i);
+        row = swTableRow_set(table, key, keylen);
+        if (!row)
+        {
+            printf("set %s failed.\n", key);
+            return 3;
+        }
+        swTableRow_set_value(row, col_id, &i, 0);
+        swTableRow_commit(table, row);
+
+        //delete every third row while the index is being migrated
+        if (i % 3 == 0 && swTableRow_del(table, key, keylen) < 0)
+        {
+            return 4;
+        }
+    }
+    printf("row_num=%d, stripe[0].index_size=%d\n", table->row_num, table->stripes[0].index.size);
+
+    for (i = 0; i < TABLE_MAX_SIZE; i++)
+    {
+        keylen = snprintf(key, sizeof(key), "key_%d", i);
+        row = swTableRow_copy(table, key, keylen);
+        if (i % 3 == 0)
+        {
+            if (row)
+            {
+                printf("%s should be deleted.\n", key);
+                return 5;
+            }
+            continue;
+        }
+        if (!row)
+        {
+            printf("%s not found.\n", key);
+            return 6;
+        }
+        memcpy(&value, row->data + col_id->index, sizeof(value));
+        if (value != i)
+        {
+            return 7;
+        }
+    }
+
+    int count = 0;
+    swTable_iterator_rewind(table);
+    while (swTable_iterator_current(table))
+    {
+        count++;
+        swTable_iterator_forward(table);
+    }
+    printf("iterator count=%d\n", count);
+
+    swTable_free(table);
+    return count == TABLE_MAX_SIZE - (TABLE_MAX_SIZE + 2) / 3 ? 0 : 8;
+}
+
+#define TABLE_READER_N   4
+#define TABLE_WRITE_N    200000
+
+/**
+ * readers must never see a half written row
+ */
+swUnitTest(table_test2)
+{
+    swTable *table = swTable_new(TABLE_SIZE, 0);
+    if (!table)
+    {
+        return 1;
+    }
+    swTableColumn_add(table, SW_STRL("a")-1, SW_TABLE_INT, 8);
+    swTableColumn_add(table, SW_STRL("b")-1, SW_TABLE_INT, 8);
+    if (swTable_create(table) < 0)
+    {
+        return 2;
+    }
+
+    swTableColumn *col_a = swTableColumn_get(table, SW_STRL("a")-1);
+    swTableColumn *col_b = swTableColumn_get(table, SW_STRL("b")-1);
+    swTableRow *row;
+    int64_t a, b;
+    int i, status, ret = 0;
+    pid_t pid;
+
+    for (i = 0; i < TABLE_READER_N; i++)
+    {
+        pid = fork();
+        if (pid == 0)
+        {
+            int n, error = 0;
+            for (n = 0; n < TABLE_WRITE_N; n++)
+            {
+                row = swTableRow_copy(table, SW_STRL("hot")-1);
+                if (!row)
+                {
+                    continue;
+                }
+                memcpy(&a, row->data + col_a->index, sizeof(a));
+                memcpy(&b, row->data + col_b->index, sizeof(b));
+                if (a != b)
+                {
+                    error++;
+                }
+            }
+            exit(error > 0);
+        }
+    }
+
+    for (a = 0; a < TABLE_WRITE_N; a++)
+    {
+        row = swTableRow_set(table, SW_STRL("hot")-1);
+        swTableRow_set_value(row, col_a, &a, 0);
+        swTableRow_set_value(row, col_b, &a, 0);
+        swTableRow_commit(table, row);
+        if (a % 1000 == 0)
+        {
+            swTableRow_del(table, SW_STRL("hot")-1);
+        }
+    }
+
+    for (i = 0; i < TABLE_READER_N; i++)
+    {
+        wait(&status);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            ret = 3;
+        }
+    }
+    swTable_free(table);
+    return ret;
+}
+
+#define TABLE_INCR_N     100000
+
+swUnitTest(table_test3)
+{
+    swTable *table = swTable_new(TABLE_SIZE, 0);
+    if (!table)
+    {
+        return 1;
+    }
+    swTableColumn_add(table, SW_STRL("flag")-1, SW_TABLE_INT, 1);
+    swTableColumn_add(table, SW_STRL("count")-1, SW_TABLE_INT, 8);
+    swTableColumn_add(table, SW_STRL("max")-1, SW_TABLE_INT, 4);
+    swTableColumn_add(table, SW_STRL("sum")-1, SW_TABLE_FLOAT, 0);
+    if (swTable_create(table) < 0)
+    {
+        return 2;
+    }
+
+    swTableColumn *col_count = swTableColumn_get(table, SW_STRL("count")-1);
+    swTableColumn *col_max = swTableColumn_get(table, SW_STRL("max")-1);
+    swTableColumn *col_sum = swTableColumn_get(table, SW_STRL("sum")-1);
+    swTable_number value, result;
+    int i, n, status, ret = 0;
+
+    for (i = 0; i < TABLE_READER_N; i++)
+    {
+        if (fork() == 0)
+        {
+            for (n = 0; n < TABLE_INCR_N; n++)
+            {
+                value.lval = 1;
+                swTableRow_atomic(table, SW_STRL("counter")-1, col_count, SW_TABLE_ATOMIC_ADD, &value, NULL, &result);
+                value.lval = n;
+                swTableRow_atomic(table, SW_STRL("counter")-1, col_max, SW_TABLE_ATOMIC_MAX, &value, NULL, &result);
+                value.dval = 0.5;
+                swTableRow_atomic(table, SW_STRL("counter")-1, col_sum, SW_TABLE_ATOMIC_ADD, &value, NULL, &result);
+            }
+            exit(0);
+        }
+    }
+    for (i = 0; i < TABLE_READER_N; i++)
+    {
+        wait(&status);
+    }
+
+    swTableRow *row = swTableRow_copy(table, SW_STRL("counter")-1);
+    int64_t count;
+    int32_t max;
+    double sum;
+    memcpy(&count, row->data + col_count->index, sizeof(count));
+    memcpy(&max, row->data + col_max->index, sizeof(max));
+    memcpy(&sum, row->data + col_sum->index, sizeof(sum));
+    printf("count=%ld, max=%d, sum=%f\n", (long) count, max, sum);
+    if (count != TABLE_READER_N * TABLE_INCR_N || max != TABLE_INCR_N - 1 || sum != TABLE_READER_N * TABLE_INCR_N * 0.5)
+    {
+        ret = 3;
+    }
+
+    swTable_number compare;
+    compare.lval = count;
+    value.lval = 0;
+    swTableRow_atomic(table, SW_STRL("counter")-1, col_count, SW_TABLE_ATOMIC_CAS, &value, &compare, &result);
+    row = swTableRow_copy(table, SW_STRL("counter")-1);
+    memcpy(&count, row->data + col_count->index, sizeof(count));
+    if (result.lval != compare.lval || count != 0)
+    {
+        ret = 4;
+    }
+
+    //min/max of a missing key is the operand
+    value.lval = 100;
+    swTableRow_atomic(table, SW_STRL("min")-1, col_max, SW_TABLE_ATOMIC_MIN, &value, NULL, &result);
+    if (result.lval != 100)
+    {
+        ret = 5;
+    }
+    value.dval = -1.5;
+    swTableRow_atomic(table, SW_STRL("max")-1, col_sum, SW_TABLE_ATOMIC_MAX, &value, NULL, &result);
+    if (result.dval != -1.5)
+    {
+        ret = 6;
+    }
+
+    swTable_free(table);
+    return ret;
+}
+
+static int table_find_check(swTable *table, swTableColumn *col, int op, void *value, int vlen)
+{
+    swTableRow *rows[TABLE_SIZE];
+    swTableRow *row;
+    char buf[64];
+    swTableColumn_write(col, buf, value, vlen);
+    int n = swTable_find(table, col, op, buf, rows, TABLE_SIZE);
+    int count = 0;
+
+    //compare with a full scan
+    swTable_iterator_rewind(table);
+    while ((row = swTable_iterator_current(table)))
+    {
+        int64_t a = 0, b = 0;
+        int match;
+        if (col->type == SW_TABLE_STRING)
+        {
+            swTable_string_length_t la, lb;
+            memcpy(&la, row->data + col->index, sizeof(la));
+            memcpy(&lb, buf, sizeof(lb));
+            match = la >= lb && memcmp(row->data + col->index + sizeof(la), buf + sizeof(lb), lb) == 0;
+        }
+        else
+        {
+            memcpy(&a, row->data + col->index, col->size);
+            memcpy(&b, buf, col->size);
+            match = op == SW_TABLE_FIND_EQ ? a == b : (op == SW_TABLE_FIND_GT ? a > b : a < b);
+        }
+        count += match;
+        swTable_iterator_forward(table);
+    }
+    if (n != count)
+    {
+        printf("op=%d, find=%d, scan=%d\n", op, n, count);
+        return 1;
+    }
+    //the copies are matched again, an unknown operator matches nothing
+    for (count = 0; count < n; count++)
+    {
+        row = swTableRow_copy_row(table, rows[count]);
+        if (!row || !swTableColumn_match(col, row->data + col->index, op, buf)
+                || swTableColumn_match(col, row->data + col->index, SW_TABLE_FIND_LIKE + 1, buf))
+        {
+            printf("op=%d, row#%d not matched\n", op, count);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+swUnitTest(table_test4)
+{
+    swTable *table = swTable_new(TABLE_SIZE, TABLE_SIZE);
+    if (!table)
+    {
+        return 1;
+    }
+    swTableColumn_add(table, SW_STRL("uid")-1, SW_TABLE_INT, 8);
+    swTableColumn_add(table, SW_STRL("score")-1, SW_TABLE_INT, 4);
+    swTableColumn_add(table, SW_STRL("name")-1, SW_TABLE_STRING, 32);
+    swTableColumn_add(table, SW_STRL("online")-1, SW_TABLE_INT, 1);
+    swTableColumn_add_index(table, SW_STRL("uid")-1, SW_TABLE_INDEX_HASH);
+    swTableColumn_add_index(table, SW_STRL("online")-1, SW_TABLE_INDEX_HASH);
+    swTableColumn_add_index(table, SW_STRL("score")-1, SW_TABLE_INDEX_ORDERED);
+    swTableColumn_add_index(table, SW_STRL("name")-1, SW_TABLE_INDEX_ORDERED);
+    if (swTable_create(table) < 0)
+    {
+        return 2;
+    }
+
+    swTableColumn *col_uid = swTableColumn_get(table, SW_STRL("uid")-1);
+    swTableColumn *col_score = swTableColumn_get(table, SW_STRL("score")-1);
+    swTableColumn *col_name = swTableColumn_get(table, SW_STRL("name")-1);
+    swTableColumn *col_online = swTableColumn_get(table, SW_STRL("online")-1);
+    swTableRow *row;
+    char key[32], name[32];
+    int i, keylen, ret = 0;
+    int64_t uid, value, online;
+
+    for (i = 0; i < 1000; i++)
+    {
+        keylen = snprintf(key, sizeof(key), "session_%d", i);
+        row = swTableRow_set(table, key, keylen);
+        uid = i % 100;
+        value = (i * 7919) % 1000;
+        swTableRow_set_value(row, col_uid, &uid, 0);
+        swTableRow_set_value(row, col_score, &value, 0);
+        swTableRow_set_value(row, col_name, name, snprintf(name, sizeof(name), "user_%d", i % 50));
+        //two values, the rows are chained under one slot
+        online = i % 2;
+        swTableRow_set_value(row, col_online, &online, 0);
+        swTableRow_commit(table, row);
+    }
+    //update and delete, the indexes must follow
+    for (i = 0; i < 1000; i += 3)
+    {
+        keylen = snprintf(key, sizeof(key), "session_%d", i);
+        if (i % 2)
+        {
+            swTableRow_del(table, key, keylen);
+        }
+        else
+        {
+            row = swTableRow_set(table, key, keylen);
+            value = 500;
+            swTableRow_set_value(row, col_score, &value, 0);
+            swTableRow_commit(table, row);
+        }
+    }
+
+    uid = 42;
+    ret += table_find_check(table, col_uid, SW_TABLE_FIND_EQ, &uid, 0);
+    value = 500;
+    ret += table_find_check(table, col_score, SW_TABLE_FIND_EQ, &value, 0);
+    ret += table_find_check(table, col_score, SW_TABLE_FIND_GT, &value, 0);
+    ret += table_find_check(table, col_score, SW_TABLE_FIND_LT, &value, 0);
+    ret += table_find_check(table, col_name, SW_TABLE_FIND_LEFTLIKE, SW_STRL("user_1")-1);
+    online = 0;
+    ret += table_find_check(table, col_online, SW_TABLE_FIND_EQ, &online, 0);
+    online = 1;
+    ret += table_find_check(table, col_online, SW_TABLE_FIND_EQ, &online, 0);
+
+    swTable_free(table);
+    return ret;
+}
+
+swUnitTest(table_test5)
+{
+    swTable *table = swTable_new(TABLE_SIZE, TABLE_MAX_SIZE);
+    if (!table)
+    {
+        return 1;
+    }
+    swTableColumn_add(table, SW_STRL("id")-1, SW_TABLE_INT, 4);
+    if (swTable_create(table) < 0)
+    {
+        return 2;
+    }
+
+    char key[32];
+    int i, n, keylen, status;
+    int ret = 0;
+    swTableRow *row;
+
+    //the writers of different stripes run in parallel, every process owns its keys
+    for (i = 0; i < TABLE_READER_N; i++)
+    {
+        if (fork() == 0)
+        {
+            for (n = 0; n < TABLE_MAX_SIZE / TABLE_READER_N; n++)
+            {
+                keylen = snprintf(key, sizeof(key), "key_%d_%d", i, n);
+                row = swTableRow_set(table, key, keylen);
+                if (!row)
+                {
+                    exit(1);
+                }
+                swTableRow_commit(table, row);
+                if (n % 2 == 0 && swTableRow_del(table, key, keylen) < 0)
+                {
+                    exit(2);
+                }
+            }
+            exit(0);
+        }
+    }
+    for (i = 0; i < TABLE_READER_N; i++)
+    {
+        wait(&status);
+        if (WEXITSTATUS(status) != 0)
+        {
+            ret = 3;
+        }
+    }
+
+    for (i = 0; i < TABLE_READER_N && ret == 0; i++)
+    {
+        for (n = 0; n < TABLE_MAX_SIZE / TABLE_READER_N; n++)
+        {
+            keylen = snprintf(key, sizeof(key), "key_%d_%d", i, n);
+            if (swTableRow_exist(table, key, keylen) != n % 2)
+            {
+                printf("%s is wrong.\n", key);
+                ret = 4;
+                break;
+            }
+        }
+    }
+    printf("row_num=%d\n", table->row_num);
+    if (table->row_num != TABLE_MAX_SIZE / 2)
+    {
+        ret = 5;
+    }
+
+    swTable_free(table);
+    return ret;
+}
@@ -0,0 +1,217 @@
+/*
+ +----------------------------------------------------------------------+
+ | Swoole                                                               |
+ +----------------------------------------------------------------------+
+ | This source file is subject to version 2.0 of the Apache license,    |
+ | that is bundled with this package in the file LICENSE, and is        |
+ | available through the world-wide-web at the following url:           |
+ | http://www.apache.org/licenses/LICENSE-2.0.html                      |
+ | If you did not receive a copy of the Apache2.0 license and are unable|
+ | to obtain it through the world-wide-web, please send a note to       |
+ | license@swoole.com so we can mail you a copy immediately.            |
+ +----------------------------------------------------------------------+
+ | Author: Tianfeng Han  <mikan.tenny@gmail.com>                        |
+ +----------------------------------------------------------------------+
+ */
+
+#include "swoole.h"
+#include "tests.h"
+
+#define TIMER_TEST_NUM     100000
+
+static int timer_fired;
+static int timer_error;
+static long timer_next;
+
+static int timer_set(swTimer *timer, long exec_msec)
+{
+    timer_next = exec_msec;
+    return SW_OK;
+}
+
+static void timer_onAfter(swTimer *timer, swTimer_node *tnode)
+{
+    //fired too early or too late, the wheel runs the tick of exec_msec
+    if (timer->wheel && tnode->exec_msec != timer->wheel->current)
+    {
+        timer_error++;
+    }
+    timer_fired++;
+}
+
+static void timer_onTick(swTimer *timer, swTimer_node *tnode)
+{
+    timer_fired++;
+    if (timer_fired >= 10)
+    {
+        tnode->remove = 1;
+    }
+}
+
+/**
+ * move the clock forward
+ */
+static void timer_run(swTimer *timer, int msec)
+{
+    timer->basetime -= msec;
+    swTimer_select(timer);
+}
+
+static int timer_init(swTimer *timer, int backend)
+{
+    bzero(timer, sizeof(swTimer));
+    if (swTimer_create(timer, backend) < 0)
+    {
+        return SW_ERR;
+    }
+    timer->set = timer_set;
+    timer->onAfter = timer_onAfter;
+    timer->onTick = timer_onTick;
+    timer->_next_msec = -1;
+    return SW_OK;
+}
+
+swUnitTest(timer_test1)
+{
+    swTimer timer;
+    swTimer_node *nodes[1000];
+    int i;
+
+    if (timer_init(&timer, SW_TIMER_BACKEND_WHEEL) < 0)
+    {
+        return 1;
+    }
+    swTimer_select(&timer);
+
+    timer_fired = 0;
+    timer_error = 0;
+    for (i = 0; i < 1000; i++)
+    {
+        //up to level 3
+        nodes[i] = swTimer_add(&timer, 1 + swoole_system_random(0, 300000), 0, NULL);
+    }
+    //cancel half of them
+    for (i = 0; i < 1000; i += 2)
+    {
+        swTimer_del(&timer, nodes[i]);
+    }
+    swTimer_select(&timer);
+    if (timer_next <= 0)
+    {
+        printf("next timeout error: %ld\n", timer_next);
+        return 2;
+    }
+
+    for (i = 0; i < 300000 && timer.num > 0; i += 997)
+    {
+        timer_run(&timer, 997);
+    }
+    if (timer_fired != 500 || timer_error > 0 || timer.num != 0 || timer_next != -1)
+    {
+        printf("fired=%d, error=%d, num=%d\n", timer_fired, timer_error, timer.num);
+        return 3;
+    }
+
+    //tick timer
+    timer_fired = 0;
+    swTimer_add(&timer, 100, 1, NULL);
+    for (i = 0; i < 20; i++)
+    {
+        timer_run(&timer, 100);
+    }
+    if (timer_fired != 10 || timer.num != 0)
+    {
+        printf("tick fired=%d, num=%d\n", timer_fired, timer.num);
+        return 4;
+    }
+
+    //the empty ticks of a long idle period are skipped
+    timer_fired = 0;
+    timer_run(&timer, 86400 * 1000);
+    swTimer_add(&timer, 5, 0, NULL);
+    swTimer_add(&timer, 9 * 86400 * 1000, 0, NULL);
+    struct timeval start, end;
+    gettimeofday(&start, NULL);
+    timer_run(&timer, 10 * 86400 * 1000);
+    gettimeofday(&end, NULL);
+    long usec = (end.tv_sec - start.tv_sec) * 1000000 + end.tv_usec - start.tv_usec;
+    if (timer_fired != 2 || timer_error > 0 || timer.num != 0 || usec > 100000)
+    {
+        printf("idle fired=%d, error=%d, num=%d, usec=%ld\n", timer_fired, timer_error, timer.num, usec);
+        return 5;
+    }
+
+    //a short timer after an idle period must not wait for the cascade of the upper levels
+    timer_fired = 0;
+    timer_run(&timer, 4000);
+    swTimer_add(&timer, 100000, 0, NULL);
+    timer_run(&timer, 4000);
+    swTimer_add(&timer, 90, 0, NULL);
+    timer_run(&timer, 90);
+    if (timer_fired != 1 || timer_error > 0)
+    {
+        printf("short fired=%d, error=%d\n", timer_fired, timer_error);
+        return 6;
+    }
+    timer_run(&timer, 100000);
+
+    //step 1ms, every timer fires on its own tick
+    timer_fired = 0;
+    for (i = 0; i < 1000; i++)
+    {
+        swTimer_add(&timer, 1 + swoole_system_random(0, 300000), 0, NULL);
+    }
+    for (i = 0; i <= 300000 && timer.num > 0; i++)
+    {
+        timer_run(&timer, 1);
+    }
+    if (timer_fired != 1000 || timer_error > 0 || timer.num != 0)
+    {
+        printf("step fired=%d, error=%d, num=%d\n", timer_fired, timer_error, timer.num);
+        return 7;
+    }
+
+    swTimer_free(&timer);
+    printf("timer wheel test OK\n");
+    return 0;
+}
+
+static double timer_bench(int backend)
+{
+    swTimer timer;
+    swTimer_node **nodes = malloc(sizeof(swTimer_node *) * TIMER_TEST_NUM);
+    struct timeval start, end;
+    int i;
+
+    timer_init(&timer, backend);
+    swTimer_select(&timer);
+    gettimeofday(&start, NULL);
+
+    //add -> cancel half -> expire the rest, like connection timeouts
+    for (i = 0; i < TIMER_TEST_NUM; i++)
+    {
+        nodes[i] = swTimer_add(&timer, 1000 + (i % 60000), 0, NULL);
+    }
+    for (i = 0; i < TIMER_TEST_NUM; i += 2)
+    {
+        swTimer_del(&timer, nodes[i]);
+    }
+    while (timer.num > 0)
+    {
+        timer_run(&timer, 50);
+    }
+
+    gettimeofday(&end, NULL);
+    swTimer_free(&timer);
+    free(nodes);
+    return (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_usec - start.tv_usec) / 1000.0;
+}
+
+swUnitTest(timer_test2)
+{
+    timer_fired = 0;
+    printf("heap:  %d timers, %.2f ms\n", TIMER_TEST_NUM, timer_bench(SW_TIMER_BACKEND_HEAP));
+    timer_fired = 0;
+    printf("wheel: %d timers, %.2f ms\n", TIMER_TEST_NUM, timer_bench(SW_TIMER_BACKEND_WHEEL));
+    return 0;
+}
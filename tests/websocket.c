@@ -29,4 +29,152 @@ swUnitTest(ws_test1)
 	}
 	return 0;
 }
-#endif
\ No newline at end of file
+#endif
+#include "swoole.h"
+#include "tests.h"
+#include "websocket.h"
+
+static void ws_fill(char *data, size_t length)
+{
+	size_t i;
+	for (i = 0; i < length; i++)
+	{
+		data[i] = (char) (i * 31 + 7);
+	}
+}
+
+static void ws_mask_bytewise(char *data, size_t length, char *mask_key)
+{
+	size_t i;
+	for (i = 0; i < length; i++)
+	{
+		data[i] ^= mask_key[i % SW_WEBSOCKET_MASK_LEN];
+	}
+}
+
+swUnitTest(ws_test2)
+{
+	char src[1024], expect[1024], out[1024 + 1];
+	char key[SW_WEBSOCKET_MASK_LEN];
+	int i, length, offset;
+
+	ws_fill(src, sizeof(src));
+	swWebSocket_mask_key(key);
+
+	//every length and misaligned start
+	for (offset = 0; offset < 4; offset++)
+	{
+		for (length = 0; length < sizeof(src) - offset; length++)
+		{
+			memcpy(expect, src + offset, length);
+			ws_mask_bytewise(expect, length, key);
+			swWebSocket_mask(out + 1, src + offset, length, key);
+			if (memcmp(out + 1, expect, length) != 0)
+			{
+				printf("mask error, offset=%d, length=%d\n", offset, length);
+				return 1;
+			}
+		}
+	}
+
+	//encode + decode
+	swString *buffer = swString_new(8192);
+	size_t sizes[] = {0, 1, 125, 126, 65535, 65536, 100000};
+	char *payload = sw_malloc(100000);
+	ws_fill(payload, 100000);
+
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		swWebSocket_frame frame;
+		swString_clear(buffer);
+		swWebSocket_encode(buffer, payload, sizes[i], WEBSOCKET_OPCODE_BINARY_FRAME, 1, 1);
+		if (swWebSocket_get_package_length(NULL, NULL, buffer->str, buffer->length) != buffer->length)
+		{
+			printf("package length error, size=%ld\n", sizes[i]);
+			return 2;
+		}
+		swWebSocket_decode(&frame, buffer);
+		if (frame.payload_length != sizes[i] || memcmp(frame.payload, payload, sizes[i]) != 0)
+		{
+			printf("decode error, size=%ld\n", sizes[i]);
+			return 3;
+		}
+	}
+
+	//encode_iov gives the same frame without copying the payload
+	char header[SW_WEBSOCKET_HEADER_MAX_LEN];
+	struct iovec iov[2];
+	char *masked = sw_malloc(100000);
+	int iovcnt;
+
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		swString_clear(buffer);
+		swWebSocket_encode(buffer, payload, sizes[i], WEBSOCKET_OPCODE_TEXT_FRAME, 1, 0);
+		iovcnt = swWebSocket_encode_iov(iov, header, payload, sizes[i], WEBSOCKET_OPCODE_TEXT_FRAME, 1, 0);
+		if (iovcnt != (sizes[i] > 0 ? 2 : 1) || iov[0].iov_len + sizes[i] != buffer->length
+				|| memcmp(buffer->str, header, iov[0].iov_len) != 0
+				|| (iovcnt == 2 && (iov[1].iov_base != payload || iov[1].iov_len != sizes[i])))
+		{
+			printf("encode_iov error, size=%ld\n", sizes[i]);
+			return 4;
+		}
+
+		//masked in place
+		swWebSocket_frame frame;
+		memcpy(masked, payload, sizes[i]);
+		iovcnt = swWebSocket_encode_iov(iov, header, masked, sizes[i], WEBSOCKET_OPCODE_BINARY_FRAME, 1, 1);
+		swString_clear(buffer);
+		swString_append_ptr(buffer, header, iov[0].iov_len);
+		swString_append_ptr(buffer, masked, sizes[i]);
+		swWebSocket_decode(&frame, buffer);
+		if (frame.payload_length != sizes[i] || memcmp(frame.payload, payload, sizes[i]) != 0)
+		{
+			printf("encode_iov mask error, size=%ld\n", sizes[i]);
+			return 5;
+		}
+	}
+
+	sw_free(masked);
+	sw_free(payload);
+	swString_free(buffer);
+	printf("websocket mask test OK\n");
+	return 0;
+}
+
+swUnitTest(ws_test3)
+{
+	size_t sizes[] = {1024, 4096, 16384, 65536};
+	char *data = sw_malloc(65536);
+	char key[SW_WEBSOCKET_MASK_LEN];
+	struct timeval start, end;
+	int i, j, n;
+
+	ws_fill(data, 65536);
+	swWebSocket_mask_key(key);
+
+	for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		n = (64 * 1024 * 1024) / sizes[i];
+
+		gettimeofday(&start, NULL);
+		for (j = 0; j < n; j++)
+		{
+			ws_mask_bytewise(data, sizes[i], key);
+		}
+		gettimeofday(&end, NULL);
+		double t1 = (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_usec - start.tv_usec) / 1000.0;
+
+		gettimeofday(&start, NULL);
+		for (j = 0; j < n; j++)
+		{
+			swWebSocket_mask(data, data, sizes[i], key);
+		}
+		gettimeofday(&end, NULL);
+		double t2 = (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_usec - start.tv_usec) / 1000.0;
+
+		printf("frame=%ld, 64M bytes: bytewise %.2f ms, swWebSocket_mask %.2f ms\n", sizes[i], t1, t2);
+	}
+	sw_free(data);
+	return 0;
+}